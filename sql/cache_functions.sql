@@ -6,3 +6,7 @@ RETURNS TRIGGER AS '$libdir/timescaledb', 'invalidate_relcache_trigger' LANGUAGE
 -- This function is only used for debugging
 CREATE OR REPLACE FUNCTION _timescaledb_cache.invalidate_relcache(catalog_table REGCLASS)
 RETURNS BOOLEAN AS '$libdir/timescaledb', 'invalidate_relcache' LANGUAGE C STRICT;
+
+-- This function is only used for testing
+CREATE OR REPLACE FUNCTION _timescaledb_cache.hypertable_cache_has_entry(hypertable REGCLASS)
+RETURNS BOOLEAN AS '$libdir/timescaledb', 'hypertable_cache_has_entry' LANGUAGE C STRICT;
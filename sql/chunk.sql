@@ -11,3 +11,10 @@ CREATE OR REPLACE FUNCTION _timescaledb_internal.dimension_calculate_default_ran
     OUT range_start       BIGINT,
     OUT range_end         BIGINT)
     AS '$libdir/timescaledb', 'dimension_calculate_closed_range_default' LANGUAGE C STABLE;
+
+-- Pre-create the chunks for the next interval of a hypertable's open
+-- dimension if the current interval has been filled beyond
+-- timescaledb.chunk_precreate_threshold. Returns the number of chunks
+-- created.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.precreate_chunks(hypertable REGCLASS) RETURNS INTEGER
+AS '$libdir/timescaledb', 'precreate_chunks' LANGUAGE C VOLATILE STRICT;
@@ -328,3 +328,151 @@ CREATE OR REPLACE FUNCTION show_tablespaces(hypertable REGCLASS)
 $BODY$
     SELECT * FROM _timescaledb_internal.show_tablespaces(hypertable);
 $BODY$;
+
+-- Compress a chunk, optionally segmenting the compressed rows by the given
+-- columns. Returns the table that holds the compressed data.
+CREATE OR REPLACE FUNCTION compress_chunk(chunk REGCLASS, segment_by NAME[] = NULL)
+       RETURNS REGCLASS
+AS '$libdir/timescaledb', 'compress_chunk' LANGUAGE C VOLATILE;
+
+-- Move the rows of a compressed chunk back into the chunk
+CREATE OR REPLACE FUNCTION decompress_chunk(chunk REGCLASS)
+       RETURNS VOID
+AS '$libdir/timescaledb', 'decompress_chunk' LANGUAGE C VOLATILE STRICT;
+
+-- Enable chunk skipping on a column. Keeps the range of values of the column
+-- in each chunk, which allows excluding chunks in queries that restrict the
+-- column, even if it is not a dimension of the hypertable. With bloom_filter,
+-- a Bloom filter of the column's values is also kept for each chunk, which
+-- allows excluding chunks on equality restrictions of any hashable column.
+CREATE OR REPLACE FUNCTION enable_chunk_skipping(
+    hypertable   REGCLASS,
+    column_name  NAME,
+    bloom_filter BOOLEAN = FALSE
+)
+       RETURNS VOID
+AS '$libdir/timescaledb', 'enable_chunk_skipping' LANGUAGE C VOLATILE STRICT;
+
+-- Disable chunk skipping on a column and remove the column's chunk stats
+CREATE OR REPLACE FUNCTION disable_chunk_skipping(hypertable REGCLASS, column_name NAME)
+       RETURNS VOID
+AS '$libdir/timescaledb', 'disable_chunk_skipping' LANGUAGE C VOLATILE STRICT;
+
+-- Turn a view into a continuous aggregate. The view must aggregate a
+-- hypertable grouped by time_bucket() on the hypertable's time column. The
+-- aggregated rows are materialized into a separate hypertable on refresh and
+-- the view returns the materialized rows along with the aggregates of the
+-- rows that were not materialized yet.
+CREATE OR REPLACE FUNCTION create_continuous_aggregate(view REGCLASS)
+       RETURNS VOID
+AS '$libdir/timescaledb', 'create_continuous_aggregate' LANGUAGE C VOLATILE STRICT;
+
+-- Refresh a continuous aggregate. Recomputes the materialized buckets that
+-- were modified since the last refresh and materializes the buckets up to
+-- the bucket of the greatest time value of the hypertable.
+CREATE OR REPLACE FUNCTION refresh_continuous_aggregate(continuous_aggregate REGCLASS)
+       RETURNS VOID
+AS '$libdir/timescaledb', 'refresh_continuous_aggregate' LANGUAGE C VOLATILE STRICT;
+
+-- Set the target size of the chunks of a hypertable. With a target size,
+-- the chunk time interval is adapted whenever a chunk is created, based on
+-- the size and fill of recent chunks. The size can be 'off', 'estimate' to
+-- derive it from shared_buffers, or a size like '1GB'. Returns the target
+-- size in bytes.
+CREATE OR REPLACE FUNCTION set_adaptive_chunk_sizing(
+    main_table        REGCLASS,
+    chunk_target_size TEXT = 'estimate'
+)
+       RETURNS BIGINT
+AS '$libdir/timescaledb', 'chunk_adaptive_set' LANGUAGE C VOLATILE STRICT;
+
+-- Reorder a chunk by an index, like CLUSTER, but without blocking reads
+-- until the reordered chunk is swapped in. Writes to the chunk are blocked
+-- throughout. The index can be an index of the chunk or of its hypertable.
+-- Without an index, the chunk's clustered index is used.
+CREATE OR REPLACE FUNCTION reorder_chunk(
+    chunk   REGCLASS,
+    index   REGCLASS = NULL,
+    verbose BOOLEAN = FALSE
+)
+       RETURNS VOID
+AS '$libdir/timescaledb', 'reorder_chunk' LANGUAGE C VOLATILE;
+
+-- Merge chunks that are adjacent along the time dimension into one chunk,
+-- e.g., to reduce the number of chunks of a hypertable whose chunk time
+-- interval was too small. The chunks must be in the same partition of all
+-- other dimensions. The rows are copied into the chunk with the lowest time
+-- range, whose range is extended, and the other chunks are dropped. Reads
+-- are only blocked at the end of the merge. Returns the merged chunk.
+CREATE OR REPLACE FUNCTION merge_chunks(chunks REGCLASS[])
+       RETURNS REGCLASS
+AS '$libdir/timescaledb', 'chunk_merge_chunks' LANGUAGE C VOLATILE STRICT;
+
+-- Add a policy that drops the chunks of a hypertable that are older than
+-- older_than. The policy runs as a background job every schedule_interval.
+CREATE OR REPLACE FUNCTION add_drop_chunks_policy(
+    hypertable        REGCLASS,
+    older_than        INTERVAL,
+    schedule_interval INTERVAL = '1 day'
+)
+    RETURNS INTEGER LANGUAGE SQL VOLATILE STRICT AS
+$BODY$
+    SELECT _timescaledb_internal.add_job('drop_chunks', hypertable, schedule_interval, older_than, NULL);
+$BODY$;
+
+-- Add a policy that reorders the chunks of a hypertable by the given index
+-- with reorder_chunk(), once they no longer receive inserts. Each run
+-- reorders the chunks of the most recent completed interval of the time
+-- dimension. The policy runs as a background job every schedule_interval.
+CREATE OR REPLACE FUNCTION add_reorder_policy(
+    hypertable        REGCLASS,
+    index_name        NAME,
+    schedule_interval INTERVAL = '1 day'
+)
+    RETURNS INTEGER LANGUAGE SQL VOLATILE STRICT AS
+$BODY$
+    SELECT _timescaledb_internal.add_job('reorder', hypertable, schedule_interval, NULL, index_name);
+$BODY$;
+
+-- Add a policy that analyzes a hypertable. The policy runs as a background
+-- job every schedule_interval.
+CREATE OR REPLACE FUNCTION add_analyze_policy(
+    hypertable        REGCLASS,
+    schedule_interval INTERVAL = '1 day'
+)
+    RETURNS INTEGER LANGUAGE SQL VOLATILE STRICT AS
+$BODY$
+    SELECT _timescaledb_internal.add_job('analyze', hypertable, schedule_interval, NULL, NULL);
+$BODY$;
+
+-- Add a policy that pre-creates the chunks of the next interval of a
+-- hypertable once the current interval is filled beyond
+-- timescaledb.chunk_precreate_threshold, so that inserts do not pay for
+-- creating them. The policy runs as a background job every
+-- schedule_interval.
+CREATE OR REPLACE FUNCTION add_precreate_chunks_policy(
+    hypertable        REGCLASS,
+    schedule_interval INTERVAL = '1 minute'
+)
+    RETURNS INTEGER LANGUAGE SQL VOLATILE STRICT AS
+$BODY$
+    SELECT _timescaledb_internal.add_job('precreate_chunks', hypertable, schedule_interval, NULL, NULL);
+$BODY$;
+
+-- Change the schedule of a background job. NULL arguments keep the current
+-- setting. A max_runtime of zero means no limit and a max_retries of -1
+-- means retrying failed runs indefinitely.
+CREATE OR REPLACE FUNCTION alter_job_schedule(
+    job_id            INTEGER,
+    schedule_interval INTERVAL = NULL,
+    max_runtime       INTERVAL = NULL,
+    max_retries       INTEGER = NULL,
+    retry_period      INTERVAL = NULL
+)
+       RETURNS VOID
+AS '$libdir/timescaledb', 'bgw_job_alter_schedule' LANGUAGE C VOLATILE;
+
+-- Remove a background job. A running job finishes its current run.
+CREATE OR REPLACE FUNCTION delete_job(job_id INTEGER)
+       RETURNS VOID
+AS '$libdir/timescaledb', 'bgw_job_delete' LANGUAGE C VOLATILE STRICT;
@@ -329,61 +329,7 @@ CREATE OR REPLACE FUNCTION _timescaledb_internal.drop_chunks_impl(
     cascade  BOOLEAN = FALSE,
     truncate_before  BOOLEAN = FALSE
 )
-    RETURNS VOID LANGUAGE PLPGSQL VOLATILE AS
-$BODY$
-DECLARE
-    chunk_row _timescaledb_catalog.chunk;
-    cascade_mod TEXT = '';
-    exist_count INT = 0;
-BEGIN
-    IF older_than_time IS NULL AND table_name IS NULL AND schema_name IS NULL THEN
-        RAISE 'Cannot have all 3 arguments to drop_chunks_older_than be NULL';
-    END IF;
-
-    IF cascade THEN
-        cascade_mod = 'CASCADE';
-    END IF;
-
-    IF table_name IS NOT NULL THEN
-        SELECT COUNT(*)
-        FROM _timescaledb_catalog.hypertable h
-        WHERE (drop_chunks_impl.schema_name IS NULL OR h.schema_name = drop_chunks_impl.schema_name)
-        AND drop_chunks_impl.table_name = h.table_name
-        INTO STRICT exist_count;
-
-        IF exist_count = 0 THEN
-            RAISE 'hypertable % does not exist', drop_chunks_impl.table_name
-            USING ERRCODE = 'IO001';
-        END IF;
-    END IF;
-
-    FOR chunk_row IN SELECT *
-        FROM _timescaledb_catalog.chunk c
-        INNER JOIN _timescaledb_catalog.hypertable h ON (h.id = c.hypertable_id)
-        INNER JOIN _timescaledb_internal.dimension_get_time(h.id) time_dimension ON(true)
-        INNER JOIN _timescaledb_catalog.dimension_slice ds
-            ON (ds.dimension_id = time_dimension.id)
-        INNER JOIN _timescaledb_catalog.chunk_constraint cc
-            ON (cc.dimension_slice_id = ds.id AND cc.chunk_id = c.id)
-        WHERE (older_than_time IS NULL OR ds.range_end <= older_than_time)
-        AND (drop_chunks_impl.schema_name IS NULL OR h.schema_name = drop_chunks_impl.schema_name)
-        AND (drop_chunks_impl.table_name IS NULL OR h.table_name = drop_chunks_impl.table_name)
-    LOOP
-        IF truncate_before THEN
-            EXECUTE format(
-                $$
-                TRUNCATE %I.%I %s
-                $$, chunk_row.schema_name, chunk_row.table_name, cascade_mod
-            );
-        END IF;
-        EXECUTE format(
-                $$
-                DROP TABLE %I.%I %s
-                $$, chunk_row.schema_name, chunk_row.table_name, cascade_mod
-        );
-    END LOOP;
-END
-$BODY$;
+    RETURNS VOID AS '$libdir/timescaledb', 'chunk_drop_chunks' LANGUAGE C VOLATILE;
 
 CREATE OR REPLACE FUNCTION _timescaledb_internal.drop_chunks_type_check(
     given_type REGTYPE,
@@ -589,3 +535,27 @@ AS '$libdir/timescaledb', 'chunk_index_clone' LANGUAGE C VOLATILE STRICT;
 
 CREATE OR REPLACE FUNCTION _timescaledb_internal.chunk_index_replace(chunk_index_oid_old OID, chunk_index_oid_new OID) RETURNS VOID
 AS '$libdir/timescaledb', 'chunk_index_replace' LANGUAGE C VOLATILE STRICT;
+
+-- Get the watermark of a continuous aggregate as a value of the type of
+-- time_type. Buckets below the watermark are read from the materialization.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.cagg_watermark(hypertable_id INTEGER, time_type anyelement)
+    RETURNS anyelement
+AS '$libdir/timescaledb', 'continuous_agg_watermark' LANGUAGE C STABLE;
+
+-- Add a background job for a hypertable. older_than is only valid for
+-- drop_chunks jobs and index_name only for reorder jobs.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.add_job(
+    job_type          NAME,
+    hypertable        REGCLASS,
+    schedule_interval INTERVAL,
+    older_than        INTERVAL,
+    index_name        NAME
+)
+    RETURNS INTEGER
+AS '$libdir/timescaledb', 'bgw_job_add' LANGUAGE C VOLATILE;
+
+-- Run a background job in the current transaction and record the run in the
+-- job's stats
+CREATE OR REPLACE FUNCTION _timescaledb_internal.run_job(job_id INTEGER)
+    RETURNS VOID
+AS '$libdir/timescaledb', 'bgw_job_run' LANGUAGE C VOLATILE STRICT;
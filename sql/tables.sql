@@ -34,6 +34,13 @@
 -- reconfigured, but the new partitioning only affects newly created
 -- chunks.
 --
+-- Adaptive chunk sizing
+------------------------
+-- With a non-zero chunk_target_size (in bytes), the interval of the
+-- first open dimension is adapted whenever a chunk is created, based on
+-- the size and fill of recent chunks, so that chunks approach the target
+-- size.
+--
 CREATE TABLE IF NOT EXISTS _timescaledb_catalog.hypertable (
     id                      SERIAL    PRIMARY KEY,
     schema_name             NAME      NOT NULL CHECK (schema_name != '_timescaledb_catalog'),
@@ -41,6 +48,7 @@ CREATE TABLE IF NOT EXISTS _timescaledb_catalog.hypertable (
     associated_schema_name  NAME      NOT NULL,
     associated_table_prefix NAME      NOT NULL,
     num_dimensions          SMALLINT  NOT NULL CHECK (num_dimensions > 0),
+    chunk_target_size       BIGINT    NOT NULL DEFAULT 0 CHECK (chunk_target_size >= 0),
     UNIQUE (id, schema_name),
     UNIQUE (schema_name, table_name),
     UNIQUE (associated_schema_name, associated_table_prefix)
@@ -144,3 +152,119 @@ CREATE TABLE IF NOT EXISTS _timescaledb_catalog.chunk_index (
 CREATE INDEX IF NOT EXISTS chunk_index_hypertable_id_hypertable_index_name_idx
 ON _timescaledb_catalog.chunk_index(hypertable_id, hypertable_index_name);
 SELECT pg_catalog.pg_extension_config_dump('_timescaledb_catalog.chunk_index', '');
+
+-- A compressed chunk has its rows stored in a separate table, in
+-- batches of column values. The chunk's own table only holds rows
+-- inserted after the chunk was compressed.
+CREATE TABLE IF NOT EXISTS _timescaledb_catalog.compressed_chunk (
+    chunk_id              INTEGER NOT NULL PRIMARY KEY REFERENCES _timescaledb_catalog.chunk(id) ON DELETE CASCADE,
+    schema_name           NAME NOT NULL,
+    table_name            NAME NOT NULL,
+    num_rows              BIGINT NOT NULL,
+    UNIQUE(schema_name, table_name)
+);
+SELECT pg_catalog.pg_extension_config_dump('_timescaledb_catalog.compressed_chunk', '');
+
+-- Columns of a hypertable that have per-chunk min/max stats, and optionally
+-- Bloom filters, that can be used to exclude chunks in queries
+CREATE TABLE IF NOT EXISTS _timescaledb_catalog.hypertable_column_stats (
+    hypertable_id         INTEGER NOT NULL REFERENCES _timescaledb_catalog.hypertable(id) ON DELETE CASCADE,
+    column_name           NAME NOT NULL,
+    bloom_filter          BOOLEAN NOT NULL,
+    PRIMARY KEY(hypertable_id, column_name)
+);
+SELECT pg_catalog.pg_extension_config_dump('_timescaledb_catalog.hypertable_column_stats', '');
+
+-- The range of values and the number of NULLs of a column in a chunk. Values
+-- are stored in the internal (int64) time representation. Stats are updated
+-- in place as rows are inserted and can only grow. A chunk's stats are marked
+-- invalid when they can no longer be maintained, e.g., on an UPDATE of the
+-- column. The Bloom filter, if enabled, holds the hashes of the column's
+-- values in the chunk.
+CREATE TABLE IF NOT EXISTS _timescaledb_catalog.chunk_column_stats (
+    chunk_id              INTEGER NOT NULL REFERENCES _timescaledb_catalog.chunk(id) ON DELETE CASCADE,
+    column_name           NAME NOT NULL,
+    min_value             BIGINT NOT NULL,
+    max_value             BIGINT NOT NULL,
+    null_count            BIGINT NOT NULL,
+    valid                 BOOLEAN NOT NULL,
+    bloom_filter          BYTEA NULL,
+    PRIMARY KEY(chunk_id, column_name)
+);
+-- Bloom filters are updated in place, which requires them to be stored
+-- inline and uncompressed
+ALTER TABLE _timescaledb_catalog.chunk_column_stats ALTER COLUMN bloom_filter SET STORAGE PLAIN;
+SELECT pg_catalog.pg_extension_config_dump('_timescaledb_catalog.chunk_column_stats', '');
+
+-- A continuous aggregate is a view that groups the rows of a raw
+-- hypertable by time_bucket(). The aggregated rows of complete buckets
+-- are materialized into a separate hypertable. Buckets below the
+-- watermark are read from the materialization and the remaining buckets
+-- are computed from the raw hypertable, via the "direct view" that holds
+-- the original view definition. The watermark is stored in the internal
+-- (int64) time representation and nothing is materialized while it is at
+-- the minimum value.
+CREATE TABLE IF NOT EXISTS _timescaledb_catalog.continuous_agg (
+    mat_hypertable_id     INTEGER NOT NULL PRIMARY KEY REFERENCES _timescaledb_catalog.hypertable(id) ON DELETE CASCADE,
+    raw_hypertable_id     INTEGER NOT NULL REFERENCES _timescaledb_catalog.hypertable(id) ON DELETE CASCADE,
+    user_view_schema      NAME NOT NULL,
+    user_view_name        NAME NOT NULL,
+    direct_view_schema    NAME NOT NULL,
+    direct_view_name      NAME NOT NULL,
+    bucket_column_name    NAME NOT NULL,
+    bucket_width          BIGINT NOT NULL,
+    watermark             BIGINT NOT NULL,
+    UNIQUE(user_view_schema, user_view_name)
+);
+CREATE INDEX IF NOT EXISTS continuous_agg_raw_hypertable_id_idx
+ON _timescaledb_catalog.continuous_agg(raw_hypertable_id);
+SELECT pg_catalog.pg_extension_config_dump('_timescaledb_catalog.continuous_agg', '');
+
+-- Ranges of time values (in the internal time representation) of the raw
+-- hypertable that were modified since the continuous aggregate was last
+-- refreshed. Every statement that writes to the raw hypertable adds one
+-- row per continuous aggregate.
+CREATE TABLE IF NOT EXISTS _timescaledb_catalog.continuous_aggs_invalidation_log (
+    materialization_id      INTEGER NOT NULL REFERENCES _timescaledb_catalog.continuous_agg(mat_hypertable_id) ON DELETE CASCADE,
+    lowest_modified_value   BIGINT NOT NULL,
+    greatest_modified_value BIGINT NOT NULL
+);
+CREATE INDEX IF NOT EXISTS continuous_aggs_invalidation_log_idx
+ON _timescaledb_catalog.continuous_aggs_invalidation_log(materialization_id);
+SELECT pg_catalog.pg_extension_config_dump('_timescaledb_catalog.continuous_aggs_invalidation_log', '');
+
+-- Maintenance jobs run by the background job scheduler. Each job runs a
+-- policy (drop_chunks, reorder, analyze or precreate_chunks) on a
+-- hypertable every schedule_interval. A failed job is retried after
+-- retry_period, backing off exponentially, up to max_retries times (-1
+-- means no limit) before waiting for its next scheduled run. A job that
+-- runs longer than max_runtime is terminated (zero means no limit).
+CREATE TABLE IF NOT EXISTS _timescaledb_catalog.bgw_job (
+    id                  SERIAL    NOT NULL PRIMARY KEY,
+    job_type            NAME      NOT NULL CHECK (job_type IN ('drop_chunks', 'reorder', 'analyze', 'precreate_chunks')),
+    hypertable_id       INTEGER   NOT NULL REFERENCES _timescaledb_catalog.hypertable(id) ON DELETE CASCADE,
+    schedule_interval   INTERVAL  NOT NULL CHECK (schedule_interval > INTERVAL '0'),
+    max_runtime         INTERVAL  NOT NULL CHECK (max_runtime >= INTERVAL '0'),
+    max_retries         INTEGER   NOT NULL CHECK (max_retries >= -1),
+    retry_period        INTERVAL  NOT NULL CHECK (retry_period > INTERVAL '0'),
+    older_than          INTERVAL  NULL CHECK ((job_type = 'drop_chunks') = (older_than IS NOT NULL)),
+    index_name          NAME      NULL CHECK ((job_type = 'reorder') = (index_name IS NOT NULL)),
+    UNIQUE(hypertable_id, job_type)
+);
+SELECT pg_catalog.pg_extension_config_dump('_timescaledb_catalog.bgw_job', '');
+SELECT pg_catalog.pg_extension_config_dump(pg_get_serial_sequence('_timescaledb_catalog.bgw_job','id'), '');
+
+-- Run statistics and the next scheduled start of background jobs. Rows are
+-- maintained by the scheduler and the job workers and are not dumped.
+CREATE TABLE IF NOT EXISTS _timescaledb_catalog.bgw_job_stat (
+    job_id                INTEGER     NOT NULL PRIMARY KEY REFERENCES _timescaledb_catalog.bgw_job(id) ON DELETE CASCADE,
+    last_start            TIMESTAMPTZ NOT NULL,
+    last_finish           TIMESTAMPTZ NOT NULL,
+    next_start            TIMESTAMPTZ NOT NULL,
+    last_run_success      BOOLEAN     NOT NULL,
+    total_runs            BIGINT      NOT NULL,
+    total_successes       BIGINT      NOT NULL,
+    total_failures        BIGINT      NOT NULL,
+    total_crashes         BIGINT      NOT NULL,
+    consecutive_failures  INTEGER     NOT NULL
+);
@@ -16,3 +16,7 @@ DROP FUNCTION _timescaledb_internal.chunk_constraint_drop_table_constraint(_time
 -- Dimension functions
 DROP FUNCTION _timescaledb_internal.change_column_type(int, name, regtype);
 DROP FUNCTION _timescaledb_internal.rename_column(int, name, name);
+
+-- Adaptive chunk sizing
+ALTER TABLE _timescaledb_catalog.hypertable
+    ADD COLUMN chunk_target_size BIGINT NOT NULL DEFAULT 0 CHECK (chunk_target_size >= 0);
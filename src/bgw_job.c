@@ -0,0 +1,973 @@
+#include <postgres.h>
+#include <math.h>
+#include <access/heapam.h>
+#include <access/htup_details.h>
+#include <access/xact.h>
+#include <catalog/pg_type.h>
+#include <commands/extension.h>
+#include <executor/spi.h>
+#include <postmaster/bgworker.h>
+#include <storage/ipc.h>
+#include <storage/lmgr.h>
+#include <tcop/tcopprot.h>
+#include <utils/builtins.h>
+#include <utils/lsyscache.h>
+#include <utils/memutils.h>
+#include <utils/rel.h>
+#include <utils/snapmgr.h>
+#include <utils/timestamp.h>
+#include <miscadmin.h>
+#include <pgstat.h>
+
+#include "bgw_job.h"
+#include "catalog.h"
+#include "chunk.h"
+#include "chunk_index.h"
+#include "chunk_precreate.h"
+#include "compat.h"
+#include "dimension.h"
+#include "dimension_slice.h"
+#include "dimension_vector.h"
+#include "errors.h"
+#include "extension.h"
+#include "guc.h"
+#include "hypertable.h"
+#include "hypertable_cache.h"
+#include "reorder.h"
+#include "scanner.h"
+#include "utils.h"
+
+/*
+ * Background jobs.
+ *
+ * A job runs a maintenance policy on a hypertable on a schedule. Jobs are
+ * started by the scheduler (see bgw_scheduler.c), each in its own dynamic
+ * background worker, and run as the owner of the hypertable. The scheduler
+ * records the start of a run in the job's stats and the worker records its
+ * result. A run that fails is retried with exponential backoff.
+ *
+ * The stats of a job are written by the scheduler when it starts or loses
+ * track of a run, by the job's worker when the run ends, and by manual runs
+ * with run_job(). Writers lock the job's stats for the rest of their
+ * transaction before reading them, so that concurrent updates are not lost.
+ * The scheduler never waits for the lock; it skips jobs whose stats are
+ * locked, e.g., by a manual run.
+ */
+
+TS_FUNCTION_INFO_V1(bgw_job_add);
+TS_FUNCTION_INFO_V1(bgw_job_delete);
+TS_FUNCTION_INFO_V1(bgw_job_alter_schedule);
+TS_FUNCTION_INFO_V1(bgw_job_run);
+
+#define BGW_JOB_WORKER_NAME "TimescaleDB background job"
+
+/* Cap on the exponent of the retry backoff */
+#define BGW_JOB_MAX_BACKOFF_EXPONENT 10
+
+static const char *job_type_names[_MAX_JOB_TYPE] = {
+	[JOB_TYPE_DROP_CHUNKS] = "drop_chunks",
+	[JOB_TYPE_REORDER] = "reorder",
+	[JOB_TYPE_ANALYZE] = "analyze",
+	[JOB_TYPE_PRECREATE_CHUNKS] = "precreate_chunks",
+};
+
+static BgwJobType
+bgw_job_type_from_name(const char *name)
+{
+	int			i;
+
+	for (i = 0; i < _MAX_JOB_TYPE; i++)
+		if (strcmp(job_type_names[i], name) == 0)
+			return i;
+
+	ereport(ERROR,
+			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			 errmsg("Invalid job type \"%s\"", name)));
+	pg_unreachable();
+}
+
+static int
+bgw_job_scan(int indexid, ScanKeyData *scankey, int nkeys,
+			 tuple_found_func tuple_found, void *data, LOCKMODE lockmode)
+{
+	Catalog    *catalog = catalog_get();
+	ScannerCtx	scanctx = {
+		.table = catalog->tables[BGW_JOB].id,
+		.index = catalog->tables[BGW_JOB].index_ids[indexid],
+		.scantype = ScannerTypeIndex,
+		.nkeys = nkeys,
+		.scankey = scankey,
+		.tuple_found = tuple_found,
+		.data = data,
+		.lockmode = lockmode,
+		.scandirection = ForwardScanDirection,
+	};
+
+	return scanner_scan(&scanctx);
+}
+
+static int
+bgw_job_scan_by_id(int32 job_id, tuple_found_func tuple_found, void *data, LOCKMODE lockmode)
+{
+	ScanKeyData scankey[1];
+
+	ScanKeyInit(&scankey[0], Anum_bgw_job_pkey_idx_id,
+				BTEqualStrategyNumber, F_INT4EQ, Int32GetDatum(job_id));
+
+	return bgw_job_scan(BGW_JOB_PKEY_IDX, scankey, 1, tuple_found, data, lockmode);
+}
+
+static BgwJob *
+bgw_job_from_tuple(HeapTuple tuple, TupleDesc desc)
+{
+	BgwJob	   *job = palloc0(sizeof(BgwJob));
+	Datum		values[Natts_bgw_job];
+	bool		nulls[Natts_bgw_job];
+
+	heap_deform_tuple(tuple, desc, values, nulls);
+
+	job->fd.id = DatumGetInt32(values[Anum_bgw_job_id - 1]);
+	namecpy(&job->fd.job_type, DatumGetName(values[Anum_bgw_job_job_type - 1]));
+	job->fd.hypertable_id = DatumGetInt32(values[Anum_bgw_job_hypertable_id - 1]);
+	memcpy(&job->fd.schedule_interval, DatumGetIntervalP(values[Anum_bgw_job_schedule_interval - 1]), sizeof(Interval));
+	memcpy(&job->fd.max_runtime, DatumGetIntervalP(values[Anum_bgw_job_max_runtime - 1]), sizeof(Interval));
+	job->fd.max_retries = DatumGetInt32(values[Anum_bgw_job_max_retries - 1]);
+	memcpy(&job->fd.retry_period, DatumGetIntervalP(values[Anum_bgw_job_retry_period - 1]), sizeof(Interval));
+
+	if (!nulls[Anum_bgw_job_older_than - 1])
+		memcpy(&job->fd.older_than, DatumGetIntervalP(values[Anum_bgw_job_older_than - 1]), sizeof(Interval));
+
+	if (!nulls[Anum_bgw_job_index_name - 1])
+		namecpy(&job->fd.index_name, DatumGetName(values[Anum_bgw_job_index_name - 1]));
+
+	job->type = bgw_job_type_from_name(NameStr(job->fd.job_type));
+
+	return job;
+}
+
+static bool
+bgw_job_tuple_append(TupleInfo *ti, void *data)
+{
+	List	  **jobs = data;
+
+	*jobs = lappend(*jobs, bgw_job_from_tuple(ti->tuple, ti->desc));
+
+	return true;
+}
+
+/*
+ * Get all jobs, in job ID order.
+ */
+List *
+bgw_job_get_all(void)
+{
+	List	   *jobs = NIL;
+
+	bgw_job_scan(BGW_JOB_PKEY_IDX, NULL, 0, bgw_job_tuple_append, &jobs, AccessShareLock);
+
+	return jobs;
+}
+
+static bool
+bgw_job_tuple_found(TupleInfo *ti, void *data)
+{
+	BgwJob	  **job = data;
+
+	*job = bgw_job_from_tuple(ti->tuple, ti->desc);
+
+	return false;
+}
+
+BgwJob *
+bgw_job_find(int32 job_id)
+{
+	BgwJob	   *job = NULL;
+
+	bgw_job_scan_by_id(job_id, bgw_job_tuple_found, &job, AccessShareLock);
+
+	return job;
+}
+
+static void
+bgw_job_insert(FormData_bgw_job *fd, bool has_older_than, bool has_index_name)
+{
+	Catalog    *catalog = catalog_get();
+	Relation	rel = heap_open(catalog->tables[BGW_JOB].id, RowExclusiveLock);
+	Datum		values[Natts_bgw_job];
+	bool		nulls[Natts_bgw_job] = {false};
+	CatalogSecurityContext sec_ctx;
+
+	values[Anum_bgw_job_id - 1] = Int32GetDatum(fd->id);
+	values[Anum_bgw_job_job_type - 1] = NameGetDatum(&fd->job_type);
+	values[Anum_bgw_job_hypertable_id - 1] = Int32GetDatum(fd->hypertable_id);
+	values[Anum_bgw_job_schedule_interval - 1] = IntervalPGetDatum(&fd->schedule_interval);
+	values[Anum_bgw_job_max_runtime - 1] = IntervalPGetDatum(&fd->max_runtime);
+	values[Anum_bgw_job_max_retries - 1] = Int32GetDatum(fd->max_retries);
+	values[Anum_bgw_job_retry_period - 1] = IntervalPGetDatum(&fd->retry_period);
+	values[Anum_bgw_job_older_than - 1] = IntervalPGetDatum(&fd->older_than);
+	values[Anum_bgw_job_index_name - 1] = NameGetDatum(&fd->index_name);
+	nulls[Anum_bgw_job_older_than - 1] = !has_older_than;
+	nulls[Anum_bgw_job_index_name - 1] = !has_index_name;
+
+	catalog_become_owner(catalog, &sec_ctx);
+	catalog_insert_values(rel, RelationGetDescr(rel), values, nulls);
+	catalog_restore_user(&sec_ctx);
+
+	heap_close(rel, RowExclusiveLock);
+}
+
+static int
+bgw_job_stat_scan_by_job_id(int32 job_id, tuple_found_func tuple_found,
+							void *data, LOCKMODE lockmode)
+{
+	Catalog    *catalog = catalog_get();
+	ScanKeyData scankey[1];
+	ScannerCtx	scanctx = {
+		.table = catalog->tables[BGW_JOB_STAT].id,
+		.index = catalog->tables[BGW_JOB_STAT].index_ids[BGW_JOB_STAT_PKEY_IDX],
+		.scantype = ScannerTypeIndex,
+		.nkeys = 1,
+		.scankey = scankey,
+		.tuple_found = tuple_found,
+		.data = data,
+		.lockmode = lockmode,
+		.scandirection = ForwardScanDirection,
+	};
+
+	ScanKeyInit(&scankey[0], Anum_bgw_job_stat_pkey_idx_job_id,
+				BTEqualStrategyNumber, F_INT4EQ, Int32GetDatum(job_id));
+
+	return scanner_scan(&scanctx);
+}
+
+/*
+ * Lock the stats of a job until the end of the transaction.
+ */
+static void
+bgw_job_stat_lock(int32 job_id)
+{
+	LockDatabaseObject(catalog_get()->tables[BGW_JOB_STAT].id, job_id, 0, ExclusiveLock);
+}
+
+/*
+ * Lock the stats of a job until the end of the transaction, unless they are
+ * locked by another transaction.
+ *
+ * Returns true if the lock was acquired.
+ */
+bool
+bgw_job_stat_try_lock(int32 job_id)
+{
+	return ConditionalLockDatabaseObject(catalog_get()->tables[BGW_JOB_STAT].id,
+										 job_id, 0, ExclusiveLock);
+}
+
+static bool
+bgw_job_stat_tuple_found(TupleInfo *ti, void *data)
+{
+	memcpy(data, GETSTRUCT(ti->tuple), sizeof(FormData_bgw_job_stat));
+
+	return false;
+}
+
+bool
+bgw_job_stat_find(int32 job_id, FormData_bgw_job_stat *stat)
+{
+	return bgw_job_stat_scan_by_job_id(job_id, bgw_job_stat_tuple_found,
+									   stat, AccessShareLock) > 0;
+}
+
+static bool
+bgw_job_stat_tuple_update(TupleInfo *ti, void *data)
+{
+	HeapTuple	tuple = heap_copytuple(ti->tuple);
+	CatalogSecurityContext sec_ctx;
+
+	memcpy(GETSTRUCT(tuple), data, sizeof(FormData_bgw_job_stat));
+
+	catalog_become_owner(catalog_get(), &sec_ctx);
+	catalog_update(ti->scanrel, tuple);
+	catalog_restore_user(&sec_ctx);
+
+	heap_freetuple(tuple);
+
+	return false;
+}
+
+static void
+bgw_job_stat_insert(FormData_bgw_job_stat *fd)
+{
+	Catalog    *catalog = catalog_get();
+	Relation	rel = heap_open(catalog->tables[BGW_JOB_STAT].id, RowExclusiveLock);
+	Datum		values[Natts_bgw_job_stat];
+	bool		nulls[Natts_bgw_job_stat] = {false};
+	CatalogSecurityContext sec_ctx;
+
+	values[Anum_bgw_job_stat_job_id - 1] = Int32GetDatum(fd->job_id);
+	values[Anum_bgw_job_stat_last_start - 1] = TimestampTzGetDatum(fd->last_start);
+	values[Anum_bgw_job_stat_last_finish - 1] = TimestampTzGetDatum(fd->last_finish);
+	values[Anum_bgw_job_stat_next_start - 1] = TimestampTzGetDatum(fd->next_start);
+	values[Anum_bgw_job_stat_last_run_success - 1] = BoolGetDatum(fd->last_run_success);
+	values[Anum_bgw_job_stat_total_runs - 1] = Int64GetDatum(fd->total_runs);
+	values[Anum_bgw_job_stat_total_successes - 1] = Int64GetDatum(fd->total_successes);
+	values[Anum_bgw_job_stat_total_failures - 1] = Int64GetDatum(fd->total_failures);
+	values[Anum_bgw_job_stat_total_crashes - 1] = Int64GetDatum(fd->total_crashes);
+	values[Anum_bgw_job_stat_consecutive_failures - 1] = Int32GetDatum(fd->consecutive_failures);
+
+	catalog_become_owner(catalog, &sec_ctx);
+	catalog_insert_values(rel, RelationGetDescr(rel), values, nulls);
+	catalog_restore_user(&sec_ctx);
+
+	heap_close(rel, RowExclusiveLock);
+}
+
+static bool
+bgw_job_tuple_delete(TupleInfo *ti, void *data)
+{
+	CatalogSecurityContext sec_ctx;
+
+	catalog_become_owner(catalog_get(), &sec_ctx);
+	catalog_delete(ti->scanrel, ti->tuple);
+	catalog_restore_user(&sec_ctx);
+
+	return false;
+}
+
+static TimestampTz
+timestamptz_add_interval(TimestampTz timestamp, Interval *interval)
+{
+	return DatumGetTimestampTz(DirectFunctionCall2(timestamptz_pl_interval,
+												   TimestampTzGetDatum(timestamp),
+												   IntervalPGetDatum(interval)));
+}
+
+/*
+ * Record the start of a run. Until the run ends, the job's next start is one
+ * schedule interval after this start.
+ */
+void
+bgw_job_stat_mark_start(BgwJob *job, TimestampTz start)
+{
+	FormData_bgw_job_stat stat;
+	bool		found;
+
+	bgw_job_stat_lock(job->fd.id);
+	found = bgw_job_stat_find(job->fd.id, &stat);
+
+	if (!found)
+	{
+		memset(&stat, 0, sizeof(stat));
+		stat.job_id = job->fd.id;
+		stat.last_finish = DT_NOBEGIN;
+		stat.last_run_success = true;
+	}
+
+	stat.last_start = start;
+	stat.next_start = timestamptz_add_interval(start, &job->fd.schedule_interval);
+	stat.total_runs++;
+
+	if (found)
+		bgw_job_stat_scan_by_job_id(job->fd.id, bgw_job_stat_tuple_update,
+									&stat, RowExclusiveLock);
+	else
+		bgw_job_stat_insert(&stat);
+}
+
+/*
+ * Get the time at which a run started at the given time exceeds the job's
+ * maximum runtime. A zero maximum runtime means no limit.
+ */
+TimestampTz
+bgw_job_timeout_at(BgwJob *job, TimestampTz start)
+{
+	Interval	zero = {0};
+
+	if (DatumGetBool(DirectFunctionCall2(interval_eq,
+										 IntervalPGetDatum(&job->fd.max_runtime),
+										 IntervalPGetDatum(&zero))))
+		return DT_NOEND;
+
+	return timestamptz_add_interval(start, &job->fd.max_runtime);
+}
+
+/*
+ * Get the start of the retry of a failed run. The retry period doubles with
+ * every consecutive failure, but retries are never later than the next
+ * scheduled run would be.
+ */
+static TimestampTz
+bgw_job_retry_start(BgwJob *job, TimestampTz finish, int32 consecutive_failures)
+{
+	int			exponent = Min(consecutive_failures - 1, BGW_JOB_MAX_BACKOFF_EXPONENT);
+	Interval   *backoff;
+	TimestampTz retry;
+	TimestampTz scheduled;
+
+	backoff = DatumGetIntervalP(DirectFunctionCall2(interval_mul,
+											IntervalPGetDatum(&job->fd.retry_period),
+									Float8GetDatum(ldexp(1.0, exponent))));
+	retry = timestamptz_add_interval(finish, backoff);
+	scheduled = timestamptz_add_interval(finish, &job->fd.schedule_interval);
+
+	return Min(retry, scheduled);
+}
+
+/*
+ * Record the result of a run and schedule the next run.
+ */
+void
+bgw_job_stat_mark_end(BgwJob *job, BgwJobResult result)
+{
+	FormData_bgw_job_stat stat;
+
+	bgw_job_stat_lock(job->fd.id);
+
+	if (!bgw_job_stat_find(job->fd.id, &stat))
+		return;
+
+	stat.last_finish = GetCurrentTimestamp();
+	stat.last_run_success = (result == JOB_SUCCESS);
+
+	switch (result)
+	{
+		case JOB_SUCCESS:
+			stat.total_successes++;
+			stat.consecutive_failures = 0;
+			break;
+		case JOB_FAILURE:
+			stat.total_failures++;
+			stat.consecutive_failures++;
+			break;
+		case JOB_CRASH:
+			stat.total_crashes++;
+			stat.consecutive_failures++;
+			break;
+	}
+
+	if (result != JOB_SUCCESS &&
+		(job->fd.max_retries < 0 || stat.consecutive_failures <= job->fd.max_retries))
+		stat.next_start = Min(stat.next_start,
+							  bgw_job_retry_start(job, stat.last_finish,
+												  stat.consecutive_failures));
+
+	bgw_job_stat_scan_by_job_id(job->fd.id, bgw_job_stat_tuple_update,
+								&stat, RowExclusiveLock);
+}
+
+static void
+bgw_job_spi_execute(const char *command, int nargs, Oid *argtypes,
+					Datum *args, int expected_result)
+{
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "Could not connect to SPI");
+
+	if (SPI_execute_with_args(command, nargs, argtypes, args, NULL, false, 0) != expected_result)
+		elog(ERROR, "Could not execute \"%s\"", command);
+
+	SPI_finish();
+}
+
+static void
+bgw_job_drop_chunks(BgwJob *job, Hypertable *ht)
+{
+	Oid			ext_schema = get_extension_schema(get_extension_oid(EXTENSION_NAME, false));
+	Oid			argtypes[3] = {INTERVALOID, NAMEOID, NAMEOID};
+	Datum		args[3] = {
+		IntervalPGetDatum(&job->fd.older_than),
+		NameGetDatum(&ht->fd.table_name),
+		NameGetDatum(&ht->fd.schema_name),
+	};
+
+	bgw_job_spi_execute(psprintf("SELECT %s.drop_chunks($1, $2, $3)",
+								 quote_identifier(get_namespace_name(ext_schema))),
+						3, argtypes, args, SPI_OK_SELECT);
+}
+
+static void
+bgw_job_analyze(Hypertable *ht)
+{
+	bgw_job_spi_execute(psprintf("ANALYZE %s",
+								 quote_qualified_identifier(NameStr(ht->fd.schema_name),
+															NameStr(ht->fd.table_name))),
+						0, NULL, NULL, SPI_OK_UTILITY);
+}
+
+static void
+bgw_job_precreate_chunks(Hypertable *ht)
+{
+	int			num_created = chunk_precreate(ht, guc_chunk_precreate_threshold);
+
+	if (num_created > 0)
+		elog(DEBUG1, "Pre-created %d chunk(s) for hypertable \"%s\"",
+			 num_created, NameStr(ht->fd.table_name));
+}
+
+/*
+ * Get the greatest value of the open dimension's column in the hypertable,
+ * in the internal time representation.
+ *
+ * Returns false if the hypertable is empty.
+ */
+static bool
+bgw_job_get_max_time(Hypertable *ht, Dimension *dim, int64 *max_time)
+{
+	Datum		value;
+	bool		isnull;
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "Could not connect to SPI");
+
+	if (SPI_execute(psprintf("SELECT max(%s) FROM %s",
+							 quote_identifier(NameStr(dim->fd.column_name)),
+							 quote_qualified_identifier(NameStr(ht->fd.schema_name),
+														NameStr(ht->fd.table_name))),
+					true, 0) != SPI_OK_SELECT)
+		elog(ERROR, "Could not get the maximum time of \"%s\"", NameStr(ht->fd.table_name));
+
+	value = SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 1, &isnull);
+
+	if (!isnull)
+		*max_time = time_value_to_internal(value, dim->fd.column_type);
+
+	SPI_finish();
+
+	return !isnull;
+}
+
+/*
+ * Get the chunks to reorder, as mappings from chunk indexes to the job's
+ * index. Only the chunks of the most recent completed interval of the open
+ * dimension are reordered, since older chunks were reordered by earlier
+ * runs and the chunks of the latest interval still receive inserts. Chunks
+ * that were already reordered are skipped.
+ *
+ * The most recent completed interval is the newest slice that ends at or
+ * before the hypertable's greatest time value and still has chunks. Slices
+ * of pre-created chunks past that value and slices left without chunks by
+ * merges are thus not picked.
+ */
+static List *
+bgw_job_reorder_get_mappings(BgwJob *job, Hypertable *ht, MemoryContext mcxt)
+{
+	Oid			index_relid = get_relname_relid(NameStr(job->fd.index_name),
+									get_rel_namespace(ht->main_table_relid));
+	Dimension  *dim = hyperspace_get_dimension(ht->space, DIMENSION_TYPE_OPEN, 0);
+	DimensionVec *slices;
+	List	   *chunk_relids = NIL;
+	List	   *mappings = NIL;
+	MemoryContext old;
+	ListCell   *lc;
+	int64		max_time;
+	int			i;
+
+	if (!OidIsValid(index_relid))
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_OBJECT),
+				 errmsg("Index \"%s\" does not exist", NameStr(job->fd.index_name))));
+
+	if (!bgw_job_get_max_time(ht, dim, &max_time))
+		return NIL;
+
+	slices = dimension_slice_scan_ending_before(dim->fd.id, max_time, 0);
+
+	for (i = slices->num_slices - 1; i >= 0 && chunk_relids == NIL; i--)
+		chunk_relids = chunk_find_all_relids_in_slice(ht->space, slices->slices[i]);
+
+	if (chunk_relids == NIL)
+		return NIL;
+
+	foreach(lc, chunk_index_get_mappings(ht, index_relid))
+	{
+		ChunkIndexMapping *cim = lfirst(lc);
+
+		if (list_member_oid(chunk_relids, cim->chunkoid) &&
+			!reorder_index_is_clustered(cim->indexoid))
+		{
+			/* The mappings need to survive the per-chunk transactions */
+			old = MemoryContextSwitchTo(mcxt);
+			mappings = lappend(mappings, memcpy(palloc(sizeof(ChunkIndexMapping)),
+												cim, sizeof(ChunkIndexMapping)));
+			MemoryContextSwitchTo(old);
+		}
+	}
+
+	return mappings;
+}
+
+/*
+ * Reorder the given chunks on their index corresponding to the job's index.
+ * At the top level, each chunk is reordered in its own transaction so that
+ * the lock on a chunk is only held while that chunk is reordered.
+ */
+static void
+bgw_job_reorder(List *mappings, bool is_top_level)
+{
+	ListCell   *lc;
+
+	foreach(lc, mappings)
+	{
+		ChunkIndexMapping *cim = lfirst(lc);
+
+		if (is_top_level)
+		{
+			PopActiveSnapshot();
+			CommitTransactionCommand();
+			StartTransactionCommand();
+			PushActiveSnapshot(GetTransactionSnapshot());
+		}
+
+		reorder_rel(cim->chunkoid, cim->indexoid, false);
+	}
+}
+
+/*
+ * Run a job. Must be called in a transaction with an active snapshot. At the
+ * top level, the job may commit and start new transactions.
+ *
+ * Returns false if the job's hypertable no longer exists.
+ */
+bool
+bgw_job_execute(BgwJob *job, bool is_top_level)
+{
+	Cache	   *hcache = hypertable_cache_pin();
+	Hypertable *ht = hypertable_cache_get_entry_by_id(hcache, job->fd.hypertable_id);
+	MemoryContext mcxt = NULL;
+	List	   *mappings = NIL;
+
+	if (NULL == ht)
+	{
+		cache_release(hcache);
+		return false;
+	}
+
+	switch (job->type)
+	{
+		case JOB_TYPE_DROP_CHUNKS:
+			bgw_job_drop_chunks(job, ht);
+			break;
+		case JOB_TYPE_ANALYZE:
+			bgw_job_analyze(ht);
+			break;
+		case JOB_TYPE_PRECREATE_CHUNKS:
+			bgw_job_precreate_chunks(ht);
+			break;
+		case JOB_TYPE_REORDER:
+			mcxt = AllocSetContextCreate(TopMemoryContext,
+										 "Job reorder",
+										 ALLOCSET_DEFAULT_SIZES);
+			mappings = bgw_job_reorder_get_mappings(job, ht, mcxt);
+			break;
+		default:
+			elog(ERROR, "Unknown job type %d", job->type);
+	}
+
+	cache_release(hcache);
+
+	if (NULL != mcxt)
+	{
+		bgw_job_reorder(mappings, is_top_level);
+		MemoryContextDelete(mcxt);
+	}
+
+	return true;
+}
+
+/*
+ * Main function of a job's background worker. The job ID is passed as the
+ * worker's argument.
+ */
+void
+bgw_job_main(Datum arg)
+{
+	int32		job_id = DatumGetInt32(arg);
+	BgwJob	   *job = NULL;
+	Oid			owner = InvalidOid;
+	BgwJobResult result = JOB_FAILURE;
+	MemoryContext oldcontext;
+
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	BackgroundWorkerInitializeConnection(guc_bgw_scheduler_database, NULL);
+
+	StartTransactionCommand();
+	PushActiveSnapshot(GetTransactionSnapshot());
+
+	if (extension_is_loaded())
+	{
+		BgwJob	   *found = bgw_job_find(job_id);
+
+		if (NULL != found)
+		{
+			Oid			relid = hypertable_id_to_relid(found->fd.hypertable_id);
+			Relation	rel = OidIsValid(relid) ? relation_open(relid, AccessShareLock) : NULL;
+
+			if (NULL != rel)
+			{
+				owner = rel->rd_rel->relowner;
+				relation_close(rel, AccessShareLock);
+			}
+
+			oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+			job = palloc(sizeof(BgwJob));
+			memcpy(job, found, sizeof(BgwJob));
+			MemoryContextSwitchTo(oldcontext);
+		}
+	}
+
+	PopActiveSnapshot();
+	CommitTransactionCommand();
+
+	if (NULL == job)
+		proc_exit(0);
+
+	pgstat_report_appname(BGW_JOB_WORKER_NAME);
+
+	SetCurrentStatementStartTimestamp();
+	StartTransactionCommand();
+	PushActiveSnapshot(GetTransactionSnapshot());
+	pgstat_report_activity(STATE_RUNNING, NameStr(job->fd.job_type));
+
+	PG_TRY();
+	{
+		Oid			saved_uid;
+		int			sec_ctx;
+
+		/* Run the job as the owner of the hypertable */
+		GetUserIdAndSecContext(&saved_uid, &sec_ctx);
+
+		if (OidIsValid(owner))
+			SetUserIdAndSecContext(owner, sec_ctx | SECURITY_LOCAL_USERID_CHANGE);
+
+		if (bgw_job_execute(job, true))
+			result = JOB_SUCCESS;
+
+		SetUserIdAndSecContext(saved_uid, sec_ctx);
+
+		PopActiveSnapshot();
+		CommitTransactionCommand();
+	}
+	PG_CATCH();
+	{
+		/* Report the error and record the failure in a new transaction */
+		HOLD_INTERRUPTS();
+		EmitErrorReport();
+		AbortCurrentTransaction();
+		FlushErrorState();
+		RESUME_INTERRUPTS();
+		result = JOB_FAILURE;
+	}
+	PG_END_TRY();
+
+	StartTransactionCommand();
+	PushActiveSnapshot(GetTransactionSnapshot());
+	bgw_job_stat_mark_end(job, result);
+	PopActiveSnapshot();
+	CommitTransactionCommand();
+
+	pgstat_report_activity(STATE_IDLE, NULL);
+
+	proc_exit(0);
+}
+
+static Hypertable *
+bgw_job_get_hypertable(Cache *hcache, Oid relid)
+{
+	Hypertable *ht;
+
+	hypertable_permissions_check(relid, GetUserId());
+
+	ht = hypertable_cache_get_entry(hcache, relid);
+
+	if (NULL == ht)
+		ereport(ERROR,
+				(errcode(ERRCODE_IO_HYPERTABLE_NOT_EXIST),
+				 errmsg("Table \"%s\" is not a hypertable", get_rel_name(relid))));
+
+	return ht;
+}
+
+static void
+bgw_job_permissions_check(BgwJob *job)
+{
+	Oid			relid = hypertable_id_to_relid(job->fd.hypertable_id);
+
+	if (OidIsValid(relid))
+		hypertable_permissions_check(relid, GetUserId());
+}
+
+static BgwJob *
+bgw_job_get_for_update(int32 job_id)
+{
+	BgwJob	   *job = bgw_job_find(job_id);
+
+	if (NULL == job)
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_OBJECT),
+				 errmsg("Job %d does not exist", job_id)));
+
+	bgw_job_permissions_check(job);
+
+	return job;
+}
+
+/*
+ * Add a job for a hypertable.
+ *
+ * The older_than argument is only valid for drop_chunks jobs and the
+ * index_name argument only for reorder jobs.
+ */
+Datum
+bgw_job_add(PG_FUNCTION_ARGS)
+{
+	Cache	   *hcache;
+	Hypertable *ht;
+	FormData_bgw_job fd;
+	Interval	retry_period = {.time = 5 * USECS_PER_MINUTE};
+
+	if (PG_ARGISNULL(0) || PG_ARGISNULL(1) || PG_ARGISNULL(2))
+		ereport(ERROR,
+				(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+				 errmsg("Job type, hypertable and schedule interval cannot be NULL")));
+
+	memset(&fd, 0, sizeof(fd));
+	namecpy(&fd.job_type, PG_GETARG_NAME(0));
+	memcpy(&fd.schedule_interval, PG_GETARG_INTERVAL_P(2), sizeof(Interval));
+	memcpy(&fd.retry_period, &retry_period, sizeof(Interval));
+	fd.max_retries = -1;
+
+	switch (bgw_job_type_from_name(NameStr(fd.job_type)))
+	{
+		case JOB_TYPE_DROP_CHUNKS:
+			if (PG_ARGISNULL(3))
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("A drop_chunks job requires an older_than interval")));
+			memcpy(&fd.older_than, PG_GETARG_INTERVAL_P(3), sizeof(Interval));
+			break;
+		case JOB_TYPE_REORDER:
+			if (PG_ARGISNULL(4))
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("A reorder job requires an index")));
+			namecpy(&fd.index_name, PG_GETARG_NAME(4));
+			break;
+		default:
+			break;
+	}
+
+	hcache = hypertable_cache_pin();
+	ht = bgw_job_get_hypertable(hcache, PG_GETARG_OID(1));
+	fd.hypertable_id = ht->fd.id;
+
+	if (!PG_ARGISNULL(4) &&
+		!OidIsValid(get_relname_relid(NameStr(fd.index_name),
+									  get_rel_namespace(ht->main_table_relid))))
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_OBJECT),
+				 errmsg("Index \"%s\" does not exist", NameStr(fd.index_name))));
+
+	cache_release(hcache);
+
+	fd.id = catalog_table_next_seq_id(catalog_get(), BGW_JOB);
+	bgw_job_insert(&fd, !PG_ARGISNULL(3), !PG_ARGISNULL(4));
+
+	PG_RETURN_INT32(fd.id);
+}
+
+/*
+ * Delete a job and its stats. A running job finishes its current run.
+ */
+Datum
+bgw_job_delete(PG_FUNCTION_ARGS)
+{
+	int32		job_id = PG_GETARG_INT32(0);
+
+	bgw_job_get_for_update(job_id);
+
+	bgw_job_stat_scan_by_job_id(job_id, bgw_job_tuple_delete, NULL, RowExclusiveLock);
+	bgw_job_scan_by_id(job_id, bgw_job_tuple_delete, NULL, RowExclusiveLock);
+
+	PG_RETURN_VOID();
+}
+
+static bool
+bgw_job_tuple_update_schedule(TupleInfo *ti, void *data)
+{
+	FormData_bgw_job *update = data;
+	Datum		values[Natts_bgw_job];
+	bool		nulls[Natts_bgw_job];
+	bool		repl[Natts_bgw_job] = {false};
+	HeapTuple	tuple;
+	CatalogSecurityContext sec_ctx;
+
+	values[Anum_bgw_job_schedule_interval - 1] = IntervalPGetDatum(&update->schedule_interval);
+	values[Anum_bgw_job_max_runtime - 1] = IntervalPGetDatum(&update->max_runtime);
+	values[Anum_bgw_job_max_retries - 1] = Int32GetDatum(update->max_retries);
+	values[Anum_bgw_job_retry_period - 1] = IntervalPGetDatum(&update->retry_period);
+	nulls[Anum_bgw_job_schedule_interval - 1] = false;
+	nulls[Anum_bgw_job_max_runtime - 1] = false;
+	nulls[Anum_bgw_job_max_retries - 1] = false;
+	nulls[Anum_bgw_job_retry_period - 1] = false;
+	repl[Anum_bgw_job_schedule_interval - 1] = true;
+	repl[Anum_bgw_job_max_runtime - 1] = true;
+	repl[Anum_bgw_job_max_retries - 1] = true;
+	repl[Anum_bgw_job_retry_period - 1] = true;
+
+	tuple = heap_modify_tuple(ti->tuple, ti->desc, values, nulls, repl);
+
+	catalog_become_owner(catalog_get(), &sec_ctx);
+	catalog_update(ti->scanrel, tuple);
+	catalog_restore_user(&sec_ctx);
+
+	heap_freetuple(tuple);
+
+	return false;
+}
+
+/*
+ * Change the schedule of a job. NULL arguments keep the current setting.
+ */
+Datum
+bgw_job_alter_schedule(PG_FUNCTION_ARGS)
+{
+	BgwJob	   *job;
+
+	if (PG_ARGISNULL(0))
+		ereport(ERROR,
+				(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+				 errmsg("Job ID cannot be NULL")));
+
+	job = bgw_job_get_for_update(PG_GETARG_INT32(0));
+
+	if (!PG_ARGISNULL(1))
+		memcpy(&job->fd.schedule_interval, PG_GETARG_INTERVAL_P(1), sizeof(Interval));
+	if (!PG_ARGISNULL(2))
+		memcpy(&job->fd.max_runtime, PG_GETARG_INTERVAL_P(2), sizeof(Interval));
+	if (!PG_ARGISNULL(3))
+		job->fd.max_retries = PG_GETARG_INT32(3);
+	if (!PG_ARGISNULL(4))
+		memcpy(&job->fd.retry_period, PG_GETARG_INTERVAL_P(4), sizeof(Interval));
+
+	bgw_job_scan_by_id(job->fd.id, bgw_job_tuple_update_schedule, &job->fd, RowExclusiveLock);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Run a job in the current transaction and record the run in the job's
+ * stats, as if it had been started by the scheduler. Errors are raised
+ * rather than recorded as failures. The job's stats stay locked until the
+ * end of the transaction, so the scheduler does not start the job meanwhile.
+ */
+Datum
+bgw_job_run(PG_FUNCTION_ARGS)
+{
+	BgwJob	   *job = bgw_job_get_for_update(PG_GETARG_INT32(0));
+
+	bgw_job_stat_mark_start(job, GetCurrentTimestamp());
+	bgw_job_execute(job, false);
+	bgw_job_stat_mark_end(job, JOB_SUCCESS);
+
+	PG_RETURN_VOID();
+}
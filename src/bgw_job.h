@@ -0,0 +1,45 @@
+#ifndef TIMESCALEDB_BGW_JOB_H
+#define TIMESCALEDB_BGW_JOB_H
+
+#include <postgres.h>
+#include <fmgr.h>
+#include <nodes/pg_list.h>
+
+#include "catalog.h"
+
+typedef enum BgwJobType
+{
+	JOB_TYPE_DROP_CHUNKS = 0,
+	JOB_TYPE_REORDER,
+	JOB_TYPE_ANALYZE,
+	JOB_TYPE_PRECREATE_CHUNKS,
+	_MAX_JOB_TYPE,
+} BgwJobType;
+
+typedef struct BgwJob
+{
+	FormData_bgw_job fd;
+	BgwJobType type;
+} BgwJob;
+
+typedef enum BgwJobResult
+{
+	JOB_SUCCESS,
+	JOB_FAILURE,
+	/* The job's worker exited without recording the result of the run */
+	JOB_CRASH,
+} BgwJobResult;
+
+extern List *bgw_job_get_all(void);
+extern BgwJob *bgw_job_find(int32 job_id);
+
+extern bool bgw_job_stat_find(int32 job_id, FormData_bgw_job_stat *stat);
+extern bool bgw_job_stat_try_lock(int32 job_id);
+extern void bgw_job_stat_mark_start(BgwJob *job, TimestampTz start);
+extern void bgw_job_stat_mark_end(BgwJob *job, BgwJobResult result);
+extern TimestampTz bgw_job_timeout_at(BgwJob *job, TimestampTz start);
+
+extern bool bgw_job_execute(BgwJob *job, bool is_top_level);
+extern PGDLLEXPORT void bgw_job_main(Datum arg);
+
+#endif   /* TIMESCALEDB_BGW_JOB_H */
@@ -0,0 +1,510 @@
+#include <postgres.h>
+#include <access/xact.h>
+#include <postmaster/bgworker.h>
+#include <storage/ipc.h>
+#include <storage/latch.h>
+#include <storage/proc.h>
+#include <utils/guc.h>
+#include <utils/memutils.h>
+#include <utils/snapmgr.h>
+#include <utils/timestamp.h>
+#include <miscadmin.h>
+#include <pgstat.h>
+
+#include "bgw_job.h"
+#include "bgw_scheduler.h"
+#include "compat.h"
+#include "extension.h"
+#include "guc.h"
+
+/*
+ * Background job scheduler.
+ *
+ * The scheduler is a background worker that starts the jobs in the bgw_job
+ * catalog table when they are due, each in its own dynamic background
+ * worker, and keeps track of the workers it started. At most
+ * timescaledb.max_background_jobs jobs run at the same time; when more jobs
+ * are due, the ones that have been due the longest start first.
+ *
+ * A job whose worker exits without recording a result has crashed, as has a
+ * job that was running when the scheduler itself was restarted. A job that
+ * exceeds its maximum runtime is terminated.
+ */
+
+#define BGW_SCHEDULER_WORKER_NAME "TimescaleDB background job scheduler"
+#define BGW_JOB_WORKER_NAME "TimescaleDB background job"
+
+/* Longest time the scheduler sleeps before checking for new jobs */
+#define BGW_SCHEDULER_MAX_NAPTIME_MS 60000L
+
+typedef struct ScheduledJob
+{
+	BgwJob		job;
+	TimestampTz next_start;
+	/* Only set while the job is running */
+	TimestampTz timeout_at;
+	BackgroundWorkerHandle *handle;
+	bool		terminated;
+} ScheduledJob;
+
+static volatile sig_atomic_t got_sighup = false;
+static volatile sig_atomic_t got_sigterm = false;
+
+/* Jobs started by this scheduler that are still running */
+static List *running_jobs = NIL;
+static MemoryContext scheduler_mcxt = NULL;
+
+static ScheduledJob *
+running_job_find(int32 job_id)
+{
+	ListCell   *lc;
+
+	foreach(lc, running_jobs)
+	{
+		ScheduledJob *sjob = lfirst(lc);
+
+		if (sjob->job.fd.id == job_id)
+			return sjob;
+	}
+
+	return NULL;
+}
+
+/*
+ * Record a crash for a job whose run has not finished. Called in a
+ * transaction. Nothing is recorded if the job's stats are locked by a manual
+ * run, which records its own result.
+ */
+static void
+bgw_scheduler_mark_crash_if_unfinished(BgwJob *job)
+{
+	FormData_bgw_job_stat stat;
+
+	if (!bgw_job_stat_try_lock(job->fd.id))
+		return;
+
+	if (bgw_job_stat_find(job->fd.id, &stat) && stat.last_finish < stat.last_start)
+	{
+		ereport(LOG,
+				(errmsg("Background job %d exited without recording its result",
+						job->fd.id)));
+		bgw_job_stat_mark_end(job, JOB_CRASH);
+	}
+}
+
+/*
+ * Check on the running jobs. Jobs whose workers have exited are forgotten
+ * and jobs that exceed their maximum runtime are terminated.
+ */
+static void
+bgw_scheduler_check_running(TimestampTz now)
+{
+	List	   *stopped = NIL;
+	ListCell   *lc;
+
+	foreach(lc, running_jobs)
+	{
+		ScheduledJob *sjob = lfirst(lc);
+		pid_t		pid;
+
+		if (GetBackgroundWorkerPid(sjob->handle, &pid) == BGWH_STOPPED)
+			stopped = lappend(stopped, sjob);
+		else if (!sjob->terminated && now >= sjob->timeout_at)
+		{
+			ereport(LOG,
+					(errmsg("Terminating background job %d after exceeding its maximum runtime",
+							sjob->job.fd.id)));
+			TerminateBackgroundWorker(sjob->handle);
+			sjob->terminated = true;
+		}
+	}
+
+	if (stopped == NIL)
+		return;
+
+	StartTransactionCommand();
+	PushActiveSnapshot(GetTransactionSnapshot());
+
+	foreach(lc, stopped)
+	{
+		ScheduledJob *sjob = lfirst(lc);
+
+		if (extension_is_loaded())
+			bgw_scheduler_mark_crash_if_unfinished(&sjob->job);
+
+		running_jobs = list_delete_ptr(running_jobs, sjob);
+		pfree(sjob->handle);
+		pfree(sjob);
+	}
+
+	PopActiveSnapshot();
+	CommitTransactionCommand();
+
+	list_free(stopped);
+}
+
+static int
+scheduled_job_cmp(const void *left, const void *right)
+{
+	const ScheduledJob *l = *((ScheduledJob * const *) left);
+	const ScheduledJob *r = *((ScheduledJob * const *) right);
+
+	if (l->next_start < r->next_start)
+		return -1;
+	if (l->next_start > r->next_start)
+		return 1;
+
+	return l->job.fd.id - r->job.fd.id;
+}
+
+/*
+ * Get the jobs that are not running, ordered by the time they are due. Jobs
+ * that appear to be running without a worker of this scheduler, e.g., after
+ * a restart of the scheduler, are recorded as crashed. Jobs whose stats are
+ * locked by another transaction, e.g., a manual run, are skipped; the stats
+ * of the other jobs stay locked until the end of the transaction.
+ */
+static List *
+bgw_scheduler_get_idle_jobs(void)
+{
+	List	   *jobs;
+	List	   *idle = NIL;
+	ScheduledJob **sorted;
+	ListCell   *lc;
+	int			i = 0;
+
+	jobs = bgw_job_get_all();
+
+	foreach(lc, jobs)
+	{
+		BgwJob	   *job = lfirst(lc);
+		ScheduledJob *sjob;
+		FormData_bgw_job_stat stat;
+
+		if (NULL != running_job_find(job->fd.id) || !bgw_job_stat_try_lock(job->fd.id))
+			continue;
+
+		sjob = palloc0(sizeof(ScheduledJob));
+		memcpy(&sjob->job, job, sizeof(BgwJob));
+
+		if (bgw_job_stat_find(job->fd.id, &stat))
+		{
+			if (stat.last_finish < stat.last_start)
+			{
+				bgw_scheduler_mark_crash_if_unfinished(job);
+				bgw_job_stat_find(job->fd.id, &stat);
+			}
+			sjob->next_start = stat.next_start;
+		}
+		else
+			sjob->next_start = DT_NOBEGIN;
+
+		idle = lappend(idle, sjob);
+	}
+
+	if (list_length(idle) < 2)
+		return idle;
+
+	sorted = palloc(sizeof(ScheduledJob *) * list_length(idle));
+
+	foreach(lc, idle)
+		sorted[i++] = lfirst(lc);
+
+	qsort(sorted, i, sizeof(ScheduledJob *), scheduled_job_cmp);
+
+	list_free(idle);
+	idle = NIL;
+
+	while (i > 0)
+		idle = lcons(sorted[--i], idle);
+
+	return idle;
+}
+
+static BackgroundWorkerHandle *
+bgw_scheduler_register_job_worker(BgwJob *job)
+{
+	BackgroundWorker worker;
+	BackgroundWorkerHandle *handle;
+
+	memset(&worker, 0, sizeof(worker));
+	worker.bgw_flags = BGWORKER_SHMEM_ACCESS | BGWORKER_BACKEND_DATABASE_CONNECTION;
+	worker.bgw_start_time = BgWorkerStart_RecoveryFinished;
+	worker.bgw_restart_time = BGW_NEVER_RESTART;
+	worker.bgw_notify_pid = MyProcPid;
+	worker.bgw_main_arg = Int32GetDatum(job->fd.id);
+	snprintf(worker.bgw_name, BGW_MAXLEN, BGW_JOB_WORKER_NAME " %d", job->fd.id);
+	snprintf(worker.bgw_library_name, BGW_MAXLEN, EXTENSION_NAME);
+	snprintf(worker.bgw_function_name, BGW_MAXLEN, "bgw_job_main");
+
+	if (!RegisterDynamicBackgroundWorker(&worker, &handle))
+		return NULL;
+
+	return handle;
+}
+
+/*
+ * Start the jobs that are due, as long as there are free job slots.
+ *
+ * Returns the time at which the next idle job is due.
+ */
+static TimestampTz
+bgw_scheduler_start_jobs(MemoryContext loop_mcxt)
+{
+	TimestampTz now = GetCurrentTimestamp();
+	TimestampTz next_wakeup = DT_NOEND;
+	List	   *to_start = NIL;
+	List	   *failed = NIL;
+	ListCell   *lc;
+	MemoryContext old;
+	int			slots = guc_max_background_jobs - list_length(running_jobs);
+
+	SetCurrentStatementStartTimestamp();
+	StartTransactionCommand();
+	PushActiveSnapshot(GetTransactionSnapshot());
+	pgstat_report_activity(STATE_RUNNING, BGW_SCHEDULER_WORKER_NAME);
+
+	if (extension_is_loaded())
+	{
+		List	   *idle;
+
+		old = MemoryContextSwitchTo(loop_mcxt);
+		idle = bgw_scheduler_get_idle_jobs();
+		MemoryContextSwitchTo(old);
+
+		foreach(lc, idle)
+		{
+			ScheduledJob *sjob = lfirst(lc);
+
+			if (sjob->next_start <= now)
+			{
+				/*
+				 * Without a free slot, the job waits until a running job
+				 * exits, which sets the latch
+				 */
+				if (slots <= 0)
+					continue;
+
+				/* The start needs to be committed before the worker runs */
+				bgw_job_stat_mark_start(&sjob->job, now);
+				sjob->timeout_at = bgw_job_timeout_at(&sjob->job, now);
+				old = MemoryContextSwitchTo(loop_mcxt);
+				to_start = lappend(to_start, sjob);
+				MemoryContextSwitchTo(old);
+				slots--;
+			}
+			else if (sjob->next_start < next_wakeup)
+				next_wakeup = sjob->next_start;
+		}
+	}
+
+	PopActiveSnapshot();
+	CommitTransactionCommand();
+
+	foreach(lc, to_start)
+	{
+		ScheduledJob *sjob = lfirst(lc);
+		BackgroundWorkerHandle *handle = bgw_scheduler_register_job_worker(&sjob->job);
+		ScheduledJob *running;
+
+		if (NULL == handle)
+		{
+			ereport(LOG,
+					(errmsg("Could not start background job %d: no free background worker slots",
+							sjob->job.fd.id)));
+			failed = lappend(failed, sjob);
+			continue;
+		}
+
+		old = MemoryContextSwitchTo(scheduler_mcxt);
+		running = palloc(sizeof(ScheduledJob));
+		memcpy(running, sjob, sizeof(ScheduledJob));
+		running->handle = handle;
+		running->terminated = false;
+		running_jobs = lappend(running_jobs, running);
+		MemoryContextSwitchTo(old);
+	}
+
+	if (failed != NIL)
+	{
+		StartTransactionCommand();
+		PushActiveSnapshot(GetTransactionSnapshot());
+
+		foreach(lc, failed)
+		{
+			ScheduledJob *sjob = lfirst(lc);
+
+			if (bgw_job_stat_try_lock(sjob->job.fd.id))
+				bgw_job_stat_mark_end(&sjob->job, JOB_FAILURE);
+		}
+
+		PopActiveSnapshot();
+		CommitTransactionCommand();
+
+		/* Retries are scheduled from the stats on the next round */
+		next_wakeup = now;
+	}
+
+	pgstat_report_activity(STATE_IDLE, NULL);
+
+	return next_wakeup;
+}
+
+/*
+ * Get the time to sleep until the next wakeup, including the timeouts of
+ * running jobs, in milliseconds.
+ */
+static long
+bgw_scheduler_naptime(TimestampTz next_wakeup)
+{
+	TimestampTz now = GetCurrentTimestamp();
+	ListCell   *lc;
+	long		secs;
+	int			usecs;
+	long		naptime;
+
+	foreach(lc, running_jobs)
+	{
+		ScheduledJob *sjob = lfirst(lc);
+
+		if (!sjob->terminated && sjob->timeout_at < next_wakeup)
+			next_wakeup = sjob->timeout_at;
+	}
+
+	if (next_wakeup <= now)
+		return 0;
+
+	TimestampDifference(now, next_wakeup, &secs, &usecs);
+
+	if (secs >= BGW_SCHEDULER_MAX_NAPTIME_MS / 1000)
+		return BGW_SCHEDULER_MAX_NAPTIME_MS;
+
+	/* Round up so that the job is due when the scheduler wakes up */
+	naptime = secs * 1000L + (usecs + 999) / 1000;
+
+	return naptime;
+}
+
+static void
+bgw_scheduler_sighup(SIGNAL_ARGS)
+{
+	int			save_errno = errno;
+
+	got_sighup = true;
+	SetLatch(MyLatch);
+	errno = save_errno;
+}
+
+static void
+bgw_scheduler_sigterm(SIGNAL_ARGS)
+{
+	int			save_errno = errno;
+
+	got_sigterm = true;
+	SetLatch(MyLatch);
+	errno = save_errno;
+}
+
+void
+bgw_scheduler_main(Datum arg)
+{
+	MemoryContext loop_mcxt;
+
+	pqsignal(SIGHUP, bgw_scheduler_sighup);
+	pqsignal(SIGTERM, bgw_scheduler_sigterm);
+	BackgroundWorkerUnblockSignals();
+
+	BackgroundWorkerInitializeConnection(guc_bgw_scheduler_database, NULL);
+
+	scheduler_mcxt = AllocSetContextCreate(TopMemoryContext,
+										   "Background job scheduler",
+										   ALLOCSET_DEFAULT_SIZES);
+	loop_mcxt = AllocSetContextCreate(scheduler_mcxt,
+									  "Background job scheduler loop",
+									  ALLOCSET_DEFAULT_SIZES);
+
+	while (!got_sigterm)
+	{
+		TimestampTz next_wakeup;
+		int			rc;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (got_sighup)
+		{
+			got_sighup = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		/*
+		 * An error in one round, e.g., a lock timeout or a concurrently
+		 * dropped extension, must not take down the scheduler and lose
+		 * track of the running jobs. The round is retried after the maximum
+		 * naptime.
+		 */
+		PG_TRY();
+		{
+			bgw_scheduler_check_running(GetCurrentTimestamp());
+			next_wakeup = bgw_scheduler_start_jobs(loop_mcxt);
+		}
+		PG_CATCH();
+		{
+			HOLD_INTERRUPTS();
+			EmitErrorReport();
+			AbortCurrentTransaction();
+			FlushErrorState();
+			RESUME_INTERRUPTS();
+			pgstat_report_activity(STATE_IDLE, NULL);
+			next_wakeup = DT_NOEND;
+		}
+		PG_END_TRY();
+
+		MemoryContextReset(loop_mcxt);
+
+		/* The latch is also set when one of the job workers exits */
+		rc = WaitLatch(MyLatch,
+					   WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+					   bgw_scheduler_naptime(next_wakeup)
+#if PG10
+					   ,PG_WAIT_EXTENSION
+#endif
+			);
+		ResetLatch(MyLatch);
+
+		if (rc & WL_POSTMASTER_DEATH)
+			proc_exit(1);
+	}
+
+	proc_exit(0);
+}
+
+void
+_bgw_scheduler_init(void)
+{
+	BackgroundWorker worker;
+
+	/*
+	 * The scheduler can only be registered when preloaded and it needs to
+	 * know which database to connect to.
+	 */
+	if (!process_shared_preload_libraries_in_progress ||
+		NULL == guc_bgw_scheduler_database ||
+		guc_bgw_scheduler_database[0] == '\0')
+		return;
+
+	memset(&worker, 0, sizeof(worker));
+	worker.bgw_flags = BGWORKER_SHMEM_ACCESS | BGWORKER_BACKEND_DATABASE_CONNECTION;
+	worker.bgw_start_time = BgWorkerStart_RecoveryFinished;
+	worker.bgw_restart_time = 60;
+	worker.bgw_notify_pid = 0;
+	snprintf(worker.bgw_name, BGW_MAXLEN, BGW_SCHEDULER_WORKER_NAME);
+	snprintf(worker.bgw_library_name, BGW_MAXLEN, EXTENSION_NAME);
+	snprintf(worker.bgw_function_name, BGW_MAXLEN, "bgw_scheduler_main");
+
+	RegisterBackgroundWorker(&worker);
+}
+
+void
+_bgw_scheduler_fini(void)
+{
+}
@@ -0,0 +1,12 @@
+#ifndef TIMESCALEDB_BGW_SCHEDULER_H
+#define TIMESCALEDB_BGW_SCHEDULER_H
+
+#include <postgres.h>
+#include <fmgr.h>
+
+extern PGDLLEXPORT void bgw_scheduler_main(Datum arg);
+
+extern void _bgw_scheduler_init(void);
+extern void _bgw_scheduler_fini(void);
+
+#endif   /* TIMESCALEDB_BGW_SCHEDULER_H */
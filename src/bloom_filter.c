@@ -0,0 +1,99 @@
+#include <postgres.h>
+#include <access/hash.h>
+
+#include "bloom_filter.h"
+
+/*
+ * A Bloom filter over 32-bit hash values. The bit positions of a value are
+ * derived from its hash via double hashing, i.e., position i is
+ * h1 + i * h2, where h2 is a rehash of h1. The number of bits is taken from
+ * the size of the filter, so filters of different sizes can coexist.
+ */
+
+static inline uint32
+bloom_filter_num_bits(bytea *filter)
+{
+	return VARSIZE_ANY_EXHDR(filter) * BITS_PER_BYTE;
+}
+
+static inline uint32
+bloom_filter_position(bytea *filter, uint32 hash, int i)
+{
+	/* Make h2 odd, so that the positions do not repeat too early */
+	uint32		h2 = DatumGetUInt32(hash_uint32(hash)) | 1;
+
+	return (hash + i * h2) % bloom_filter_num_bits(filter);
+}
+
+bytea *
+bloom_filter_create(void)
+{
+	bytea	   *filter = palloc0(VARHDRSZ + BLOOM_FILTER_NUM_BYTES);
+
+	SET_VARSIZE(filter, VARHDRSZ + BLOOM_FILTER_NUM_BYTES);
+
+	return filter;
+}
+
+void
+bloom_filter_add(bytea *filter, uint32 hash)
+{
+	uint8	   *bits = (uint8 *) VARDATA_ANY(filter);
+	int			i;
+
+	for (i = 0; i < BLOOM_FILTER_NUM_HASHES; i++)
+	{
+		uint32		pos = bloom_filter_position(filter, hash, i);
+
+		bits[pos / BITS_PER_BYTE] |= 1 << (pos % BITS_PER_BYTE);
+	}
+}
+
+/*
+ * Check if a hash value might have been added to the filter. False positives
+ * are possible, false negatives are not.
+ */
+bool
+bloom_filter_contains(bytea *filter, uint32 hash)
+{
+	uint8	   *bits = (uint8 *) VARDATA_ANY(filter);
+	int			i;
+
+	for (i = 0; i < BLOOM_FILTER_NUM_HASHES; i++)
+	{
+		uint32		pos = bloom_filter_position(filter, hash, i);
+
+		if ((bits[pos / BITS_PER_BYTE] & (1 << (pos % BITS_PER_BYTE))) == 0)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Add the values of the src filter to the dst filter. Both filters must have
+ * the same size. Returns true if dst changed.
+ */
+bool
+bloom_filter_merge(bytea *dst, bytea *src)
+{
+	uint8	   *dst_bits = (uint8 *) VARDATA_ANY(dst);
+	uint8	   *src_bits = (uint8 *) VARDATA_ANY(src);
+	Size		size = VARSIZE_ANY_EXHDR(dst);
+	bool		changed = false;
+	Size		i;
+
+	if (VARSIZE_ANY_EXHDR(src) != size)
+		elog(ERROR, "cannot merge Bloom filters of different sizes");
+
+	for (i = 0; i < size; i++)
+	{
+		if ((dst_bits[i] | src_bits[i]) != dst_bits[i])
+		{
+			dst_bits[i] |= src_bits[i];
+			changed = true;
+		}
+	}
+
+	return changed;
+}
@@ -0,0 +1,20 @@
+#ifndef TIMESCALEDB_BLOOM_FILTER_H
+#define TIMESCALEDB_BLOOM_FILTER_H
+
+#include <postgres.h>
+
+/*
+ * Size of a chunk's Bloom filter. The filter is stored inline in a catalog
+ * tuple, so it must fit on a page. With 32768 bits and four hash functions,
+ * the false positive rate is about 1% for 3500 distinct values and 10% for
+ * 7500 distinct values.
+ */
+#define BLOOM_FILTER_NUM_BYTES 4096
+#define BLOOM_FILTER_NUM_HASHES 4
+
+extern bytea *bloom_filter_create(void);
+extern void bloom_filter_add(bytea *filter, uint32 hash);
+extern bool bloom_filter_contains(bytea *filter, uint32 hash);
+extern bool bloom_filter_merge(bytea *dst, bytea *src);
+
+#endif   /* TIMESCALEDB_BLOOM_FILTER_H */
@@ -8,7 +8,9 @@
 #include <miscadmin.h>
 
 #include "catalog.h"
+#include "chunk_column_stats.h"
 #include "compat.h"
+#include "compress_chunk.h"
 #include "extension.h"
 #include "hypertable_cache.h"
 
@@ -38,6 +40,15 @@
  * (e.g., when replacing a negative hypertable entry with a positive one). Note,
  * also, that INSERTS can taint the cache if the transaction that did the INSERT
  * fails. This is why we also need to invalidate caches on transaction failure.
+ *
+ * Changes to chunk metadata (chunks, chunk constraints and dimension slices)
+ * made via the catalog API only affect a single hypertable, so they do not go
+ * through the dummy tables. Instead, they invalidate the relcache entry of the
+ * hypertable's main table, which evicts only that hypertable from our cache.
+ * PostgreSQL also invalidates the main table's relcache entry whenever a child
+ * table (chunk) is added to or removed from it, or the table is altered, so
+ * such changes evict the hypertable as well. Only changes to hypertables and
+ * dimensions invalidate the caches of all hypertables.
  */
 
 void		_cache_invalidate_init(void);
@@ -56,6 +67,8 @@ cache_invalidate_callback(Datum arg, Oid relid)
 	if (extension_invalidate(relid))
 	{
 		hypertable_cache_invalidate_callback();
+		compressed_chunk_cache_invalidate();
+		chunk_column_stats_cache_invalidate();
 		return;
 	}
 
@@ -64,8 +77,23 @@ cache_invalidate_callback(Datum arg, Oid relid)
 
 	catalog = catalog_get();
 
-	if (relid == catalog_get_cache_proxy_id(catalog, CACHE_TYPE_HYPERTABLE))
+	/*
+	 * An invalid relid means that all relcache entries are invalidated (e.g.,
+	 * on invalidation queue overflow), so we need to flush everything.
+	 * Otherwise, the invalidation might target a hypertable's main table (e.g.,
+	 * when a chunk is added or dropped), in which case only that hypertable's
+	 * cache entry is invalidated. This is cheap for relations that are not in
+	 * the cache.
+	 */
+	if (!OidIsValid(relid) ||
+		relid == catalog_get_cache_proxy_id(catalog, CACHE_TYPE_HYPERTABLE))
+	{
 		hypertable_cache_invalidate_callback();
+		compressed_chunk_cache_invalidate();
+		chunk_column_stats_cache_invalidate();
+	}
+	else
+		hypertable_cache_invalidate_entry(relid);
 }
 
 static inline CmdType
@@ -10,6 +10,7 @@
 #include <access/htup_details.h>
 #include <miscadmin.h>
 #include <commands/dbcommands.h>
+#include <commands/extension.h>
 #include <commands/sequence.h>
 #include <access/xact.h>
 
@@ -29,6 +30,13 @@ static const char *catalog_table_names[_MAX_CATALOG_TABLES + 1] = {
 	[CHUNK_CONSTRAINT] = CHUNK_CONSTRAINT_TABLE_NAME,
 	[CHUNK_INDEX] = CHUNK_INDEX_TABLE_NAME,
 	[TABLESPACE] = TABLESPACE_TABLE_NAME,
+	[COMPRESSED_CHUNK] = COMPRESSED_CHUNK_TABLE_NAME,
+	[HYPERTABLE_COLUMN_STATS] = HYPERTABLE_COLUMN_STATS_TABLE_NAME,
+	[CHUNK_COLUMN_STATS] = CHUNK_COLUMN_STATS_TABLE_NAME,
+	[CONTINUOUS_AGG] = CONTINUOUS_AGG_TABLE_NAME,
+	[CONTINUOUS_AGGS_INVALIDATION_LOG] = CONTINUOUS_AGGS_INVALIDATION_LOG_TABLE_NAME,
+	[BGW_JOB] = BGW_JOB_TABLE_NAME,
+	[BGW_JOB_STAT] = BGW_JOB_STAT_TABLE_NAME,
 	[_MAX_CATALOG_TABLES] = "invalid table",
 };
 
@@ -87,6 +95,51 @@ static const TableIndexDef catalog_table_index_definitions[_MAX_CATALOG_TABLES]
 			[TABLESPACE_PKEY_IDX] = "tablespace_pkey",
 			[TABLESPACE_HYPERTABLE_ID_TABLESPACE_NAME_IDX] = "tablespace_hypertable_id_tablespace_name_key",
 		}
+	},
+	[COMPRESSED_CHUNK] = {
+		.length = _MAX_COMPRESSED_CHUNK_INDEX,
+		.names = (char *[]) {
+			[COMPRESSED_CHUNK_PKEY_IDX] = "compressed_chunk_pkey",
+		}
+	},
+	[HYPERTABLE_COLUMN_STATS] = {
+		.length = _MAX_HYPERTABLE_COLUMN_STATS_INDEX,
+		.names = (char *[]) {
+			[HYPERTABLE_COLUMN_STATS_PKEY_IDX] = "hypertable_column_stats_pkey",
+		}
+	},
+	[CHUNK_COLUMN_STATS] = {
+		.length = _MAX_CHUNK_COLUMN_STATS_INDEX,
+		.names = (char *[]) {
+			[CHUNK_COLUMN_STATS_PKEY_IDX] = "chunk_column_stats_pkey",
+		}
+	},
+	[CONTINUOUS_AGG] = {
+		.length = _MAX_CONTINUOUS_AGG_INDEX,
+		.names = (char *[]) {
+			[CONTINUOUS_AGG_PKEY_IDX] = "continuous_agg_pkey",
+			[CONTINUOUS_AGG_USER_VIEW_NAME_IDX] = "continuous_agg_user_view_schema_user_view_name_key",
+			[CONTINUOUS_AGG_RAW_HYPERTABLE_ID_IDX] = "continuous_agg_raw_hypertable_id_idx",
+		}
+	},
+	[CONTINUOUS_AGGS_INVALIDATION_LOG] = {
+		.length = _MAX_CONTINUOUS_AGGS_INVALIDATION_LOG_INDEX,
+		.names = (char *[]) {
+			[CONTINUOUS_AGGS_INVALIDATION_LOG_IDX] = "continuous_aggs_invalidation_log_idx",
+		}
+	},
+	[BGW_JOB] = {
+		.length = _MAX_BGW_JOB_INDEX,
+		.names = (char *[]) {
+			[BGW_JOB_PKEY_IDX] = "bgw_job_pkey",
+			[BGW_JOB_HYPERTABLE_ID_JOB_TYPE_IDX] = "bgw_job_hypertable_id_job_type_key",
+		}
+	},
+	[BGW_JOB_STAT] = {
+		.length = _MAX_BGW_JOB_STAT_INDEX,
+		.names = (char *[]) {
+			[BGW_JOB_STAT_PKEY_IDX] = "bgw_job_stat_pkey",
+		}
 	}
 };
 
@@ -98,6 +151,13 @@ static const char *catalog_table_serial_id_names[_MAX_CATALOG_TABLES] = {
 	[CHUNK_CONSTRAINT] = CATALOG_SCHEMA_NAME ".chunk_constraint_name",
 	[CHUNK_INDEX] = NULL,
 	[TABLESPACE] = CATALOG_SCHEMA_NAME ".tablespace_id_seq",
+	[COMPRESSED_CHUNK] = NULL,
+	[HYPERTABLE_COLUMN_STATS] = NULL,
+	[CHUNK_COLUMN_STATS] = NULL,
+	[CONTINUOUS_AGG] = NULL,
+	[CONTINUOUS_AGGS_INVALIDATION_LOG] = NULL,
+	[BGW_JOB] = CATALOG_SCHEMA_NAME ".bgw_job_id_seq",
+	[BGW_JOB_STAT] = NULL,
 };
 
 typedef struct InternalFunctionDef
@@ -240,6 +300,7 @@ catalog_get(void)
 													catalog.cache_schema_id);
 
 	catalog.internal_schema_id = get_namespace_oid(INTERNAL_SCHEMA_NAME, false);
+	catalog.extension_schema_id = get_extension_schema(get_extension_oid(EXTENSION_NAME, false));
 
 	for (i = 0; i < _MAX_INTERNAL_FUNCTIONS; i++)
 	{
@@ -400,6 +461,8 @@ catalog_table_next_seq_id(Catalog *catalog, CatalogTable table)
 
 #endif   /* PG96 */
 
+static void catalog_invalidate_cache_on_change(Oid catalog_relid, CmdType operation);
+
 /*
  * Insert a new row into a catalog table.
  */
@@ -407,7 +470,7 @@ void
 catalog_insert(Relation rel, HeapTuple tuple)
 {
 	CatalogTupleInsert(rel, tuple);
-	catalog_invalidate_cache(RelationGetRelid(rel), CMD_INSERT);
+	catalog_invalidate_cache_on_change(RelationGetRelid(rel), CMD_INSERT);
 	/* Make changes visible */
 	CommandCounterIncrement();
 }
@@ -428,7 +491,7 @@ void
 catalog_update_tid(Relation rel, ItemPointer tid, HeapTuple tuple)
 {
 	CatalogTupleUpdate(rel, tid, tuple);
-	catalog_invalidate_cache(RelationGetRelid(rel), CMD_UPDATE);
+	catalog_invalidate_cache_on_change(RelationGetRelid(rel), CMD_UPDATE);
 	/* Make changes visible */
 	CommandCounterIncrement();
 }
@@ -443,7 +506,7 @@ void
 catalog_delete_tid(Relation rel, ItemPointer tid)
 {
 	CatalogTupleDelete(rel, tid);
-	catalog_invalidate_cache(RelationGetRelid(rel), CMD_DELETE);
+	catalog_invalidate_cache_on_change(RelationGetRelid(rel), CMD_DELETE);
 	CommandCounterIncrement();
 }
 
@@ -493,6 +556,14 @@ catalog_invalidate_cache(Oid catalog_relid, CmdType operation)
 		case CHUNK:
 		case CHUNK_CONSTRAINT:
 		case DIMENSION_SLICE:
+
+			/*
+			 * Only SQL statements on these tables get here (see
+			 * catalog_invalidate_cache_on_change()), and the trigger does not
+			 * know which hypertables the changed rows belong to. New chunks
+			 * need no invalidation, since chunk lookups fall back to the
+			 * catalog for chunks that are not cached.
+			 */
 			if (operation == CMD_UPDATE || operation == CMD_DELETE)
 			{
 				relid = catalog_get_cache_proxy_id(catalog, CACHE_TYPE_HYPERTABLE);
@@ -501,6 +572,8 @@ catalog_invalidate_cache(Oid catalog_relid, CmdType operation)
 			break;
 		case HYPERTABLE:
 		case DIMENSION:
+		case HYPERTABLE_COLUMN_STATS:
+		case COMPRESSED_CHUNK:
 			relid = catalog_get_cache_proxy_id(catalog, CACHE_TYPE_HYPERTABLE);
 			CacheInvalidateRelcacheByRelid(relid);
 			break;
@@ -509,3 +582,45 @@ catalog_invalidate_cache(Oid catalog_relid, CmdType operation)
 			break;
 	}
 }
+
+/*
+ * Invalidate caches after a change to a catalog table via the catalog API.
+ *
+ * Changes to chunk metadata (chunks, chunk constraints and dimension slices)
+ * only affect a single hypertable. Instead of invalidating the caches of all
+ * hypertables, the code that updates or deletes such metadata invalidates the
+ * owning hypertable via catalog_invalidate_hypertable().
+ */
+static void
+catalog_invalidate_cache_on_change(Oid catalog_relid, CmdType operation)
+{
+	switch (catalog_table_get(catalog_get(), catalog_relid))
+	{
+		case CHUNK:
+		case CHUNK_CONSTRAINT:
+		case DIMENSION_SLICE:
+			break;
+		default:
+			catalog_invalidate_cache(catalog_relid, operation);
+			break;
+	}
+}
+
+/*
+ * Invalidate the cached metadata of a single hypertable.
+ *
+ * This is signaled to other backends via a relcache invalidation on the
+ * hypertable's main table, which only evicts that hypertable from the
+ * hypertable cache. If the hypertable no longer exists, the caches of all
+ * hypertables are invalidated instead.
+ */
+void
+catalog_invalidate_hypertable(Oid hypertable_relid)
+{
+	if (OidIsValid(hypertable_relid) &&
+		SearchSysCacheExists1(RELOID, ObjectIdGetDatum(hypertable_relid)))
+		CacheInvalidateRelcacheByRelid(hypertable_relid);
+	else
+		CacheInvalidateRelcacheByRelid(catalog_get_cache_proxy_id(catalog_get(),
+															  CACHE_TYPE_HYPERTABLE));
+}
@@ -6,6 +6,7 @@
 #include <utils/rel.h>
 #include <nodes/nodes.h>
 #include <access/heapam.h>
+#include <datatype/timestamp.h>
 /*
  * TimescaleDB catalog.
  *
@@ -30,6 +31,13 @@ typedef enum CatalogTable
 	CHUNK_CONSTRAINT,
 	CHUNK_INDEX,
 	TABLESPACE,
+	COMPRESSED_CHUNK,
+	HYPERTABLE_COLUMN_STATS,
+	CHUNK_COLUMN_STATS,
+	CONTINUOUS_AGG,
+	CONTINUOUS_AGGS_INVALIDATION_LOG,
+	BGW_JOB,
+	BGW_JOB_STAT,
 	_MAX_CATALOG_TABLES,
 } CatalogTable;
 
@@ -75,6 +83,7 @@ enum Anum_hypertable
 	Anum_hypertable_associated_schema_name,
 	Anum_hypertable_associated_table_prefix,
 	Anum_hypertable_num_dimensions,
+	Anum_hypertable_chunk_target_size,
 	_Anum_hypertable_max,
 };
 
@@ -89,6 +98,7 @@ typedef struct FormData_hypertable
 	NameData	associated_schema_name;
 	NameData	associated_table_prefix;
 	int16		num_dimensions;
+	int64		chunk_target_size;
 } FormData_hypertable;
 
 typedef FormData_hypertable *Form_hypertable;
@@ -286,6 +296,11 @@ enum Anum_chunk_idx
 	Anum_chunk_idx_id = 1,
 };
 
+enum Anum_chunk_hypertable_id_idx
+{
+	Anum_chunk_hypertable_id_idx_hypertable_id = 1,
+};
+
 enum Anum_chunk_schema_name_idx
 {
 	Anum_chunk_schema_name_idx_schema_name = 1,
@@ -447,6 +462,363 @@ typedef struct FormData_tablespace_hypertable_id_tablespace_name_idx
 }	FormData_tablespace_hypertable_id_tablespace_name_idx;
 
 
+/************************************
+ *
+ * Compressed chunk table definitions
+ *
+ ************************************/
+
+#define COMPRESSED_CHUNK_TABLE_NAME "compressed_chunk"
+
+enum Anum_compressed_chunk
+{
+	Anum_compressed_chunk_chunk_id = 1,
+	Anum_compressed_chunk_schema_name,
+	Anum_compressed_chunk_table_name,
+	Anum_compressed_chunk_num_rows,
+	_Anum_compressed_chunk_max,
+};
+
+#define Natts_compressed_chunk \
+	(_Anum_compressed_chunk_max - 1)
+
+typedef struct FormData_compressed_chunk
+{
+	int32		chunk_id;
+	NameData	schema_name;
+	NameData	table_name;
+	int64		num_rows;
+} FormData_compressed_chunk;
+
+typedef FormData_compressed_chunk *Form_compressed_chunk;
+
+enum
+{
+	COMPRESSED_CHUNK_PKEY_IDX = 0,
+	_MAX_COMPRESSED_CHUNK_INDEX,
+};
+
+enum Anum_compressed_chunk_pkey_idx
+{
+	Anum_compressed_chunk_pkey_idx_chunk_id = 1,
+	_Anum_compressed_chunk_pkey_idx_max,
+};
+
+/*******************************************
+ *
+ * Hypertable column stats table definitions
+ *
+ *******************************************/
+
+#define HYPERTABLE_COLUMN_STATS_TABLE_NAME "hypertable_column_stats"
+
+enum Anum_hypertable_column_stats
+{
+	Anum_hypertable_column_stats_hypertable_id = 1,
+	Anum_hypertable_column_stats_column_name,
+	Anum_hypertable_column_stats_bloom_filter,
+	_Anum_hypertable_column_stats_max,
+};
+
+#define Natts_hypertable_column_stats \
+	(_Anum_hypertable_column_stats_max - 1)
+
+typedef struct FormData_hypertable_column_stats
+{
+	int32		hypertable_id;
+	NameData	column_name;
+	bool		bloom_filter;
+} FormData_hypertable_column_stats;
+
+typedef FormData_hypertable_column_stats *Form_hypertable_column_stats;
+
+enum
+{
+	HYPERTABLE_COLUMN_STATS_PKEY_IDX = 0,
+	_MAX_HYPERTABLE_COLUMN_STATS_INDEX,
+};
+
+enum Anum_hypertable_column_stats_pkey_idx
+{
+	Anum_hypertable_column_stats_pkey_idx_hypertable_id = 1,
+	Anum_hypertable_column_stats_pkey_idx_column_name,
+	_Anum_hypertable_column_stats_pkey_idx_max,
+};
+
+/**************************************
+ *
+ * Chunk column stats table definitions
+ *
+ **************************************/
+
+#define CHUNK_COLUMN_STATS_TABLE_NAME "chunk_column_stats"
+
+enum Anum_chunk_column_stats
+{
+	Anum_chunk_column_stats_chunk_id = 1,
+	Anum_chunk_column_stats_column_name,
+	Anum_chunk_column_stats_min_value,
+	Anum_chunk_column_stats_max_value,
+	Anum_chunk_column_stats_null_count,
+	Anum_chunk_column_stats_valid,
+	Anum_chunk_column_stats_bloom_filter,
+	_Anum_chunk_column_stats_max,
+};
+
+#define Natts_chunk_column_stats \
+	(_Anum_chunk_column_stats_max - 1)
+
+typedef struct FormData_chunk_column_stats
+{
+	int32		chunk_id;
+	NameData	column_name;
+	int64		min_value;
+	int64		max_value;
+	int64		null_count;
+	bool		valid;
+	/* bytea bloom_filter (nullable) is not part of the fixed-size struct */
+} FormData_chunk_column_stats;
+
+typedef FormData_chunk_column_stats *Form_chunk_column_stats;
+
+enum
+{
+	CHUNK_COLUMN_STATS_PKEY_IDX = 0,
+	_MAX_CHUNK_COLUMN_STATS_INDEX,
+};
+
+enum Anum_chunk_column_stats_pkey_idx
+{
+	Anum_chunk_column_stats_pkey_idx_chunk_id = 1,
+	Anum_chunk_column_stats_pkey_idx_column_name,
+	_Anum_chunk_column_stats_pkey_idx_max,
+};
+
+/**********************************
+ *
+ * Continuous aggregate definitions
+ *
+ **********************************/
+
+#define CONTINUOUS_AGG_TABLE_NAME "continuous_agg"
+
+enum Anum_continuous_agg
+{
+	Anum_continuous_agg_mat_hypertable_id = 1,
+	Anum_continuous_agg_raw_hypertable_id,
+	Anum_continuous_agg_user_view_schema,
+	Anum_continuous_agg_user_view_name,
+	Anum_continuous_agg_direct_view_schema,
+	Anum_continuous_agg_direct_view_name,
+	Anum_continuous_agg_bucket_column_name,
+	Anum_continuous_agg_bucket_width,
+	Anum_continuous_agg_watermark,
+	_Anum_continuous_agg_max,
+};
+
+#define Natts_continuous_agg \
+	(_Anum_continuous_agg_max - 1)
+
+typedef struct FormData_continuous_agg
+{
+	int32		mat_hypertable_id;
+	int32		raw_hypertable_id;
+	NameData	user_view_schema;
+	NameData	user_view_name;
+	NameData	direct_view_schema;
+	NameData	direct_view_name;
+	NameData	bucket_column_name;
+	int64		bucket_width;
+	int64		watermark;
+} FormData_continuous_agg;
+
+typedef FormData_continuous_agg *Form_continuous_agg;
+
+enum
+{
+	CONTINUOUS_AGG_PKEY_IDX = 0,
+	CONTINUOUS_AGG_USER_VIEW_NAME_IDX,
+	CONTINUOUS_AGG_RAW_HYPERTABLE_ID_IDX,
+	_MAX_CONTINUOUS_AGG_INDEX,
+};
+
+enum Anum_continuous_agg_pkey_idx
+{
+	Anum_continuous_agg_pkey_idx_mat_hypertable_id = 1,
+	_Anum_continuous_agg_pkey_idx_max,
+};
+
+enum Anum_continuous_agg_user_view_name_idx
+{
+	Anum_continuous_agg_user_view_name_idx_user_view_schema = 1,
+	Anum_continuous_agg_user_view_name_idx_user_view_name,
+	_Anum_continuous_agg_user_view_name_idx_max,
+};
+
+enum Anum_continuous_agg_raw_hypertable_id_idx
+{
+	Anum_continuous_agg_raw_hypertable_id_idx_raw_hypertable_id = 1,
+	_Anum_continuous_agg_raw_hypertable_id_idx_max,
+};
+
+/****************************************************
+ *
+ * Continuous aggregate invalidation log definitions
+ *
+ ****************************************************/
+
+#define CONTINUOUS_AGGS_INVALIDATION_LOG_TABLE_NAME "continuous_aggs_invalidation_log"
+
+enum Anum_continuous_aggs_invalidation_log
+{
+	Anum_continuous_aggs_invalidation_log_materialization_id = 1,
+	Anum_continuous_aggs_invalidation_log_lowest_modified_value,
+	Anum_continuous_aggs_invalidation_log_greatest_modified_value,
+	_Anum_continuous_aggs_invalidation_log_max,
+};
+
+#define Natts_continuous_aggs_invalidation_log \
+	(_Anum_continuous_aggs_invalidation_log_max - 1)
+
+typedef struct FormData_continuous_aggs_invalidation_log
+{
+	int32		materialization_id;
+	int64		lowest_modified_value;
+	int64		greatest_modified_value;
+} FormData_continuous_aggs_invalidation_log;
+
+typedef FormData_continuous_aggs_invalidation_log *Form_continuous_aggs_invalidation_log;
+
+enum
+{
+	CONTINUOUS_AGGS_INVALIDATION_LOG_IDX = 0,
+	_MAX_CONTINUOUS_AGGS_INVALIDATION_LOG_INDEX,
+};
+
+enum Anum_continuous_aggs_invalidation_log_idx
+{
+	Anum_continuous_aggs_invalidation_log_idx_materialization_id = 1,
+	_Anum_continuous_aggs_invalidation_log_idx_max,
+};
+
+
+/******************************
+ *
+ * Background job definitions
+ *
+ ******************************/
+
+#define BGW_JOB_TABLE_NAME "bgw_job"
+
+enum Anum_bgw_job
+{
+	Anum_bgw_job_id = 1,
+	Anum_bgw_job_job_type,
+	Anum_bgw_job_hypertable_id,
+	Anum_bgw_job_schedule_interval,
+	Anum_bgw_job_max_runtime,
+	Anum_bgw_job_max_retries,
+	Anum_bgw_job_retry_period,
+	Anum_bgw_job_older_than,
+	Anum_bgw_job_index_name,
+	_Anum_bgw_job_max,
+};
+
+#define Natts_bgw_job \
+	(_Anum_bgw_job_max - 1)
+
+typedef struct FormData_bgw_job
+{
+	int32		id;
+	NameData	job_type;
+	int32		hypertable_id;
+	Interval	schedule_interval;
+	Interval	max_runtime;
+	int32		max_retries;
+	Interval	retry_period;
+	/* Only for drop_chunks jobs */
+	Interval	older_than;
+	/* Only for reorder jobs */
+	NameData	index_name;
+} FormData_bgw_job;
+
+typedef FormData_bgw_job *Form_bgw_job;
+
+enum
+{
+	BGW_JOB_PKEY_IDX = 0,
+	BGW_JOB_HYPERTABLE_ID_JOB_TYPE_IDX,
+	_MAX_BGW_JOB_INDEX,
+};
+
+enum Anum_bgw_job_pkey_idx
+{
+	Anum_bgw_job_pkey_idx_id = 1,
+	_Anum_bgw_job_pkey_idx_max,
+};
+
+enum Anum_bgw_job_hypertable_id_job_type_idx
+{
+	Anum_bgw_job_hypertable_id_job_type_idx_hypertable_id = 1,
+	Anum_bgw_job_hypertable_id_job_type_idx_job_type,
+	_Anum_bgw_job_hypertable_id_job_type_idx_max,
+};
+
+/***********************************
+ *
+ * Background job stats definitions
+ *
+ ***********************************/
+
+#define BGW_JOB_STAT_TABLE_NAME "bgw_job_stat"
+
+enum Anum_bgw_job_stat
+{
+	Anum_bgw_job_stat_job_id = 1,
+	Anum_bgw_job_stat_last_start,
+	Anum_bgw_job_stat_last_finish,
+	Anum_bgw_job_stat_next_start,
+	Anum_bgw_job_stat_last_run_success,
+	Anum_bgw_job_stat_total_runs,
+	Anum_bgw_job_stat_total_successes,
+	Anum_bgw_job_stat_total_failures,
+	Anum_bgw_job_stat_total_crashes,
+	Anum_bgw_job_stat_consecutive_failures,
+	_Anum_bgw_job_stat_max,
+};
+
+#define Natts_bgw_job_stat \
+	(_Anum_bgw_job_stat_max - 1)
+
+typedef struct FormData_bgw_job_stat
+{
+	int32		job_id;
+	TimestampTz last_start;
+	TimestampTz last_finish;
+	TimestampTz next_start;
+	bool		last_run_success;
+	int64		total_runs;
+	int64		total_successes;
+	int64		total_failures;
+	int64		total_crashes;
+	int32		consecutive_failures;
+} FormData_bgw_job_stat;
+
+typedef FormData_bgw_job_stat *Form_bgw_job_stat;
+
+enum
+{
+	BGW_JOB_STAT_PKEY_IDX = 0,
+	_MAX_BGW_JOB_STAT_INDEX,
+};
+
+enum Anum_bgw_job_stat_pkey_idx
+{
+	Anum_bgw_job_stat_pkey_idx_job_id = 1,
+	_Anum_bgw_job_stat_pkey_idx_max,
+};
+
+
 #define MAX(a, b) \
 	((long)(a) > (long)(b) ? (a) : (b))
 
@@ -457,7 +829,14 @@ typedef struct FormData_tablespace_hypertable_id_tablespace_name_idx
 				MAX(_MAX_CHUNK_CONSTRAINT_INDEX,		\
 					MAX(_MAX_CHUNK_INDEX_INDEX,			\
 						MAX(_MAX_TABLESPACE_INDEX,		\
-							_MAX_CHUNK_INDEX))))))
+							MAX(_MAX_COMPRESSED_CHUNK_INDEX,	\
+								MAX(_MAX_HYPERTABLE_COLUMN_STATS_INDEX, \
+									MAX(_MAX_CHUNK_COLUMN_STATS_INDEX, \
+										MAX(_MAX_CONTINUOUS_AGG_INDEX, \
+											MAX(_MAX_CONTINUOUS_AGGS_INVALIDATION_LOG_INDEX, \
+												MAX(_MAX_BGW_JOB_INDEX, \
+													MAX(_MAX_BGW_JOB_STAT_INDEX, \
+														_MAX_CHUNK_INDEX)))))))))))))
 
 typedef enum CacheType
 {
@@ -487,6 +866,8 @@ typedef struct Catalog
 
 	Oid			owner_uid;
 	Oid			internal_schema_id;
+	/* The schema of the extension's public functions, e.g., time_bucket() */
+	Oid			extension_schema_id;
 	struct
 	{
 		Oid			function_id;
@@ -523,6 +904,7 @@ void		catalog_update(Relation rel, HeapTuple tuple);
 void		catalog_delete_tid(Relation rel, ItemPointer tid);
 void		catalog_delete(Relation rel, HeapTuple tuple);
 void		catalog_invalidate_cache(Oid catalog_relid, CmdType operation);
+void		catalog_invalidate_hypertable(Oid hypertable_relid);
 
 /* Delete only: do not increment command counter or invalidate caches */
 void		catalog_delete_only(Relation rel, HeapTuple tuple);
@@ -1,8 +1,10 @@
 #include <postgres.h>
+#include <catalog/dependency.h>
 #include <catalog/namespace.h>
 #include <catalog/pg_trigger.h>
 #include <catalog/indexing.h>
 #include <catalog/pg_inherits.h>
+#include <catalog/pg_class.h>
 #include <commands/trigger.h>
 #include <commands/tablecmds.h>
 #include <tcop/tcopprot.h>
@@ -10,25 +12,38 @@
 #include <access/htup_details.h>
 #include <access/xact.h>
 #include <access/reloptions.h>
+#include <access/genam.h>
+#include <catalog/pg_am.h>
+#include <catalog/pg_index.h>
 #include <nodes/makefuncs.h>
+#include <utils/acl.h>
 #include <utils/builtins.h>
 #include <utils/lsyscache.h>
 #include <utils/syscache.h>
 #include <utils/hsearch.h>
+#include <utils/rel.h>
+#include <utils/snapmgr.h>
+#include <storage/lmgr.h>
 #include <miscadmin.h>
 
 #include "chunk.h"
+#include "chunk_adaptive.h"
+#include "chunk_column_stats.h"
 #include "chunk_index.h"
 #include "catalog.h"
 #include "dimension.h"
 #include "dimension_slice.h"
 #include "dimension_vector.h"
+#include "errors.h"
 #include "partitioning.h"
 #include "hypertable.h"
+#include "hypertable_cache.h"
 #include "hypercube.h"
 #include "scanner.h"
 #include "process_utility.h"
 #include "trigger.h"
+#include "utils.h"
+#include "compress_chunk.h"
 #include "compat.h"
 
 typedef bool (*on_chunk_func) (ChunkScanCtx *ctx, Chunk *chunk);
@@ -448,6 +463,9 @@ chunk_create_after_lock(Hypertable *ht, Point *p, const char *schema, const char
 	Hypercube  *cube;
 	Chunk	   *chunk;
 
+	/* Adapt the interval of the open dimension to the size of recent chunks */
+	chunk_adaptive_update_interval(ht, p);
+
 	/* Calculate the hypercube for a new chunk that covers the tuple's point */
 	cube = hypercube_calculate_from_point(hs, p);
 
@@ -466,8 +484,8 @@ chunk_create_after_lock(Hypertable *ht, Point *p, const char *schema, const char
 	snprintf(chunk->fd.table_name.data, NAMEDATALEN,
 			 "%s_%d_chunk", prefix, chunk->fd.id);
 
-	/* Insert chunk. Chunk table already locked in exclusive mode. */
-	chunk_insert_lock(chunk, NoLock);
+	/* Insert chunk */
+	chunk_insert_lock(chunk, RowExclusiveLock);
 
 	/* Insert any new dimension slices */
 	dimension_slice_insert_multi(cube->slices, cube->num_slices);
@@ -475,6 +493,9 @@ chunk_create_after_lock(Hypertable *ht, Point *p, const char *schema, const char
 	/* Add metadata for dimensional and inheritable constraints */
 	chunk_add_constraints(chunk);
 
+	/* Add empty stats for the columns that have chunk skipping enabled */
+	chunk_column_stats_create_for_chunk(ht, chunk->fd.id);
+
 	/* Create the actual table relation for the chunk */
 	chunk->table_id = chunk_create_table(chunk, ht);
 
@@ -503,18 +524,27 @@ chunk_create(Hypertable *ht, Point *p, const char *schema, const char *prefix)
 {
 	Catalog    *catalog = catalog_get();
 	Chunk	   *chunk;
-	Relation	rel;
 
-	rel = heap_open(catalog->tables[CHUNK].id, ExclusiveLock);
+	/*
+	 * Serialize chunk creation per hypertable. Chunks of different
+	 * hypertables never share dimension slices, so they can be created in
+	 * parallel. The lock is on the hypertable's catalog entry rather than its
+	 * relation so that it does not conflict with any regular table locks
+	 * (e.g., VACUUM or ANALYZE).
+	 *
+	 * The lock is held until the end of the transaction. The new chunk's
+	 * catalog rows are not visible to other sessions before the transaction
+	 * commits, so releasing the lock earlier would let a concurrent insert
+	 * into the same region miss the chunk and create an overlapping one.
+	 */
+	LockDatabaseObject(catalog->tables[HYPERTABLE].id, ht->fd.id, 0, ExclusiveLock);
 
-	/* Recheck if someone else created the chunk before we got the table lock */
+	/* Recheck if someone else created the chunk before we got the lock */
 	chunk = chunk_find(ht->space, p);
 
 	if (NULL == chunk)
 		chunk = chunk_create_after_lock(ht, p, schema, prefix);
 
-	heap_close(rel, ExclusiveLock);
-
 	Assert(chunk != NULL);
 
 	return chunk;
@@ -835,6 +865,40 @@ chunk_find(Hyperspace *hs, Point *p)
 	return chunk;
 }
 
+/*
+ * Find all chunks that have the given dimension slice as part of their
+ * hypercube.
+ *
+ * Returns a list of the chunks' table relids.
+ */
+List *
+chunk_find_all_relids_in_slice(Hyperspace *hs, DimensionSlice *slice)
+{
+	ChunkScanCtx ctx;
+	HASH_SEQ_STATUS status;
+	ChunkScanEntry *entry;
+	List	   *relids = NIL;
+
+	chunk_scan_ctx_init(&ctx, hs, NULL);
+
+	chunk_constraint_scan_by_dimension_slice_id(slice, &ctx);
+
+	hash_seq_init(&status, ctx.htab);
+
+	for (entry = hash_seq_search(&status);
+		 entry != NULL;
+		 entry = hash_seq_search(&status))
+	{
+		Chunk	   *chunk = chunk_get_by_id(entry->chunk->fd.id, 0, true);
+
+		relids = lappend_oid(relids, chunk->table_id);
+	}
+
+	chunk_scan_ctx_destroy(&ctx);
+
+	return relids;
+}
+
 Chunk *
 chunk_copy(Chunk *chunk)
 {
@@ -966,6 +1030,149 @@ chunk_get_by_id(int32 id, int16 num_constraints, bool fail_if_not_found)
 						   num_constraints, fail_if_not_found);
 }
 
+typedef struct SliceHashEntry
+{
+	int32		slice_id;
+	DimensionSlice *slice;
+} SliceHashEntry;
+
+typedef struct ChunkAppendData
+{
+	List	   *chunks;
+	Bitmapset  *skip_ids;
+} ChunkAppendData;
+
+static bool
+chunk_tuple_append(TupleInfo *ti, void *arg)
+{
+	ChunkAppendData *data = arg;
+	FormData_chunk *form = (FormData_chunk *) GETSTRUCT(ti->tuple);
+	Chunk	   *chunk;
+
+	if (bms_is_member(form->id, data->skip_ids))
+		return true;
+
+	chunk = palloc0(sizeof(Chunk));
+	chunk_fill(chunk, ti->tuple);
+	data->chunks = lappend(data->chunks, chunk);
+
+	return true;
+}
+
+/*
+ * Get all chunks of a hypertable, including their constraints and hypercubes,
+ * except the chunks whose IDs are in skip_ids.
+ *
+ * The constraints of all chunks are read with one index range scan. When
+ * building all chunks of the hypertable, its dimension slices are scanned
+ * once per dimension and then shared among the chunks' hypercubes. Otherwise,
+ * only the slices of the returned chunks are looked up.
+ */
+List *
+chunk_get_all_by_hypertable(Hyperspace *hs, Bitmapset *skip_ids)
+{
+	HASHCTL		hctl = {
+		.keysize = sizeof(int32),
+		.entrysize = sizeof(SliceHashEntry),
+		.hcxt = CurrentMemoryContext,
+	};
+	HASHCTL		chunk_hctl = {
+		.keysize = sizeof(int32),
+		.entrysize = sizeof(ChunkScanEntry),
+		.hcxt = CurrentMemoryContext,
+	};
+	ChunkAppendData data = {
+		.chunks = NIL,
+		.skip_ids = skip_ids,
+	};
+	HTAB	   *slices;
+	HTAB	   *chunks;
+	ScanKeyData scankey[1];
+	ListCell   *lc;
+	int32		min_chunk_id = PG_INT32_MAX;
+	int32		max_chunk_id = 0;
+	int			i;
+
+	/*
+	 * Perform an index scan on hypertable ID.
+	 */
+	ScanKeyInit(&scankey[0], Anum_chunk_hypertable_id_idx_hypertable_id, BTEqualStrategyNumber,
+				F_INT4EQ, Int32GetDatum(hs->hypertable_id));
+
+	chunk_scan_internal(CHUNK_HYPERTABLE_ID_INDEX, scankey, 1, chunk_tuple_append,
+						&data, 0, false, AccessShareLock);
+
+	if (data.chunks == NIL)
+		return NIL;
+
+	chunks = hash_create("chunk-id-scan", list_length(data.chunks), &chunk_hctl,
+						 HASH_ELEM | HASH_CONTEXT | HASH_BLOBS);
+
+	foreach(lc, data.chunks)
+	{
+		Chunk	   *chunk = lfirst(lc);
+		ChunkScanEntry *entry;
+
+		entry = hash_search(chunks, &chunk->fd.id, HASH_ENTER, NULL);
+		entry->chunk = chunk;
+		chunk->constraints = chunk_constraints_alloc(hs->num_dimensions);
+		min_chunk_id = Min(min_chunk_id, chunk->fd.id);
+		max_chunk_id = Max(max_chunk_id, chunk->fd.id);
+	}
+
+	chunk_constraint_scan_by_chunk_id_range(chunks, min_chunk_id, max_chunk_id);
+	hash_destroy(chunks);
+
+	slices = hash_create("chunk-slice-scan", 64, &hctl,
+						 HASH_ELEM | HASH_CONTEXT | HASH_BLOBS);
+
+	for (i = 0; NULL == skip_ids && i < hs->num_dimensions; i++)
+	{
+		DimensionVec *vec = dimension_get_slices(&hs->dimensions[i]);
+		int			j;
+
+		for (j = 0; j < vec->num_slices; j++)
+		{
+			SliceHashEntry *entry;
+
+			entry = hash_search(slices, &vec->slices[j]->fd.id, HASH_ENTER, NULL);
+			entry->slice = vec->slices[j];
+		}
+	}
+
+	foreach(lc, data.chunks)
+	{
+		Chunk	   *chunk = lfirst(lc);
+
+		chunk->cube = hypercube_alloc(hs->num_dimensions);
+
+		for (i = 0; i < chunk->constraints->num_constraints; i++)
+		{
+			ChunkConstraint *cc = chunk_constraints_get(chunk->constraints, i);
+			SliceHashEntry *entry;
+			bool		found;
+
+			if (!is_dimension_constraint(cc))
+				continue;
+
+			entry = hash_search(slices, &cc->fd.dimension_slice_id, HASH_ENTER, &found);
+
+			if (!found)
+				entry->slice = dimension_slice_scan_by_id(cc->fd.dimension_slice_id);
+
+			if (NULL == entry->slice)
+				elog(ERROR, "Dimension slice %d not found for chunk %d",
+					 cc->fd.dimension_slice_id, chunk->fd.id);
+
+			hypercube_add_slice(chunk->cube, entry->slice);
+		}
+	}
+
+	hash_destroy(slices);
+
+	return data.chunks;
+}
+
 bool
 chunk_exists(const char *schema_name, const char *table_name)
 {
@@ -978,20 +1185,44 @@ chunk_exists_relid(Oid relid)
 	return chunk_get_by_relid(relid, 0, false) != NULL;
 }
 
-static bool
-chunk_tuple_delete(TupleInfo *ti, void *data)
+/*
+ * Delete a chunk's catalog tuple and the metadata that refers to it. If the
+ * chunk table is given, the chunk's constraints are also dropped from it.
+ */
+static void
+chunk_tuple_delete_metadata(TupleInfo *ti, Oid chunk_oid)
 {
 	FormData_chunk *form = (FormData_chunk *) GETSTRUCT(ti->tuple);
-	Oid			nspoid = get_namespace_oid(NameStr(form->schema_name), false);
-	Oid			chunk_oid = get_relname_relid(NameStr(form->table_name), nspoid);
 	CatalogSecurityContext sec_ctx;
 
 	chunk_constraint_delete_by_chunk_id(form->id, chunk_oid);
+	chunk_index_delete_by_chunk_id(form->id, false);
+	compressed_chunk_delete_by_chunk_id(form->id);
+	chunk_column_stats_delete_by_chunk_id(form->id);
 
 	catalog_become_owner(catalog_get(), &sec_ctx);
 	catalog_delete(ti->scanrel, ti->tuple);
 	catalog_restore_user(&sec_ctx);
 
+	catalog_invalidate_hypertable(hypertable_id_to_relid(form->hypertable_id));
+}
+
+static bool
+chunk_tuple_delete(TupleInfo *ti, void *data)
+{
+	FormData_chunk *form = (FormData_chunk *) GETSTRUCT(ti->tuple);
+	Oid			nspoid = get_namespace_oid(NameStr(form->schema_name), false);
+	Oid			chunk_oid = get_relname_relid(NameStr(form->table_name), nspoid);
+
+	chunk_tuple_delete_metadata(ti, chunk_oid);
+
+	return false;
+}
+
+static bool
+chunk_tuple_delete_metadata_only(TupleInfo *ti, void *data)
+{
+	chunk_tuple_delete_metadata(ti, InvalidOid);
 	return false;
 }
 
@@ -1018,6 +1249,292 @@ chunk_delete_by_relid(Oid relid)
 							   RowExclusiveLock);
 }
 
+/*
+ * Get the minimum and maximum value of a column in a chunk, in the internal
+ * time representation, from the first and last entries of a valid,
+ * non-partial btree index on the column. This avoids scanning the chunk.
+ *
+ * Returns false if there is no such index or the chunk is empty.
+ */
+bool
+chunk_get_minmax(Oid relid, AttrNumber attnum, Oid atttype, int64 minmax[2])
+{
+	Relation	rel = heap_open(relid, AccessShareLock);
+	List	   *indexes = RelationGetIndexList(rel);
+	bool		found = false;
+	ListCell   *lc;
+
+	foreach(lc, indexes)
+	{
+		Relation	idxrel = index_open(lfirst_oid(lc), AccessShareLock);
+		IndexScanDesc scan;
+		ScanDirection dirs[2] = {ForwardScanDirection, BackwardScanDirection};
+		int			i;
+
+		/*
+		 * Partial indexes do not cover all rows and indexes that are still
+		 * being built by CREATE INDEX CONCURRENTLY might miss some
+		 */
+		if (idxrel->rd_rel->relam != BTREE_AM_OID ||
+			idxrel->rd_index->indkey.values[0] != attnum ||
+			!IndexIsValid(idxrel->rd_index) ||
+			!IndexIsReady(idxrel->rd_index) ||
+			!heap_attisnull(idxrel->rd_indextuple, Anum_pg_index_indpred))
+		{
+			index_close(idxrel, AccessShareLock);
+			continue;
+		}
+
+		/* In a descending index, the maximum comes first */
+		if (idxrel->rd_indoption[0] & INDOPTION_DESC)
+		{
+			dirs[0] = BackwardScanDirection;
+			dirs[1] = ForwardScanDirection;
+		}
+
+		scan = index_beginscan(rel, idxrel, GetTransactionSnapshot(), 0, 0);
+
+		for (i = 0; i < 2; i++)
+		{
+			HeapTuple	tuple;
+			Datum		value;
+			bool		isnull;
+
+			index_rescan(scan, NULL, 0, NULL, 0);
+			tuple = index_getnext(scan, dirs[i]);
+
+			if (NULL == tuple)
+				break;
+
+			value = heap_getattr(tuple, attnum, RelationGetDescr(rel), &isnull);
+
+			if (isnull)
+				break;
+
+			minmax[i] = time_value_to_internal(value, atttype);
+		}
+
+		found = (i == 2);
+
+		index_endscan(scan);
+		index_close(idxrel, AccessShareLock);
+		break;
+	}
+
+	list_free(indexes);
+	heap_close(rel, AccessShareLock);
+
+	return found;
+}
+
+/*
+ * Get the IDs of a hypertable's chunks that only cover time values below
+ * older_than, or all chunks if all_chunks is set. The chunks are found through
+ * the slices of the time dimension, so only the slice index and the chunk
+ * constraints of the matching slices are scanned.
+ */
+static List *
+chunk_get_ids_older_than(Hypertable *ht, int64 older_than, bool all_chunks)
+{
+	Dimension  *time_dim = hyperspace_get_dimension(ht->space, DIMENSION_TYPE_OPEN, 0);
+	DimensionVec *slices;
+	ChunkScanCtx ctx;
+	HASH_SEQ_STATUS status;
+	ChunkScanEntry *entry;
+	List	   *chunk_ids = NIL;
+	int			i;
+
+	if (NULL == time_dim)
+		return NIL;
+
+	if (all_chunks)
+		slices = dimension_slice_scan_by_dimension(time_dim->fd.id, 0);
+	else
+		slices = dimension_slice_scan_ending_before(time_dim->fd.id, older_than, 0);
+
+	chunk_scan_ctx_init(&ctx, ht->space, NULL);
+
+	for (i = 0; i < slices->num_slices; i++)
+		chunk_constraint_scan_by_dimension_slice_id(slices->slices[i], &ctx);
+
+	hash_seq_init(&status, ctx.htab);
+
+	for (entry = hash_seq_search(&status);
+		 entry != NULL;
+		 entry = hash_seq_search(&status))
+		chunk_ids = lappend_int(chunk_ids, entry->chunk_id);
+
+	chunk_scan_ctx_destroy(&ctx);
+
+	return chunk_ids;
+}
+
+TS_FUNCTION_INFO_V1(chunk_drop_chunks);
+
+/*
+ * Drop the chunks that only cover time values older than the given time (in
+ * the internal time format) in all hypertables matching the given table and
+ * schema names. A NULL time drops all chunks of the matching hypertables.
+ *
+ * The chunks are locked in chunk ID order, their metadata is deleted, and
+ * all chunk tables are dropped in a single deletion. Chunks that were dropped,
+ * or extended past older_than by a merge, while waiting for the lock are
+ * skipped.
+ */
+Datum
+chunk_drop_chunks(PG_FUNCTION_ARGS)
+{
+	Name		table_name = PG_ARGISNULL(1) ? NULL : PG_GETARG_NAME(1);
+	Name		schema_name = PG_ARGISNULL(2) ? NULL : PG_GETARG_NAME(2);
+	bool		cascade = !PG_ARGISNULL(3) && PG_GETARG_BOOL(3);
+	bool		truncate_before = !PG_ARGISNULL(4) && PG_GETARG_BOOL(4);
+	DropBehavior behavior = cascade ? DROP_CASCADE : DROP_RESTRICT;
+	List	   *ht_relids;
+	List	   *chunk_ids = NIL;
+	List	   *truncate_relations = NIL;
+	ObjectAddresses *objects;
+	ListCell   *lc;
+	Cache	   *hcache;
+	int32	   *ids;
+	int			num_chunks;
+	int			num_locked = 0;
+	int			i;
+
+	if (PG_ARGISNULL(0) && NULL == table_name && NULL == schema_name)
+		elog(ERROR, "Cannot have all 3 arguments to drop_chunks_older_than be NULL");
+
+	ht_relids = hypertable_get_relids_by_name(schema_name, table_name);
+
+	if (NULL != table_name && ht_relids == NIL)
+		ereport(ERROR,
+				(errcode(ERRCODE_IO_HYPERTABLE_NOT_EXIST),
+				 errmsg("hypertable %s does not exist", NameStr(*table_name))));
+
+	hcache = hypertable_cache_pin();
+
+	foreach(lc, ht_relids)
+	{
+		Hypertable *ht = hypertable_cache_get_entry(hcache, lfirst_oid(lc));
+		List	   *ht_chunk_ids;
+
+		if (NULL == ht)
+			continue;
+
+		ht_chunk_ids = chunk_get_ids_older_than(ht,
+												PG_ARGISNULL(0) ? 0 : PG_GETARG_INT64(0),
+												PG_ARGISNULL(0));
+
+		chunk_ids = list_concat(chunk_ids, ht_chunk_ids);
+	}
+
+	if (chunk_ids == NIL)
+	{
+		cache_release(hcache);
+		PG_RETURN_VOID();
+	}
+
+	/*
+	 * Lock the chunks in a consistent order to avoid deadlocks with
+	 * concurrent drops of overlapping sets of chunks
+	 */
+	num_chunks = list_length(chunk_ids);
+	ids = palloc(sizeof(int32) * num_chunks);
+	i = 0;
+
+	foreach(lc, chunk_ids)
+		ids[i++] = lfirst_int(lc);
+
+	qsort(ids, num_chunks, sizeof(int32), int_cmp);
+
+	objects = new_object_addresses();
+
+	for (i = 0; i < num_chunks; i++)
+	{
+		Chunk	   *chunk = chunk_get_by_id(ids[i], 0, false);
+		Hypertable *ht;
+		ObjectAddress addr = {
+			.classId = RelationRelationId,
+		};
+
+		if (NULL == chunk)
+			continue;
+
+		/* Like DROP TABLE, check ownership before queueing for the lock */
+		if (!pg_class_ownercheck(chunk->table_id, GetUserId()))
+			aclcheck_error(ACLCHECK_NOT_OWNER, ACL_KIND_CLASS,
+						   NameStr(chunk->fd.table_name));
+
+		LockRelationOid(chunk->table_id, AccessExclusiveLock);
+
+		/*
+		 * The chunk might have been dropped or merged with newer chunks
+		 * while waiting for the lock, so look it up again now that it cannot
+		 * change under us
+		 */
+		ht = hypertable_cache_get_entry_by_id(hcache, chunk->fd.hypertable_id);
+
+		if (NULL == ht)
+			continue;
+
+		chunk = chunk_get_by_id(ids[i], ht->space->num_dimensions, false);
+
+		if (NULL == chunk)
+			continue;
+
+		if (!PG_ARGISNULL(0))
+		{
+			Dimension  *time_dim = hyperspace_get_dimension(ht->space, DIMENSION_TYPE_OPEN, 0);
+			DimensionSlice *slice = hypercube_get_slice_by_dimension_id(chunk->cube, time_dim->fd.id);
+
+			if (NULL == slice || slice->fd.range_end > PG_GETARG_INT64(0))
+				continue;
+		}
+
+		ids[num_locked++] = ids[i];
+		addr.objectId = chunk->table_id;
+
+		add_exact_object_address(&addr, objects);
+		truncate_relations = lappend(truncate_relations,
+									 makeRangeVar(NameStr(chunk->fd.schema_name),
+												  NameStr(chunk->fd.table_name), -1));
+	}
+
+	cache_release(hcache);
+
+	if (num_locked == 0)
+		PG_RETURN_VOID();
+
+	if (truncate_before)
+	{
+		TruncateStmt *stmt = makeNode(TruncateStmt);
+
+		stmt->relations = truncate_relations;
+		stmt->restart_seqs = false;
+		stmt->behavior = behavior;
+		ExecuteTruncate(stmt);
+	}
+
+	for (i = 0; i < num_locked; i++)
+	{
+		ScanKeyData scankey[1];
+
+		ScanKeyInit(&scankey[0], Anum_chunk_idx_id, BTEqualStrategyNumber,
+					F_INT4EQ, Int32GetDatum(ids[i]));
+
+		chunk_scan_internal(CHUNK_ID_INDEX, scankey, 1,
+							chunk_tuple_delete_metadata_only, NULL, 0, false,
+							RowExclusiveLock);
+	}
+
+	/*
+	 * Deleting the chunk metadata invalidates the hypertable cache, so there
+	 * is no need to invalidate the affected hypertables one by one
+	 */
+	performMultipleDeletions(objects, behavior, 0);
+
+	PG_RETURN_VOID();
+}
+
 static bool
 chunk_recreate_constraint(ChunkScanCtx *ctx, Chunk *chunk)
 {
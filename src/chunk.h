@@ -66,6 +66,8 @@ extern Chunk *chunk_create(Hypertable *ht, Point *p, const char *schema, const c
 extern Chunk *chunk_create_stub(int32 id, int16 num_constraints);
 extern void chunk_free(Chunk *chunk);
 extern Chunk *chunk_find(Hyperspace *hs, Point *p);
+extern List *chunk_find_all_relids_in_slice(Hyperspace *hs, DimensionSlice *slice);
+extern List *chunk_get_all_by_hypertable(Hyperspace *hs, Bitmapset *skip_ids);
 extern Chunk *chunk_copy(Chunk *chunk);
 extern Chunk *chunk_get_by_name(const char *schema_name, const char *table_name, int16 num_constraints, bool fail_if_not_found);
 extern Chunk *chunk_get_by_relid(Oid relid, int16 num_constraints, bool fail_if_not_found);
@@ -74,5 +76,6 @@ extern bool chunk_exists(const char *schema_name, const char *table_name);
 extern bool chunk_exists_relid(Oid relid);
 extern void chunk_recreate_all_constraints_for_dimension(Hyperspace *hs, int32 dimension_id);
 extern int	chunk_delete_by_relid(Oid chunk_oid);
+extern bool chunk_get_minmax(Oid relid, AttrNumber attnum, Oid atttype, int64 minmax[2]);
 
 #endif   /* TIMESCALEDB_CHUNK_H */
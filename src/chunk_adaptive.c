@@ -0,0 +1,245 @@
+#include <postgres.h>
+#include <math.h>
+#include <storage/bufmgr.h>
+#include <utils/builtins.h>
+#include <utils/lsyscache.h>
+#include <miscadmin.h>
+
+#include "chunk.h"
+#include "chunk_adaptive.h"
+#include "compat.h"
+#include "dimension.h"
+#include "dimension_slice.h"
+#include "dimension_vector.h"
+#include "errors.h"
+#include "hypertable.h"
+#include "hypertable_cache.h"
+
+/*
+ * Adaptive chunk sizing.
+ *
+ * With a chunk target size set on a hypertable, the interval of the first
+ * open dimension is recalculated whenever a new chunk is created. For each
+ * of the most recent intervals, the size of its chunks is extrapolated to
+ * the size they would have if their data covered the whole interval, which
+ * gives the interval at which chunks would reach the target size. The new
+ * interval is the average over these intervals.
+ *
+ * The range of data in a chunk is read from the first and last entries of
+ * a btree index on the dimension column, so chunks without such an index
+ * are not taken into account.
+ */
+
+TS_FUNCTION_INFO_V1(chunk_adaptive_set);
+
+/* Number of recent intervals to base a new interval on */
+#define CHUNK_ADAPTIVE_NUM_INTERVALS 3
+
+/* Intervals filled less than this are too sparse to extrapolate from */
+#define CHUNK_ADAPTIVE_MIN_FILL 0.1
+
+/* Relative change of the interval below which it is kept as is */
+#define CHUNK_ADAPTIVE_MIN_CHANGE 0.15
+
+/*
+ * Fraction of shared_buffers that the chunks of the most recent interval
+ * should fit in when the target size is estimated.
+ */
+#define CHUNK_ADAPTIVE_MEMORY_FRACTION 0.9
+
+/*
+ * Calculate the interval at which chunks of the given slice would reach the
+ * target size.
+ *
+ * Returns zero if the slice's chunks don't allow an estimate.
+ */
+static double
+calculate_slice_interval(Hypertable *ht, Dimension *dim, DimensionSlice *slice)
+{
+	int64		slice_interval = slice->fd.range_end - slice->fd.range_start;
+	int64		min = PG_INT64_MAX;
+	int64		max = PG_INT64_MIN;
+	int64		total_size = 0;
+	int			num_chunks = 0;
+	double		fill;
+	double		full_size;
+	ListCell   *lc;
+
+	foreach(lc, chunk_find_all_relids_in_slice(ht->space, slice))
+	{
+		Oid			relid = lfirst_oid(lc);
+		AttrNumber	attnum = get_attnum(relid, NameStr(dim->fd.column_name));
+		int64		minmax[2];
+
+		if (!chunk_get_minmax(relid, attnum, dim->fd.column_type, minmax))
+			continue;
+
+		min = Min(min, minmax[0]);
+		max = Max(max, minmax[1]);
+		total_size += DatumGetInt64(DirectFunctionCall1(pg_total_relation_size,
+													ObjectIdGetDatum(relid)));
+		num_chunks++;
+	}
+
+	if (num_chunks == 0)
+		return 0;
+
+	fill = Min(1.0, (double) (max - min + 1) / slice_interval);
+
+	if (fill < CHUNK_ADAPTIVE_MIN_FILL)
+		return 0;
+
+	/* The size of a chunk if its data covered the whole interval */
+	full_size = (double) total_size / num_chunks / fill;
+
+	if (full_size <= 0)
+		return 0;
+
+	return slice_interval * (ht->fd.chunk_target_size / full_size);
+}
+
+/*
+ * Calculate a new interval for an open dimension from the intervals that
+ * precede the given coordinate.
+ *
+ * Returns zero if no estimate could be made.
+ */
+static int64
+calculate_interval(Hypertable *ht, Dimension *dim, int64 coord)
+{
+	DimensionVec *slices = dimension_get_slices(dim);
+	double		interval_sum = 0;
+	int			num_intervals = 0;
+	int			i;
+
+	/* Don't adapt when backfilling before the most recent interval */
+	if (slices->num_slices > 0 &&
+		coord < slices->slices[slices->num_slices - 1]->fd.range_start)
+		return 0;
+
+	for (i = slices->num_slices - 1; i >= 0 && num_intervals < CHUNK_ADAPTIVE_NUM_INTERVALS; i--)
+	{
+		DimensionSlice *slice = slices->slices[i];
+		double		interval;
+
+		/* Slices that were cut to the ends of the range are unbounded */
+		if (slice->fd.range_start == DIMENSION_SLICE_MINVALUE ||
+			slice->fd.range_end == DIMENSION_SLICE_MAXVALUE)
+			continue;
+
+		interval = calculate_slice_interval(ht, dim, slice);
+
+		if (interval > 0)
+		{
+			interval_sum += interval;
+			num_intervals++;
+		}
+	}
+
+	if (num_intervals == 0)
+		return 0;
+
+	return (int64) Max(1.0, Min(interval_sum / num_intervals, (double) (PG_INT64_MAX / 2)));
+}
+
+/*
+ * Adapt the interval of a hypertable's open dimension before a chunk is
+ * created for the given point. The new interval is stored in the dimension
+ * and also applies to the chunk about to be created.
+ */
+void
+chunk_adaptive_update_interval(Hypertable *ht, Point *p)
+{
+	Dimension  *dim = hyperspace_get_open_dimension(ht->space, 0);
+	int64		interval;
+
+	if (ht->fd.chunk_target_size <= 0 || NULL == dim)
+		return;
+
+	interval = calculate_interval(ht, dim, p->coordinates[dim - ht->space->dimensions]);
+
+	if (interval <= 0 ||
+		fabs((double) (interval - dim->fd.interval_length)) <
+		CHUNK_ADAPTIVE_MIN_CHANGE * dim->fd.interval_length)
+		return;
+
+	elog(DEBUG1, "adaptive chunking changes the interval of hypertable \"%s\" from "
+		 INT64_FORMAT " to " INT64_FORMAT,
+		 NameStr(ht->fd.table_name), dim->fd.interval_length, interval);
+
+	dimension_set_interval_length(dim, interval);
+}
+
+/*
+ * Estimate a chunk target size from the available memory. The chunks of the
+ * most recent interval, one for each partition of the closed dimensions,
+ * should fit in shared_buffers together.
+ */
+static int64
+chunk_adaptive_estimate_target_size(Hypertable *ht)
+{
+	int64		num_partitions = 1;
+	int			i;
+
+	for (i = 0; i < ht->space->num_dimensions; i++)
+	{
+		Dimension  *dim = &ht->space->dimensions[i];
+
+		if (IS_CLOSED_DIMENSION(dim))
+			num_partitions *= dim->fd.num_slices;
+	}
+
+	return (int64) (CHUNK_ADAPTIVE_MEMORY_FRACTION * NBuffers * BLCKSZ / num_partitions);
+}
+
+/*
+ * Set the chunk target size of a hypertable.
+ *
+ * The size is given as text: 'off' disables adaptive chunk sizing,
+ * 'estimate' derives the size from shared_buffers and anything else is a
+ * size like '1GB'. Returns the target size in bytes.
+ */
+Datum
+chunk_adaptive_set(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	char	   *target = text_to_cstring(PG_GETARG_TEXT_PP(1));
+	Cache	   *hcache;
+	Hypertable *ht;
+	int64		target_size;
+
+	hypertable_permissions_check(relid, GetUserId());
+
+	hcache = hypertable_cache_pin();
+	ht = hypertable_cache_get_entry(hcache, relid);
+
+	if (NULL == ht)
+		ereport(ERROR,
+				(errcode(ERRCODE_IO_HYPERTABLE_NOT_EXIST),
+				 errmsg("Table \"%s\" is not a hypertable", get_rel_name(relid))));
+
+	if (NULL == hyperspace_get_open_dimension(ht->space, 0))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("Hypertable \"%s\" has no open dimension to adapt",
+						get_rel_name(relid))));
+
+	if (pg_strcasecmp(target, "off") == 0)
+		target_size = 0;
+	else if (pg_strcasecmp(target, "estimate") == 0)
+		target_size = chunk_adaptive_estimate_target_size(ht);
+	else
+		target_size = DatumGetInt64(DirectFunctionCall1(pg_size_bytes,
+														PG_GETARG_DATUM(1)));
+
+	if (target_size < 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("Invalid chunk target size \"%s\"", target)));
+
+	hypertable_set_chunk_target_size(ht, target_size);
+
+	cache_release(hcache);
+
+	PG_RETURN_INT64(target_size);
+}
@@ -0,0 +1,11 @@
+#ifndef TIMESCALEDB_CHUNK_ADAPTIVE_H
+#define TIMESCALEDB_CHUNK_ADAPTIVE_H
+
+#include <postgres.h>
+
+typedef struct Hypertable Hypertable;
+typedef struct Point Point;
+
+extern void chunk_adaptive_update_interval(Hypertable *ht, Point *p);
+
+#endif   /* TIMESCALEDB_CHUNK_ADAPTIVE_H */
@@ -0,0 +1,1406 @@
+#include <postgres.h>
+#include <access/hash.h>
+#include <access/heapam.h>
+#include <access/htup_details.h>
+#include <access/sysattr.h>
+#include <catalog/namespace.h>
+#include <catalog/pg_inherits_fn.h>
+#include <catalog/pg_type.h>
+#include <executor/spi.h>
+#include <lib/stringinfo.h>
+#include <nodes/relation.h>
+#include <optimizer/clauses.h>
+#include <parser/parsetree.h>
+#include <storage/lmgr.h>
+#include <utils/array.h>
+#include <utils/builtins.h>
+#include <utils/date.h>
+#include <utils/fmgroids.h>
+#include <utils/lsyscache.h>
+#include <utils/timestamp.h>
+#include <utils/typcache.h>
+#include <miscadmin.h>
+
+#include "chunk_column_stats.h"
+#include "bloom_filter.h"
+#include "catalog.h"
+#include "chunk.h"
+#include "compat.h"
+#include "errors.h"
+#include "hypertable.h"
+#include "hypertable_cache.h"
+#include "hypertable_restrict.h"
+#include "scanner.h"
+#include "utils.h"
+
+/*
+ * Per-chunk min/max stats of non-dimension columns.
+ *
+ * A hypertable can have "chunk skipping" enabled on integer, timestamp and
+ * date columns. For every chunk, the range of values and the number of NULLs
+ * of such a column are stored in _timescaledb_catalog.chunk_column_stats,
+ * in the internal (int64) time representation. Queries that restrict these
+ * columns can then exclude chunks whose range does not overlap the
+ * restriction, in the same way as the dimension slices are used to exclude
+ * chunks on dimension columns.
+ *
+ * Stats are maintained as rows are inserted via the hypertable. The range of
+ * the inserted rows is merged into the chunk's stats at the end of the
+ * insert, via an in-place (non-transactional) update, like the statistics in
+ * pg_class. Ranges only ever grow, so stats that cover rows that were deleted
+ * or never committed are wider than necessary, but never wrong. Writes that
+ * cannot be tracked (UPDATEs of the column and direct inserts into a chunk)
+ * mark the stats invalid, after which they are no longer used.
+ *
+ * Optionally, a column's stats also include a Bloom filter of the hashes of
+ * the column's values in the chunk. Unlike the range, the Bloom filter is
+ * useful on high-cardinality columns whose values are spread over all chunks
+ * (e.g., device IDs), and works on any type with a hash function. Chunks
+ * whose Bloom filter does not contain any of the values that an equality (or
+ * IN) restriction asks for are excluded. Bloom filters are maintained in the
+ * same way as the range, by OR-ing the bits of the inserted values into the
+ * chunk's filter in place.
+ */
+
+TS_FUNCTION_INFO_V1(enable_chunk_skipping);
+TS_FUNCTION_INFO_V1(disable_chunk_skipping);
+
+/*
+ * Whether any hypertable has stats columns. Most databases have none, so
+ * statements check this before looking up their result relations in the
+ * catalog. It is reset whenever the hypertable cache is invalidated, which
+ * enabling and disabling chunk skipping do. The generation detects
+ * invalidations while the flag is computed.
+ */
+typedef enum StatsInUse
+{
+	STATS_IN_USE_UNKNOWN,
+	STATS_IN_USE_NO,
+	STATS_IN_USE_YES,
+} StatsInUse;
+
+static StatsInUse stats_in_use = STATS_IN_USE_UNKNOWN;
+static uint32 stats_in_use_generation = 0;
+
+static bool
+column_type_supported(Oid type)
+{
+	switch (type)
+	{
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+		case DATEOID:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/*
+ * Convert a column value to the internal time representation. Infinite
+ * timestamps and dates map to the ends of the int64 range.
+ */
+static int64
+stats_value_to_internal(Datum value, Oid type)
+{
+	switch (type)
+	{
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			if (TIMESTAMP_IS_NOBEGIN(DatumGetTimestamp(value)))
+				return PG_INT64_MIN;
+			if (TIMESTAMP_IS_NOEND(DatumGetTimestamp(value)))
+				return PG_INT64_MAX;
+			break;
+		case DATEOID:
+			if (DATE_IS_NOBEGIN(DatumGetDateADT(value)))
+				return PG_INT64_MIN;
+			if (DATE_IS_NOEND(DatumGetDateADT(value)))
+				return PG_INT64_MAX;
+			break;
+		default:
+			break;
+	}
+
+	return time_value_to_internal(value, type);
+}
+
+static void
+chunk_stats_range_init(ChunkStatsRange *range)
+{
+	range->min_value = PG_INT64_MAX;
+	range->max_value = PG_INT64_MIN;
+	range->null_count = 0;
+}
+
+static void
+chunk_stats_range_add(ChunkStatsRange *range, Datum value, bool isnull, ChunkStatsColumn *column)
+{
+	int64		internal;
+
+	if (isnull)
+	{
+		range->null_count++;
+		return;
+	}
+
+	if (!column->min_max)
+		return;
+
+	internal = stats_value_to_internal(value, column->type);
+	range->min_value = Min(range->min_value, internal);
+	range->max_value = Max(range->max_value, internal);
+}
+
+static int
+hypertable_column_stats_scan(int32 hypertable_id, const char *column_name,
+							 tuple_found_func tuple_found, void *data, LOCKMODE lockmode)
+{
+	Catalog    *catalog = catalog_get();
+	ScanKeyData scankey[2];
+	ScannerCtx	scanctx = {
+		.table = catalog->tables[HYPERTABLE_COLUMN_STATS].id,
+		.index = catalog->tables[HYPERTABLE_COLUMN_STATS].index_ids[HYPERTABLE_COLUMN_STATS_PKEY_IDX],
+		.scantype = ScannerTypeIndex,
+		.nkeys = 1,
+		.scankey = scankey,
+		.tuple_found = tuple_found,
+		.data = data,
+		.lockmode = lockmode,
+		.scandirection = ForwardScanDirection,
+	};
+
+	ScanKeyInit(&scankey[0], Anum_hypertable_column_stats_pkey_idx_hypertable_id,
+				BTEqualStrategyNumber, F_INT4EQ, Int32GetDatum(hypertable_id));
+
+	if (NULL != column_name)
+	{
+		ScanKeyInit(&scankey[1], Anum_hypertable_column_stats_pkey_idx_column_name,
+					BTEqualStrategyNumber, F_NAMEEQ,
+					DirectFunctionCall1(namein, CStringGetDatum(column_name)));
+		scanctx.nkeys = 2;
+	}
+
+	return scanner_scan(&scanctx);
+}
+
+static int
+chunk_column_stats_scan(int32 chunk_id, const char *column_name,
+						tuple_found_func tuple_found, void *data, LOCKMODE lockmode)
+{
+	Catalog    *catalog = catalog_get();
+	ScanKeyData scankey[2];
+	ScannerCtx	scanctx = {
+		.table = catalog->tables[CHUNK_COLUMN_STATS].id,
+		.index = catalog->tables[CHUNK_COLUMN_STATS].index_ids[CHUNK_COLUMN_STATS_PKEY_IDX],
+		.scantype = ScannerTypeIndex,
+		.nkeys = 1,
+		.scankey = scankey,
+		.tuple_found = tuple_found,
+		.data = data,
+		.lockmode = lockmode,
+		.scandirection = ForwardScanDirection,
+	};
+
+	ScanKeyInit(&scankey[0], Anum_chunk_column_stats_pkey_idx_chunk_id,
+				BTEqualStrategyNumber, F_INT4EQ, Int32GetDatum(chunk_id));
+
+	if (NULL != column_name)
+	{
+		ScanKeyInit(&scankey[1], Anum_chunk_column_stats_pkey_idx_column_name,
+					BTEqualStrategyNumber, F_NAMEEQ,
+					DirectFunctionCall1(namein, CStringGetDatum(column_name)));
+		scanctx.nkeys = 2;
+	}
+
+	return scanner_scan(&scanctx);
+}
+
+typedef struct StatsColumnsInfo
+{
+	Oid			relid;
+	List	   *columns;
+} StatsColumnsInfo;
+
+static void
+chunk_stats_column_init(ChunkStatsColumn *column, Oid relid, const char *column_name,
+						AttrNumber attno, bool bloom_filter)
+{
+	int32		typmod;
+
+	memset(column, 0, sizeof(ChunkStatsColumn));
+	namestrcpy(&column->name, column_name);
+	column->attno = attno;
+	get_atttypetypmodcoll(relid, attno, &column->type, &typmod, &column->collation);
+	column->min_max = column_type_supported(column->type);
+
+	if (bloom_filter)
+	{
+		TypeCacheEntry *tce = lookup_type_cache(column->type,
+												TYPECACHE_HASH_PROC | TYPECACHE_HASH_OPFAMILY);
+
+		column->bloom_filter = OidIsValid(tce->hash_proc);
+		column->hash_proc = tce->hash_proc;
+		column->hash_opfamily = tce->hash_opf;
+	}
+}
+
+static inline uint32
+chunk_stats_column_hash(FmgrInfo *hash_proc, ChunkStatsColumn *column, Datum value)
+{
+	return DatumGetUInt32(FunctionCall1Coll(hash_proc, column->collation, value));
+}
+
+static bool
+hypertable_column_stats_tuple_found(TupleInfo *ti, void *data)
+{
+	Form_hypertable_column_stats form = (Form_hypertable_column_stats) GETSTRUCT(ti->tuple);
+	StatsColumnsInfo *info = data;
+	ChunkStatsColumn *column;
+	AttrNumber	attno = get_attnum(info->relid, NameStr(form->column_name));
+
+	if (attno == InvalidAttrNumber)
+		return true;
+
+	column = palloc(sizeof(ChunkStatsColumn));
+	chunk_stats_column_init(column, info->relid, NameStr(form->column_name),
+							attno, form->bloom_filter);
+	info->columns = lappend(info->columns, column);
+
+	return true;
+}
+
+/*
+ * Get the columns of a hypertable that have per-chunk stats.
+ */
+List *
+chunk_column_stats_get_columns(int32 hypertable_id, Oid main_table_relid)
+{
+	StatsColumnsInfo info = {
+		.relid = main_table_relid,
+	};
+
+	if (!OidIsValid(main_table_relid))
+		return NIL;
+
+	hypertable_column_stats_scan(hypertable_id, NULL, hypertable_column_stats_tuple_found,
+								 &info, AccessShareLock);
+
+	return info.columns;
+}
+
+ChunkStatsColumn *
+chunk_column_stats_get_column(Hypertable *ht, const char *column_name)
+{
+	ListCell   *lc;
+
+	foreach(lc, ht->stats_columns)
+	{
+		ChunkStatsColumn *column = lfirst(lc);
+
+		if (namestrcmp(&column->name, column_name) == 0)
+			return column;
+	}
+
+	return NULL;
+}
+
+static void
+hypertable_column_stats_insert(int32 hypertable_id, const char *column_name, bool bloom_filter)
+{
+	Catalog    *catalog = catalog_get();
+	Relation	rel = heap_open(catalog->tables[HYPERTABLE_COLUMN_STATS].id, RowExclusiveLock);
+	Datum		values[Natts_hypertable_column_stats];
+	bool		nulls[Natts_hypertable_column_stats] = {false};
+	CatalogSecurityContext sec_ctx;
+
+	values[Anum_hypertable_column_stats_hypertable_id - 1] = Int32GetDatum(hypertable_id);
+	values[Anum_hypertable_column_stats_column_name - 1] =
+		DirectFunctionCall1(namein, CStringGetDatum(column_name));
+	values[Anum_hypertable_column_stats_bloom_filter - 1] = BoolGetDatum(bloom_filter);
+
+	catalog_become_owner(catalog, &sec_ctx);
+	catalog_insert_values(rel, RelationGetDescr(rel), values, nulls);
+	catalog_restore_user(&sec_ctx);
+
+	heap_close(rel, RowExclusiveLock);
+}
+
+static void
+chunk_column_stats_insert(int32 chunk_id, const char *column_name, ChunkStatsRange *range,
+						  bytea *bloom_filter)
+{
+	Catalog    *catalog = catalog_get();
+	Relation	rel = heap_open(catalog->tables[CHUNK_COLUMN_STATS].id, RowExclusiveLock);
+	Datum		values[Natts_chunk_column_stats];
+	bool		nulls[Natts_chunk_column_stats] = {false};
+	CatalogSecurityContext sec_ctx;
+
+	values[Anum_chunk_column_stats_chunk_id - 1] = Int32GetDatum(chunk_id);
+	values[Anum_chunk_column_stats_column_name - 1] =
+		DirectFunctionCall1(namein, CStringGetDatum(column_name));
+	values[Anum_chunk_column_stats_min_value - 1] = Int64GetDatum(range->min_value);
+	values[Anum_chunk_column_stats_max_value - 1] = Int64GetDatum(range->max_value);
+	values[Anum_chunk_column_stats_null_count - 1] = Int64GetDatum(range->null_count);
+	values[Anum_chunk_column_stats_valid - 1] = BoolGetDatum(true);
+
+	if (NULL == bloom_filter)
+		nulls[Anum_chunk_column_stats_bloom_filter - 1] = true;
+	else
+		values[Anum_chunk_column_stats_bloom_filter - 1] = PointerGetDatum(bloom_filter);
+
+	catalog_become_owner(catalog, &sec_ctx);
+	catalog_insert_values(rel, RelationGetDescr(rel), values, nulls);
+	catalog_restore_user(&sec_ctx);
+
+	heap_close(rel, RowExclusiveLock);
+}
+
+/*
+ * Create empty stats for a new chunk.
+ */
+void
+chunk_column_stats_create_for_chunk(Hypertable *ht, int32 chunk_id)
+{
+	ListCell   *lc;
+
+	foreach(lc, ht->stats_columns)
+	{
+		ChunkStatsColumn *column = lfirst(lc);
+		ChunkStatsRange range;
+
+		chunk_stats_range_init(&range);
+		chunk_column_stats_insert(chunk_id, NameStr(column->name), &range,
+								  column->bloom_filter ? bloom_filter_create() : NULL);
+	}
+}
+
+static bool
+column_stats_tuple_delete(TupleInfo *ti, void *data)
+{
+	CatalogSecurityContext sec_ctx;
+
+	catalog_become_owner(catalog_get(), &sec_ctx);
+	catalog_delete(ti->scanrel, ti->tuple);
+	catalog_restore_user(&sec_ctx);
+
+	return true;
+}
+
+int
+chunk_column_stats_delete_by_chunk_id(int32 chunk_id)
+{
+	return chunk_column_stats_scan(chunk_id, NULL, column_stats_tuple_delete,
+								   NULL, RowExclusiveLock);
+}
+
+static bool
+chunk_column_stats_tuple_invalidate(TupleInfo *ti, void *data)
+{
+	HeapTuple	tuple;
+
+	if (!((Form_chunk_column_stats) GETSTRUCT(ti->tuple))->valid)
+		return true;
+
+	tuple = heap_copytuple(ti->tuple);
+	((Form_chunk_column_stats) GETSTRUCT(tuple))->valid = false;
+	heap_inplace_update(ti->scanrel, tuple);
+	heap_freetuple(tuple);
+
+	return true;
+}
+
+/*
+ * Mark the stats of a chunk's column, or of all its columns if column_name is
+ * NULL, as invalid. Like the updates of the stats, this happens in place, so
+ * that it also holds if the transaction that made the stats invalid aborts.
+ */
+void
+chunk_column_stats_invalidate(int32 chunk_id, const char *column_name)
+{
+	chunk_column_stats_scan(chunk_id, column_name, chunk_column_stats_tuple_invalidate,
+							NULL, RowExclusiveLock);
+}
+
+static bool
+stop_at_first_tuple(TupleInfo *ti, void *data)
+{
+	return false;
+}
+
+static bool
+chunk_column_stats_in_use(void)
+{
+	while (stats_in_use == STATS_IN_USE_UNKNOWN)
+	{
+		Catalog    *catalog = catalog_get();
+		uint32		generation = stats_in_use_generation;
+		ScannerCtx	scanctx = {
+			.table = catalog->tables[HYPERTABLE_COLUMN_STATS].id,
+			.scantype = ScannerTypeHeap,
+			.tuple_found = stop_at_first_tuple,
+			.lockmode = AccessShareLock,
+			.scandirection = ForwardScanDirection,
+		};
+		bool		found = scanner_scan(&scanctx) > 0;
+
+		if (generation == stats_in_use_generation)
+			stats_in_use = found ? STATS_IN_USE_YES : STATS_IN_USE_NO;
+	}
+
+	return stats_in_use == STATS_IN_USE_YES;
+}
+
+void
+chunk_column_stats_cache_invalidate(void)
+{
+	stats_in_use = STATS_IN_USE_UNKNOWN;
+	stats_in_use_generation++;
+}
+
+/*
+ * Get the hypertable of a chunk, if the hypertable has stats columns.
+ */
+static Hypertable *
+chunk_get_stats_hypertable(Cache *hcache, Oid relid, Chunk **chunk)
+{
+	Hypertable *ht;
+
+	if (NULL != hypertable_cache_get_entry(hcache, relid))
+		return NULL;
+
+	*chunk = chunk_get_by_relid(relid, 0, false);
+
+	if (NULL == *chunk)
+		return NULL;
+
+	ht = hypertable_cache_get_entry(hcache, (*chunk)->hypertable_relid);
+
+	if (NULL == ht || ht->stats_columns == NIL)
+		return NULL;
+
+	return ht;
+}
+
+/*
+ * Invalidate all stats of a chunk before rows are written to it directly,
+ * e.g., via COPY, rather than via its hypertable.
+ */
+void
+chunk_column_stats_invalidate_by_relid(Oid relid)
+{
+	Cache	   *hcache;
+	Chunk	   *chunk;
+
+	if (!chunk_column_stats_in_use())
+		return;
+
+	hcache = hypertable_cache_pin();
+
+	if (NULL != chunk_get_stats_hypertable(hcache, relid, &chunk))
+		chunk_column_stats_invalidate(chunk->fd.id, NULL);
+
+	cache_release(hcache);
+}
+
+/*
+ * Invalidate the stats that a statement might make stale. Inserts via the
+ * hypertable maintain the stats, but direct inserts into chunks and UPDATEs
+ * of stats columns do not.
+ */
+void
+chunk_column_stats_invalidate_for_statement(PlannedStmt *stmt)
+{
+	Cache	   *hcache;
+	ListCell   *lc;
+
+	if ((stmt->commandType != CMD_INSERT && stmt->commandType != CMD_UPDATE) ||
+		!chunk_column_stats_in_use())
+		return;
+
+	hcache = hypertable_cache_pin();
+
+	foreach(lc, stmt->resultRelations)
+	{
+		RangeTblEntry *rte = rt_fetch(lfirst_int(lc), stmt->rtable);
+		Chunk	   *chunk;
+		Hypertable *ht = chunk_get_stats_hypertable(hcache, rte->relid, &chunk);
+		ListCell   *lc_col;
+
+		if (NULL == ht)
+			continue;
+
+		if (stmt->commandType == CMD_INSERT)
+		{
+			chunk_column_stats_invalidate(chunk->fd.id, NULL);
+			continue;
+		}
+
+		foreach(lc_col, ht->stats_columns)
+		{
+			ChunkStatsColumn *column = lfirst(lc_col);
+			AttrNumber	attno = get_attnum(rte->relid, NameStr(column->name));
+
+			if (bms_is_member(attno - FirstLowInvalidHeapAttributeNumber, rte->updatedCols))
+				chunk_column_stats_invalidate(chunk->fd.id, NameStr(column->name));
+		}
+	}
+
+	cache_release(hcache);
+}
+
+/*
+ * Rename the column of a stats tuple. Both stats catalog tables start with an
+ * int32 ID followed by the column name, so this works on either of them.
+ */
+static bool
+column_stats_tuple_rename(TupleInfo *ti, void *data)
+{
+	HeapTuple	tuple = heap_copytuple(ti->tuple);
+	CatalogSecurityContext sec_ctx;
+
+	namestrcpy(&((Form_hypertable_column_stats) GETSTRUCT(tuple))->column_name, data);
+
+	catalog_become_owner(catalog_get(), &sec_ctx);
+	catalog_update(ti->scanrel, tuple);
+	catalog_restore_user(&sec_ctx);
+
+	heap_freetuple(tuple);
+
+	return true;
+}
+
+static int32
+chunk_relid_get_id(Oid chunk_relid)
+{
+	Chunk	   *chunk = chunk_get_by_relid(chunk_relid, 0, false);
+
+	return NULL == chunk ? 0 : chunk->fd.id;
+}
+
+/*
+ * Update the stats of a hypertable after one of its columns was renamed.
+ */
+void
+chunk_column_stats_rename_column(Hypertable *ht, const char *old_name, const char *new_name)
+{
+	List	   *chunks;
+	ListCell   *lc;
+
+	if (NULL == chunk_column_stats_get_column(ht, old_name))
+		return;
+
+	hypertable_column_stats_scan(ht->fd.id, old_name, column_stats_tuple_rename,
+								 (void *) new_name, RowExclusiveLock);
+
+	chunks = find_inheritance_children(ht->main_table_relid, NoLock);
+
+	foreach(lc, chunks)
+	{
+		int32		chunk_id = chunk_relid_get_id(lfirst_oid(lc));
+
+		if (chunk_id > 0)
+			chunk_column_stats_scan(chunk_id, old_name, column_stats_tuple_rename,
+									(void *) new_name, RowExclusiveLock);
+	}
+
+	catalog_invalidate_hypertable(ht->main_table_relid);
+}
+
+/*
+ * Remove a column's stats from a hypertable and all its chunks.
+ */
+static void
+column_stats_delete(Hypertable *ht, const char *column_name)
+{
+	List	   *chunks;
+	ListCell   *lc;
+
+	hypertable_column_stats_scan(ht->fd.id, column_name, column_stats_tuple_delete,
+								 NULL, RowExclusiveLock);
+
+	chunks = find_inheritance_children(ht->main_table_relid, NoLock);
+
+	foreach(lc, chunks)
+	{
+		int32		chunk_id = chunk_relid_get_id(lfirst_oid(lc));
+
+		if (chunk_id > 0)
+			chunk_column_stats_scan(chunk_id, column_name, column_stats_tuple_delete,
+									NULL, RowExclusiveLock);
+	}
+
+	catalog_invalidate_hypertable(ht->main_table_relid);
+}
+
+void
+chunk_column_stats_drop_column(Hypertable *ht, const char *column_name)
+{
+	if (NULL != chunk_column_stats_get_column(ht, column_name))
+		column_stats_delete(ht, column_name);
+}
+
+/*
+ * Create the state that tracks the stats of the rows inserted into a chunk.
+ * The tuples are expected in the layout of the hypertable's main table, as
+ * given by tupdesc. Returns NULL if the hypertable has no stats columns.
+ */
+ChunkStatsInsertState *
+chunk_column_stats_insert_state_create(Hypertable *ht, int32 chunk_id, TupleDesc tupdesc)
+{
+	ChunkStatsInsertState *state;
+	ListCell   *lc;
+	int			i = 0;
+
+	if (ht->stats_columns == NIL)
+		return NULL;
+
+	state = palloc0(sizeof(ChunkStatsInsertState));
+	state->chunk_id = chunk_id;
+	state->tupdesc = CreateTupleDescCopy(tupdesc);
+	state->num_columns = list_length(ht->stats_columns);
+	state->columns = palloc(sizeof(ChunkStatsColumn *) * state->num_columns);
+	state->ranges = palloc(sizeof(ChunkStatsRange) * state->num_columns);
+	state->bloom_filters = palloc0(sizeof(bytea *) * state->num_columns);
+	state->hash_procs = palloc0(sizeof(FmgrInfo) * state->num_columns);
+
+	foreach(lc, ht->stats_columns)
+	{
+		ChunkStatsColumn *column = lfirst(lc);
+
+		state->columns[i] = column;
+		chunk_stats_range_init(&state->ranges[i]);
+
+		if (column->bloom_filter)
+		{
+			state->bloom_filters[i] = bloom_filter_create();
+			fmgr_info(column->hash_proc, &state->hash_procs[i]);
+		}
+		i++;
+	}
+
+	return state;
+}
+
+void
+chunk_column_stats_insert_state_add(ChunkStatsInsertState *state, HeapTuple tuple)
+{
+	int			i;
+
+	state->num_tuples++;
+
+	for (i = 0; i < state->num_columns; i++)
+	{
+		ChunkStatsColumn *column = state->columns[i];
+		bool		isnull;
+		Datum		value = heap_getattr(tuple, column->attno, state->tupdesc, &isnull);
+
+		chunk_stats_range_add(&state->ranges[i], value, isnull, column);
+
+		if (NULL != state->bloom_filters[i] && !isnull)
+			bloom_filter_add(state->bloom_filters[i],
+							 chunk_stats_column_hash(&state->hash_procs[i], column, value));
+	}
+}
+
+typedef struct StatsMergeInfo
+{
+	ChunkStatsRange *range;
+	bytea	   *bloom_filter;
+} StatsMergeInfo;
+
+static bool
+chunk_column_stats_tuple_merge(TupleInfo *ti, void *data)
+{
+	StatsMergeInfo *info = data;
+	ChunkStatsRange *range = info->range;
+	Form_chunk_column_stats form = (Form_chunk_column_stats) GETSTRUCT(ti->tuple);
+	HeapTuple	tuple;
+	bool		changed = false;
+
+	if (!form->valid)
+		return false;
+
+	tuple = heap_copytuple(ti->tuple);
+	form = (Form_chunk_column_stats) GETSTRUCT(tuple);
+
+	if (form->min_value > range->min_value ||
+		form->max_value < range->max_value ||
+		range->null_count > 0)
+	{
+		form->min_value = Min(form->min_value, range->min_value);
+		form->max_value = Max(form->max_value, range->max_value);
+		form->null_count += range->null_count;
+		changed = true;
+	}
+
+	if (NULL != info->bloom_filter)
+	{
+		bool		isnull;
+		Datum		filter = heap_getattr(tuple, Anum_chunk_column_stats_bloom_filter,
+										  ti->desc, &isnull);
+
+		/*
+		 * The filter is stored inline and uncompressed (STORAGE PLAIN), so
+		 * its bits can be set directly in the copy of the tuple
+		 */
+		if (!isnull)
+		{
+			if (VARATT_IS_EXTENDED(DatumGetPointer(filter)))
+				elog(ERROR, "unexpected compressed or external Bloom filter");
+
+			if (bloom_filter_merge((bytea *) DatumGetPointer(filter), info->bloom_filter))
+				changed = true;
+		}
+	}
+
+	if (changed)
+		heap_inplace_update(ti->scanrel, tuple);
+
+	heap_freetuple(tuple);
+
+	return false;
+}
+
+/*
+ * Merge the stats of the inserted rows into the chunk's stats.
+ *
+ * Concurrent inserts into the same chunk serialize on a lock on the chunk's
+ * stats, which is only held while the stats are merged.
+ */
+void
+chunk_column_stats_insert_state_finish(ChunkStatsInsertState *state)
+{
+	Catalog    *catalog = catalog_get();
+	int			i;
+
+	if (NULL == state || state->num_tuples == 0)
+		return;
+
+	for (i = 0; i < state->num_columns; i++)
+	{
+		StatsMergeInfo info = {
+			.range = &state->ranges[i],
+			.bloom_filter = state->bloom_filters[i],
+		};
+
+		LockDatabaseObject(catalog->tables[CHUNK_COLUMN_STATS].id, state->chunk_id, 0, ExclusiveLock);
+		chunk_column_stats_scan(state->chunk_id, NameStr(state->columns[i]->name),
+								chunk_column_stats_tuple_merge, &info, RowExclusiveLock);
+		UnlockDatabaseObject(catalog->tables[CHUNK_COLUMN_STATS].id, state->chunk_id, 0, ExclusiveLock);
+	}
+}
+
+/*
+ * The hashes of the values that an equality or IN restriction asks for. A
+ * chunk can only match if its Bloom filter contains at least one of them.
+ */
+typedef struct BloomProbe
+{
+	int			num_hashes;
+	uint32		hashes[FLEXIBLE_ARRAY_MEMBER];
+} BloomProbe;
+
+/*
+ * The restriction of a query on a stats column: the inclusive range
+ * [min_value, max_value] that the column's values must be in, whether the
+ * column must be NULL, and the Bloom filter probes.
+ */
+typedef struct ColumnStatsRestrict
+{
+	ChunkStatsColumn *column;
+	bool		restricted;
+	bool		range_restricted;
+	bool		is_null;
+	/* Set if no value can fulfill the restriction */
+	bool		empty;
+	int64		min_value;
+	int64		max_value;
+	List	   *bloom_probes;
+} ColumnStatsRestrict;
+
+struct ChunkStatsRestrict
+{
+	Index		rti;
+	bool		restricted;
+	int			num_columns;
+	ColumnStatsRestrict columns[FLEXIBLE_ARRAY_MEMBER];
+};
+
+static void
+column_stats_restrict_update(ColumnStatsRestrict *cr, StrategyNumber strategy, int64 value)
+{
+	int64		min_value = PG_INT64_MIN;
+	int64		max_value = PG_INT64_MAX;
+
+	switch (strategy)
+	{
+		case BTLessStrategyNumber:
+			if (value == PG_INT64_MIN)
+				cr->empty = true;
+			else
+				max_value = value - 1;
+			break;
+		case BTLessEqualStrategyNumber:
+			max_value = value;
+			break;
+		case BTEqualStrategyNumber:
+			min_value = value;
+			max_value = value;
+			break;
+		case BTGreaterEqualStrategyNumber:
+			min_value = value;
+			break;
+		case BTGreaterStrategyNumber:
+			if (value == PG_INT64_MAX)
+				cr->empty = true;
+			else
+				min_value = value + 1;
+			break;
+		default:
+			return;
+	}
+
+	cr->restricted = true;
+	cr->range_restricted = true;
+	cr->min_value = Max(cr->min_value, min_value);
+	cr->max_value = Min(cr->max_value, max_value);
+
+	if (cr->min_value > cr->max_value)
+		cr->empty = true;
+}
+
+static ColumnStatsRestrict *
+chunk_stats_restrict_get_column(ChunkStatsRestrict *sr, Var *var)
+{
+	int			i;
+
+	if (var->varno != sr->rti || var->varlevelsup != 0)
+		return NULL;
+
+	for (i = 0; i < sr->num_columns; i++)
+		if (sr->columns[i].column->attno == var->varattno)
+			return &sr->columns[i];
+
+	return NULL;
+}
+
+/*
+ * Add a Bloom filter probe for the values of an equality restriction. The
+ * values can be of any type in the hash operator family of the column, since
+ * the hash functions of an operator family are compatible.
+ */
+static bool
+column_stats_restrict_add_bloom_probe(ColumnStatsRestrict *cr, Oid opno, Oid type,
+									  Datum *values, bool *nulls, int num_values)
+{
+	ChunkStatsColumn *column = cr->column;
+	BloomProbe *probe;
+	FmgrInfo	hash_proc;
+	Oid			hash_procid;
+	int			i;
+
+	if (!column->bloom_filter ||
+		get_op_opfamily_strategy(opno, column->hash_opfamily) != HTEqualStrategyNumber)
+		return false;
+
+	if (type == column->type)
+		hash_procid = column->hash_proc;
+	else
+		hash_procid = get_opfamily_proc(column->hash_opfamily, type, type, HASHPROC);
+
+	if (!OidIsValid(hash_procid))
+		return false;
+
+	fmgr_info(hash_procid, &hash_proc);
+
+	probe = palloc(offsetof(BloomProbe, hashes) + sizeof(uint32) * num_values);
+	probe->num_hashes = 0;
+
+	/* NULLs never compare equal, so they need not be probed */
+	for (i = 0; i < num_values; i++)
+		if (NULL == nulls || !nulls[i])
+			probe->hashes[probe->num_hashes++] =
+				chunk_stats_column_hash(&hash_proc, column, values[i]);
+
+	cr->bloom_probes = lappend(cr->bloom_probes, probe);
+	cr->restricted = true;
+
+	return true;
+}
+
+static void
+chunk_stats_restrict_add_opexpr(ChunkStatsRestrict *sr, OpExpr *op)
+{
+	ColumnStatsRestrict *cr;
+	StrategyNumber strategy;
+	Var		   *var;
+	Const	   *c;
+	Oid			opno;
+	int64		value;
+
+	if (!hypertable_restrict_get_var_const(op, &var, &c, &opno) || c->constisnull)
+		return;
+
+	cr = chunk_stats_restrict_get_column(sr, var);
+
+	if (NULL == cr)
+		return;
+
+	if (column_stats_restrict_add_bloom_probe(cr, opno, c->consttype, &c->constvalue, NULL, 1))
+		sr->restricted = true;
+
+	if (!cr->column->min_max)
+		return;
+
+	strategy = hypertable_restrict_operator_strategy(cr->column->type, opno);
+
+	if (strategy == InvalidStrategy ||
+		!hypertable_restrict_const_to_internal(cr->column->type, c, &value))
+		return;
+
+	column_stats_restrict_update(cr, strategy, value);
+	sr->restricted = true;
+}
+
+/*
+ * Add a "column = ANY(array)" restriction, i.e., an IN list, as a Bloom filter
+ * probe.
+ */
+static void
+chunk_stats_restrict_add_scalararrayopexpr(ChunkStatsRestrict *sr, ScalarArrayOpExpr *saop)
+{
+	ColumnStatsRestrict *cr;
+	Node	   *left = linitial(saop->args);
+	Node	   *right = lsecond(saop->args);
+	ArrayType  *arr;
+	Oid			elemtype;
+	int16		elmlen;
+	bool		elmbyval;
+	char		elmalign;
+	Datum	   *values;
+	bool	   *nulls;
+	int			num_values;
+
+	if (!saop->useOr)
+		return;
+
+	if (IsA(left, RelabelType))
+		left = (Node *) ((RelabelType *) left)->arg;
+
+	if (!IsA(left, Var) || !IsA(right, Const) || ((Const *) right)->constisnull)
+		return;
+
+	cr = chunk_stats_restrict_get_column(sr, (Var *) left);
+
+	if (NULL == cr || !cr->column->bloom_filter)
+		return;
+
+	arr = DatumGetArrayTypeP(((Const *) right)->constvalue);
+	elemtype = ARR_ELEMTYPE(arr);
+	get_typlenbyvalalign(elemtype, &elmlen, &elmbyval, &elmalign);
+	deconstruct_array(arr, elemtype, elmlen, elmbyval, elmalign, &values, &nulls, &num_values);
+
+	if (column_stats_restrict_add_bloom_probe(cr, saop->opno, elemtype, values, nulls, num_values))
+		sr->restricted = true;
+}
+
+static void
+chunk_stats_restrict_add_nulltest(ChunkStatsRestrict *sr, NullTest *nt)
+{
+	ColumnStatsRestrict *cr;
+	Node	   *arg = (Node *) nt->arg;
+
+	if (nt->nulltesttype != IS_NULL || nt->argisrow)
+		return;
+
+	if (IsA(arg, RelabelType))
+		arg = (Node *) ((RelabelType *) arg)->arg;
+
+	if (!IsA(arg, Var))
+		return;
+
+	cr = chunk_stats_restrict_get_column(sr, (Var *) arg);
+
+	if (NULL == cr)
+		return;
+
+	cr->restricted = true;
+	cr->is_null = true;
+	sr->restricted = true;
+}
+
+static void
+chunk_stats_restrict_add_qual(ChunkStatsRestrict *sr, Node *qual)
+{
+	ListCell   *lc;
+
+	if (and_clause(qual))
+	{
+		foreach(lc, ((BoolExpr *) qual)->args)
+			chunk_stats_restrict_add_qual(sr, lfirst(lc));
+	}
+	else if (IsA(qual, OpExpr))
+		chunk_stats_restrict_add_opexpr(sr, (OpExpr *) qual);
+	else if (IsA(qual, ScalarArrayOpExpr))
+		chunk_stats_restrict_add_scalararrayopexpr(sr, (ScalarArrayOpExpr *) qual);
+	else if (IsA(qual, NullTest))
+		chunk_stats_restrict_add_nulltest(sr, (NullTest *) qual);
+}
+
+/*
+ * Create the restriction on the stats columns of a hypertable from a list of
+ * (constified) restriction clauses. Returns NULL if the clauses do not
+ * restrict any stats column.
+ */
+ChunkStatsRestrict *
+chunk_stats_restrict_create(Index rti, Hypertable *ht, List *restrictinfos)
+{
+	ChunkStatsRestrict *sr;
+	ListCell   *lc;
+	int			i = 0;
+
+	if (NULL == ht || ht->stats_columns == NIL)
+		return NULL;
+
+	sr = palloc0(sizeof(ChunkStatsRestrict) +
+				 sizeof(ColumnStatsRestrict) * list_length(ht->stats_columns));
+	sr->rti = rti;
+	sr->num_columns = list_length(ht->stats_columns);
+
+	foreach(lc, ht->stats_columns)
+	{
+		sr->columns[i].column = lfirst(lc);
+		sr->columns[i].min_value = PG_INT64_MIN;
+		sr->columns[i].max_value = PG_INT64_MAX;
+		i++;
+	}
+
+	foreach(lc, restrictinfos)
+		chunk_stats_restrict_add_qual(sr, (Node *) ((RestrictInfo *) lfirst(lc))->clause);
+
+	if (!sr->restricted)
+	{
+		pfree(sr);
+		return NULL;
+	}
+
+	return sr;
+}
+
+/*
+ * Check if a chunk's Bloom filter might contain the values of all probes.
+ */
+static bool
+bloom_probes_match(List *probes, TupleInfo *ti)
+{
+	bool		isnull;
+	Datum		datum = heap_getattr(ti->tuple, Anum_chunk_column_stats_bloom_filter,
+									 ti->desc, &isnull);
+	bytea	   *filter;
+	ListCell   *lc;
+
+	if (isnull)
+		return true;
+
+	filter = DatumGetByteaPP(datum);
+
+	foreach(lc, probes)
+	{
+		BloomProbe *probe = lfirst(lc);
+		bool		found = false;
+		int			i;
+
+		for (i = 0; i < probe->num_hashes && !found; i++)
+			found = bloom_filter_contains(filter, probe->hashes[i]);
+
+		if (!found)
+			return false;
+	}
+
+	return true;
+}
+
+typedef struct StatsMatchInfo
+{
+	ChunkStatsRestrict *sr;
+	bool		excluded;
+} StatsMatchInfo;
+
+static bool
+chunk_column_stats_tuple_match(TupleInfo *ti, void *data)
+{
+	Form_chunk_column_stats form = (Form_chunk_column_stats) GETSTRUCT(ti->tuple);
+	StatsMatchInfo *info = data;
+	int			i;
+
+	if (!form->valid)
+		return true;
+
+	for (i = 0; i < info->sr->num_columns; i++)
+	{
+		ColumnStatsRestrict *cr = &info->sr->columns[i];
+
+		if (!cr->restricted || namestrcmp(&form->column_name, NameStr(cr->column->name)) != 0)
+			continue;
+
+		if (cr->empty ||
+			(cr->is_null && form->null_count == 0) ||
+			(cr->range_restricted &&
+			 (form->min_value > form->max_value ||
+			  form->max_value < cr->min_value ||
+			  form->min_value > cr->max_value)) ||
+			(cr->bloom_probes != NIL && !bloom_probes_match(cr->bloom_probes, ti)))
+		{
+			info->excluded = true;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Check if the stats of a chunk might match the restriction. Chunks without
+ * (valid) stats always match.
+ */
+bool
+chunk_stats_restrict_match_chunk(ChunkStatsRestrict *sr, int32 chunk_id)
+{
+	StatsMatchInfo info = {
+		.sr = sr,
+	};
+
+	chunk_column_stats_scan(chunk_id, NULL, chunk_column_stats_tuple_match,
+							&info, AccessShareLock);
+
+	return !info.excluded;
+}
+
+#define BLOOM_FILTER_FETCH_SIZE 1000
+
+/*
+ * Compute the stats of a column of an existing chunk. The chunk is queried
+ * via SPI, so that the rows of compressed chunks are included.
+ */
+static void
+chunk_column_stats_compute(Oid chunk_relid, ChunkStatsColumn *column, ChunkStatsRange *range)
+{
+	const char *colname = quote_identifier(NameStr(column->name));
+	const char *chunk_name = quote_qualified_identifier(get_namespace_name(get_rel_namespace(chunk_relid)),
+														get_rel_name(chunk_relid));
+	StringInfoData command;
+	bool		isnull;
+	Datum		value;
+
+	initStringInfo(&command);
+
+	if (column->min_max)
+		appendStringInfo(&command, "SELECT min(%s), max(%s), count(*) - count(%s) FROM %s",
+						 colname, colname, colname, chunk_name);
+	else
+		appendStringInfo(&command, "SELECT NULL, NULL, count(*) - count(%s) FROM %s",
+						 colname, chunk_name);
+
+	if (SPI_execute(command.data, true, 0) != SPI_OK_SELECT || SPI_processed != 1)
+		elog(ERROR, "could not compute stats of column \"%s\" of chunk \"%s\"",
+			 NameStr(column->name), get_rel_name(chunk_relid));
+
+	chunk_stats_range_init(range);
+
+	value = SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 1, &isnull);
+
+	if (!isnull)
+		range->min_value = stats_value_to_internal(value, column->type);
+
+	value = SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 2, &isnull);
+
+	if (!isnull)
+		range->max_value = stats_value_to_internal(value, column->type);
+
+	range->null_count = DatumGetInt64(SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 3, &isnull));
+
+	SPI_freetuptable(SPI_tuptable);
+}
+
+/*
+ * Build the Bloom filter of a column of an existing chunk. The values are
+ * fetched in batches via a cursor to bound memory usage on large chunks.
+ */
+static bytea *
+chunk_column_stats_compute_bloom_filter(Oid chunk_relid, ChunkStatsColumn *column)
+{
+	const char *colname = quote_identifier(NameStr(column->name));
+	bytea	   *filter = bloom_filter_create();
+	StringInfoData command;
+	FmgrInfo	hash_proc;
+	Portal		portal;
+
+	fmgr_info(column->hash_proc, &hash_proc);
+
+	initStringInfo(&command);
+	appendStringInfo(&command, "SELECT %s FROM %s WHERE %s IS NOT NULL",
+					 colname,
+			  quote_qualified_identifier(get_namespace_name(get_rel_namespace(chunk_relid)),
+										 get_rel_name(chunk_relid)),
+					 colname);
+
+	portal = SPI_cursor_open_with_args(NULL, command.data, 0, NULL, NULL, NULL, true, 0);
+
+	if (NULL == portal)
+		elog(ERROR, "could not compute the Bloom filter of column \"%s\" of chunk \"%s\"",
+			 NameStr(column->name), get_rel_name(chunk_relid));
+
+	for (;;)
+	{
+		uint64		i;
+
+		SPI_cursor_fetch(portal, true, BLOOM_FILTER_FETCH_SIZE);
+
+		if (SPI_processed == 0)
+			break;
+
+		for (i = 0; i < SPI_processed; i++)
+		{
+			bool		isnull;
+			Datum		value = SPI_getbinval(SPI_tuptable->vals[i], SPI_tuptable->tupdesc, 1, &isnull);
+
+			if (!isnull)
+				bloom_filter_add(filter, chunk_stats_column_hash(&hash_proc, column, value));
+		}
+
+		SPI_freetuptable(SPI_tuptable);
+	}
+
+	SPI_freetuptable(SPI_tuptable);
+	SPI_cursor_close(portal);
+
+	return filter;
+}
+
+static Hypertable *
+chunk_skipping_get_hypertable(Cache *hcache, Oid relid)
+{
+	Hypertable *ht;
+
+	hypertable_permissions_check(relid, GetUserId());
+
+	/* Block inserts while the stats are changed */
+	LockRelationOid(relid, ShareLock);
+
+	ht = hypertable_cache_get_entry(hcache, relid);
+
+	if (NULL == ht)
+		ereport(ERROR,
+				(errcode(ERRCODE_IO_HYPERTABLE_NOT_EXIST),
+				 errmsg("Table \"%s\" is not a hypertable", get_rel_name(relid))));
+
+	return ht;
+}
+
+/*
+ * Enable chunk skipping on a column of a hypertable, optionally with Bloom
+ * filters. Computes the stats of the column for all existing chunks.
+ */
+Datum
+enable_chunk_skipping(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	Name		column_name = PG_GETARG_NAME(1);
+	bool		bloom_filter = PG_GETARG_BOOL(2);
+	Cache	   *hcache = hypertable_cache_pin();
+	Hypertable *ht = chunk_skipping_get_hypertable(hcache, relid);
+	AttrNumber	attno = get_attnum(relid, NameStr(*column_name));
+	ChunkStatsColumn column;
+	List	   *chunks;
+	ListCell   *lc;
+
+	if (attno == InvalidAttrNumber)
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_COLUMN),
+				 errmsg("Column \"%s\" does not exist", NameStr(*column_name))));
+
+	chunk_stats_column_init(&column, relid, NameStr(*column_name), attno, bloom_filter);
+
+	if (bloom_filter && !column.bloom_filter)
+		ereport(ERROR,
+				(errcode(ERRCODE_IO_OPERATION_NOT_SUPPORTED),
+				 errmsg("Bloom filters are not supported on columns of type %s",
+						format_type_be(column.type)),
+				 errhint("Bloom filters require a type with a hash function.")));
+
+	if (!bloom_filter && !column.min_max)
+		ereport(ERROR,
+				(errcode(ERRCODE_IO_OPERATION_NOT_SUPPORTED),
+				 errmsg("Chunk skipping is not supported on columns of type %s",
+						format_type_be(column.type)),
+				 errhint("Chunk skipping supports integer, timestamp and date columns. "
+						 "Other columns require bloom_filter => true.")));
+
+	if (NULL != chunk_column_stats_get_column(ht, NameStr(*column_name)))
+		ereport(ERROR,
+				(errcode(ERRCODE_DUPLICATE_OBJECT),
+				 errmsg("Chunk skipping is already enabled on column \"%s\"",
+						NameStr(*column_name))));
+
+	hypertable_column_stats_insert(ht->fd.id, NameStr(*column_name), bloom_filter);
+
+	/* Also waits for direct inserts into chunks to finish */
+	chunks = find_inheritance_children(relid, ShareLock);
+
+	if (chunks != NIL && SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "Could not connect to SPI");
+
+	foreach(lc, chunks)
+	{
+		Oid			chunk_relid = lfirst_oid(lc);
+		int32		chunk_id = chunk_relid_get_id(chunk_relid);
+		ChunkStatsRange range;
+		bytea	   *filter = NULL;
+
+		if (chunk_id <= 0)
+			continue;
+
+		chunk_column_stats_compute(chunk_relid, &column, &range);
+
+		if (column.bloom_filter)
+			filter = chunk_column_stats_compute_bloom_filter(chunk_relid, &column);
+
+		chunk_column_stats_insert(chunk_id, NameStr(*column_name), &range, filter);
+	}
+
+	if (chunks != NIL)
+		SPI_finish();
+
+	catalog_invalidate_hypertable(relid);
+	cache_release(hcache);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Disable chunk skipping on a column of a hypertable and remove the stats of
+ * the column.
+ */
+Datum
+disable_chunk_skipping(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	Name		column_name = PG_GETARG_NAME(1);
+	Cache	   *hcache = hypertable_cache_pin();
+	Hypertable *ht = chunk_skipping_get_hypertable(hcache, relid);
+
+	if (NULL == chunk_column_stats_get_column(ht, NameStr(*column_name)))
+		ereport(ERROR,
+				(errcode(ERRCODE_IO_OPERATION_NOT_SUPPORTED),
+				 errmsg("Chunk skipping is not enabled on column \"%s\"",
+						NameStr(*column_name))));
+
+	column_stats_delete(ht, NameStr(*column_name));
+	cache_release(hcache);
+
+	PG_RETURN_VOID();
+}
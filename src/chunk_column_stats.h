@@ -0,0 +1,75 @@
+#ifndef TIMESCALEDB_CHUNK_COLUMN_STATS_H
+#define TIMESCALEDB_CHUNK_COLUMN_STATS_H
+
+#include <postgres.h>
+#include <access/htup.h>
+#include <access/tupdesc.h>
+#include <fmgr.h>
+#include <nodes/pg_list.h>
+#include <nodes/plannodes.h>
+
+typedef struct Hypertable Hypertable;
+
+/* A hypertable column that has per-chunk stats */
+typedef struct ChunkStatsColumn
+{
+	NameData	name;
+	/* Attribute number in the hypertable's main table */
+	AttrNumber	attno;
+	Oid			type;
+	Oid			collation;
+	/* Whether the chunks have the range of values of the column */
+	bool		min_max;
+	/* Whether the chunks have a Bloom filter of the column's values */
+	bool		bloom_filter;
+	/* Hash function and operator family used for the Bloom filter */
+	Oid			hash_proc;
+	Oid			hash_opfamily;
+} ChunkStatsColumn;
+
+/*
+ * The range of values and the number of NULLs of a column in a chunk. An empty
+ * range has min_value > max_value.
+ */
+typedef struct ChunkStatsRange
+{
+	int64		min_value;
+	int64		max_value;
+	int64		null_count;
+} ChunkStatsRange;
+
+/* Stats of the rows inserted into a chunk by a statement */
+typedef struct ChunkStatsInsertState
+{
+	int32		chunk_id;
+	TupleDesc	tupdesc;
+	int64		num_tuples;
+	int			num_columns;
+	ChunkStatsColumn **columns;
+	ChunkStatsRange *ranges;
+	/* Bloom filters and their hash functions; NULL for columns without one */
+	bytea	  **bloom_filters;
+	FmgrInfo   *hash_procs;
+} ChunkStatsInsertState;
+
+typedef struct ChunkStatsRestrict ChunkStatsRestrict;
+
+extern List *chunk_column_stats_get_columns(int32 hypertable_id, Oid main_table_relid);
+extern ChunkStatsColumn *chunk_column_stats_get_column(Hypertable *ht, const char *column_name);
+extern void chunk_column_stats_create_for_chunk(Hypertable *ht, int32 chunk_id);
+extern int	chunk_column_stats_delete_by_chunk_id(int32 chunk_id);
+extern void chunk_column_stats_invalidate(int32 chunk_id, const char *column_name);
+extern void chunk_column_stats_invalidate_by_relid(Oid relid);
+extern void chunk_column_stats_invalidate_for_statement(PlannedStmt *stmt);
+extern void chunk_column_stats_cache_invalidate(void);
+extern void chunk_column_stats_rename_column(Hypertable *ht, const char *old_name, const char *new_name);
+extern void chunk_column_stats_drop_column(Hypertable *ht, const char *column_name);
+
+extern ChunkStatsInsertState *chunk_column_stats_insert_state_create(Hypertable *ht, int32 chunk_id, TupleDesc tupdesc);
+extern void chunk_column_stats_insert_state_add(ChunkStatsInsertState *state, HeapTuple tuple);
+extern void chunk_column_stats_insert_state_finish(ChunkStatsInsertState *state);
+
+extern ChunkStatsRestrict *chunk_stats_restrict_create(Index rti, Hypertable *ht, List *restrictinfos);
+extern bool chunk_stats_restrict_match_chunk(ChunkStatsRestrict *sr, int32 chunk_id);
+
+#endif   /* TIMESCALEDB_CHUNK_COLUMN_STATS_H */
@@ -378,6 +378,59 @@ chunk_constraint_scan_by_chunk_id(int32 chunk_id, Size num_constraints_hint)
 	return constraints;
 }
 
+static bool
+chunk_constraint_chunk_id_range_tuple_found(TupleInfo *ti, void *data)
+{
+	HTAB	   *chunks = data;
+	FormData_chunk_constraint *form = (FormData_chunk_constraint *) GETSTRUCT(ti->tuple);
+	ChunkScanEntry *entry = hash_search(chunks, &form->chunk_id, HASH_FIND, NULL);
+
+	if (NULL != entry)
+		chunk_constraints_add_from_tuple(entry->chunk->constraints, ti->tuple);
+
+	return true;
+}
+
+/*
+ * Scan the constraints of many chunks at once.
+ *
+ * The chunks are given in a hash table of ChunkScanEntry keyed on chunk ID,
+ * and their constraints are added to the chunks' (allocated) constraint sets.
+ * Instead of one scan per chunk, a single index range scan covers all chunk
+ * IDs between the given minimum and maximum. Constraints of other chunks in
+ * that range are skipped.
+ */
+void
+chunk_constraint_scan_by_chunk_id_range(HTAB *chunks, int32 min_chunk_id, int32 max_chunk_id)
+{
+	Catalog    *catalog = catalog_get();
+	ScanKeyData scankey[2];
+	ScannerCtx	scanctx = {
+		.table = catalog->tables[CHUNK_CONSTRAINT].id,
+		.index = catalog->tables[CHUNK_CONSTRAINT].index_ids[CHUNK_CONSTRAINT_CHUNK_ID_DIMENSION_SLICE_ID_IDX],
+		.scantype = ScannerTypeIndex,
+		.nkeys = 2,
+		.scankey = scankey,
+		.data = chunks,
+		.tuple_found = chunk_constraint_chunk_id_range_tuple_found,
+		.lockmode = AccessShareLock,
+		.scandirection = ForwardScanDirection,
+	};
+
+	ScanKeyInit(&scankey[0],
+			  Anum_chunk_constraint_chunk_id_dimension_slice_id_idx_chunk_id,
+				BTGreaterEqualStrategyNumber,
+				F_INT4GE,
+				Int32GetDatum(min_chunk_id));
+	ScanKeyInit(&scankey[1],
+			  Anum_chunk_constraint_chunk_id_dimension_slice_id_idx_chunk_id,
+				BTLessEqualStrategyNumber,
+				F_INT4LE,
+				Int32GetDatum(max_chunk_id));
+
+	scanner_scan(&scanctx);
+}
+
 typedef struct ChunkConstraintScanData
 {
 	ChunkScanCtx *scanctx;
@@ -560,14 +613,23 @@ chunk_constraint_delete_tuple(TupleInfo *ti, void *data)
 	bool		isnull;
 	Datum		constrname = heap_getattr(ti->tuple, Anum_chunk_constraint_constraint_name,
 										  ti->desc, &isnull);
-	ObjectAddress constrobj = {
-		.classId = ConstraintRelationId,
-		.objectId = get_relation_constraint_oid(info->chunk_oid,
-								  NameStr(*DatumGetName(constrname)), false),
-	};
 
 	catalog_delete(ti->scanrel, ti->tuple);
-	performDeletion(&constrobj, DROP_RESTRICT, 0);
+
+	/*
+	 * Without a chunk table, only the metadata is deleted. The constraint is
+	 * dropped along with the table.
+	 */
+	if (OidIsValid(info->chunk_oid))
+	{
+		ObjectAddress constrobj = {
+			.classId = ConstraintRelationId,
+			.objectId = get_relation_constraint_oid(info->chunk_oid,
+								  NameStr(*DatumGetName(constrname)), false),
+		};
+
+		performDeletion(&constrobj, DROP_RESTRICT, 0);
+	}
 
 	return true;
 }
@@ -640,3 +702,56 @@ chunk_constraint_recreate(ChunkConstraint *cc, Oid chunk_oid)
 	performDeletion(&constrobj, DROP_RESTRICT, 0);
 	chunk_constraint_create_on_table(cc, chunk_oid);
 }
+
+/*
+ * Replace a chunk's dimension constraint for one slice with a constraint for
+ * another slice of the same dimension, e.g., when the chunk's range is
+ * extended by merging. Both the metadata and the table constraint are
+ * replaced.
+ */
+void
+chunk_constraint_replace_dimension_slice(int32 chunk_id, Oid chunk_oid,
+										 int32 old_slice_id, int32 new_slice_id)
+{
+	Catalog    *catalog = catalog_get();
+	ScanKeyData scankey[2];
+	DeleteConstraintInfo info = {
+		.chunk_id = chunk_id,
+		.chunk_oid = chunk_oid,
+		.hypertable_constraint_name = NULL,
+	};
+	ScannerCtx	scanctx = {
+		.table = catalog->tables[CHUNK_CONSTRAINT].id,
+		.index = catalog->tables[CHUNK_CONSTRAINT].index_ids[CHUNK_CONSTRAINT_CHUNK_ID_DIMENSION_SLICE_ID_IDX],
+		.scantype = ScannerTypeIndex,
+		.nkeys = 2,
+		.scankey = scankey,
+		.data = &info,
+		.tuple_found = chunk_constraint_delete_tuple,
+		.lockmode = RowExclusiveLock,
+		.scandirection = ForwardScanDirection,
+	};
+	ChunkConstraints *ccs = chunk_constraints_alloc(1);
+
+	ScanKeyInit(&scankey[0],
+			  Anum_chunk_constraint_chunk_id_dimension_slice_id_idx_chunk_id,
+				BTEqualStrategyNumber,
+				F_INT4EQ,
+				Int32GetDatum(chunk_id));
+	ScanKeyInit(&scankey[1],
+	Anum_chunk_constraint_chunk_id_dimension_slice_id_idx_dimension_slice_id,
+				BTEqualStrategyNumber,
+				F_INT4EQ,
+				Int32GetDatum(old_slice_id));
+
+	if (scanner_scan(&scanctx) != 1)
+		elog(ERROR, "dimension slice %d is not a constraint of chunk %d",
+			 old_slice_id, chunk_id);
+
+	chunk_constraints_add(ccs, chunk_id, new_slice_id, NULL, NULL);
+	chunk_constraints_insert(ccs);
+
+	process_utility_set_expect_chunk_modification(true);
+	chunk_constraint_create_on_table(&ccs->constraints[0], chunk_oid);
+	process_utility_set_expect_chunk_modification(false);
+}
@@ -4,6 +4,7 @@
 
 #include <postgres.h>
 #include <nodes/pg_list.h>
+#include <utils/hsearch.h>
 
 #include "catalog.h"
 #include "hypertable.h"
@@ -35,6 +36,7 @@ typedef struct ChunkScanCtx ChunkScanCtx;
 
 extern ChunkConstraints *chunk_constraints_alloc(int size_hint);
 extern ChunkConstraints *chunk_constraint_scan_by_chunk_id(int32 chunk_id, Size count_hint);
+extern void chunk_constraint_scan_by_chunk_id_range(HTAB *chunks, int32 min_chunk_id, int32 max_chunk_id);
 extern ChunkConstraints *chunk_constraints_copy(ChunkConstraints *constraints);
 extern int	chunk_constraints_add_dimension_constraints(ChunkConstraints *ccs, int32 chunk_id, Hypercube *cube);
 extern int	chunk_constraints_add_inheritable_constraints(ChunkConstraints *ccs, int32 chunk_id, Oid hypertable_oid);
@@ -45,5 +47,6 @@ extern void chunk_constraint_create_on_chunk(Chunk *chunk, Oid constraint_oid);
 extern int	chunk_constraint_delete_by_hypertable_constraint_name(int32 chunk_id, Oid chunk_oid, char *hypertable_constraint_name);
 extern int	chunk_constraint_delete_by_chunk_id(int32 chunk_id, Oid chunk_oid);
 extern void chunk_constraint_recreate(ChunkConstraint *cc, Oid chunk_oid);
+extern void chunk_constraint_replace_dimension_slice(int32 chunk_id, Oid chunk_oid, int32 old_slice_id, int32 new_slice_id);
 
 #endif   /* TIMESCALEDB_CHUNK_CONSTRAINT_H */
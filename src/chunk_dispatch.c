@@ -9,6 +9,7 @@
 #include "chunk_insert_state.h"
 #include "subspace_store.h"
 #include "dimension.h"
+#include "guc.h"
 
 ChunkDispatch *
 chunk_dispatch_create(Hypertable *ht, EState *estate, Query *parse)
@@ -19,7 +20,9 @@ chunk_dispatch_create(Hypertable *ht, EState *estate, Query *parse)
 	cd->estate = estate;
 	cd->hypertable_result_rel_info = NULL;
 	cd->parse = parse;
-	cd->cache = subspace_store_init(ht->space->num_dimensions, estate->es_query_cxt);
+	cd->cache = subspace_store_init(ht->space->num_dimensions, estate->es_query_cxt,
+									guc_max_open_chunks_per_insert);
+	continuous_agg_invalidation_init(&cd->invalidation);
 
 	return cd;
 }
@@ -28,12 +31,19 @@ void
 chunk_dispatch_destroy(ChunkDispatch *cd)
 {
 	subspace_store_free(cd->cache);
+	continuous_agg_invalidation_flush(&cd->invalidation, cd->hypertable);
 }
 
 static void
-destroy_chunk_insert_state(void *cis)
+destroy_chunk_insert_state(void *cisptr)
 {
-	chunk_insert_state_destroy((ChunkInsertState *) cis);
+	ChunkInsertState *cis = cisptr;
+	ChunkDispatch *dispatch = cis->dispatch;
+
+	if (NULL != dispatch->on_chunk_insert_state_close)
+		dispatch->on_chunk_insert_state_close(cis, dispatch->on_chunk_insert_state_close_arg);
+
+	chunk_insert_state_destroy(cis);
 }
 
 /*
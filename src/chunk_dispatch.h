@@ -7,8 +7,12 @@
 
 #include "hypertable_cache.h"
 #include "cache.h"
+#include "continuous_agg.h"
 #include "subspace_store.h"
 
+typedef struct Point Point;
+typedef struct ChunkInsertState ChunkInsertState;
+
 /*
  * ChunkDispatch keeps cached state needed to dispatch tuples to chunks. It is
  * separate from any plan and executor nodes, since it is used both for INSERT
@@ -27,10 +31,20 @@ typedef struct ChunkDispatch
 	ResultRelInfo *hypertable_result_rel_info;
 	Query	   *parse;
 
-} ChunkDispatch;
+	/*
+	 * Optional callback invoked right before a chunk insert state is closed,
+	 * e.g., when it is evicted from the cache. COPY uses this to flush tuples
+	 * that are still buffered for the chunk.
+	 */
+	void		(*on_chunk_insert_state_close) (ChunkInsertState *cis, void *arg);
+	void	   *on_chunk_insert_state_close_arg;
 
-typedef struct Point Point;
-typedef struct ChunkInsertState ChunkInsertState;
+	/*
+	 * The range of time values of the dispatched tuples, which is logged as
+	 * an invalidation for the hypertable's continuous aggregates
+	 */
+	ContinuousAggInvalidation invalidation;
+} ChunkDispatch;
 
 ChunkDispatch *chunk_dispatch_create(Hypertable *ht, EState *estate, Query *query);
 void		chunk_dispatch_destroy(ChunkDispatch *dispatch);
@@ -13,7 +13,20 @@
 #include "cache.h"
 #include "hypertable_cache.h"
 #include "dimension.h"
+#include "hypercube.h"
 #include "hypertable.h"
+#include "guc.h"
+
+/*
+ * A tuple in a dispatch batch, along with its point in the hyperspace and the
+ * group of tuples (i.e., the chunk) it belongs to.
+ */
+typedef struct ChunkDispatchBatchTuple
+{
+	HeapTuple	tuple;
+	Point	   *point;
+	int			group;
+} ChunkDispatchBatchTuple;
 
 static void
 chunk_dispatch_begin(CustomScanState *node, EState *estate, int eflags)
@@ -36,6 +49,176 @@ chunk_dispatch_begin(CustomScanState *node, EState *estate, int eflags)
 	state->hypertable_cache = hypertable_cache;
 	state->dispatch = chunk_dispatch_create(ht, estate, state->parse);
 	node->custom_ps = list_make1(ps);
+
+	/*
+	 * Batching changes the order in which tuples are inserted, which matters
+	 * for ON CONFLICT, so only batch plain inserts.
+	 */
+	if (guc_insert_batch_size > 1 &&
+		(state->parse == NULL || state->parse->onConflict == NULL))
+	{
+		state->batch_size = guc_insert_batch_size;
+		state->batch = palloc(sizeof(ChunkDispatchBatchTuple) * state->batch_size);
+		state->batch_slot = ExecInitExtraTupleSlot(estate);
+		state->batch_mcxt = AllocSetContextCreate(estate->es_query_cxt,
+												  "chunk dispatch batch",
+												  ALLOCSET_DEFAULT_SIZES);
+	}
+}
+
+/*
+ * Find the group of a point in a batch, i.e., the group whose chunk's
+ * hypercube contains the point. Consecutive tuples commonly belong to the
+ * same chunk, so the last group is tried first. Returns -1 if no group
+ * matches.
+ */
+static int
+chunk_dispatch_batch_find_group(Hypercube **group_cubes, int num_groups,
+								int last_group, Point *point)
+{
+	int			group;
+
+	if (last_group >= 0 && hypercube_contains_point(group_cubes[last_group], point))
+		return last_group;
+
+	for (group = 0; group < num_groups; group++)
+		if (group != last_group && hypercube_contains_point(group_cubes[group], point))
+			return group;
+
+	return -1;
+}
+
+/*
+ * Fill a new batch with tuples from the subplan.
+ *
+ * The points of all tuples are calculated in one pass and each tuple is
+ * matched against the hypercubes of the chunks already seen in the batch.
+ * The chunk is only resolved for the first tuple of each group, so the
+ * routing cost is paid once per chunk and batch rather than once per tuple.
+ * The tuples are then grouped by chunk, keeping the order in which the
+ * chunks first appear in the batch (and the order of tuples within each
+ * chunk). The tuples are copied since the subplan reuses its slot. Returns
+ * the number of tuples in the batch.
+ */
+static int
+chunk_dispatch_fill_batch(ChunkDispatchState *state)
+{
+	PlanState  *substate = linitial(state->cscan_state.custom_ps);
+	Hypertable *ht = state->dispatch->hypertable;
+	ChunkDispatchBatchTuple *tuples;
+	Hypercube **group_cubes;
+	int		   *group_offsets;
+	int			num_groups = 0;
+	int			last_group = -1;
+	int			ntuples = 0;
+	int			i;
+	MemoryContext old;
+
+	MemoryContextReset(state->batch_mcxt);
+
+	old = MemoryContextSwitchTo(state->batch_mcxt);
+	tuples = palloc(sizeof(ChunkDispatchBatchTuple) * state->batch_size);
+	group_cubes = palloc(sizeof(Hypercube *) * state->batch_size);
+	group_offsets = palloc0(sizeof(int) * (state->batch_size + 1));
+	MemoryContextSwitchTo(old);
+
+	while (ntuples < state->batch_size)
+	{
+		TupleTableSlot *slot = ExecProcNode(substate);
+		ChunkDispatchBatchTuple *bt = &tuples[ntuples];
+		int			group;
+
+		if (TupIsNull(slot))
+		{
+			state->subplan_done = true;
+			break;
+		}
+
+		if (NULL == state->batch_slot->tts_tupleDescriptor)
+			ExecSetSlotDescriptor(state->batch_slot, slot->tts_tupleDescriptor);
+
+		old = MemoryContextSwitchTo(state->batch_mcxt);
+		bt->tuple = ExecCopySlotTuple(slot);
+		bt->point = hyperspace_calculate_point(ht->space, bt->tuple, slot->tts_tupleDescriptor);
+		continuous_agg_invalidation_add_point(&state->dispatch->invalidation, bt->point);
+
+		group = chunk_dispatch_batch_find_group(group_cubes, num_groups,
+												last_group, bt->point);
+
+		if (group < 0)
+		{
+			/*
+			 * Copy the hypercube, since the chunk cache might evict the chunk
+			 * while the rest of the batch is resolved
+			 */
+			group = num_groups++;
+			group_cubes[group] = hypercube_copy(hypertable_get_chunk(ht, bt->point)->cube);
+		}
+		MemoryContextSwitchTo(old);
+
+		bt->group = group;
+		last_group = group;
+		group_offsets[group + 1]++;
+		ntuples++;
+	}
+
+	/* Stable counting sort of the tuples by group */
+	for (i = 1; i <= num_groups; i++)
+		group_offsets[i] += group_offsets[i - 1];
+
+	for (i = 0; i < ntuples; i++)
+		state->batch[group_offsets[tuples[i].group]++] = tuples[i];
+
+	state->batch_count = ntuples;
+	state->batch_next = 0;
+	state->batch_cis = NULL;
+
+	return ntuples;
+}
+
+/*
+ * Return the next tuple in the current batch, routed to its chunk.
+ */
+static TupleTableSlot *
+chunk_dispatch_exec_batch(ChunkDispatchState *state)
+{
+	ChunkDispatch *dispatch = state->dispatch;
+	EState	   *estate = state->cscan_state.ss.ps.state;
+	ChunkDispatchBatchTuple *bt;
+	TupleTableSlot *slot = state->batch_slot;
+
+	if (state->batch_next >= state->batch_count)
+	{
+		if (state->subplan_done || chunk_dispatch_fill_batch(state) == 0)
+			return NULL;
+	}
+
+	bt = &state->batch[state->batch_next++];
+
+	/* Save the main table's (hypertable's) ResultRelInfo */
+	if (NULL == dispatch->hypertable_result_rel_info)
+		dispatch->hypertable_result_rel_info = estate->es_result_relation_info;
+
+	/* Only look up the insert state for the first tuple in a group */
+	if (NULL == state->batch_cis || state->batch_group != bt->group)
+	{
+		MemoryContext old = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+
+		state->batch_cis = chunk_dispatch_get_chunk_insert_state(dispatch,
+																 bt->point,
+												  state->parent->operation);
+		state->batch_group = bt->group;
+		MemoryContextSwitchTo(old);
+	}
+
+	estate->es_result_relation_info = state->batch_cis->result_relation_info;
+
+	ExecStoreTuple(bt->tuple, slot, InvalidBuffer, false);
+
+	/* Convert the tuple to the chunk's rowtype, if necessary */
+	chunk_insert_state_convert_tuple(state->batch_cis, bt->tuple, &slot);
+
+	return slot;
 }
 
 static TupleTableSlot *
@@ -45,6 +228,9 @@ chunk_dispatch_exec(CustomScanState *node)
 	TupleTableSlot *slot;
 	PlanState  *substate = linitial(node->custom_ps);
 
+	if (state->batch_size > 1)
+		return chunk_dispatch_exec_batch(state);
+
 	/* Get the next tuple from the subplan state node */
 	slot = ExecProcNode(substate);
 
@@ -67,6 +253,7 @@ chunk_dispatch_exec(CustomScanState *node)
 
 		/* Calculate the tuple's point in the N-dimensional hyperspace */
 		point = hyperspace_calculate_point(ht->space, tuple, tupdesc);
+		continuous_agg_invalidation_add_point(&dispatch->invalidation, point);
 
 		/* Save the main table's (hypertable's) ResultRelInfo */
 		if (NULL == dispatch->hypertable_result_rel_info)
@@ -114,8 +301,13 @@ chunk_dispatch_end(CustomScanState *node)
 static void
 chunk_dispatch_rescan(CustomScanState *node)
 {
+	ChunkDispatchState *state = (ChunkDispatchState *) node;
 	PlanState  *substate = linitial(node->custom_ps);
 
+	state->batch_count = 0;
+	state->batch_next = 0;
+	state->subplan_done = false;
+
 	ExecReScan(substate);
 }
 
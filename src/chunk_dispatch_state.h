@@ -6,6 +6,7 @@
 #include <nodes/parsenodes.h>
 
 typedef struct ChunkDispatch ChunkDispatch;
+typedef struct ChunkInsertState ChunkInsertState;
 typedef struct ChunkDispatchInfo ChunkDispatchInfo;
 typedef struct Cache Cache;
 
@@ -30,6 +31,22 @@ typedef struct ChunkDispatchState
 	 * for each chunk.
 	 */
 	ChunkDispatch *dispatch;
+
+	/*
+	 * State for batched dispatch. When batching is enabled, tuples are read
+	 * from the subplan in batches and grouped by chunk before they are handed
+	 * to the ModifyTable node. This way each chunk is resolved, and its insert
+	 * state looked up, once per group instead of once per tuple.
+	 */
+	int			batch_size;
+	int			batch_count;	/* Number of tuples in the current batch */
+	int			batch_next;		/* Index of the next tuple to return */
+	bool		subplan_done;
+	struct ChunkDispatchBatchTuple *batch;
+	TupleTableSlot *batch_slot;
+	MemoryContext batch_mcxt;
+	ChunkInsertState *batch_cis;	/* Insert state of the current group */
+	int			batch_group;
 } ChunkDispatchState;
 
 #define CHUNK_DISPATCH_STATE_NAME "ChunkDispatchState"
@@ -596,6 +596,23 @@ chunk_index_delete(Chunk *chunk, Oid chunk_indexrelid, bool drop_index)
 						  scankey, 2, chunk_index_tuple_delete, &drop_index);
 }
 
+/*
+ * Delete the metadata of all indexes of a chunk, e.g., when the chunk is
+ * deleted.
+ */
+int
+chunk_index_delete_by_chunk_id(int32 chunk_id, bool drop_index)
+{
+	ScanKeyData scankey[1];
+
+	ScanKeyInit(&scankey[0],
+				Anum_chunk_index_chunk_id_index_name_idx_chunk_id,
+				BTEqualStrategyNumber, F_INT4EQ, Int32GetDatum(chunk_id));
+
+	return chunk_index_scan_update(CHUNK_INDEX_CHUNK_ID_INDEX_NAME_IDX,
+						  scankey, 1, chunk_index_tuple_delete, &drop_index);
+}
+
 static bool
 chunk_index_tuple_found(TupleInfo *ti, void *const data)
 {
@@ -6,15 +6,19 @@
 #include <utils/guc.h>
 #include <nodes/plannodes.h>
 #include <nodes/relation.h>
+#include <access/sysattr.h>
 #include <access/xact.h>
 #include <optimizer/plancat.h>
 #include <optimizer/clauses.h>
 #include <optimizer/planner.h>
+#include <parser/parsetree.h>
 #include <miscadmin.h>
 
 #include "errors.h"
 #include "chunk_insert_state.h"
 #include "chunk_dispatch.h"
+#include "chunk_column_stats.h"
+#include "compress_chunk.h"
 #include "compat.h"
 
 /*
@@ -69,6 +73,9 @@ create_chunk_range_table_entry(EState *estate, Relation rel)
  * will remain on existing tables (marked as dropped) but won't be created on
  * new tables (chunks). This leads to a situation where the root table and
  * chunks can have different attnums for columns.
+ *
+ * Since every tuple routed to the chunk passes through here, this is also
+ * where the tuple is added to the chunk's column stats.
  */
 HeapTuple
 chunk_insert_state_convert_tuple(ChunkInsertState *state,
@@ -77,6 +84,9 @@ chunk_insert_state_convert_tuple(ChunkInsertState *state,
 {
 	Relation	chunkrel = state->result_relation_info->ri_RelationDesc;
 
+	if (NULL != state->stats)
+		chunk_column_stats_insert_state_add(state->stats, tuple);
+
 	if (NULL == state->tup_conv_map)
 		/* No conversion needed */
 		return tuple;
@@ -221,6 +231,61 @@ tuple_conversion_needed(TupleDesc indesc,
 			indesc->tdhasoid != outdesc->tdhasoid);
 }
 
+/*
+ * Set up tracking of the chunk's column stats for the inserted tuples.
+ *
+ * Stats are tracked on the tuples as they are routed to the chunk. If the
+ * inserted values can still change after that, via BEFORE ROW triggers on the
+ * chunk or the UPDATE of an ON CONFLICT clause, the affected stats are marked
+ * invalid instead.
+ */
+static void
+chunk_insert_state_init_stats(ChunkInsertState *state, Chunk *chunk,
+							  Relation parent_rel, OnConflictAction onconflict)
+{
+	Hypertable *ht = state->dispatch->hypertable;
+	TriggerDesc *trigdesc = state->result_relation_info->ri_TrigDesc;
+	ListCell   *lc;
+
+	if (ht->stats_columns == NIL)
+		return;
+
+	if (NULL != trigdesc && trigdesc->trig_insert_before_row)
+	{
+		chunk_column_stats_invalidate(chunk->fd.id, NULL);
+		return;
+	}
+
+	if (onconflict == ONCONFLICT_UPDATE)
+	{
+		Query	   *parse = state->dispatch->parse;
+		RangeTblEntry *rte = rt_fetch(parse->resultRelation, parse->rtable);
+
+		foreach(lc, ht->stats_columns)
+		{
+			ChunkStatsColumn *column = lfirst(lc);
+
+			if (bms_is_member(column->attno - FirstLowInvalidHeapAttributeNumber, rte->updatedCols))
+				chunk_column_stats_invalidate(chunk->fd.id, NameStr(column->name));
+		}
+	}
+
+	state->stats = chunk_column_stats_insert_state_create(ht, chunk->fd.id,
+													RelationGetDescr(parent_rel));
+}
+
+static bool
+has_unique_index(ResultRelInfo *resrelinfo)
+{
+	int			i;
+
+	for (i = 0; i < resrelinfo->ri_NumIndices; i++)
+		if (resrelinfo->ri_IndexRelationInfo[i]->ii_Unique)
+			return true;
+
+	return false;
+}
+
 /*
  * Create new insert chunk state.
  *
@@ -270,6 +335,7 @@ chunk_insert_state_create(Chunk *chunk, ChunkDispatch *dispatch, CmdType operati
 
 	state = palloc0(sizeof(ChunkInsertState));
 	state->mctx = cis_context;
+	state->dispatch = dispatch;
 	state->rel = rel;
 	state->result_relation_info = resrelinfo;
 
@@ -277,6 +343,18 @@ chunk_insert_state_create(Chunk *chunk, ChunkDispatch *dispatch, CmdType operati
 		resrelinfo->ri_IndexRelationDescs == NULL)
 		ExecOpenIndices(resrelinfo, onconflict != ONCONFLICT_NONE);
 
+	/*
+	 * The unique indexes of a compressed chunk only cover the rows inserted
+	 * after compression, so they can neither enforce uniqueness nor find
+	 * conflicts with the rows in the compressed batches.
+	 */
+	if (has_unique_index(resrelinfo) && compressed_chunk_exists(chunk->table_id))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("Cannot insert into compressed chunk \"%s\" of a hypertable with unique indexes",
+						get_rel_name(chunk->table_id)),
+				 errhint("Decompress the chunk with decompress_chunk() first.")));
+
 	if (resrelinfo->ri_TrigDesc != NULL)
 	{
 		if (resrelinfo->ri_TrigDesc->trig_insert_instead_row ||
@@ -301,6 +379,8 @@ chunk_insert_state_create(Chunk *chunk, ChunkDispatch *dispatch, CmdType operati
 	if (state->tup_conv_map)
 		state->slot = MakeTupleTableSlot();
 
+	chunk_insert_state_init_stats(state, chunk, parent_rel, onconflict);
+
 	heap_close(parent_rel, AccessShareLock);
 
 	MemoryContextSwitchTo(old_mcxt);
@@ -314,6 +394,8 @@ chunk_insert_state_destroy(ChunkInsertState *state)
 	if (state == NULL)
 		return;
 
+	chunk_column_stats_insert_state_finish(state->stats);
+
 	ExecCloseIndices(state->result_relation_info);
 	heap_close(state->rel, NoLock);
 
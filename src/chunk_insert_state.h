@@ -9,18 +9,22 @@
 #include "chunk.h"
 #include "cache.h"
 
+typedef struct ChunkDispatch ChunkDispatch;
+typedef struct ChunkStatsInsertState ChunkStatsInsertState;
+
 typedef struct ChunkInsertState
 {
+	ChunkDispatch *dispatch;
 	Relation	rel;
 	ResultRelInfo *result_relation_info;
 	List	   *arbiter_indexes;
 	TupleConversionMap *tup_conv_map;
 	TupleTableSlot *slot;
+	/* Stats of the inserted tuples, if the hypertable has stats columns */
+	ChunkStatsInsertState *stats;
 	MemoryContext mctx;
 } ChunkInsertState;
 
-typedef struct ChunkDispatch ChunkDispatch;
-
 extern HeapTuple chunk_insert_state_convert_tuple(ChunkInsertState *state, HeapTuple tuple, TupleTableSlot **existing_slot);
 extern ChunkInsertState *chunk_insert_state_create(Chunk *chunk, ChunkDispatch *dispatch, CmdType operation);
 extern void chunk_insert_state_destroy(ChunkInsertState *state);
@@ -0,0 +1,469 @@
+#include <postgres.h>
+#include <access/heapam.h>
+#include <access/htup_details.h>
+#include <access/multixact.h>
+#include <access/rewriteheap.h>
+#include <access/transam.h>
+#include <access/tupconvert.h>
+#include <access/xlog.h>
+#include <catalog/dependency.h>
+#include <catalog/pg_class.h>
+#include <catalog/pg_type.h>
+#include <commands/cluster.h>
+#include <commands/tablecmds.h>
+#include <commands/vacuum.h>
+#include <storage/bufmgr.h>
+#include <storage/lmgr.h>
+#include <utils/acl.h>
+#include <utils/array.h>
+#include <utils/lsyscache.h>
+#include <utils/rel.h>
+#include <utils/syscache.h>
+#include <utils/tqual.h>
+#include <miscadmin.h>
+
+#include "catalog.h"
+#include "chunk.h"
+#include "chunk_column_stats.h"
+#include "chunk_constraint.h"
+#include "compat.h"
+#include "compress_chunk.h"
+#include "dimension.h"
+#include "dimension_slice.h"
+#include "hypercube.h"
+#include "hypertable_cache.h"
+#include "utils.h"
+
+/*
+ * Merging of chunks.
+ *
+ * Chunks that are adjacent along the first open dimension, and that are in
+ * the same partition of all other dimensions, are merged into the chunk
+ * with the lowest range. The rows of all chunks are copied into a new
+ * relfilenode for that chunk under an ExclusiveLock, which blocks writes but
+ * not reads. Only the swap of the new relfilenode, which also rebuilds the
+ * chunk's indexes once, the replacement of the chunk's dimension constraint
+ * and the drop of the other chunks need an AccessExclusiveLock.
+ *
+ * Like CLUSTER, the rows are copied with their original transaction
+ * information, so the merge is MVCC-safe: transactions with snapshots from
+ * before the merge see the same rows in the merged chunk as they saw in the
+ * separate chunks.
+ */
+
+TS_FUNCTION_INFO_V1(chunk_merge_chunks);
+
+typedef struct MergeChunk
+{
+	Chunk	   *chunk;
+	DimensionSlice *slice;		/* The chunk's slice in the merge dimension */
+} MergeChunk;
+
+static int
+merge_chunk_cmp(const void *left, const void *right)
+{
+	return dimension_slice_cmp(((const MergeChunk *) left)->slice,
+							   ((const MergeChunk *) right)->slice);
+}
+
+/*
+ * Copy the rows of a chunk into the new heap with the heap rewrite module,
+ * like CLUSTER, so that the rows keep their transaction information. The
+ * rows are converted to the new heap's row type in case the chunk's columns
+ * have a different layout, e.g., due to dropped columns.
+ *
+ * Each chunk gets its own rewrite state, since the state tracks update
+ * chains by the TIDs of the old heap. Returns the number of copied rows.
+ */
+static double
+merge_copy_data(Relation NewHeap, Relation OldHeap, TransactionId *pFreezeXid,
+				MultiXactId *pCutoffMulti)
+{
+	TupleConversionMap *map = convert_tuples_by_name(RelationGetDescr(OldHeap),
+												 RelationGetDescr(NewHeap),
+							 gettext_noop("could not convert row type"));
+	bool		use_wal = XLogIsNeeded() && RelationNeedsWAL(NewHeap);
+	TransactionId OldestXmin;
+	TransactionId FreezeXid;
+	MultiXactId MultiXactCutoff;
+	RewriteState rwstate;
+	HeapScanDesc scan;
+	HeapTuple	tuple;
+	double		num_tuples = 0;
+
+	vacuum_set_xid_limits(OldHeap, 0, 0, 0, 0, &OldestXmin, &FreezeXid,
+						  NULL, &MultiXactCutoff, NULL);
+
+	/* Never move the frozen horizons of the relation backwards */
+	if (TransactionIdPrecedes(FreezeXid, OldHeap->rd_rel->relfrozenxid))
+		FreezeXid = OldHeap->rd_rel->relfrozenxid;
+
+	if (MultiXactIdPrecedes(MultiXactCutoff, OldHeap->rd_rel->relminmxid))
+		MultiXactCutoff = OldHeap->rd_rel->relminmxid;
+
+	/* The merged chunk's horizons are the oldest of all chunks */
+	if (!TransactionIdIsValid(*pFreezeXid) || TransactionIdPrecedes(FreezeXid, *pFreezeXid))
+		*pFreezeXid = FreezeXid;
+
+	if (!MultiXactIdIsValid(*pCutoffMulti) || MultiXactIdPrecedes(MultiXactCutoff, *pCutoffMulti))
+		*pCutoffMulti = MultiXactCutoff;
+
+	rwstate = begin_heap_rewrite(OldHeap, NewHeap, OldestXmin, FreezeXid,
+								 MultiXactCutoff, use_wal);
+
+	scan = heap_beginscan(OldHeap, SnapshotAny, 0, NULL);
+
+	while ((tuple = heap_getnext(scan, ForwardScanDirection)) != NULL)
+	{
+		Buffer		buf = scan->rs_cbuf;
+		HeapTuple	copiedTuple;
+		bool		isdead;
+
+		CHECK_FOR_INTERRUPTS();
+
+		LockBuffer(buf, BUFFER_LOCK_SHARE);
+
+		switch (HeapTupleSatisfiesVacuum(tuple, OldestXmin, buf))
+		{
+			case HEAPTUPLE_DEAD:
+				isdead = true;
+				break;
+			case HEAPTUPLE_RECENTLY_DEAD:
+			case HEAPTUPLE_LIVE:
+				isdead = false;
+				break;
+			case HEAPTUPLE_INSERT_IN_PROGRESS:
+			case HEAPTUPLE_DELETE_IN_PROGRESS:
+
+				/*
+				 * Writers are blocked by the ExclusiveLock, so these can only
+				 * come from the current transaction. Keep them, like CLUSTER.
+				 */
+				isdead = false;
+				break;
+			default:
+				elog(ERROR, "unexpected HeapTupleSatisfiesVacuum result");
+				isdead = false;
+				break;
+		}
+
+		LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+
+		if (isdead)
+		{
+			/* The rewrite module still needs to see dead tuples of chains */
+			rewrite_heap_dead_tuple(rwstate, tuple);
+			continue;
+		}
+
+		num_tuples += 1;
+
+		if (NULL != map)
+			copiedTuple = do_convert_tuple(tuple, map);
+		else
+			copiedTuple = heap_copytuple(tuple);
+
+		if (OldHeap->rd_rel->relhasoids)
+			HeapTupleSetOid(copiedTuple, HeapTupleGetOid(tuple));
+
+		rewrite_heap_tuple(rwstate, tuple, copiedTuple);
+		heap_freetuple(copiedTuple);
+	}
+
+	heap_endscan(scan);
+	end_heap_rewrite(rwstate);
+
+	if (NULL != map)
+		free_conversion_map(map);
+
+	return num_tuples;
+}
+
+/*
+ * Create a new heap for the first chunk and fill it with the rows of all
+ * chunks. Returns the OID of the new heap.
+ */
+static Oid
+merge_make_heap(MergeChunk *mcs, int num_chunks, TransactionId *pFreezeXid,
+				MultiXactId *pCutoffMulti)
+{
+	Relation	rel = heap_open(mcs[0].chunk->table_id, NoLock);
+	Oid			OIDNewHeap = make_new_heap(mcs[0].chunk->table_id,
+										   rel->rd_rel->reltablespace,
+										   rel->rd_rel->relpersistence,
+										   ExclusiveLock);
+	Relation	NewHeap = heap_open(OIDNewHeap, AccessExclusiveLock);
+	double		num_tuples = 0;
+	Relation	relRelation;
+	HeapTuple	reltup;
+	Form_pg_class relform;
+	int			i;
+
+	heap_close(rel, NoLock);
+
+	*pFreezeXid = InvalidTransactionId;
+	*pCutoffMulti = InvalidMultiXactId;
+
+	for (i = 0; i < num_chunks; i++)
+	{
+		Relation	OldHeap = heap_open(mcs[i].chunk->table_id, NoLock);
+
+		num_tuples += merge_copy_data(NewHeap, OldHeap, pFreezeXid, pCutoffMulti);
+		heap_close(OldHeap, NoLock);
+	}
+
+	/* The size statistics are swapped along with the relfilenodes */
+	relRelation = heap_open(RelationRelationId, RowExclusiveLock);
+	reltup = SearchSysCacheCopy1(RELOID, ObjectIdGetDatum(OIDNewHeap));
+
+	if (!HeapTupleIsValid(reltup))
+		elog(ERROR, "cache lookup failed for relation %u", OIDNewHeap);
+
+	relform = (Form_pg_class) GETSTRUCT(reltup);
+	relform->relpages = RelationGetNumberOfBlocks(NewHeap);
+	relform->reltuples = num_tuples;
+	catalog_update(relRelation, reltup);
+	heap_freetuple(reltup);
+	heap_close(relRelation, RowExclusiveLock);
+
+	heap_close(NewHeap, NoLock);
+
+	return OIDNewHeap;
+}
+
+/*
+ * Lock the chunks in chunk ID order to avoid deadlocks with concurrent
+ * merges or drops of overlapping sets of chunks.
+ */
+static void
+merge_lock_chunks(MergeChunk *mcs, int num_chunks, LOCKMODE lockmode)
+{
+	int32	   *ids = palloc(sizeof(int32) * num_chunks);
+	int			i,
+				j;
+
+	for (i = 0; i < num_chunks; i++)
+		ids[i] = mcs[i].chunk->fd.id;
+
+	qsort(ids, num_chunks, sizeof(int32), int_cmp);
+
+	for (i = 0; i < num_chunks; i++)
+		for (j = 0; j < num_chunks; j++)
+			if (mcs[j].chunk->fd.id == ids[i])
+				LockRelationOid(mcs[j].chunk->table_id, lockmode);
+
+	pfree(ids);
+}
+
+/*
+ * Check that the sorted chunks can be merged into one chunk, i.e., they are
+ * in the same partition of all dimensions except the merge dimension, along
+ * which they are adjacent.
+ */
+static void
+merge_check_chunks(Hyperspace *hs, Dimension *dim, MergeChunk *mcs, int num_chunks)
+{
+	int			i,
+				j;
+
+	for (i = 1; i < num_chunks; i++)
+	{
+		const char *prev_name = get_rel_name(mcs[i - 1].chunk->table_id);
+		const char *name = get_rel_name(mcs[i].chunk->table_id);
+
+		for (j = 0; j < hs->num_dimensions; j++)
+		{
+			int32		dimension_id = hs->dimensions[j].fd.id;
+
+			if (dimension_id == dim->fd.id)
+				continue;
+
+			if (!dimension_slices_equal(hypercube_get_slice_by_dimension_id(mcs[0].chunk->cube, dimension_id),
+										hypercube_get_slice_by_dimension_id(mcs[i].chunk->cube, dimension_id)))
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("Chunks \"%s\" and \"%s\" are in different partitions of dimension \"%s\"",
+								get_rel_name(mcs[0].chunk->table_id), name,
+								NameStr(hs->dimensions[j].fd.column_name))));
+		}
+
+		if (mcs[i - 1].slice->fd.range_end != mcs[i].slice->fd.range_start)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("Chunks \"%s\" and \"%s\" are not adjacent", prev_name, name),
+					 errhint("Only chunks with consecutive ranges of dimension \"%s\" can be merged.",
+							 NameStr(dim->fd.column_name))));
+	}
+}
+
+/*
+ * Merge chunks that are adjacent along the first open dimension into one
+ * chunk.
+ *
+ * Takes an array of at least two chunks of the same hypertable and returns
+ * the merged chunk, which is the chunk with the lowest range. The other
+ * chunks are dropped.
+ */
+Datum
+chunk_merge_chunks(PG_FUNCTION_ARGS)
+{
+	ArrayType  *arr = PG_GETARG_ARRAYTYPE_P(0);
+	Datum	   *relids;
+	bool	   *nulls;
+	int			num_chunks;
+	MergeChunk *mcs;
+	Cache	   *hcache;
+	Hypertable *ht = NULL;
+	Dimension  *dim;
+	Oid			hypertable_relid;
+	DimensionSlice *merged;
+	ObjectAddresses *objects;
+	Oid			OIDNewHeap;
+	TransactionId frozenXid;
+	MultiXactId cutoffMulti;
+	char		relpersistence;
+	int			i;
+
+	deconstruct_array(arr, REGCLASSOID, sizeof(Oid), true, 'i',
+					  &relids, &nulls, &num_chunks);
+
+	if (num_chunks < 2)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("At least two chunks are needed for a merge")));
+
+	mcs = palloc0(sizeof(MergeChunk) * num_chunks);
+
+	/* Find the chunk IDs, which determine the order of locking */
+	for (i = 0; i < num_chunks; i++)
+	{
+		Oid			relid = DatumGetObjectId(relids[i]);
+		int			j;
+
+		if (nulls[i])
+			ereport(ERROR,
+					(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+					 errmsg("Chunk cannot be NULL")));
+
+		for (j = 0; j < i; j++)
+			if (DatumGetObjectId(relids[j]) == relid)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("Chunk \"%s\" is given more than once", get_rel_name(relid))));
+
+		if (!pg_class_ownercheck(relid, GetUserId()))
+			aclcheck_error(ACLCHECK_NOT_OWNER, ACL_KIND_CLASS, get_rel_name(relid));
+
+		mcs[i].chunk = chunk_get_by_relid(relid, 0, false);
+
+		if (NULL == mcs[i].chunk)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("\"%s\" is not a chunk", get_rel_name(relid))));
+	}
+
+	/* Block writes, but not reads, while the rows are copied */
+	merge_lock_chunks(mcs, num_chunks, ExclusiveLock);
+
+	/*
+	 * The chunks might have been changed or dropped while waiting for the
+	 * locks, so read them again now that they are locked
+	 */
+	hcache = hypertable_cache_pin();
+
+	for (i = 0; i < num_chunks; i++)
+	{
+		Oid			relid = DatumGetObjectId(relids[i]);
+		Chunk	   *chunk = chunk_get_by_relid(relid, 0, false);
+
+		if (NULL == chunk || chunk->fd.id != mcs[i].chunk->fd.id)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("\"%s\" is not a chunk", get_rel_name(relid))));
+
+		if (NULL == ht)
+			ht = hypertable_cache_get_entry_by_id(hcache, chunk->fd.hypertable_id);
+		else if (chunk->fd.hypertable_id != ht->fd.id)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("Chunk \"%s\" is not a chunk of hypertable \"%s\"",
+							get_rel_name(relid), get_rel_name(ht->main_table_relid))));
+
+		if (NULL != compressed_chunk_get_by_relid(relid))
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("Cannot merge compressed chunk \"%s\"", get_rel_name(relid)),
+					 errhint("Decompress the chunk before merging it.")));
+
+		mcs[i].chunk = chunk_get_by_relid(relid, ht->space->num_dimensions, true);
+	}
+
+	hypertable_relid = ht->main_table_relid;
+	dim = hyperspace_get_open_dimension(ht->space, 0);
+
+	if (NULL == dim)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("Hypertable \"%s\" has no open dimension to merge chunks along",
+						get_rel_name(hypertable_relid))));
+
+	for (i = 0; i < num_chunks; i++)
+		mcs[i].slice = hypercube_get_slice_by_dimension_id(mcs[i].chunk->cube, dim->fd.id);
+
+	qsort(mcs, num_chunks, sizeof(MergeChunk), merge_chunk_cmp);
+	merge_check_chunks(ht->space, dim, mcs, num_chunks);
+
+	merged = dimension_slice_create(dim->fd.id,
+									mcs[0].slice->fd.range_start,
+									mcs[num_chunks - 1].slice->fd.range_end);
+
+	cache_release(hcache);
+
+	for (i = 0; i < num_chunks; i++)
+	{
+		Relation	rel = heap_open(mcs[i].chunk->table_id, NoLock);
+
+		CheckTableNotInUse(rel, "merge_chunks");
+		heap_close(rel, NoLock);
+	}
+
+	relpersistence = get_rel_persistence(mcs[0].chunk->table_id);
+	OIDNewHeap = merge_make_heap(mcs, num_chunks, &frozenXid, &cutoffMulti);
+
+	/* Only the catalog changes, the swap and the index rebuild block reads */
+	merge_lock_chunks(mcs, num_chunks, AccessExclusiveLock);
+
+	/*
+	 * Extend the first chunk's range before the swap, so that its new
+	 * constraint is only checked against the chunk's own rows
+	 */
+	dimension_slice_scan_for_existing(merged);
+	dimension_slice_insert(merged);
+	chunk_constraint_replace_dimension_slice(mcs[0].chunk->fd.id,
+											 mcs[0].chunk->table_id,
+											 mcs[0].slice->fd.id,
+											 merged->fd.id);
+
+	finish_heap_swap(mcs[0].chunk->table_id, OIDNewHeap, false, false, true, true,
+					 frozenXid, cutoffMulti, relpersistence);
+
+	chunk_column_stats_invalidate(mcs[0].chunk->fd.id, NULL);
+
+	objects = new_object_addresses();
+
+	for (i = 1; i < num_chunks; i++)
+	{
+		ObjectAddress addr = {
+			.classId = RelationRelationId,
+			.objectId = mcs[i].chunk->table_id,
+		};
+
+		chunk_delete_by_relid(mcs[i].chunk->table_id);
+		add_exact_object_address(&addr, objects);
+	}
+
+	performMultipleDeletions(objects, DROP_RESTRICT, 0);
+	catalog_invalidate_hypertable(hypertable_relid);
+
+	PG_RETURN_OID(mcs[0].chunk->table_id);
+}
@@ -0,0 +1,199 @@
+#include <postgres.h>
+#include <utils/lsyscache.h>
+#include <miscadmin.h>
+
+#include "chunk.h"
+#include "chunk_precreate.h"
+#include "catalog.h"
+#include "compat.h"
+#include "dimension.h"
+#include "dimension_slice.h"
+#include "dimension_vector.h"
+#include "errors.h"
+#include "guc.h"
+#include "hypertable.h"
+#include "hypertable_cache.h"
+#include "utils.h"
+
+/*
+ * Chunk pre-creation.
+ *
+ * The first tuple that falls outside the existing chunks of a hypertable pays
+ * the full cost of creating a new chunk (catalog inserts, table creation,
+ * constraints, triggers and indexes). To avoid latency spikes at interval
+ * boundaries, the chunks covering the next interval of a hypertable's open
+ * dimension can be created ahead of time, for all partitions of the closed
+ * dimensions, once the data in the current interval has reached a
+ * configurable fraction of the interval.
+ *
+ * Pre-creation runs periodically for a hypertable as a precreate_chunks job
+ * of the background job scheduler (see bgw_job.c), added with
+ * add_precreate_chunks_policy(). It can also be triggered for a specific
+ * hypertable via the precreate_chunks() SQL function.
+ */
+
+/*
+ * Get the maximum value of the open dimension's column in the given chunks.
+ * The value is read from the end of an index on the column, so that large
+ * chunks are not scanned. Chunks without such an index are skipped.
+ *
+ * Returns true if a (non-null) maximum value was found, otherwise false.
+ */
+static bool
+chunk_precreate_max_value(Dimension *dim, List *relids, int64 *max_value)
+{
+	ListCell   *lc;
+	bool		found = false;
+
+	foreach(lc, relids)
+	{
+		Oid			relid = lfirst_oid(lc);
+		AttrNumber	attnum = get_attnum(relid, NameStr(dim->fd.column_name));
+		int64		minmax[2];
+
+		if (!chunk_get_minmax(relid, attnum, dim->fd.column_type, minmax))
+			continue;
+
+		if (!found || minmax[1] > *max_value)
+			*max_value = minmax[1];
+		found = true;
+	}
+
+	return found;
+}
+
+/*
+ * Pre-create the chunks that cover the next interval of the hypertable's open
+ * dimension if the data in the most recent interval has crossed the given
+ * fraction of the interval. Chunks are created for every partition of the
+ * hypertable's closed dimensions.
+ *
+ * Returns the number of chunks created.
+ */
+int
+chunk_precreate(Hypertable *ht, double threshold)
+{
+	Hyperspace *hs = ht->space;
+	Dimension  *dim = hyperspace_get_open_dimension(hs, 0);
+	DimensionVec *slices;
+	DimensionSlice *latest;
+	List	   *relids;
+	int64		max_value;
+	double		fill;
+	int16	   *partitions;
+	Point	   *p;
+	int			num_created = 0;
+	int			i;
+
+	/*
+	 * Only hypertables with exactly one open dimension are supported, since
+	 * there is no obvious "next" interval when there are several open
+	 * dimensions.
+	 */
+	if (NULL == dim || NULL != hyperspace_get_open_dimension(hs, 1))
+		return 0;
+
+	slices = dimension_get_slices(dim);
+
+	if (slices->num_slices == 0)
+		return 0;
+
+	/* The slices are sorted, so the last one covers the most recent interval */
+	latest = slices->slices[slices->num_slices - 1];
+
+	if (latest->fd.range_start == DIMENSION_SLICE_MINVALUE ||
+		latest->fd.range_end == DIMENSION_SLICE_MAXVALUE)
+		return 0;
+
+	relids = chunk_find_all_relids_in_slice(hs, latest);
+
+	if (!chunk_precreate_max_value(dim, relids, &max_value))
+		return 0;
+
+	fill = (double) (max_value - latest->fd.range_start) /
+		(double) (latest->fd.range_end - latest->fd.range_start);
+
+	if (fill < threshold)
+		return 0;
+
+	p = palloc0(POINT_SIZE(hs->num_dimensions));
+	p->cardinality = hs->num_dimensions;
+	p->num_coords = hs->num_dimensions;
+
+	/* Iterate over all combinations of closed dimension partitions */
+	partitions = palloc0(sizeof(int16) * hs->num_dimensions);
+
+	do
+	{
+		Chunk	   *chunk;
+
+		for (i = 0; i < hs->num_dimensions; i++)
+		{
+			Dimension  *d = &hs->dimensions[i];
+
+			if (IS_OPEN_DIMENSION(d))
+				p->coordinates[i] = latest->fd.range_end;
+			else
+				p->coordinates[i] = partitions[i] *
+					(DIMENSION_SLICE_CLOSED_MAX / (int64) d->fd.num_slices);
+		}
+
+		chunk = chunk_find(hs, p);
+
+		if (NULL == chunk)
+		{
+			chunk_create(ht, p,
+						 NameStr(ht->fd.associated_schema_name),
+						 NameStr(ht->fd.associated_table_prefix));
+			num_created++;
+		}
+
+		/* Advance to the next combination of partitions */
+		for (i = hs->num_dimensions - 1; i >= 0; i--)
+		{
+			Dimension  *d = &hs->dimensions[i];
+
+			if (!IS_CLOSED_DIMENSION(d))
+				continue;
+
+			if (++partitions[i] < d->fd.num_slices)
+				break;
+
+			partitions[i] = 0;
+		}
+	} while (i >= 0);
+
+	return num_created;
+}
+
+TS_FUNCTION_INFO_V1(precreate_chunks);
+
+/*
+ * Pre-create the next chunks of a hypertable if the current fill level
+ * crosses the configured threshold.
+ */
+Datum
+precreate_chunks(PG_FUNCTION_ARGS)
+{
+	Oid			hypertable_oid = PG_GETARG_OID(0);
+	Cache	   *hcache;
+	Hypertable *ht;
+	int			num_created;
+
+	hypertable_permissions_check(hypertable_oid, GetUserId());
+
+	hcache = hypertable_cache_pin();
+	ht = hypertable_cache_get_entry(hcache, hypertable_oid);
+
+	if (NULL == ht)
+		ereport(ERROR,
+				(errcode(ERRCODE_IO_HYPERTABLE_NOT_EXIST),
+				 errmsg("Table \"%s\" is not a hypertable",
+						get_rel_name(hypertable_oid))));
+
+	num_created = chunk_precreate(ht, guc_chunk_precreate_threshold);
+
+	cache_release(hcache);
+
+	PG_RETURN_INT32(num_created);
+}
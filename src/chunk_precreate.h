@@ -0,0 +1,11 @@
+#ifndef TIMESCALEDB_CHUNK_PRECREATE_H
+#define TIMESCALEDB_CHUNK_PRECREATE_H
+
+#include <postgres.h>
+#include <fmgr.h>
+
+typedef struct Hypertable Hypertable;
+
+extern int	chunk_precreate(Hypertable *ht, double threshold);
+
+#endif   /* TIMESCALEDB_CHUNK_PRECREATE_H */
@@ -0,0 +1,404 @@
+#include <postgres.h>
+#include <utils/memutils.h>
+
+#include "chunk.h"
+#include "chunk_slice_index.h"
+#include "dimension.h"
+#include "dimension_slice.h"
+#include "hypercube.h"
+
+#define CHUNK_SLICE_INDEX_DEFAULT_CAPACITY 16
+
+typedef struct ChunkRelidEntry
+{
+	Oid			relid;
+	Chunk	   *chunk;
+} ChunkRelidEntry;
+
+static void
+index_dimension_init(ChunkSliceIndexDimension *dim, int32 dimension_id, int32 capacity)
+{
+	dim->dimension_id = dimension_id;
+	dim->num_entries = 0;
+	dim->capacity = Max(capacity, CHUNK_SLICE_INDEX_DEFAULT_CAPACITY);
+	dim->entries = palloc(sizeof(ChunkSliceIndexEntry) * dim->capacity);
+}
+
+static void
+index_dimension_expand(ChunkSliceIndexDimension *dim)
+{
+	if (dim->num_entries < dim->capacity)
+		return;
+
+	dim->capacity *= 2;
+	dim->entries = repalloc(dim->entries, sizeof(ChunkSliceIndexEntry) * dim->capacity);
+}
+
+/*
+ * Recompute the running maximum of range_end, starting at the given entry.
+ */
+static void
+index_dimension_update_max_end(ChunkSliceIndexDimension *dim, int32 from)
+{
+	int32		i;
+
+	for (i = from; i < dim->num_entries; i++)
+	{
+		ChunkSliceIndexEntry *entry = &dim->entries[i];
+
+		if (i == 0 || entry->range_end > dim->entries[i - 1].max_end)
+			entry->max_end = entry->range_end;
+		else
+			entry->max_end = dim->entries[i - 1].max_end;
+	}
+}
+
+/*
+ * Get the number of entries that start at or before the given value, i.e.,
+ * the position of the first entry that starts after the value.
+ */
+static int32
+index_dimension_upper_bound(ChunkSliceIndexDimension *dim, int64 value)
+{
+	int32		low = 0;
+	int32		high = dim->num_entries;
+
+	while (low < high)
+	{
+		int32		mid = low + (high - low) / 2;
+
+		if (dim->entries[mid].range_start <= value)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+static int
+index_entry_cmp(const void *left, const void *right)
+{
+	const ChunkSliceIndexEntry *le = left;
+	const ChunkSliceIndexEntry *re = right;
+
+	if (le->range_start < re->range_start)
+		return -1;
+
+	if (le->range_start > re->range_start)
+		return 1;
+
+	return 0;
+}
+
+static void
+index_dimension_append(ChunkSliceIndexDimension *dim, DimensionSlice *slice, Chunk *chunk)
+{
+	ChunkSliceIndexEntry *entry;
+
+	index_dimension_expand(dim);
+	entry = &dim->entries[dim->num_entries++];
+	entry->range_start = slice->fd.range_start;
+	entry->range_end = slice->fd.range_end;
+	entry->chunk = chunk;
+}
+
+static void
+index_dimension_insert(ChunkSliceIndexDimension *dim, DimensionSlice *slice, Chunk *chunk)
+{
+	int32		pos = index_dimension_upper_bound(dim, slice->fd.range_start);
+
+	index_dimension_expand(dim);
+
+	/* New chunks are typically appended, so this rarely moves anything */
+	memmove(&dim->entries[pos + 1], &dim->entries[pos],
+			sizeof(ChunkSliceIndexEntry) * (dim->num_entries - pos));
+	dim->entries[pos].range_start = slice->fd.range_start;
+	dim->entries[pos].range_end = slice->fd.range_end;
+	dim->entries[pos].chunk = chunk;
+	dim->num_entries++;
+
+	index_dimension_update_max_end(dim, pos);
+}
+
+static bool
+index_chunk_is_complete(ChunkSliceIndex *index, Chunk *chunk)
+{
+	int			i;
+
+	if (NULL == chunk->cube || chunk->cube->num_slices != index->num_dimensions)
+		return false;
+
+	for (i = 0; i < index->num_dimensions; i++)
+		if (chunk->cube->slices[i]->fd.dimension_id != index->dimensions[i].dimension_id)
+			return false;
+
+	return true;
+}
+
+static void
+relid_map_add(HTAB *relid_map, Chunk *chunk)
+{
+	ChunkRelidEntry *entry;
+	bool		found;
+
+	entry = hash_search(relid_map, &chunk->table_id, HASH_ENTER, &found);
+	entry->chunk = chunk;
+}
+
+/*
+ * Add a copy of a chunk to the index.
+ *
+ * Returns the index's copy of the chunk, or NULL if the chunk cannot be
+ * indexed since it lacks slices.
+ */
+static Chunk *
+index_add_chunk(ChunkSliceIndex *index, Chunk *chunk, bool append)
+{
+	MemoryContext old = MemoryContextSwitchTo(index->mcxt);
+	int			i;
+
+	index->chunk_ids = bms_add_member(index->chunk_ids, chunk->fd.id);
+
+	if (!index_chunk_is_complete(index, chunk))
+	{
+		index->num_unindexed++;
+		MemoryContextSwitchTo(old);
+		return NULL;
+	}
+
+	chunk = chunk_copy(chunk);
+
+	for (i = 0; i < index->num_dimensions; i++)
+	{
+		if (append)
+			index_dimension_append(&index->dimensions[i], chunk->cube->slices[i], chunk);
+		else
+			index_dimension_insert(&index->dimensions[i], chunk->cube->slices[i], chunk);
+	}
+
+	index->num_chunks++;
+
+	if (NULL != index->relid_map)
+		relid_map_add(index->relid_map, chunk);
+
+	MemoryContextSwitchTo(old);
+
+	return chunk;
+}
+
+/*
+ * Build an index for all the chunks in the given hyperspace.
+ *
+ * The index gets its own memory context, which is a child of the given parent
+ * context.
+ */
+ChunkSliceIndex *
+chunk_slice_index_create(Hyperspace *hs, MemoryContext parent)
+{
+	MemoryContext mcxt = AllocSetContextCreate(parent,
+											   "Chunk slice index",
+											   ALLOCSET_DEFAULT_SIZES);
+	MemoryContext scan_mcxt = AllocSetContextCreate(CurrentMemoryContext,
+													"Chunk slice index scan",
+													ALLOCSET_DEFAULT_SIZES);
+	MemoryContext old;
+	ChunkSliceIndex *index;
+	List	   *chunks;
+	ListCell   *lc;
+	int			i;
+
+	/* Scan all chunks on a transient memory context */
+	old = MemoryContextSwitchTo(scan_mcxt);
+	chunks = chunk_get_all_by_hypertable(hs, NULL);
+
+	MemoryContextSwitchTo(mcxt);
+
+	index = palloc0(sizeof(ChunkSliceIndex) + sizeof(ChunkSliceIndexDimension) * hs->num_dimensions);
+	index->mcxt = mcxt;
+	index->hypertable_id = hs->hypertable_id;
+	index->num_dimensions = hs->num_dimensions;
+
+	for (i = 0; i < hs->num_dimensions; i++)
+		index_dimension_init(&index->dimensions[i], hs->dimensions[i].fd.id, list_length(chunks));
+
+	MemoryContextSwitchTo(scan_mcxt);
+
+	foreach(lc, chunks)
+		index_add_chunk(index, lfirst(lc), true);
+
+	MemoryContextSwitchTo(old);
+	MemoryContextDelete(scan_mcxt);
+
+	for (i = 0; i < index->num_dimensions; i++)
+	{
+		ChunkSliceIndexDimension *dim = &index->dimensions[i];
+
+		qsort(dim->entries, dim->num_entries, sizeof(ChunkSliceIndexEntry), index_entry_cmp);
+		index_dimension_update_max_end(dim, 0);
+	}
+
+	return index;
+}
+
+void
+chunk_slice_index_free(ChunkSliceIndex *index)
+{
+	MemoryContextDelete(index->mcxt);
+}
+
+/*
+ * Add the chunks that other backends created since the index was built, or
+ * last refreshed, to a stale index.
+ *
+ * Only the chunk catalog is scanned for the hypertable's chunk IDs. The
+ * constraints and slices are read only for the chunks that are not yet in
+ * the index.
+ */
+void
+chunk_slice_index_refresh(ChunkSliceIndex *index, Hyperspace *hs)
+{
+	MemoryContext scan_mcxt;
+	MemoryContext old;
+	List	   *chunks;
+	ListCell   *lc;
+
+	if (!index->stale)
+		return;
+
+	scan_mcxt = AllocSetContextCreate(CurrentMemoryContext,
+									  "Chunk slice index scan",
+									  ALLOCSET_DEFAULT_SIZES);
+	old = MemoryContextSwitchTo(scan_mcxt);
+	chunks = chunk_get_all_by_hypertable(hs, index->chunk_ids);
+
+	foreach(lc, chunks)
+		index_add_chunk(index, lfirst(lc), false);
+
+	MemoryContextSwitchTo(old);
+	MemoryContextDelete(scan_mcxt);
+
+	index->stale = false;
+}
+
+/*
+ * Add a chunk to the index.
+ *
+ * Returns the index's copy of the chunk, or NULL if the chunk could not be
+ * indexed (or is already known to the index).
+ */
+Chunk *
+chunk_slice_index_add(ChunkSliceIndex *index, Chunk *chunk)
+{
+	if (bms_is_member(chunk->fd.id, index->chunk_ids))
+		return NULL;
+
+	return index_add_chunk(index, chunk, false);
+}
+
+/*
+ * Find the chunk that encloses the given point.
+ *
+ * Candidates are found via the interval index of the first dimension and then
+ * checked against the point's coordinates in the remaining dimensions.
+ */
+Chunk *
+chunk_slice_index_find(ChunkSliceIndex *index, Point *p)
+{
+	ChunkSliceIndexDimension *dim;
+	int64		coord;
+	int32		i;
+
+	if (index->num_dimensions == 0 || p->num_coords != index->num_dimensions)
+		return NULL;
+
+	dim = &index->dimensions[0];
+	coord = REMAP_LAST_COORDINATE(p->coordinates[0]);
+
+	for (i = index_dimension_upper_bound(dim, coord) - 1;
+		 i >= 0 && dim->entries[i].max_end > coord;
+		 i--)
+	{
+		ChunkSliceIndexEntry *entry = &dim->entries[i];
+
+		if (entry->range_end > coord && hypercube_contains_point(entry->chunk->cube, p))
+			return entry->chunk;
+	}
+
+	return NULL;
+}
+
+/*
+ * Get an indexed chunk by its relid.
+ *
+ * The map from relid to chunk is built on first use, since it is only needed
+ * for matching already expanded children against the index.
+ */
+Chunk *
+chunk_slice_index_get_by_relid(ChunkSliceIndex *index, Oid relid)
+{
+	ChunkRelidEntry *entry;
+
+	if (NULL == index->relid_map)
+	{
+		ChunkSliceIndexDimension *dim;
+		HASHCTL		ctl = {
+			.keysize = sizeof(Oid),
+			.entrysize = sizeof(ChunkRelidEntry),
+			.hcxt = index->mcxt,
+		};
+		int32		i;
+
+		index->relid_map = hash_create("Chunk slice index relid map",
+									   Max(index->num_chunks, 16),
+									   &ctl,
+									   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+		if (index->num_dimensions > 0)
+		{
+			dim = &index->dimensions[0];
+
+			for (i = 0; i < dim->num_entries; i++)
+				relid_map_add(index->relid_map, dim->entries[i].chunk);
+		}
+	}
+
+	entry = hash_search(index->relid_map, &relid, HASH_FIND, NULL);
+
+	return NULL == entry ? NULL : entry->chunk;
+}
+
+/*
+ * Find all chunks that overlap the range [range_start, range_end) in the
+ * dimension at the given index.
+ *
+ * Returns a list of chunks, ordered by their range start in the dimension.
+ */
+List *
+chunk_slice_index_find_range(ChunkSliceIndex *index, int16 dimension_index,
+							 int64 range_start, int64 range_end)
+{
+	ChunkSliceIndexDimension *dim;
+	List	   *chunks = NIL;
+	int32		i;
+
+	Assert(dimension_index >= 0 && dimension_index < index->num_dimensions);
+
+	if (range_end <= range_start)
+		return NIL;
+
+	dim = &index->dimensions[dimension_index];
+
+	/* Walk backwards from the last entry that starts before the range end */
+	for (i = index_dimension_upper_bound(dim, range_end - 1) - 1;
+		 i >= 0 && dim->entries[i].max_end > range_start;
+		 i--)
+	{
+		ChunkSliceIndexEntry *entry = &dim->entries[i];
+
+		if (entry->range_end > range_start)
+			chunks = lcons(entry->chunk, chunks);
+	}
+
+	return chunks;
+}
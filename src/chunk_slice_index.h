@@ -0,0 +1,76 @@
+#ifndef TIMESCALEDB_CHUNK_SLICE_INDEX_H
+#define TIMESCALEDB_CHUNK_SLICE_INDEX_H
+
+#include <postgres.h>
+#include <nodes/bitmapset.h>
+#include <nodes/pg_list.h>
+#include <utils/hsearch.h>
+#include <utils/memutils.h>
+
+typedef struct Chunk Chunk;
+typedef struct Hyperspace Hyperspace;
+typedef struct Point Point;
+
+/*
+ * An entry in the interval index of a dimension. The entries of a dimension
+ * are sorted on range_start, and max_end holds the maximum range_end of all
+ * entries up to and including this one. This makes the sorted array an
+ * (implicit) augmented interval tree: the intervals that enclose a coordinate
+ * are found with a binary search for the last entry starting at or before the
+ * coordinate, followed by a backwards walk that stops as soon as max_end no
+ * longer reaches the coordinate.
+ */
+typedef struct ChunkSliceIndexEntry
+{
+	int64		range_start;
+	int64		range_end;
+	int64		max_end;
+	Chunk	   *chunk;
+} ChunkSliceIndexEntry;
+
+typedef struct ChunkSliceIndexDimension
+{
+	int32		dimension_id;
+	int32		num_entries;
+	int32		capacity;
+	ChunkSliceIndexEntry *entries;
+} ChunkSliceIndexDimension;
+
+/*
+ * ChunkSliceIndex is an in-memory index of the chunks of a hypertable,
+ * organized by the chunks' dimension slices. It allows finding the chunk that
+ * encloses a point, or the chunks that overlap a range in a dimension, without
+ * any catalog scans.
+ *
+ * The index is built from the catalog the first time it is needed and lives in
+ * the hypertable cache. New chunks are added as they are found or created, and
+ * chunks added by other backends are picked up by refreshing a stale index.
+ * Since removing chunks invalidates the entire hypertable cache, the index
+ * never needs to forget chunks.
+ */
+typedef struct ChunkSliceIndex
+{
+	MemoryContext mcxt;
+	int32		hypertable_id;
+	/* Chunks might have been added since the index was built or refreshed */
+	bool		stale;
+	/* IDs of all chunks known to the index, including unindexed ones */
+	Bitmapset  *chunk_ids;
+	int32		num_chunks;
+	/* Chunks that could not be indexed since they lack slices */
+	int32		num_unindexed;
+	/* Map from chunk relid to chunk, built on demand */
+	HTAB	   *relid_map;
+	int16		num_dimensions;
+	ChunkSliceIndexDimension dimensions[FLEXIBLE_ARRAY_MEMBER];
+} ChunkSliceIndex;
+
+extern ChunkSliceIndex *chunk_slice_index_create(Hyperspace *hs, MemoryContext parent);
+extern void chunk_slice_index_free(ChunkSliceIndex *index);
+extern void chunk_slice_index_refresh(ChunkSliceIndex *index, Hyperspace *hs);
+extern Chunk *chunk_slice_index_add(ChunkSliceIndex *index, Chunk *chunk);
+extern Chunk *chunk_slice_index_find(ChunkSliceIndex *index, Point *p);
+extern Chunk *chunk_slice_index_get_by_relid(ChunkSliceIndex *index, Oid relid);
+extern List *chunk_slice_index_find_range(ChunkSliceIndex *index, int16 dimension_index, int64 range_start, int64 range_end);
+
+#endif   /* TIMESCALEDB_CHUNK_SLICE_INDEX_H */
@@ -0,0 +1,1056 @@
+#include <postgres.h>
+#include <access/heapam.h>
+#include <access/htup_details.h>
+#include <access/xact.h>
+#include <catalog/dependency.h>
+#include <catalog/index.h>
+#include <catalog/namespace.h>
+#include <catalog/pg_class.h>
+#include <catalog/pg_type.h>
+#include <commands/tablecmds.h>
+#include <executor/spi.h>
+#include <lib/stringinfo.h>
+#include <nodes/makefuncs.h>
+#include <storage/lmgr.h>
+#include <utils/array.h>
+#include <utils/builtins.h>
+#include <utils/datum.h>
+#include <utils/fmgroids.h>
+#include <utils/hsearch.h>
+#include <utils/inval.h>
+#include <utils/lsyscache.h>
+#include <utils/memutils.h>
+#include <utils/rel.h>
+#include <utils/snapmgr.h>
+#include <miscadmin.h>
+
+#include "compress_chunk.h"
+#include "chunk.h"
+#include "compat.h"
+#include "dimension.h"
+#include "errors.h"
+#include "hypertable.h"
+#include "hypertable_cache.h"
+#include "scanner.h"
+
+/*
+ * Columnar compression of chunks.
+ *
+ * Compressing a chunk moves its rows into a separate table, in the chunk's
+ * schema, that has one row per batch of up to COMPRESSION_BATCH_SIZE rows of
+ * the chunk. Every column of the chunk is stored in the batch as a single
+ * compressed value (see compression.c), except for segment-by columns, which
+ * have the same value for all rows of a batch and are stored as is. Each
+ * batch also stores its number of rows and the minimum and maximum value of
+ * the time column, which allows skipping batches when scanning.
+ *
+ * Rows are sorted by the segment-by columns and time before they are split
+ * into batches, so that the compressed values are regular sequences of
+ * timestamps and slowly changing measurements, which compress well.
+ *
+ * The chunk's table is kept and can take new rows after compression. Scans
+ * of a compressed chunk read both the batches and the chunk's table.
+ */
+
+TS_FUNCTION_INFO_V1(compress_chunk);
+TS_FUNCTION_INFO_V1(decompress_chunk);
+
+/*
+ * The relids of all compressed chunks, so that the planner and inserts can
+ * tell whether a table is a compressed chunk without scanning the catalog.
+ * The set is built on first use and reset whenever the hypertable cache is
+ * invalidated, which happens when chunks are compressed, decompressed or
+ * dropped. The generation detects invalidations while the set is built.
+ */
+static HTAB *compressed_chunk_relids = NULL;
+static uint32 compressed_chunk_relids_generation = 0;
+
+static int
+compressed_chunk_scan_by_chunk_id(int32 chunk_id, tuple_found_func tuple_found,
+								  void *data, LOCKMODE lockmode)
+{
+	Catalog    *catalog = catalog_get();
+	ScanKeyData scankey[1];
+	ScannerCtx	scanctx = {
+		.table = catalog->tables[COMPRESSED_CHUNK].id,
+		.index = catalog->tables[COMPRESSED_CHUNK].index_ids[COMPRESSED_CHUNK_PKEY_IDX],
+		.scantype = ScannerTypeIndex,
+		.nkeys = 1,
+		.scankey = scankey,
+		.tuple_found = tuple_found,
+		.data = data,
+		.lockmode = lockmode,
+		.scandirection = ForwardScanDirection,
+	};
+
+	ScanKeyInit(&scankey[0], Anum_compressed_chunk_pkey_idx_chunk_id,
+				BTEqualStrategyNumber, F_INT4EQ, Int32GetDatum(chunk_id));
+
+	return scanner_scan(&scanctx);
+}
+
+static bool
+compressed_chunk_tuple_found(TupleInfo *ti, void *data)
+{
+	CompressedChunk **cc = data;
+
+	*cc = palloc0(sizeof(CompressedChunk));
+	memcpy(&(*cc)->fd, GETSTRUCT(ti->tuple), sizeof(FormData_compressed_chunk));
+
+	return false;
+}
+
+/*
+ * Get the compressed data of a chunk. Returns NULL if the table is not a
+ * chunk or the chunk is not compressed.
+ */
+CompressedChunk *
+compressed_chunk_get_by_relid(Oid chunk_relid)
+{
+	Chunk	   *chunk = chunk_get_by_relid(chunk_relid, 0, false);
+	CompressedChunk *cc = NULL;
+
+	if (NULL == chunk)
+		return NULL;
+
+	compressed_chunk_scan_by_chunk_id(chunk->fd.id, compressed_chunk_tuple_found,
+									  &cc, AccessShareLock);
+
+	if (NULL == cc)
+		return NULL;
+
+	cc->chunk_relid = chunk_relid;
+	cc->hypertable_relid = chunk->hypertable_relid;
+	cc->compressed_relid = get_relname_relid(NameStr(cc->fd.table_name),
+											 get_namespace_oid(NameStr(cc->fd.schema_name), false));
+
+	if (!OidIsValid(cc->compressed_relid))
+		elog(ERROR, "compressed table of chunk \"%s\" not found", get_rel_name(chunk_relid));
+
+	return cc;
+}
+
+static bool
+compressed_chunk_relid_found(TupleInfo *ti, void *data)
+{
+	HTAB	   *relids = data;
+	Chunk	   *chunk = chunk_get_by_id(((Form_compressed_chunk) GETSTRUCT(ti->tuple))->chunk_id,
+										0, false);
+
+	if (NULL != chunk)
+		hash_search(relids, &chunk->table_id, HASH_ENTER, NULL);
+
+	return true;
+}
+
+static HTAB *
+compressed_chunk_relids_build(void)
+{
+	Catalog    *catalog = catalog_get();
+	HASHCTL		hctl = {
+		.keysize = sizeof(Oid),
+		.entrysize = sizeof(Oid),
+		.hcxt = CacheMemoryContext,
+	};
+	HTAB	   *relids = hash_create("compressed chunk relids", 16, &hctl,
+									 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	ScannerCtx	scanctx = {
+		.table = catalog->tables[COMPRESSED_CHUNK].id,
+		.scantype = ScannerTypeHeap,
+		.data = relids,
+		.tuple_found = compressed_chunk_relid_found,
+		.lockmode = AccessShareLock,
+		.scandirection = ForwardScanDirection,
+	};
+
+	scanner_scan(&scanctx);
+
+	return relids;
+}
+
+/*
+ * Check if a table is a compressed chunk.
+ */
+bool
+compressed_chunk_exists(Oid chunk_relid)
+{
+	while (NULL == compressed_chunk_relids)
+	{
+		uint32		generation = compressed_chunk_relids_generation;
+		HTAB	   *relids = compressed_chunk_relids_build();
+
+		if (generation == compressed_chunk_relids_generation)
+			compressed_chunk_relids = relids;
+		else
+			hash_destroy(relids);
+	}
+
+	return NULL != hash_search(compressed_chunk_relids, &chunk_relid, HASH_FIND, NULL);
+}
+
+void
+compressed_chunk_cache_invalidate(void)
+{
+	if (NULL != compressed_chunk_relids)
+		hash_destroy(compressed_chunk_relids);
+
+	compressed_chunk_relids = NULL;
+	compressed_chunk_relids_generation++;
+}
+
+static void
+compressed_chunk_insert(int32 chunk_id, const char *schema_name, const char *table_name, int64 num_rows)
+{
+	Catalog    *catalog = catalog_get();
+	Relation	rel = heap_open(catalog->tables[COMPRESSED_CHUNK].id, RowExclusiveLock);
+	TupleDesc	desc = RelationGetDescr(rel);
+	Datum		values[Natts_compressed_chunk];
+	bool		nulls[Natts_compressed_chunk] = {false};
+	CatalogSecurityContext sec_ctx;
+
+	values[Anum_compressed_chunk_chunk_id - 1] = Int32GetDatum(chunk_id);
+	values[Anum_compressed_chunk_schema_name - 1] =
+		DirectFunctionCall1(namein, CStringGetDatum(schema_name));
+	values[Anum_compressed_chunk_table_name - 1] =
+		DirectFunctionCall1(namein, CStringGetDatum(table_name));
+	values[Anum_compressed_chunk_num_rows - 1] = Int64GetDatum(num_rows);
+
+	catalog_become_owner(catalog, &sec_ctx);
+	catalog_insert_values(rel, desc, values, nulls);
+	catalog_restore_user(&sec_ctx);
+
+	heap_close(rel, RowExclusiveLock);
+}
+
+static bool
+compressed_chunk_tuple_delete(TupleInfo *ti, void *data)
+{
+	CatalogSecurityContext sec_ctx;
+
+	catalog_become_owner(catalog_get(), &sec_ctx);
+	catalog_delete(ti->scanrel, ti->tuple);
+	catalog_restore_user(&sec_ctx);
+
+	return true;
+}
+
+/*
+ * Delete the compressed chunk metadata of a chunk. The compressed table is
+ * not dropped, since it depends on the chunk's table.
+ */
+int
+compressed_chunk_delete_by_chunk_id(int32 chunk_id)
+{
+	return compressed_chunk_scan_by_chunk_id(chunk_id, compressed_chunk_tuple_delete,
+											 NULL, RowExclusiveLock);
+}
+
+typedef struct CompressedTablesData
+{
+	int32		hypertable_id;
+	List	   *tables;
+} CompressedTablesData;
+
+static bool
+compressed_chunk_table_found(TupleInfo *ti, void *data)
+{
+	CompressedTablesData *ctd = data;
+	Form_compressed_chunk form = (Form_compressed_chunk) GETSTRUCT(ti->tuple);
+	Chunk	   *chunk = chunk_get_by_id(form->chunk_id, 0, false);
+
+	if (NULL != chunk && chunk->fd.hypertable_id == ctd->hypertable_id)
+		ctd->tables = lappend(ctd->tables,
+							  makeRangeVar(pstrdup(NameStr(form->schema_name)),
+										   pstrdup(NameStr(form->table_name)), -1));
+
+	return true;
+}
+
+/*
+ * Get the compressed tables of a hypertable's chunks.
+ */
+static List *
+compressed_chunk_get_tables(Hypertable *ht)
+{
+	Catalog    *catalog = catalog_get();
+	CompressedTablesData ctd = {
+		.hypertable_id = ht->fd.id,
+		.tables = NIL,
+	};
+	ScannerCtx	scanctx = {
+		.table = catalog->tables[COMPRESSED_CHUNK].id,
+		.scantype = ScannerTypeHeap,
+		.data = &ctd,
+		.tuple_found = compressed_chunk_table_found,
+		.lockmode = AccessShareLock,
+		.scandirection = ForwardScanDirection,
+	};
+
+	scanner_scan(&scanctx);
+
+	return ctd.tables;
+}
+
+bool
+compressed_chunk_hypertable_has_compressed(Hypertable *ht)
+{
+	return compressed_chunk_get_tables(ht) != NIL;
+}
+
+/*
+ * Rename a column in the compressed tables of a hypertable's chunks. The
+ * columns of compressed tables are matched by name with the columns of the
+ * chunks, so they have to follow renames of the hypertable's columns.
+ */
+void
+compressed_chunk_rename_column(Hypertable *ht, const char *oldname, const char *newname)
+{
+	List	   *tables = compressed_chunk_get_tables(ht);
+	ListCell   *lc;
+
+	foreach(lc, tables)
+	{
+		RenameStmt *stmt = makeNode(RenameStmt);
+
+		stmt->renameType = OBJECT_COLUMN;
+		stmt->relationType = OBJECT_TABLE;
+		stmt->relation = lfirst(lc);
+		stmt->subname = pstrdup(oldname);
+		stmt->newname = pstrdup(newname);
+		stmt->missing_ok = false;
+
+		renameatt(stmt);
+	}
+}
+
+static AttrNumber
+tupdesc_get_attno(TupleDesc desc, const char *name)
+{
+	int			i;
+
+	for (i = 0; i < desc->natts; i++)
+	{
+		FormData_pg_attribute *attr = desc->attrs[i];
+
+		if (!attr->attisdropped && namestrcmp(&attr->attname, name) == 0)
+			return attr->attnum;
+	}
+
+	return InvalidAttrNumber;
+}
+
+/*
+ * Create a reader for the batches of a compressed table. Chunk columns are
+ * matched by name with the columns of the compressed table, which follow
+ * renames of the hypertable's columns. Columns added to the chunk after it was
+ * compressed are read as NULLs, which is why new columns with defaults are
+ * rejected while a hypertable has compressed chunks.
+ */
+CompressedBatchReader *
+compressed_batch_reader_create(TupleDesc chunk_desc, TupleDesc compressed_desc)
+{
+	CompressedBatchReader *reader = palloc0(sizeof(CompressedBatchReader));
+	int			i;
+
+	reader->chunk_desc = chunk_desc;
+	reader->compressed_desc = compressed_desc;
+	reader->columns = palloc0(sizeof(CompressedColumn) * chunk_desc->natts);
+	reader->count_attno = tupdesc_get_attno(compressed_desc, COMPRESSION_COLUMN_COUNT);
+
+	if (reader->count_attno == InvalidAttrNumber)
+		elog(ERROR, "compressed table is missing column \"%s\"", COMPRESSION_COLUMN_COUNT);
+
+	for (i = 0; i < chunk_desc->natts; i++)
+	{
+		FormData_pg_attribute *attr = chunk_desc->attrs[i];
+		CompressedColumn *column;
+		AttrNumber	compressed_attno;
+		Oid			compressed_typid;
+
+		if (attr->attisdropped)
+			continue;
+
+		compressed_attno = tupdesc_get_attno(compressed_desc, NameStr(attr->attname));
+
+		if (compressed_attno == InvalidAttrNumber)
+			continue;
+
+		compressed_typid = compressed_desc->attrs[AttrNumberGetAttrOffset(compressed_attno)]->atttypid;
+
+		if (compressed_typid != BYTEAOID && compressed_typid != attr->atttypid)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATATYPE_MISMATCH),
+					 errmsg("Compressed data of column \"%s\" has a different type than the chunk",
+							NameStr(attr->attname))));
+
+		column = &reader->columns[reader->num_columns++];
+		column->chunk_attno = attr->attnum;
+		column->compressed_attno = compressed_attno;
+		column->typid = attr->atttypid;
+
+		/* Segment-by columns keep their type, so they cannot be bytea */
+		column->segment_by = (compressed_typid != BYTEAOID);
+	}
+
+	reader->decompressors = palloc0(sizeof(Decompressor *) * reader->num_columns);
+	reader->segment_values = palloc0(sizeof(Datum) * reader->num_columns);
+	reader->segment_nulls = palloc0(sizeof(bool) * reader->num_columns);
+
+	return reader;
+}
+
+/*
+ * Start reading the rows of a batch. The decompressed data is allocated in
+ * the current memory context, and segment-by values point into the compressed
+ * tuple, which must stay valid until all rows of the batch have been read.
+ */
+void
+compressed_batch_reader_set_batch(CompressedBatchReader *reader, HeapTuple compressed_tuple)
+{
+	bool		isnull;
+	int			i;
+
+	reader->num_rows = DatumGetInt32(heap_getattr(compressed_tuple, reader->count_attno,
+												  reader->compressed_desc, &isnull));
+	reader->row = 0;
+
+	if (isnull)
+		elog(ERROR, "compressed data is corrupt");
+
+	for (i = 0; i < reader->num_columns; i++)
+	{
+		CompressedColumn *column = &reader->columns[i];
+		Datum		value = heap_getattr(compressed_tuple, column->compressed_attno,
+										 reader->compressed_desc, &isnull);
+
+		if (column->segment_by)
+		{
+			reader->segment_values[i] = value;
+			reader->segment_nulls[i] = isnull;
+		}
+		else if (isnull)
+			reader->decompressors[i] = NULL;
+		else
+		{
+			reader->decompressors[i] = decompressor_create(value, column->typid);
+
+			if (decompressor_num_rows(reader->decompressors[i]) != reader->num_rows)
+				elog(ERROR, "compressed data is corrupt");
+		}
+	}
+}
+
+/*
+ * Get the next row of the current batch, as values and nulls for all the
+ * attributes of the chunk. Returns false when the batch has no more rows.
+ */
+bool
+compressed_batch_reader_next(CompressedBatchReader *reader, Datum *values, bool *nulls)
+{
+	int			i;
+
+	if (reader->row >= reader->num_rows)
+		return false;
+
+	for (i = 0; i < reader->chunk_desc->natts; i++)
+	{
+		values[i] = (Datum) 0;
+		nulls[i] = true;
+	}
+
+	for (i = 0; i < reader->num_columns; i++)
+	{
+		CompressedColumn *column = &reader->columns[i];
+		int			off = AttrNumberGetAttrOffset(column->chunk_attno);
+
+		if (column->segment_by)
+		{
+			values[off] = reader->segment_values[i];
+			nulls[off] = reader->segment_nulls[i];
+		}
+		else if (NULL != reader->decompressors[i] &&
+				 !decompressor_next(reader->decompressors[i], &values[off], &nulls[off]))
+			elog(ERROR, "compressed data is corrupt");
+	}
+
+	reader->row++;
+
+	return true;
+}
+
+/*
+ * State for writing the rows of a chunk into batches.
+ */
+typedef struct CompressionWriter
+{
+	Relation	compressed_rel;
+	BulkInsertState bistate;
+	CommandId	mycid;
+	int			num_columns;
+	char	  **names;
+	Oid		   *typids;
+	int16	   *typlens;
+	bool	   *typbyvals;
+	bool	   *segment_by;
+	int			time_column;
+	/* State of the current batch */
+	MemoryContext batch_context;
+	Compressor **compressors;
+	Datum	   *segment_values;
+	bool	   *segment_nulls;
+	Datum		min_time;
+	Datum		max_time;
+	int32		num_rows;
+	int64		total_rows;
+} CompressionWriter;
+
+static List *
+get_segment_by_columns(ArrayType *array)
+{
+	Datum	   *elems;
+	bool	   *nulls;
+	int			nelems;
+	List	   *columns = NIL;
+	int			i;
+
+	deconstruct_array(array, NAMEOID, NAMEDATALEN, false, 'c', &elems, &nulls, &nelems);
+
+	for (i = 0; i < nelems; i++)
+	{
+		if (nulls[i])
+			ereport(ERROR,
+					(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+					 errmsg("Segment-by columns cannot be NULL")));
+
+		columns = lappend(columns, NameStr(*DatumGetName(elems[i])));
+	}
+
+	return columns;
+}
+
+static bool
+list_member_name(List *names, const char *name)
+{
+	ListCell   *lc;
+
+	foreach(lc, names)
+		if (strncmp(lfirst(lc), name, NAMEDATALEN) == 0)
+			return true;
+
+	return false;
+}
+
+static CompressionWriter *
+compression_writer_create(Relation chunk_rel, List *segment_by, const char *time_column)
+{
+	TupleDesc	desc = RelationGetDescr(chunk_rel);
+	CompressionWriter *writer = palloc0(sizeof(CompressionWriter));
+	ListCell   *lc;
+	int			i;
+
+	foreach(lc, segment_by)
+	{
+		AttrNumber	attno = tupdesc_get_attno(desc, lfirst(lc));
+
+		if (attno == InvalidAttrNumber)
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_COLUMN),
+					 errmsg("Column \"%s\" does not exist in chunk \"%s\"",
+							(char *) lfirst(lc), RelationGetRelationName(chunk_rel))));
+
+		if (desc->attrs[AttrNumberGetAttrOffset(attno)]->atttypid == BYTEAOID)
+			ereport(ERROR,
+					(errcode(ERRCODE_IO_OPERATION_NOT_SUPPORTED),
+					 errmsg("Cannot segment by column \"%s\" of type bytea",
+							(char *) lfirst(lc))));
+	}
+
+	writer->names = palloc(sizeof(char *) * desc->natts);
+	writer->typids = palloc(sizeof(Oid) * desc->natts);
+	writer->typlens = palloc(sizeof(int16) * desc->natts);
+	writer->typbyvals = palloc(sizeof(bool) * desc->natts);
+	writer->segment_by = palloc(sizeof(bool) * desc->natts);
+	writer->time_column = -1;
+
+	for (i = 0; i < desc->natts; i++)
+	{
+		FormData_pg_attribute *attr = desc->attrs[i];
+		int			col;
+
+		if (attr->attisdropped)
+			continue;
+
+		if (strncmp(NameStr(attr->attname), "_ts_meta_", strlen("_ts_meta_")) == 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_IO_OPERATION_NOT_SUPPORTED),
+					 errmsg("Cannot compress chunk with column \"%s\"", NameStr(attr->attname)),
+					 errdetail("Column names starting with \"_ts_meta_\" are reserved for compression metadata.")));
+
+		col = writer->num_columns++;
+		writer->names[col] = pstrdup(NameStr(attr->attname));
+		writer->typids[col] = attr->atttypid;
+		writer->typlens[col] = attr->attlen;
+		writer->typbyvals[col] = attr->attbyval;
+		writer->segment_by[col] = list_member_name(segment_by, NameStr(attr->attname));
+
+		if (namestrcmp(&attr->attname, time_column) == 0)
+			writer->time_column = col;
+	}
+
+	if (writer->time_column < 0)
+		elog(ERROR, "time column \"%s\" not found in chunk \"%s\"",
+			 time_column, RelationGetRelationName(chunk_rel));
+
+	writer->compressors = palloc0(sizeof(Compressor *) * writer->num_columns);
+	writer->segment_values = palloc0(sizeof(Datum) * writer->num_columns);
+	writer->segment_nulls = palloc0(sizeof(bool) * writer->num_columns);
+	writer->batch_context = AllocSetContextCreate(CurrentMemoryContext,
+												  "Compression batch",
+												  ALLOCSET_DEFAULT_SIZES);
+
+	return writer;
+}
+
+/*
+ * Create the table for the compressed data of a chunk. Compressed columns are
+ * bytea, stored out of line without further compression by TOAST, since the
+ * data is already compressed.
+ *
+ * As for chunks, the table is created as the catalog owner in the internal
+ * schema and as the chunk's owner elsewhere, and is owned by the chunk's
+ * owner.
+ */
+static Oid
+compress_chunk_create_table(CompressionWriter *writer, const char *schema_name,
+							const char *table_name, Relation chunk_rel)
+{
+	const char *qualified_name = quote_qualified_identifier(schema_name, table_name);
+	const char *time_type = format_type_be(writer->typids[writer->time_column]);
+	Oid			owner = chunk_rel->rd_rel->relowner;
+	StringInfoData command;
+	ObjectAddress compressed_addr;
+	ObjectAddress chunk_addr;
+	bool		has_compressed_columns = false;
+	Oid			relid;
+	Oid			uid,
+				saved_uid;
+	int			sec_ctx;
+	int			i;
+
+	if (strncmp(schema_name, INTERNAL_SCHEMA_NAME, NAMEDATALEN) == 0)
+		uid = catalog_get()->owner_uid;
+	else
+		uid = owner;
+
+	GetUserIdAndSecContext(&saved_uid, &sec_ctx);
+
+	if (uid != saved_uid)
+		SetUserIdAndSecContext(uid, sec_ctx | SECURITY_LOCAL_USERID_CHANGE);
+
+	initStringInfo(&command);
+	appendStringInfo(&command, "CREATE TABLE %s (", qualified_name);
+
+	for (i = 0; i < writer->num_columns; i++)
+		appendStringInfo(&command, "%s %s, ",
+						 quote_identifier(writer->names[i]),
+						 writer->segment_by[i] ? format_type_be(writer->typids[i]) : "bytea");
+
+	appendStringInfo(&command, "%s integer, %s %s, %s %s)",
+					 COMPRESSION_COLUMN_COUNT,
+					 COMPRESSION_COLUMN_MIN, time_type,
+					 COMPRESSION_COLUMN_MAX, time_type);
+
+	if (SPI_execute(command.data, false, 0) != SPI_OK_UTILITY)
+		elog(ERROR, "could not create table \"%s\"", table_name);
+
+	resetStringInfo(&command);
+	appendStringInfo(&command, "ALTER TABLE %s", qualified_name);
+
+	for (i = 0; i < writer->num_columns; i++)
+	{
+		if (writer->segment_by[i])
+			continue;
+
+		appendStringInfo(&command, "%s ALTER COLUMN %s SET STORAGE EXTERNAL",
+						 has_compressed_columns ? "," : "",
+						 quote_identifier(writer->names[i]));
+		has_compressed_columns = true;
+	}
+
+	if (has_compressed_columns &&
+		SPI_execute(command.data, false, 0) != SPI_OK_UTILITY)
+		elog(ERROR, "could not alter table \"%s\"", table_name);
+
+	if (uid != saved_uid)
+		SetUserIdAndSecContext(saved_uid, sec_ctx);
+
+	relid = get_relname_relid(table_name, get_namespace_oid(schema_name, false));
+
+	if (uid != owner)
+		ATExecChangeOwner(relid, owner, false, AccessExclusiveLock);
+
+	/* The compressed table goes away with the chunk */
+	ObjectAddressSet(compressed_addr, RelationRelationId, relid);
+	ObjectAddressSet(chunk_addr, RelationRelationId, RelationGetRelid(chunk_rel));
+	recordDependencyOn(&compressed_addr, &chunk_addr, DEPENDENCY_AUTO);
+
+	return relid;
+}
+
+static void
+compression_writer_flush(CompressionWriter *writer)
+{
+	TupleDesc	desc = RelationGetDescr(writer->compressed_rel);
+	Datum	   *values = palloc(sizeof(Datum) * desc->natts);
+	bool	   *nulls = palloc0(sizeof(bool) * desc->natts);
+	MemoryContext oldcontext = MemoryContextSwitchTo(writer->batch_context);
+	HeapTuple	tuple;
+	int			i;
+
+	for (i = 0; i < writer->num_columns; i++)
+	{
+		if (writer->segment_by[i])
+		{
+			values[i] = writer->segment_values[i];
+			nulls[i] = writer->segment_nulls[i];
+		}
+		else
+			values[i] = compressor_finish(writer->compressors[i]);
+	}
+
+	values[writer->num_columns] = Int32GetDatum(writer->num_rows);
+	values[writer->num_columns + 1] = writer->min_time;
+	values[writer->num_columns + 2] = writer->max_time;
+
+	tuple = heap_form_tuple(desc, values, nulls);
+	heap_insert(writer->compressed_rel, tuple, writer->mycid, 0, writer->bistate);
+
+	MemoryContextSwitchTo(oldcontext);
+	MemoryContextReset(writer->batch_context);
+	pfree(values);
+	pfree(nulls);
+
+	writer->total_rows += writer->num_rows;
+	writer->num_rows = 0;
+}
+
+static Datum
+detoast_segment_value(Datum value, int16 typlen)
+{
+	if (typlen == -1)
+		return PointerGetDatum(PG_DETOAST_DATUM_PACKED(value));
+
+	return value;
+}
+
+static bool
+compression_writer_same_segment(CompressionWriter *writer, HeapTuple tuple, TupleDesc desc)
+{
+	int			i;
+
+	for (i = 0; i < writer->num_columns; i++)
+	{
+		Datum		value;
+		bool		isnull;
+
+		if (!writer->segment_by[i])
+			continue;
+
+		value = heap_getattr(tuple, i + 1, desc, &isnull);
+
+		if (isnull != writer->segment_nulls[i])
+			return false;
+
+		if (!isnull &&
+			!datumIsEqual(detoast_segment_value(value, writer->typlens[i]),
+						  writer->segment_values[i],
+						  writer->typbyvals[i],
+						  writer->typlens[i]))
+			return false;
+	}
+
+	return true;
+}
+
+static void
+compression_writer_append(CompressionWriter *writer, HeapTuple tuple, TupleDesc desc)
+{
+	MemoryContext oldcontext;
+	Datum		time_value;
+	bool		isnull;
+	int			i;
+
+	/* A batch ends when it is full or the segment changes */
+	if (writer->num_rows > 0 &&
+		(writer->num_rows >= COMPRESSION_BATCH_SIZE ||
+		 !compression_writer_same_segment(writer, tuple, desc)))
+		compression_writer_flush(writer);
+
+	oldcontext = MemoryContextSwitchTo(writer->batch_context);
+
+	for (i = 0; i < writer->num_columns; i++)
+	{
+		Datum		value = heap_getattr(tuple, i + 1, desc, &isnull);
+
+		if (writer->segment_by[i])
+		{
+			if (writer->num_rows == 0)
+			{
+				writer->segment_nulls[i] = isnull;
+				writer->segment_values[i] = isnull ? (Datum) 0 :
+					datumCopy(detoast_segment_value(value, writer->typlens[i]),
+							  writer->typbyvals[i], writer->typlens[i]);
+			}
+			continue;
+		}
+
+		if (writer->num_rows == 0)
+			writer->compressors[i] = compressor_create(writer->typids[i]);
+
+		compressor_append(writer->compressors[i], value, isnull);
+	}
+
+	/* Rows are in time order within a segment, and time is never NULL */
+	time_value = datumCopy(heap_getattr(tuple, writer->time_column + 1, desc, &isnull),
+						   writer->typbyvals[writer->time_column],
+						   writer->typlens[writer->time_column]);
+
+	if (writer->num_rows == 0)
+		writer->min_time = time_value;
+	writer->max_time = time_value;
+	writer->num_rows++;
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Read all rows of the chunk, sorted by segment and time, and write them in
+ * batches.
+ */
+static void
+compress_chunk_write_batches(CompressionWriter *writer, const char *chunk_name)
+{
+	StringInfoData query;
+	SPIPlanPtr	plan;
+	Portal		portal;
+	int			i;
+
+	initStringInfo(&query);
+	appendStringInfoString(&query, "SELECT ");
+
+	for (i = 0; i < writer->num_columns; i++)
+		appendStringInfo(&query, "%s%s", i > 0 ? ", " : "", quote_identifier(writer->names[i]));
+
+	appendStringInfo(&query, " FROM ONLY %s ORDER BY ", chunk_name);
+
+	for (i = 0; i < writer->num_columns; i++)
+		if (writer->segment_by[i])
+			appendStringInfo(&query, "%s, ", quote_identifier(writer->names[i]));
+
+	appendStringInfoString(&query, quote_identifier(writer->names[writer->time_column]));
+
+	plan = SPI_prepare(query.data, 0, NULL);
+
+	if (NULL == plan)
+		elog(ERROR, "could not prepare query to read chunk \"%s\"", chunk_name);
+
+	portal = SPI_cursor_open(NULL, plan, NULL, NULL, false);
+
+	for (;;)
+	{
+		uint64		row;
+
+		SPI_cursor_fetch(portal, true, COMPRESSION_BATCH_SIZE);
+
+		if (SPI_processed == 0)
+			break;
+
+		for (row = 0; row < SPI_processed; row++)
+			compression_writer_append(writer, SPI_tuptable->vals[row], SPI_tuptable->tupdesc);
+
+		SPI_freetuptable(SPI_tuptable);
+	}
+
+	if (writer->num_rows > 0)
+		compression_writer_flush(writer);
+
+	SPI_cursor_close(portal);
+}
+
+static Chunk *
+compress_chunk_get_chunk(Oid relid)
+{
+	Chunk	   *chunk;
+
+	if (!OidIsValid(relid))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("Invalid chunk")));
+
+	chunk = chunk_get_by_relid(relid, 0, false);
+
+	if (NULL == chunk)
+		ereport(ERROR,
+				(errcode(ERRCODE_IO_OPERATION_NOT_SUPPORTED),
+				 errmsg("Table \"%s\" is not a chunk", get_rel_name(relid))));
+
+	hypertable_permissions_check(chunk->hypertable_relid, GetUserId());
+
+	/* Block all access to the chunk while its rows are moved */
+	LockRelationOid(relid, AccessExclusiveLock);
+
+	return chunk;
+}
+
+/*
+ * Compress a chunk, optionally segmented by the given columns. Returns the
+ * table that holds the compressed data.
+ */
+Datum
+compress_chunk(PG_FUNCTION_ARGS)
+{
+	Oid			chunk_relid = PG_ARGISNULL(0) ? InvalidOid : PG_GETARG_OID(0);
+	List	   *segment_by = PG_ARGISNULL(1) ? NIL : get_segment_by_columns(PG_GETARG_ARRAYTYPE_P(1));
+	Chunk	   *chunk = compress_chunk_get_chunk(chunk_relid);
+	CompressionWriter *writer;
+	Cache	   *hcache;
+	Hypertable *ht;
+	Dimension  *time_dim;
+	Relation	chunk_rel;
+	char		table_name[NAMEDATALEN];
+	const char *chunk_name;
+	Oid			compressed_relid;
+
+	if (NULL != compressed_chunk_get_by_relid(chunk_relid))
+		ereport(ERROR,
+				(errcode(ERRCODE_IO_OPERATION_NOT_SUPPORTED),
+				 errmsg("Chunk \"%s\" is already compressed", get_rel_name(chunk_relid))));
+
+	hcache = hypertable_cache_pin();
+	ht = hypertable_cache_get_entry(hcache, chunk->hypertable_relid);
+	time_dim = hyperspace_get_open_dimension(ht->space, 0);
+
+	if (NULL == time_dim)
+		ereport(ERROR,
+				(errcode(ERRCODE_IO_OPERATION_NOT_SUPPORTED),
+				 errmsg("Cannot compress chunks of hypertables without a time dimension")));
+
+	chunk_rel = heap_open(chunk_relid, NoLock);
+	writer = compression_writer_create(chunk_rel, segment_by, NameStr(time_dim->fd.column_name));
+	cache_release(hcache);
+
+	snprintf(table_name, NAMEDATALEN, "_compressed_hyper_%d_%d_chunk",
+			 chunk->fd.hypertable_id, chunk->fd.id);
+	chunk_name = quote_qualified_identifier(NameStr(chunk->fd.schema_name),
+											NameStr(chunk->fd.table_name));
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "Could not connect to SPI");
+
+	compressed_relid = compress_chunk_create_table(writer, NameStr(chunk->fd.schema_name),
+												   table_name, chunk_rel);
+
+	writer->compressed_rel = heap_open(compressed_relid, RowExclusiveLock);
+	writer->bistate = GetBulkInsertState();
+	writer->mycid = GetCurrentCommandId(true);
+
+	compress_chunk_write_batches(writer, chunk_name);
+
+	FreeBulkInsertState(writer->bistate);
+	heap_close(writer->compressed_rel, NoLock);
+
+	/* The rows now live in the compressed table */
+	if (SPI_execute(psprintf("TRUNCATE ONLY %s", chunk_name), false, 0) != SPI_OK_UTILITY)
+		elog(ERROR, "could not truncate chunk \"%s\"", NameStr(chunk->fd.table_name));
+
+	SPI_finish();
+
+	heap_close(chunk_rel, NoLock);
+
+	compressed_chunk_insert(chunk->fd.id, NameStr(chunk->fd.schema_name), table_name,
+							writer->total_rows);
+
+	/* Plans that scan the chunk need to read the compressed data */
+	CacheInvalidateRelcacheByRelid(chunk_relid);
+
+	PG_RETURN_OID(compressed_relid);
+}
+
+/*
+ * Decompress a chunk, moving its rows back into the chunk's table and
+ * dropping the compressed table.
+ */
+Datum
+decompress_chunk(PG_FUNCTION_ARGS)
+{
+	Oid			chunk_relid = PG_GETARG_OID(0);
+	Chunk	   *chunk = compress_chunk_get_chunk(chunk_relid);
+	CompressedChunk *cc = compressed_chunk_get_by_relid(chunk_relid);
+	CompressedBatchReader *reader;
+	Relation	chunk_rel;
+	Relation	compressed_rel;
+	HeapScanDesc scan;
+	HeapTuple	tuple;
+	Snapshot	snapshot;
+	BulkInsertState bistate;
+	CommandId	mycid;
+	MemoryContext batch_context;
+	MemoryContext oldcontext;
+	ObjectAddress compressed_addr;
+	Datum	   *values;
+	bool	   *nulls;
+
+	if (NULL == cc)
+		ereport(ERROR,
+				(errcode(ERRCODE_IO_OPERATION_NOT_SUPPORTED),
+				 errmsg("Chunk \"%s\" is not compressed", get_rel_name(chunk_relid))));
+
+	chunk_rel = heap_open(chunk_relid, NoLock);
+	compressed_rel = heap_open(cc->compressed_relid, AccessExclusiveLock);
+	reader = compressed_batch_reader_create(RelationGetDescr(chunk_rel),
+											RelationGetDescr(compressed_rel));
+	values = palloc(sizeof(Datum) * RelationGetDescr(chunk_rel)->natts);
+	nulls = palloc(sizeof(bool) * RelationGetDescr(chunk_rel)->natts);
+	batch_context = AllocSetContextCreate(CurrentMemoryContext,
+										  "Decompression batch",
+										  ALLOCSET_DEFAULT_SIZES);
+
+	/* See the batches written earlier in this transaction */
+	CommandCounterIncrement();
+	snapshot = RegisterSnapshot(GetLatestSnapshot());
+	bistate = GetBulkInsertState();
+	mycid = GetCurrentCommandId(true);
+	scan = heap_beginscan(compressed_rel, snapshot, 0, NULL);
+
+	while ((tuple = heap_getnext(scan, ForwardScanDirection)) != NULL)
+	{
+		MemoryContextReset(batch_context);
+		oldcontext = MemoryContextSwitchTo(batch_context);
+		compressed_batch_reader_set_batch(reader, tuple);
+
+		while (compressed_batch_reader_next(reader, values, nulls))
+			heap_insert(chunk_rel,
+						heap_form_tuple(RelationGetDescr(chunk_rel), values, nulls),
+						mycid, 0, bistate);
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	heap_endscan(scan);
+	FreeBulkInsertState(bistate);
+	UnregisterSnapshot(snapshot);
+	MemoryContextDelete(batch_context);
+	heap_close(compressed_rel, NoLock);
+	heap_close(chunk_rel, NoLock);
+
+	/* The rows were inserted without index entries */
+	reindex_relation(chunk_relid, 0, 0);
+
+	compressed_chunk_delete_by_chunk_id(chunk->fd.id);
+	ObjectAddressSet(compressed_addr, RelationRelationId, cc->compressed_relid);
+	performDeletion(&compressed_addr, DROP_RESTRICT, 0);
+
+	CacheInvalidateRelcacheByRelid(chunk_relid);
+
+	PG_RETURN_VOID();
+}
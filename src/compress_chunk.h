@@ -0,0 +1,70 @@
+#ifndef TIMESCALEDB_COMPRESS_CHUNK_H
+#define TIMESCALEDB_COMPRESS_CHUNK_H
+
+#include <postgres.h>
+#include <access/htup.h>
+#include <access/tupdesc.h>
+
+#include "catalog.h"
+#include "compression.h"
+#include "hypertable.h"
+
+/* Rows are compressed in batches of at most this many rows */
+#define COMPRESSION_BATCH_SIZE 1000
+
+/* Metadata columns of the compressed table */
+#define COMPRESSION_COLUMN_COUNT "_ts_meta_count"
+#define COMPRESSION_COLUMN_MIN "_ts_meta_min"
+#define COMPRESSION_COLUMN_MAX "_ts_meta_max"
+
+typedef struct CompressedChunk
+{
+	FormData_compressed_chunk fd;
+	Oid			chunk_relid;
+	Oid			hypertable_relid;
+	Oid			compressed_relid;
+} CompressedChunk;
+
+/*
+ * A chunk column in the compressed table. Segment-by columns are stored as is,
+ * with one value per batch, while other columns are stored compressed.
+ */
+typedef struct CompressedColumn
+{
+	AttrNumber	chunk_attno;
+	AttrNumber	compressed_attno;
+	Oid			typid;
+	bool		segment_by;
+} CompressedColumn;
+
+/*
+ * Reads the rows of the batches of a compressed table in the layout of the
+ * chunk's table.
+ */
+typedef struct CompressedBatchReader
+{
+	TupleDesc	chunk_desc;
+	TupleDesc	compressed_desc;
+	int			num_columns;
+	CompressedColumn *columns;
+	AttrNumber	count_attno;
+	/* State of the current batch */
+	Decompressor **decompressors;
+	Datum	   *segment_values;
+	bool	   *segment_nulls;
+	int32		num_rows;
+	int32		row;
+} CompressedBatchReader;
+
+extern CompressedChunk *compressed_chunk_get_by_relid(Oid chunk_relid);
+extern bool compressed_chunk_exists(Oid chunk_relid);
+extern void compressed_chunk_cache_invalidate(void);
+extern int	compressed_chunk_delete_by_chunk_id(int32 chunk_id);
+extern bool compressed_chunk_hypertable_has_compressed(Hypertable *ht);
+extern void compressed_chunk_rename_column(Hypertable *ht, const char *oldname, const char *newname);
+
+extern CompressedBatchReader *compressed_batch_reader_create(TupleDesc chunk_desc, TupleDesc compressed_desc);
+extern void compressed_batch_reader_set_batch(CompressedBatchReader *reader, HeapTuple compressed_tuple);
+extern bool compressed_batch_reader_next(CompressedBatchReader *reader, Datum *values, bool *nulls);
+
+#endif   /* TIMESCALEDB_COMPRESS_CHUNK_H */
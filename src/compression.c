@@ -0,0 +1,703 @@
+#include <postgres.h>
+#include <access/tupmacs.h>
+#include <catalog/pg_type.h>
+#include <fmgr.h>
+#include <lib/stringinfo.h>
+#include <utils/lsyscache.h>
+
+#include "compression.h"
+
+/*
+ * Compressed data starts with this header, followed by the NULL bitmap (if
+ * there are NULLs) and the encoded non-NULL values. The bitmap has one bit
+ * per row, set for NULLs, and is stored as 64-bit words so that the values
+ * start at an aligned offset.
+ */
+typedef struct CompressedDataHeader
+{
+	char		vl_len_[4];
+	uint8		algorithm;
+	bool		has_nulls;
+	uint16		padding;
+	int32		num_rows;
+	int32		num_values;
+} CompressedDataHeader;
+
+/*
+ * Bit arrays hold the NULL bitmap and the encoded values for the delta-delta
+ * and Gorilla algorithms. Bits are filled from the least significant bit of
+ * each word.
+ */
+typedef struct BitArray
+{
+	uint64	   *words;
+	uint32		max_words;
+	uint64		num_bits;
+} BitArray;
+
+typedef struct BitArrayReader
+{
+	const uint64 *words;
+	uint64		num_bits;
+	uint64		position;
+} BitArrayReader;
+
+static void
+bit_array_init(BitArray *array)
+{
+	array->max_words = 16;
+	array->words = palloc0(sizeof(uint64) * array->max_words);
+	array->num_bits = 0;
+}
+
+static Size
+bit_array_size(BitArray *array)
+{
+	return ((array->num_bits + 63) / 64) * sizeof(uint64);
+}
+
+/* Append the lowest num_bits bits of the given value */
+static void
+bit_array_append(BitArray *array, int num_bits, uint64 bits)
+{
+	uint32		word = array->num_bits / 64;
+	int			offset = array->num_bits % 64;
+
+	Assert(num_bits >= 0 && num_bits <= 64);
+
+	if (num_bits == 0)
+		return;
+
+	if (num_bits < 64)
+		bits &= (UINT64CONST(1) << num_bits) - 1;
+
+	if (word + 1 >= array->max_words)
+	{
+		uint32		max_words = array->max_words * 2;
+
+		array->words = repalloc(array->words, sizeof(uint64) * max_words);
+		memset(array->words + array->max_words, 0, sizeof(uint64) * (max_words - array->max_words));
+		array->max_words = max_words;
+	}
+
+	array->words[word] |= bits << offset;
+
+	if (offset > 0 && offset + num_bits > 64)
+		array->words[word + 1] |= bits >> (64 - offset);
+
+	array->num_bits += num_bits;
+}
+
+static void
+bit_array_reader_init(BitArrayReader *reader, const char *data, Size size)
+{
+	reader->words = (const uint64 *) data;
+	reader->num_bits = size * 8;
+	reader->position = 0;
+}
+
+static uint64
+bit_array_read(BitArrayReader *reader, int num_bits)
+{
+	uint32		word = reader->position / 64;
+	int			offset = reader->position % 64;
+	uint64		bits;
+
+	if (num_bits == 0)
+		return 0;
+
+	if (reader->position + num_bits > reader->num_bits)
+		elog(ERROR, "compressed data is corrupt");
+
+	bits = reader->words[word] >> offset;
+
+	if (offset > 0 && offset + num_bits > 64)
+		bits |= reader->words[word + 1] << (64 - offset);
+
+	if (num_bits < 64)
+		bits &= (UINT64CONST(1) << num_bits) - 1;
+
+	reader->position += num_bits;
+
+	return bits;
+}
+
+/*
+ * Selectors pick the encoding of the next value. A selector is written as
+ * that many one bits, terminated by a zero bit unless it is the largest
+ * selector.
+ */
+static void
+write_selector(BitArray *array, int selector, int max_selector)
+{
+	bit_array_append(array, selector, ~UINT64CONST(0));
+
+	if (selector < max_selector)
+		bit_array_append(array, 1, 0);
+}
+
+static int
+read_selector(BitArrayReader *reader, int max_selector)
+{
+	int			selector = 0;
+
+	while (selector < max_selector && bit_array_read(reader, 1) == 1)
+		selector++;
+
+	return selector;
+}
+
+static int
+leading_zeros(uint64 value)
+{
+#ifdef __GNUC__
+	return __builtin_clzll(value);
+#else
+	int			n = 0;
+
+	while ((value & (UINT64CONST(1) << 63)) == 0)
+	{
+		value <<= 1;
+		n++;
+	}
+
+	return n;
+#endif
+}
+
+static int
+trailing_zeros(uint64 value)
+{
+#ifdef __GNUC__
+	return __builtin_ctzll(value);
+#else
+	int			n = 0;
+
+	while ((value & 1) == 0)
+	{
+		value >>= 1;
+		n++;
+	}
+
+	return n;
+#endif
+}
+
+/*
+ * Delta-of-delta encoding.
+ *
+ * Regularly spaced values, like the timestamps of periodic measurements, have
+ * a constant delta, so the delta of the deltas is mostly zero. The first value
+ * is stored as is. Every following value stores the zigzag-encoded delta of
+ * deltas, using the smallest of the bit widths below, behind a selector. All
+ * arithmetic wraps around, so any int64 value round-trips.
+ */
+#define DELTADELTA_MAX_SELECTOR 5
+
+static const int deltadelta_bits[DELTADELTA_MAX_SELECTOR + 1] = {0, 7, 9, 12, 32, 64};
+
+static inline uint64
+zigzag_encode(uint64 value)
+{
+	return (value << 1) ^ (0 - (value >> 63));
+}
+
+static inline uint64
+zigzag_decode(uint64 value)
+{
+	return (value >> 1) ^ (0 - (value & 1));
+}
+
+/*
+ * Gorilla XOR encoding of floats.
+ *
+ * Consecutive values of a metric tend to share their sign, exponent and high
+ * mantissa bits, so the XOR with the previous value has many leading and
+ * trailing zeros. A zero XOR takes a single bit. Otherwise, only the bits
+ * between the leading and trailing zeros are stored, reusing the previous
+ * window if the bits fit into it.
+ */
+#define GORILLA_MAX_SELECTOR 2
+#define GORILLA_LEADING_BITS 5
+#define GORILLA_LENGTH_BITS 6
+
+typedef union FloatBits
+{
+	float8		value;
+	uint64		bits;
+} FloatBits;
+
+struct Compressor
+{
+	CompressionAlgorithm algorithm;
+	Oid			typeoid;
+	int16		typlen;
+	bool		typbyval;
+	char		typalign;
+	int32		num_rows;
+	int32		num_values;
+	bool		has_nulls;
+	BitArray	nulls;
+	/* Delta-delta and Gorilla state */
+	BitArray	bits;
+	uint64		prev;
+	uint64		prev_delta;
+	int			prev_leading;
+	int			prev_trailing;
+	/* Array state */
+	StringInfoData values;
+};
+
+struct Decompressor
+{
+	CompressedDataHeader *header;
+	Oid			typeoid;
+	int16		typlen;
+	bool		typbyval;
+	char		typalign;
+	int32		row;
+	int32		value_no;
+	BitArrayReader nulls;
+	/* Delta-delta and Gorilla state */
+	BitArrayReader bits;
+	uint64		prev;
+	uint64		prev_delta;
+	int			prev_leading;
+	int			prev_trailing;
+	/* Array state */
+	const char *values;
+	Size		values_size;
+	Size		offset;
+};
+
+CompressionAlgorithm
+compression_algorithm_for_type(Oid typeoid)
+{
+	switch (getBaseType(typeoid))
+	{
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case DATEOID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			return COMPRESSION_ALGORITHM_DELTADELTA;
+		case FLOAT4OID:
+		case FLOAT8OID:
+			return COMPRESSION_ALGORITHM_GORILLA;
+		default:
+			return COMPRESSION_ALGORITHM_ARRAY;
+	}
+}
+
+static uint64
+datum_to_bits(Datum value, Oid typeoid)
+{
+	FloatBits	fb;
+
+	switch (typeoid)
+	{
+		case INT2OID:
+			return (uint64) (int64) DatumGetInt16(value);
+		case INT4OID:
+		case DATEOID:
+			return (uint64) (int64) DatumGetInt32(value);
+		case FLOAT4OID:
+			fb.value = (float8) DatumGetFloat4(value);
+			return fb.bits;
+		case FLOAT8OID:
+			fb.value = DatumGetFloat8(value);
+			return fb.bits;
+		default:
+			return (uint64) DatumGetInt64(value);
+	}
+}
+
+static Datum
+bits_to_datum(uint64 bits, Oid typeoid)
+{
+	FloatBits	fb;
+
+	switch (typeoid)
+	{
+		case INT2OID:
+			return Int16GetDatum((int16) bits);
+		case INT4OID:
+		case DATEOID:
+			return Int32GetDatum((int32) bits);
+		case FLOAT4OID:
+			fb.bits = bits;
+			return Float4GetDatum((float4) fb.value);
+		case FLOAT8OID:
+			fb.bits = bits;
+			return Float8GetDatum(fb.value);
+		default:
+			return Int64GetDatum((int64) bits);
+	}
+}
+
+Compressor *
+compressor_create(Oid typeoid)
+{
+	Compressor *compressor = palloc0(sizeof(Compressor));
+
+	compressor->algorithm = compression_algorithm_for_type(typeoid);
+	compressor->typeoid = getBaseType(typeoid);
+	get_typlenbyvalalign(compressor->typeoid,
+						 &compressor->typlen,
+						 &compressor->typbyval,
+						 &compressor->typalign);
+	bit_array_init(&compressor->nulls);
+
+	if (compressor->algorithm == COMPRESSION_ALGORITHM_ARRAY)
+		initStringInfo(&compressor->values);
+	else
+		bit_array_init(&compressor->bits);
+
+	return compressor;
+}
+
+static void
+deltadelta_append(Compressor *compressor, uint64 value)
+{
+	uint64		delta;
+	uint64		zigzag;
+	int			selector = 0;
+
+	if (compressor->num_values == 0)
+	{
+		bit_array_append(&compressor->bits, 64, value);
+		compressor->prev = value;
+		compressor->prev_delta = 0;
+		return;
+	}
+
+	delta = value - compressor->prev;
+	zigzag = zigzag_encode(delta - compressor->prev_delta);
+
+	while (selector < DELTADELTA_MAX_SELECTOR &&
+		   (zigzag >> deltadelta_bits[selector]) != 0)
+		selector++;
+
+	write_selector(&compressor->bits, selector, DELTADELTA_MAX_SELECTOR);
+	bit_array_append(&compressor->bits, deltadelta_bits[selector], zigzag);
+	compressor->prev = value;
+	compressor->prev_delta = delta;
+}
+
+static void
+gorilla_append(Compressor *compressor, uint64 value)
+{
+	uint64		xor;
+	int			leading;
+	int			trailing;
+	int			length;
+
+	if (compressor->num_values == 0)
+	{
+		bit_array_append(&compressor->bits, 64, value);
+		compressor->prev = value;
+		compressor->prev_leading = -1;
+		return;
+	}
+
+	xor = value ^ compressor->prev;
+	compressor->prev = value;
+
+	if (xor == 0)
+	{
+		write_selector(&compressor->bits, 0, GORILLA_MAX_SELECTOR);
+		return;
+	}
+
+	leading = Min(leading_zeros(xor), (1 << GORILLA_LEADING_BITS) - 1);
+	trailing = trailing_zeros(xor);
+
+	if (compressor->prev_leading >= 0 &&
+		leading >= compressor->prev_leading &&
+		trailing >= compressor->prev_trailing)
+	{
+		/* Reuse the previous window */
+		length = 64 - compressor->prev_leading - compressor->prev_trailing;
+		write_selector(&compressor->bits, 1, GORILLA_MAX_SELECTOR);
+		bit_array_append(&compressor->bits, length, xor >> compressor->prev_trailing);
+		return;
+	}
+
+	length = 64 - leading - trailing;
+	write_selector(&compressor->bits, 2, GORILLA_MAX_SELECTOR);
+	bit_array_append(&compressor->bits, GORILLA_LEADING_BITS, leading);
+	bit_array_append(&compressor->bits, GORILLA_LENGTH_BITS, length - 1);
+	bit_array_append(&compressor->bits, length, xor >> trailing);
+	compressor->prev_leading = leading;
+	compressor->prev_trailing = trailing;
+}
+
+/*
+ * Values that cannot be encoded otherwise are appended as in a heap tuple,
+ * aligned according to their type. Varlenas are detoasted and stored with a
+ * regular 4-byte header.
+ */
+static void
+array_append(Compressor *compressor, Datum value)
+{
+	StringInfo	values = &compressor->values;
+	int			offset;
+	Size		size;
+
+	if (compressor->typlen == -1)
+		value = PointerGetDatum(PG_DETOAST_DATUM(value));
+
+	offset = att_align_nominal(values->len, compressor->typalign);
+
+	while (values->len < offset)
+		appendStringInfoChar(values, '\0');
+
+	size = att_addlength_datum(0, compressor->typlen, value);
+	enlargeStringInfo(values, size);
+
+	if (compressor->typbyval)
+		store_att_byval(values->data + values->len, value, compressor->typlen);
+	else
+		memcpy(values->data + values->len, DatumGetPointer(value), size);
+
+	values->len += size;
+}
+
+void
+compressor_append(Compressor *compressor, Datum value, bool isnull)
+{
+	compressor->num_rows++;
+	bit_array_append(&compressor->nulls, 1, isnull ? 1 : 0);
+
+	if (isnull)
+	{
+		compressor->has_nulls = true;
+		return;
+	}
+
+	switch (compressor->algorithm)
+	{
+		case COMPRESSION_ALGORITHM_DELTADELTA:
+			deltadelta_append(compressor, datum_to_bits(value, compressor->typeoid));
+			break;
+		case COMPRESSION_ALGORITHM_GORILLA:
+			gorilla_append(compressor, datum_to_bits(value, compressor->typeoid));
+			break;
+		default:
+			array_append(compressor, value);
+			break;
+	}
+
+	compressor->num_values++;
+}
+
+/*
+ * Get the compressed data for all values appended so far, as a bytea datum.
+ */
+Datum
+compressor_finish(Compressor *compressor)
+{
+	Size		nulls_size = compressor->has_nulls ? bit_array_size(&compressor->nulls) : 0;
+	Size		values_size;
+	Size		size;
+	CompressedDataHeader *header;
+	char	   *data;
+
+	if (compressor->algorithm == COMPRESSION_ALGORITHM_ARRAY)
+		values_size = compressor->values.len;
+	else
+		values_size = bit_array_size(&compressor->bits);
+
+	size = sizeof(CompressedDataHeader) + nulls_size + values_size;
+	header = palloc0(size);
+	SET_VARSIZE(header, size);
+	header->algorithm = compressor->algorithm;
+	header->has_nulls = compressor->has_nulls;
+	header->num_rows = compressor->num_rows;
+	header->num_values = compressor->num_values;
+	data = (char *) header + sizeof(CompressedDataHeader);
+
+	if (nulls_size > 0)
+		memcpy(data, compressor->nulls.words, nulls_size);
+
+	if (compressor->algorithm == COMPRESSION_ALGORITHM_ARRAY)
+		memcpy(data + nulls_size, compressor->values.data, values_size);
+	else
+		memcpy(data + nulls_size, compressor->bits.words, values_size);
+
+	return PointerGetDatum(header);
+}
+
+/*
+ * Create a decompressor for compressed data of a column of the given type.
+ * The data is copied, so that it is aligned and independent of the tuple it
+ * was read from.
+ */
+Decompressor *
+decompressor_create(Datum compressed, Oid typeoid)
+{
+	Decompressor *decompressor = palloc0(sizeof(Decompressor));
+	CompressedDataHeader *header = (CompressedDataHeader *) PG_DETOAST_DATUM_COPY(compressed);
+	Size		size = VARSIZE(header);
+	Size		nulls_size = 0;
+	char	   *data = (char *) header + sizeof(CompressedDataHeader);
+
+	if (size < sizeof(CompressedDataHeader) ||
+		header->algorithm != compression_algorithm_for_type(typeoid) ||
+		header->num_values > header->num_rows)
+		elog(ERROR, "compressed data is corrupt");
+
+	decompressor->header = header;
+	decompressor->typeoid = getBaseType(typeoid);
+	get_typlenbyvalalign(decompressor->typeoid,
+						 &decompressor->typlen,
+						 &decompressor->typbyval,
+						 &decompressor->typalign);
+
+	if (header->has_nulls)
+	{
+		nulls_size = ((header->num_rows + 63) / 64) * sizeof(uint64);
+
+		if (sizeof(CompressedDataHeader) + nulls_size > size)
+			elog(ERROR, "compressed data is corrupt");
+
+		bit_array_reader_init(&decompressor->nulls, data, nulls_size);
+	}
+
+	decompressor->values = data + nulls_size;
+	decompressor->values_size = size - sizeof(CompressedDataHeader) - nulls_size;
+
+	if (header->algorithm != COMPRESSION_ALGORITHM_ARRAY)
+		bit_array_reader_init(&decompressor->bits, decompressor->values, decompressor->values_size);
+
+	return decompressor;
+}
+
+int32
+decompressor_num_rows(Decompressor *decompressor)
+{
+	return decompressor->header->num_rows;
+}
+
+static uint64
+deltadelta_next(Decompressor *decompressor)
+{
+	int			selector;
+	uint64		zigzag;
+
+	if (decompressor->value_no == 0)
+	{
+		decompressor->prev = bit_array_read(&decompressor->bits, 64);
+		decompressor->prev_delta = 0;
+		return decompressor->prev;
+	}
+
+	selector = read_selector(&decompressor->bits, DELTADELTA_MAX_SELECTOR);
+	zigzag = bit_array_read(&decompressor->bits, deltadelta_bits[selector]);
+	decompressor->prev_delta += zigzag_decode(zigzag);
+	decompressor->prev += decompressor->prev_delta;
+
+	return decompressor->prev;
+}
+
+static uint64
+gorilla_next(Decompressor *decompressor)
+{
+	int			length;
+
+	if (decompressor->value_no == 0)
+	{
+		decompressor->prev = bit_array_read(&decompressor->bits, 64);
+		decompressor->prev_leading = -1;
+		return decompressor->prev;
+	}
+
+	switch (read_selector(&decompressor->bits, GORILLA_MAX_SELECTOR))
+	{
+		case 0:
+			break;
+		case 1:
+			if (decompressor->prev_leading < 0)
+				elog(ERROR, "compressed data is corrupt");
+
+			length = 64 - decompressor->prev_leading - decompressor->prev_trailing;
+			decompressor->prev ^= bit_array_read(&decompressor->bits, length) << decompressor->prev_trailing;
+			break;
+		default:
+			decompressor->prev_leading = bit_array_read(&decompressor->bits, GORILLA_LEADING_BITS);
+			length = bit_array_read(&decompressor->bits, GORILLA_LENGTH_BITS) + 1;
+
+			if (decompressor->prev_leading + length > 64)
+				elog(ERROR, "compressed data is corrupt");
+
+			decompressor->prev_trailing = 64 - decompressor->prev_leading - length;
+			decompressor->prev ^= bit_array_read(&decompressor->bits, length) << decompressor->prev_trailing;
+			break;
+	}
+
+	return decompressor->prev;
+}
+
+static Datum
+array_next(Decompressor *decompressor)
+{
+	Size		offset = att_align_nominal(decompressor->offset, decompressor->typalign);
+	const char *ptr = decompressor->values + offset;
+	Datum		value;
+
+	if (offset >= decompressor->values_size)
+		elog(ERROR, "compressed data is corrupt");
+
+	value = fetch_att(ptr, decompressor->typbyval, decompressor->typlen);
+	decompressor->offset = att_addlength_pointer(offset, decompressor->typlen, ptr);
+
+	if (decompressor->offset > decompressor->values_size)
+		elog(ERROR, "compressed data is corrupt");
+
+	return value;
+}
+
+/*
+ * Get the value of the next row. Returns false when all rows have been
+ * returned. Values of types that are passed by reference point into the
+ * decompressor's copy of the data.
+ */
+bool
+decompressor_next(Decompressor *decompressor, Datum *value, bool *isnull)
+{
+	CompressedDataHeader *header = decompressor->header;
+
+	if (decompressor->row >= header->num_rows)
+		return false;
+
+	decompressor->row++;
+
+	if (header->has_nulls && bit_array_read(&decompressor->nulls, 1) == 1)
+	{
+		*value = (Datum) 0;
+		*isnull = true;
+		return true;
+	}
+
+	if (decompressor->value_no >= header->num_values)
+		elog(ERROR, "compressed data is corrupt");
+
+	switch (header->algorithm)
+	{
+		case COMPRESSION_ALGORITHM_DELTADELTA:
+			*value = bits_to_datum(deltadelta_next(decompressor), decompressor->typeoid);
+			break;
+		case COMPRESSION_ALGORITHM_GORILLA:
+			*value = bits_to_datum(gorilla_next(decompressor), decompressor->typeoid);
+			break;
+		default:
+			*value = array_next(decompressor);
+			break;
+	}
+
+	decompressor->value_no++;
+	*isnull = false;
+
+	return true;
+}
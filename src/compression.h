@@ -0,0 +1,37 @@
+#ifndef TIMESCALEDB_COMPRESSION_H
+#define TIMESCALEDB_COMPRESSION_H
+
+#include <postgres.h>
+
+/*
+ * Compression of the values of a column.
+ *
+ * A compressor takes the values of a column, one row at a time, and encodes
+ * them into a single varlena. The algorithm depends on the column type:
+ * integers and timestamps are delta-of-delta encoded, floats are XOR encoded
+ * as in Facebook's Gorilla, and other types are stored as a plain array of
+ * values. NULLs are kept in a bitmap next to the values.
+ */
+typedef enum CompressionAlgorithm
+{
+	COMPRESSION_ALGORITHM_NONE = 0,
+	COMPRESSION_ALGORITHM_DELTADELTA,
+	COMPRESSION_ALGORITHM_GORILLA,
+	COMPRESSION_ALGORITHM_ARRAY,
+	_MAX_COMPRESSION_ALGORITHMS,
+} CompressionAlgorithm;
+
+typedef struct Compressor Compressor;
+typedef struct Decompressor Decompressor;
+
+extern CompressionAlgorithm compression_algorithm_for_type(Oid typeoid);
+
+extern Compressor *compressor_create(Oid typeoid);
+extern void compressor_append(Compressor *compressor, Datum value, bool isnull);
+extern Datum compressor_finish(Compressor *compressor);
+
+extern Decompressor *decompressor_create(Datum compressed, Oid typeoid);
+extern int32 decompressor_num_rows(Decompressor *decompressor);
+extern bool decompressor_next(Decompressor *decompressor, Datum *value, bool *isnull);
+
+#endif   /* TIMESCALEDB_COMPRESSION_H */
@@ -1,20 +1,73 @@
 #include <postgres.h>
 #include <nodes/extensible.h>
+#include <nodes/makefuncs.h>
+#include <nodes/nodeFuncs.h>
 #include <nodes/plannodes.h>
 #include <parser/parsetree.h>
 #include <optimizer/plancat.h>
 #include <optimizer/clauses.h>
 #include <optimizer/prep.h>
+#include <optimizer/subselect.h>
 #include <executor/executor.h>
+#include <executor/nodeSubplan.h>
+#include <access/heapam.h>
+#include <access/parallel.h>
 #include <catalog/pg_class.h>
 #include <utils/memutils.h>
+#include <utils/datum.h>
 #include <utils/lsyscache.h>
 #include <commands/explain.h>
+#include <portability/instr_time.h>
+#include <port/atomics.h>
 
 #include "constraint_aware_append.h"
+#include "chunk_slice_index.h"
 #include "hypertable.h"
+#include "hypertable_cache.h"
+#include "hypertable_restrict.h"
+#include "chunk_column_stats.h"
+#include "lazy_append.h"
+#include "ordered_append.h"
+#include "planner_utils.h"
 #include "compat.h"
 
+/*
+ * Indexes into the custom_private list of the CustomScan plan node.
+ *
+ * The plan is copied to parallel workers as a string, and RestrictInfo and
+ * AppendRelInfo nodes cannot be read back from one. The list therefore only
+ * holds the bare clauses and range table indexes, from which we rebuild the
+ * planner structures at execution time.
+ */
+enum CustomPrivateIndex
+{
+	CAA_PRIVATE_RTI,
+	CAA_PRIVATE_CHILD_RTIS,
+	CAA_PRIVATE_CLAUSES,
+	CAA_PRIVATE_HYPERTABLE_RELID,
+};
+
+/*
+ * Shared state of a parallel-aware scan, in dynamic shared memory.
+ *
+ * The children of a parallel Append are partial scans, which split the
+ * blocks of a chunk among all processes that scan it. Instead of having all
+ * processes go through the chunks in the same order, each process claims the
+ * next chunk from a shared counter. Processes thus spread over the chunks,
+ * and only join the scan of a chunk that another process is scanning once
+ * all chunks have been handed out. A chunk that is finished by any process
+ * is not claimed again.
+ *
+ * Both arrays are indexed by the position of the child in the plan, before
+ * any exclusion.
+ */
+typedef struct ConstraintAwareAppendParallelState
+{
+	/* Number of claims so far, the first num_plans hand out each child */
+	pg_atomic_uint32 next_plan;
+	bool		finished[FLEXIBLE_ARRAY_MEMBER];
+} ConstraintAwareAppendParallelState;
+
 /*
  * Exclude child relations (chunks) at execution time based on constraints.
  *
@@ -67,6 +120,68 @@ excluded_by_constraint(RangeTblEntry *rte, AppendRelInfo *appinfo, List *restric
 	return relation_excluded_by_constraints(&root, &rel, rte);
 }
 
+/*
+ * Build the AppendRelInfo that translates the hypertable's Vars into the
+ * chunk's. The planner's AppendRelInfo is not kept in the plan, so it is
+ * rebuilt from the relations, using the range table indexes from before the
+ * plan's range table was flattened, like the clauses.
+ */
+static AppendRelInfo *
+child_get_appinfo(ConstraintAwareAppendState *state, ConstraintAwareAppendChild *child)
+{
+	Relation	parent;
+	Relation	rel;
+	AppendRelInfo *appinfo;
+	MemoryContext old;
+
+	if (NULL != child->appinfo)
+		return child->appinfo;
+
+	/* Runtime exclusion runs in a short-lived context */
+	old = MemoryContextSwitchTo(state->csstate.ss.ps.state->es_query_cxt);
+
+	parent = heap_open(state->hypertable_relid, AccessShareLock);
+	rel = heap_open(child->rte->relid, AccessShareLock);
+
+	appinfo = makeNode(AppendRelInfo);
+	appinfo->parent_relid = state->rti;
+	appinfo->child_relid = child->rti;
+	appinfo->parent_reltype = parent->rd_rel->reltype;
+	appinfo->child_reltype = rel->rd_rel->reltype;
+	appinfo->translated_vars = make_translation_list(parent, rel, child->rti);
+	appinfo->parent_reloid = RelationGetRelid(parent);
+
+	heap_close(rel, NoLock);
+	heap_close(parent, NoLock);
+
+	MemoryContextSwitchTo(old);
+
+	child->appinfo = appinfo;
+
+	return appinfo;
+}
+
+/*
+ * Wrap the clauses from the plan in RestrictInfos for use with the planner's
+ * functions.
+ */
+static List *
+make_restrictinfos(List *clauses)
+{
+	List	   *restrictinfos = NIL;
+	ListCell   *lc;
+
+	foreach(lc, clauses)
+	{
+		RestrictInfo *rinfo = makeNode(RestrictInfo);
+
+		rinfo->clause = lfirst(lc);
+		restrictinfos = lappend(restrictinfos, rinfo);
+	}
+
+	return restrictinfos;
+}
+
 /*
  * Convert restriction clauses to constants expressions (i.e., if there are
  * mutable functions, they need to be evaluated to constants).  For instance,
@@ -107,10 +222,316 @@ constify_restrictinfos(List *restrictinfos)
 	return newinfos;
 }
 
+/*
+ * Get the range table index of the relation scanned by a child plan of an
+ * Append or MergeAppend. The planner might have put a Sort (for MergeAppend)
+ * or a Result (for projection) on top of the scan.
+ */
+static Index
+get_plan_scanrelid(Plan *plan)
+{
+	while (NULL != plan)
+	{
+		switch (nodeTag(plan))
+		{
+			case T_SeqScan:
+			case T_SampleScan:
+			case T_IndexScan:
+			case T_IndexOnlyScan:
+			case T_BitmapHeapScan:
+			case T_TidScan:
+			case T_ForeignScan:
+			case T_CustomScan:
+				return ((Scan *) plan)->scanrelid;
+			case T_Sort:
+			case T_Result:
+			case T_Material:
+				plan = plan->lefttree;
+				break;
+			default:
+				return 0;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Split the restriction clauses into the ones that can be evaluated directly
+ * against the dimension slices of chunks and the ones that need constraint
+ * refutation.
+ */
+static HypertableRestrict *
+build_hypertable_restrict(Index rti, Hypertable *ht, List *restrictinfos, List **other_clauses)
+{
+	HypertableRestrict *hr = hypertable_restrict_create(rti, ht->space);
+	ListCell   *lc;
+
+	*other_clauses = NIL;
+
+	foreach(lc, restrictinfos)
+	{
+		RestrictInfo *rinfo = lfirst(lc);
+
+		if (!hypertable_restrict_add_qual(hr, (Node *) rinfo->clause))
+			*other_clauses = lappend(*other_clauses, rinfo);
+	}
+
+	return hr;
+}
+
+typedef enum ChildExclusion
+{
+	CHILD_NOT_EXCLUDED,
+	CHILD_EXCLUDED_BY_SLICES,
+	CHILD_EXCLUDED_BY_STATS,
+	CHILD_EXCLUDED_BY_CONSTRAINTS,
+} ChildExclusion;
+
+/*
+ * Check if a child can be excluded. Chunks that are in the slice index are
+ * first matched against the restrictions on dimension columns, so that only
+ * the other clauses need constraint refutation. Restrictions on columns with
+ * chunk stats are matched against the stats before trying refutation.
+ */
+static ChildExclusion
+child_exclusion(ConstraintAwareAppendState *state,
+				ConstraintAwareAppendChild *child,
+				HypertableRestrict *hr,
+				ChunkStatsRestrict *sr,
+				List *other_clauses,
+				List *restrictinfos)
+{
+	if (0 == child->rti)
+		return CHILD_NOT_EXCLUDED;
+
+	if (NULL != hr && NULL != child->chunk)
+	{
+		if (!hypertable_restrict_match_chunk(hr, child->chunk))
+			return CHILD_EXCLUDED_BY_SLICES;
+
+		if (NULL != sr && !chunk_stats_restrict_match_chunk(sr, child->chunk->fd.id))
+			return CHILD_EXCLUDED_BY_STATS;
+
+		/* The slices already cover the clauses on dimension columns */
+		if (other_clauses != NIL &&
+			excluded_by_constraint(child->rte, child_get_appinfo(state, child), other_clauses))
+			return CHILD_EXCLUDED_BY_CONSTRAINTS;
+	}
+	else if (excluded_by_constraint(child->rte, child_get_appinfo(state, child), restrictinfos))
+		return CHILD_EXCLUDED_BY_CONSTRAINTS;
+
+	return CHILD_NOT_EXCLUDED;
+}
+
+/*
+ * Replace parameters with constants holding their current values.
+ */
+static Node *
+replace_params_mutator(Node *node, ExprContext *econtext)
+{
+	if (NULL == node)
+		return NULL;
+
+	if (IsA(node, Param))
+	{
+		Param	   *param = (Param *) node;
+		Datum		value;
+		bool		isnull;
+		int16		typlen;
+		bool		typbyval;
+
+		switch (param->paramkind)
+		{
+			case PARAM_EXEC:
+				{
+					ParamExecData *prm = &econtext->ecxt_param_exec_vals[param->paramid];
+
+					/* Parameters of init plans are evaluated on demand */
+					if (NULL != prm->execPlan)
+						ExecSetParamPlan(prm->execPlan, econtext);
+
+					value = prm->value;
+					isnull = prm->isnull;
+					break;
+				}
+			case PARAM_EXTERN:
+				{
+					ParamListInfo params = econtext->ecxt_param_list_info;
+					ParamExternData *prm;
+
+					if (NULL == params || param->paramid <= 0 || param->paramid > params->numParams)
+						return node;
+
+					prm = &params->params[param->paramid - 1];
+
+					if (!OidIsValid(prm->ptype) && NULL != params->paramFetch)
+						(*params->paramFetch) (params, param->paramid);
+
+					if (prm->ptype != param->paramtype)
+						return node;
+
+					value = prm->value;
+					isnull = prm->isnull;
+					break;
+				}
+			default:
+				return node;
+		}
+
+		get_typlenbyval(param->paramtype, &typlen, &typbyval);
+
+		return (Node *) makeConst(param->paramtype,
+								  param->paramtypmod,
+								  param->paramcollid,
+								  (int) typlen,
+								  isnull ? (Datum) 0 : datumCopy(value, typbyval, typlen),
+								  isnull,
+								  typbyval);
+	}
+
+	return expression_tree_mutator(node, replace_params_mutator, econtext);
+}
+
+static void
+get_append_state_plans(PlanState *ps, PlanState ***plans, int **num_plans)
+{
+	switch (nodeTag(ps))
+	{
+		case T_AppendState:
+			*plans = ((AppendState *) ps)->appendplans;
+			*num_plans = &((AppendState *) ps)->as_nplans;
+			break;
+		case T_MergeAppendState:
+			*plans = ((MergeAppendState *) ps)->mergeplans;
+			*num_plans = &((MergeAppendState *) ps)->ms_nplans;
+			break;
+		case T_CustomScanState:
+			if (is_ordered_append_state(ps))
+			{
+				get_append_state_plans(linitial(((CustomScanState *) ps)->custom_ps), plans, num_plans);
+				break;
+			}
+			/* FALLTHROUGH */
+		default:
+			elog(ERROR, "Invalid plan state %d", nodeTag(ps));
+	}
+}
+
+/*
+ * Exclude children based on the current values of parameters.
+ *
+ * All children that survived exclusion at startup are initialized. Here we
+ * only activate the matching ones, by moving them to the front of the
+ * Append's (or MergeAppend's) array of subplans and limiting the number of
+ * subplans the node iterates over. The excluded children stay in the array,
+ * after the active ones, so that they are still ended and explained. With
+ * lazy initialization, we scan the children ourselves and only need to
+ * record which ones are active.
+ */
+static void
+ca_append_runtime_exclude(ConstraintAwareAppendState *state)
+{
+	ExprContext *econtext = state->csstate.ss.ps.ps_ExprContext;
+	List	   *restrictinfos = NIL;
+	List	   *other_clauses = NIL;
+	HypertableRestrict *hr = NULL;
+	ChunkStatsRestrict *sr = NULL;
+	PlanState **plans;
+	int		   *num_plans;
+	bool	   *excluded;
+	int			num_active = 0;
+	int			i;
+	ListCell   *lc;
+	MemoryContext old;
+	instr_time	start,
+				duration;
+
+	INSTR_TIME_SET_CURRENT(start);
+
+	MemoryContextReset(state->exclusion_mcxt);
+	old = MemoryContextSwitchTo(state->exclusion_mcxt);
+
+	foreach(lc, state->param_clauses)
+	{
+		RestrictInfo *rinfo = makeNode(RestrictInfo);
+
+		rinfo->clause = (Expr *) replace_params_mutator((Node *) ((RestrictInfo *) lfirst(lc))->clause, econtext);
+		restrictinfos = lappend(restrictinfos, rinfo);
+	}
+
+	restrictinfos = constify_restrictinfos(restrictinfos);
+
+	if (NULL != state->ht)
+	{
+		hr = build_hypertable_restrict(state->rti, state->ht, restrictinfos, &other_clauses);
+
+		if (state->has_stats)
+			sr = chunk_stats_restrict_create(state->rti, state->ht, restrictinfos);
+	}
+
+	excluded = palloc(sizeof(bool) * state->num_children);
+
+	for (i = 0; i < state->num_children; i++)
+		excluded[i] = child_exclusion(state, &state->children[i], hr, sr, other_clauses, restrictinfos) != CHILD_NOT_EXCLUDED;
+
+	if (NULL != state->lazy)
+	{
+		/* Children are initialized on demand, so only set the active ones */
+		for (i = 0; i < state->num_children; i++)
+			if (!excluded[i])
+				state->lazy->active[num_active++] = i;
+
+		state->lazy->num_active = num_active;
+	}
+	else
+	{
+		int			num_inactive = 0;
+
+		get_append_state_plans(linitial(state->csstate.custom_ps), &plans, &num_plans);
+
+		for (i = 0; i < state->num_children; i++)
+		{
+			if (excluded[i])
+				continue;
+
+			if (NULL != state->active_plan_indexes)
+				state->active_plan_indexes[num_active] = state->plan_indexes[i];
+
+			plans[num_active++] = state->children[i].state;
+		}
+
+		*num_plans = num_active;
+
+		for (i = 0; i < state->num_children; i++)
+			if (excluded[i])
+				plans[num_active + num_inactive++] = state->children[i].state;
+	}
+
+	state->num_active_subplans = num_active;
+	state->num_excluded_at_runtime += state->num_children - num_active;
+
+	MemoryContextSwitchTo(old);
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+	state->exclusion_time += INSTR_TIME_GET_MILLISEC(duration);
+}
+
 /*
  * Initialize the scan state and prune any subplans from the Append node below
- * us in the plan tree. Pruning happens by evaluating the subplan's table
- * constraints against a folded version of the restriction clauses in the query.
+ * us in the plan tree.
+ *
+ * Pruning first matches the folded restriction clauses on dimension columns
+ * against the dimension slices of each chunk, which only requires looking up
+ * the chunk in the hypertable's slice index. Only the remaining clauses, and
+ * chunks that are not in the index, are evaluated against the chunk's table
+ * constraints via constraint refutation. Chunks in the index are also matched
+ * against the clauses on columns that have chunk stats.
+ *
+ * Clauses that compare against parameters cannot be evaluated at this
+ * point. If there are such clauses, exclusion is repeated with the current
+ * parameter values before the first tuple is fetched and on every rescan.
  */
 static void
 ca_append_begin(CustomScanState *node, EState *estate, int eflags)
@@ -118,18 +539,41 @@ ca_append_begin(CustomScanState *node, EState *estate, int eflags)
 	ConstraintAwareAppendState *state = (ConstraintAwareAppendState *) node;
 	CustomScan *cscan = (CustomScan *) node->ss.ps.plan;
 	Plan	   *subplan = copyObject(state->subplan);
-	List	   *append_rel_info = lsecond(cscan->custom_private);
-	List	   *restrictinfos = constify_restrictinfos(lthird(cscan->custom_private));
+	Plan	   *append_plan = subplan;
+	Index		rti = linitial_int(list_nth(cscan->custom_private, CAA_PRIVATE_RTI));
+	List	   *child_rtis = list_nth(cscan->custom_private, CAA_PRIVATE_CHILD_RTIS);
+	List	   *clauses = make_restrictinfos(list_nth(cscan->custom_private, CAA_PRIVATE_CLAUSES));
+	Oid			hypertable_relid = linitial_oid(list_nth(cscan->custom_private, CAA_PRIVATE_HYPERTABLE_RELID));
+	List	   *restrictinfos;
+	List	   *other_clauses = NIL;
 	List	  **appendplans,
 			   *old_appendplans;
+	List	   *children = NIL;
+	List	   *plan_indexes = NIL;
 	ListCell   *lc_plan,
-			   *lc_info;
+			   *lc_rti,
+			   *lc_child;
+	HypertableRestrict *hr = NULL;
+	ChunkStatsRestrict *sr = NULL;
+	ChunkSliceIndex *index = NULL;
+	Cache	   *hcache;
+	Hypertable *ht;
+	int			i = 0;
+	instr_time	start,
+				duration;
 
-	switch (nodeTag(subplan))
+	state->rti = rti;
+	state->hypertable_relid = hypertable_relid;
+
+	/* An ordered append wraps the Append whose children we prune */
+	if (is_ordered_append_plan(subplan))
+		append_plan = linitial(((CustomScan *) subplan)->custom_plans);
+
+	switch (nodeTag(append_plan))
 	{
 		case T_Append:
 			{
-				Append	   *append = (Append *) subplan;
+				Append	   *append = (Append *) append_plan;
 
 				old_appendplans = append->appendplans;
 				append->appendplans = NIL;
@@ -138,7 +582,7 @@ ca_append_begin(CustomScanState *node, EState *estate, int eflags)
 			}
 		case T_MergeAppend:
 			{
-				MergeAppend *append = (MergeAppend *) subplan;
+				MergeAppend *append = (MergeAppend *) append_plan;
 
 				old_appendplans = append->mergeplans;
 				append->mergeplans = NIL;
@@ -155,49 +599,272 @@ ca_append_begin(CustomScanState *node, EState *estate, int eflags)
 			 */
 			return;
 		default:
-			elog(ERROR, "Invalid plan %d", nodeTag(subplan));
+			elog(ERROR, "Invalid plan %d", nodeTag(append_plan));
 	}
 
-	forboth(lc_plan, old_appendplans, lc_info, append_rel_info)
+	INSTR_TIME_SET_CURRENT(start);
+
+	restrictinfos = constify_restrictinfos(clauses);
+	hcache = hypertable_cache_pin();
+	ht = hypertable_cache_get_entry(hcache, hypertable_relid);
+
+	if (NULL != ht)
 	{
-		Scan	   *scan = lfirst(lc_plan);
-		AppendRelInfo *appinfo = lfirst(lc_info);
-		RangeTblEntry *rte = rt_fetch(scan->scanrelid, estate->es_range_table);
+		ListCell   *lc;
 
-		switch (nodeTag(scan))
+		foreach(lc, clauses)
 		{
-			case T_SeqScan:
-			case T_SampleScan:
-			case T_IndexScan:
-			case T_IndexOnlyScan:
-			case T_BitmapIndexScan:
-			case T_BitmapHeapScan:
-			case T_TidScan:
-			case T_SubqueryScan:
-			case T_FunctionScan:
-			case T_ValuesScan:
-			case T_CteScan:
-			case T_WorkTableScan:
-			case T_ForeignScan:
-			case T_CustomScan:
+			RestrictInfo *rinfo = lfirst(lc);
 
-				/*
-				 * If this is a base rel (chunk), check if it can be excluded
-				 * from the scan. Otherwise, fall through.
-				 */
-				if (rte->rtekind == RTE_RELATION &&
-					rte->relkind == RELKIND_RELATION &&
-					!rte->inh &&
-					excluded_by_constraint(rte, appinfo, restrictinfos))
-					break;
-			default:
-				*appendplans = lappend(*appendplans, scan);
+			if (contain_param((Node *) rinfo->clause))
+				state->param_clauses = lappend(state->param_clauses, rinfo);
 		}
+
+		hr = build_hypertable_restrict(rti, ht, restrictinfos, &other_clauses);
+
+		/*
+		 * Chunk stats can change at any time, so a parallel worker might see
+		 * different stats than the leader. A parallel scan requires all
+		 * processes to have the same children, so it does not use stats.
+		 */
+		if (!node->ss.ps.plan->parallel_aware)
+		{
+			sr = chunk_stats_restrict_create(rti, ht, restrictinfos);
+			state->has_stats = ht->stats_columns != NIL;
+		}
+
+		if (hr->restricted || sr != NULL || state->param_clauses != NIL)
+			index = hypertable_get_slice_index(ht);
 	}
 
+	/*
+	 * The shared state of a parallel scan is indexed by the position of the
+	 * child in the plan, so count all children, including excluded ones
+	 */
+	state->num_plans = list_length(old_appendplans);
+
+	forboth(lc_plan, old_appendplans, lc_rti, child_rtis)
+	{
+		Plan	   *plan = lfirst(lc_plan);
+		ConstraintAwareAppendChild *child = palloc0(sizeof(ConstraintAwareAppendChild));
+
+		/* Only base rels (chunks) can be excluded. Other subplans have no RTI. */
+		child->rti = lfirst_int(lc_rti);
+
+		if (0 != child->rti)
+		{
+			/*
+			 * The range table index in the plan is the one from before the
+			 * plan's range table was flattened, so look up the chunk via the
+			 * final plan.
+			 */
+			child->rte = rt_fetch(get_plan_scanrelid(plan), estate->es_range_table);
+
+			if (child->rte->rtekind != RTE_RELATION ||
+				child->rte->relkind != RELKIND_RELATION ||
+				child->rte->inh)
+				child->rti = 0;
+			else if (NULL != index)
+				child->chunk = chunk_slice_index_get_by_relid(index, child->rte->relid);
+		}
+
+		switch (child_exclusion(state, child, hr, sr, other_clauses, restrictinfos))
+		{
+			case CHILD_EXCLUDED_BY_SLICES:
+				state->num_excluded_by_slices++;
+				break;
+			case CHILD_EXCLUDED_BY_STATS:
+				state->num_excluded_by_stats++;
+				break;
+			case CHILD_EXCLUDED_BY_CONSTRAINTS:
+				state->num_excluded_by_constraints++;
+				break;
+			case CHILD_NOT_EXCLUDED:
+				*appendplans = lappend(*appendplans, plan);
+				children = lappend(children, child);
+				plan_indexes = lappend_int(plan_indexes, i);
+				break;
+		}
+
+		i++;
+	}
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+	state->exclusion_time = INSTR_TIME_GET_MILLISEC(duration);
+
 	state->num_append_subplans = list_length(*appendplans);
-	if (state->num_append_subplans > 0)
+	state->num_active_subplans = state->num_append_subplans;
+
+	/*
+	 * A MergeAppend needs a tuple from every child before it can return
+	 * anything, so only Append children are worth initializing lazily. The
+	 * Append itself is then not needed, since we scan its children in the
+	 * same way. The children of a parallel Append must all be initialized up
+	 * front, since their shared state is set up before the scan starts.
+	 */
+	if (state->num_append_subplans > 0 && IsA(append_plan, Append) &&
+		!node->ss.ps.plan->parallel_aware &&
+		lazy_append_enabled(estate, eflags))
+		state->lazy = lazy_append_create(*appendplans, estate, eflags);
+	else if (state->num_append_subplans > 0)
 		node->custom_ps = list_make1(ExecInitNode(subplan, estate, eflags));
+
+	if (node->ss.ps.plan->parallel_aware && state->num_append_subplans > 0)
+	{
+		ListCell   *lc;
+		int			pos = 0;
+
+		state->plan_indexes = palloc(sizeof(int) * state->num_append_subplans);
+		state->active_plan_indexes = palloc(sizeof(int) * state->num_append_subplans);
+		state->parallel_current = -1;
+
+		foreach(lc, plan_indexes)
+		{
+			state->plan_indexes[pos] = lfirst_int(lc);
+			state->active_plan_indexes[pos] = lfirst_int(lc);
+			pos++;
+		}
+	}
+
+	if (state->param_clauses == NIL || state->num_append_subplans == 0)
+	{
+		state->param_clauses = NIL;
+		cache_release(hcache);
+		return;
+	}
+
+	/*
+	 * Keep the hypertable cache pinned, since runtime exclusion references
+	 * the hypertable's dimensions and the chunks in its slice index.
+	 */
+	state->hcache = hcache;
+	state->ht = ht;
+	state->exclusion_mcxt = AllocSetContextCreate(CurrentMemoryContext,
+												  "ConstraintAwareAppend exclusion",
+												  ALLOCSET_DEFAULT_SIZES);
+	state->children = palloc(sizeof(ConstraintAwareAppendChild) * state->num_append_subplans);
+	state->num_children = state->num_append_subplans;
+	state->exclude_on_exec = true;
+
+	i = 0;
+	foreach(lc_child, children)
+		state->children[i++] = *((ConstraintAwareAppendChild *) lfirst(lc_child));
+
+	if (NULL == state->lazy)
+	{
+		PlanState **plans;
+		int		   *num_plans;
+
+		get_append_state_plans(linitial(node->custom_ps), &plans, &num_plans);
+
+		for (i = 0; i < state->num_children; i++)
+			state->children[i].state = plans[i];
+	}
+}
+
+/*
+ * Find the position of a child in the Append's array of active children by
+ * its plan index, or -1 if the child is not active. Active children are in
+ * plan order.
+ */
+static int
+ca_append_active_position(ConstraintAwareAppendState *state, int num_active, int plan_index)
+{
+	int			low = 0;
+	int			high = num_active - 1;
+
+	while (low <= high)
+	{
+		int			mid = (low + high) / 2;
+
+		if (state->active_plan_indexes[mid] == plan_index)
+			return mid;
+
+		if (state->active_plan_indexes[mid] < plan_index)
+			low = mid + 1;
+		else
+			high = mid - 1;
+	}
+
+	return -1;
+}
+
+/*
+ * Claim the next child to scan in a parallel scan. Returns the position of
+ * the child in the Append's array of active children, or -1 if all are
+ * finished.
+ *
+ * Every claim atomically increments the shared counter, so the first
+ * num_plans claims across all processes hand out each child exactly once, in
+ * plan order. Claims of children that are excluded in this process, or
+ * already finished, are passed over. Once all children are handed out, we
+ * join the scan of any child that is not finished yet, starting at a
+ * different child for every claim so that processes spread out.
+ */
+static int
+ca_append_parallel_claim(ConstraintAwareAppendState *state, int num_active)
+{
+	ConstraintAwareAppendParallelState *pstate = state->pstate;
+	uint32		claim;
+	int			i;
+
+	if (num_active == 0)
+		return -1;
+
+	while ((claim = pg_atomic_fetch_add_u32(&pstate->next_plan, 1)) < (uint32) state->num_plans)
+	{
+		int			pos = ca_append_active_position(state, num_active, (int) claim);
+
+		/* Pairs with the barrier after marking a child finished */
+		pg_read_barrier();
+
+		if (pos >= 0 && !pstate->finished[claim])
+			return pos;
+	}
+
+	pg_read_barrier();
+
+	for (i = 0; i < num_active; i++)
+	{
+		int			pos = (claim + i) % num_active;
+
+		if (!pstate->finished[state->active_plan_indexes[pos]])
+			return pos;
+	}
+
+	return -1;
+}
+
+static TupleTableSlot *
+ca_append_parallel_exec(ConstraintAwareAppendState *state)
+{
+	PlanState **plans;
+	int		   *num_plans;
+
+	get_append_state_plans(linitial(state->csstate.custom_ps), &plans, &num_plans);
+
+	while (true)
+	{
+		TupleTableSlot *slot;
+
+		if (state->parallel_current < 0)
+		{
+			state->parallel_current = ca_append_parallel_claim(state, *num_plans);
+
+			if (state->parallel_current < 0)
+				return NULL;
+		}
+
+		slot = ExecProcNode(plans[state->parallel_current]);
+
+		if (!TupIsNull(slot))
+			return slot;
+
+		state->pstate->finished[state->active_plan_indexes[state->parallel_current]] = true;
+		pg_write_barrier();
+		state->parallel_current = -1;
+	}
 }
 
 static TupleTableSlot *
@@ -211,11 +878,17 @@ ca_append_exec(CustomScanState *node)
 	ExprDoneCond isDone;
 #endif
 
+	if (state->exclude_on_exec)
+	{
+		ca_append_runtime_exclude(state);
+		state->exclude_on_exec = false;
+	}
+
 	/*
 	 * Check if all append subplans were pruned. In that case there is nothing
 	 * to do.
 	 */
-	if (state->num_append_subplans == 0)
+	if (state->num_active_subplans == 0)
 		return NULL;
 
 #if PG96
@@ -234,7 +907,12 @@ ca_append_exec(CustomScanState *node)
 
 	while (true)
 	{
-		subslot = ExecProcNode(linitial(node->custom_ps));
+		if (NULL != state->lazy)
+			subslot = lazy_append_exec(state->lazy, &node->custom_ps);
+		else if (NULL != state->pstate)
+			subslot = ca_append_parallel_exec(state);
+		else
+			subslot = ExecProcNode(linitial(node->custom_ps));
 
 		if (TupIsNull(subslot))
 			return NULL;
@@ -261,18 +939,59 @@ ca_append_exec(CustomScanState *node)
 static void
 ca_append_end(CustomScanState *node)
 {
-	if (node->custom_ps != NIL)
+	ConstraintAwareAppendState *state = (ConstraintAwareAppendState *) node;
+
+	if (NULL != state->lazy)
+		lazy_append_end(state->lazy);
+	else if (node->custom_ps != NIL)
 	{
+		/* Make sure all children are ended, including inactive ones */
+		if (state->param_clauses != NIL)
+		{
+			PlanState **plans;
+			int		   *num_plans;
+
+			get_append_state_plans(linitial(node->custom_ps), &plans, &num_plans);
+			*num_plans = state->num_children;
+		}
+
 		ExecEndNode(linitial(node->custom_ps));
 	}
+
+	if (NULL != state->hcache)
+		cache_release(state->hcache);
 }
 
 static void
 ca_append_rescan(CustomScanState *node)
 {
+	ConstraintAwareAppendState *state = (ConstraintAwareAppendState *) node;
+
 #if PG96
 	node->ss.ps.ps_TupFromTlist = false;
 #endif
+
+	if (state->num_append_subplans == 0)
+		return;
+
+	/* Parameter values might have changed, so redo exclusion */
+	if (state->param_clauses != NIL)
+	{
+		ca_append_runtime_exclude(state);
+		state->exclude_on_exec = false;
+	}
+
+	if (NULL != state->lazy)
+	{
+		lazy_append_rescan(state->lazy, node->ss.ps.chgParam);
+		return;
+	}
+
+	state->parallel_current = -1;
+
+	if (node->ss.ps.chgParam != NULL)
+		UpdateChangedParamSet(linitial(node->custom_ps), node->ss.ps.chgParam);
+
 	ExecReScan(linitial(node->custom_ps));
 }
 
@@ -283,19 +1002,89 @@ ca_append_explain(CustomScanState *node,
 {
 	CustomScan *cscan = (CustomScan *) node->ss.ps.plan;
 	ConstraintAwareAppendState *state = (ConstraintAwareAppendState *) node;
-	Index		rti = linitial_int(linitial(cscan->custom_private));
-	RangeTblEntry *rte = rt_fetch(rti, es->rtable);
+	Oid			hypertable_relid = linitial_oid(list_nth(cscan->custom_private, CAA_PRIVATE_HYPERTABLE_RELID));
 
-	ExplainPropertyText("Hypertable", get_rel_name(rte->relid), es);
+	ExplainPropertyText("Hypertable", get_rel_name(hypertable_relid), es);
 	ExplainPropertyInteger("Chunks left after exclusion", state->num_append_subplans, es);
+
+	if (es->verbose)
+	{
+		ExplainPropertyInteger("Chunks excluded by slices", state->num_excluded_by_slices, es);
+
+		if (state->has_stats)
+			ExplainPropertyInteger("Chunks excluded by stats", state->num_excluded_by_stats, es);
+
+		ExplainPropertyInteger("Chunks excluded by constraints", state->num_excluded_by_constraints, es);
+	}
+
+	if (state->param_clauses != NIL && es->analyze)
+		ExplainPropertyInteger("Chunks excluded at runtime", state->num_excluded_at_runtime, es);
+
+	if (es->analyze && es->timing)
+		ExplainPropertyFloat("Exclusion time", state->exclusion_time, 3, es);
 }
 
+static Size
+ca_append_estimate_dsm(CustomScanState *node, ParallelContext *pcxt)
+{
+	ConstraintAwareAppendState *state = (ConstraintAwareAppendState *) node;
+
+	return add_size(offsetof(ConstraintAwareAppendParallelState, finished),
+					mul_size(sizeof(bool), state->num_plans));
+}
+
+static void
+ca_append_reset_dsm(ConstraintAwareAppendState *state, ConstraintAwareAppendParallelState *pstate)
+{
+	pg_atomic_write_u32(&pstate->next_plan, 0);
+	memset(pstate->finished, 0, sizeof(bool) * state->num_plans);
+}
+
+static void
+ca_append_initialize_dsm(CustomScanState *node, ParallelContext *pcxt, void *coordinate)
+{
+	ConstraintAwareAppendState *state = (ConstraintAwareAppendState *) node;
+	ConstraintAwareAppendParallelState *pstate = coordinate;
+
+	if (!node->ss.ps.plan->parallel_aware)
+		return;
+
+	pg_atomic_init_u32(&pstate->next_plan, 0);
+	ca_append_reset_dsm(state, pstate);
+	state->pstate = pstate;
+}
+
+#if PG10
+static void
+ca_append_reinitialize_dsm(CustomScanState *node, ParallelContext *pcxt, void *coordinate)
+{
+	ConstraintAwareAppendState *state = (ConstraintAwareAppendState *) node;
+
+	if (NULL != state->pstate)
+		ca_append_reset_dsm(state, state->pstate);
+}
+#endif
+
+static void
+ca_append_initialize_worker(CustomScanState *node, shm_toc *toc, void *coordinate)
+{
+	ConstraintAwareAppendState *state = (ConstraintAwareAppendState *) node;
+
+	if (node->ss.ps.plan->parallel_aware)
+		state->pstate = coordinate;
+}
 
 static CustomExecMethods constraint_aware_append_state_methods = {
 	.BeginCustomScan = ca_append_begin,
 	.ExecCustomScan = ca_append_exec,
 	.EndCustomScan = ca_append_end,
 	.ReScanCustomScan = ca_append_rescan,
+	.EstimateDSMCustomScan = ca_append_estimate_dsm,
+	.InitializeDSMCustomScan = ca_append_initialize_dsm,
+#if PG10
+	.ReInitializeDSMCustomScan = ca_append_reinitialize_dsm,
+#endif
+	.InitializeWorkerCustomScan = ca_append_initialize_worker,
 	.ExplainCustomScan = ca_append_explain,
 };
 
@@ -318,6 +1107,129 @@ static CustomScanMethods constraint_aware_append_plan_methods = {
 	.CreateCustomScanState = constraint_aware_append_state_create,
 };
 
+/*
+ * Get the range table index of each child plan's relation, in the order of the
+ * child plans. Children that do not scan a child relation of the given parent
+ * get a 0 entry.
+ */
+static List *
+get_child_rtis(PlannerInfo *root, Index parent_relid, Plan *subplan)
+{
+	List	   *plans;
+	List	   *rtis = NIL;
+	ListCell   *lc;
+
+	switch (nodeTag(subplan))
+	{
+		case T_Append:
+			plans = ((Append *) subplan)->appendplans;
+			break;
+		case T_MergeAppend:
+			plans = ((MergeAppend *) subplan)->mergeplans;
+			break;
+		case T_CustomScan:
+			if (is_ordered_append_plan(subplan))
+				return get_child_rtis(root, parent_relid, linitial(((CustomScan *) subplan)->custom_plans));
+			return NIL;
+		default:
+			return NIL;
+	}
+
+	foreach(lc, plans)
+	{
+		Index		scanrelid = get_plan_scanrelid(lfirst(lc));
+		Index		child_rti = 0;
+
+		if (scanrelid > 0)
+		{
+			ListCell   *lc_info;
+
+			foreach(lc_info, root->append_rel_list)
+			{
+				AppendRelInfo *info = lfirst(lc_info);
+
+				if (info->child_relid == scanrelid && info->parent_relid == parent_relid)
+				{
+					child_rti = scanrelid;
+					break;
+				}
+			}
+		}
+
+		rtis = lappend_int(rtis, child_rti);
+	}
+
+	return rtis;
+}
+
+/*
+ * Replace Vars of outer relations with nestloop parameters, in the same way
+ * as the planner does for the quals of parameterized scans. The nested loop
+ * sets the parameters for every outer row before it rescans us.
+ */
+static Node *
+replace_nestloop_params_mutator(Node *node, PlannerInfo *root)
+{
+	if (NULL == node)
+		return NULL;
+
+	if (IsA(node, Var))
+	{
+		Var		   *var = (Var *) node;
+		Param	   *param;
+		NestLoopParam *nlp;
+		ListCell   *lc;
+
+		if (var->varlevelsup != 0 || !bms_is_member(var->varno, root->curOuterRels))
+			return node;
+
+		param = assign_nestloop_param_var(root, var);
+
+		foreach(lc, root->curOuterParams)
+		{
+			nlp = lfirst(lc);
+
+			if (nlp->paramno == param->paramid)
+				return (Node *) param;
+		}
+
+		nlp = makeNode(NestLoopParam);
+		nlp->paramno = param->paramid;
+		nlp->paramval = var;
+		root->curOuterParams = lappend(root->curOuterParams, nlp);
+
+		return (Node *) param;
+	}
+
+	return expression_tree_mutator(node, replace_nestloop_params_mutator, root);
+}
+
+/*
+ * Get the bare clauses of the path's restrictions for the plan. The clauses
+ * of a parameterized path include join clauses that reference the outer side
+ * of a nested loop.
+ */
+static List *
+get_plan_clauses(PlannerInfo *root, Path *path, List *restrictinfos)
+{
+	List	   *result = NIL;
+	ListCell   *lc;
+
+	foreach(lc, restrictinfos)
+	{
+		Node	   *clause = (Node *) ((RestrictInfo *) lfirst(lc))->clause;
+
+		if (NULL != path->param_info)
+			clause = replace_nestloop_params_mutator(clause, root);
+		else
+			clause = copyObject(clause);
+
+		result = lappend(result, clause);
+	}
+
+	return result;
+}
+
 static Plan *
 constraint_aware_append_plan_create(PlannerInfo *root,
 									RelOptInfo *rel,
@@ -333,9 +1245,10 @@ constraint_aware_append_plan_create(PlannerInfo *root,
 	cscan->scan.plan.targetlist = tlist;		/* Target list we expect as
 												 * output */
 	cscan->custom_plans = custom_plans;
-	cscan->custom_private = list_make3(list_make1_int(rel->relid),
-									   list_copy(root->append_rel_list),
-									   list_copy(clauses));
+	cscan->custom_private = list_make4(list_make1_int(rel->relid),
+									   get_child_rtis(root, rel->relid, subplan),
+									   get_plan_clauses(root, &path->path, clauses),
+									   list_make1_oid(planner_rt_fetch(rel->relid, root)->relid));
 	cscan->custom_scan_tlist = subplan->targetlist;		/* Target list of tuples
 														 * we expect as input */
 	cscan->flags = path->flags;
@@ -368,8 +1281,6 @@ Path *
 constraint_aware_append_path_create(PlannerInfo *root, Hypertable *ht, Path *subpath)
 {
 	ConstraintAwareAppendPath *path;
-	AppendRelInfo *appinfo;
-	Oid			relid;
 
 	path = (ConstraintAwareAppendPath *) newNode(sizeof(ConstraintAwareAppendPath), T_CustomPath);
 	path->cpath.path.pathtype = T_CustomScan;
@@ -381,6 +1292,14 @@ constraint_aware_append_path_create(PlannerInfo *root, Hypertable *ht, Path *sub
 	path->cpath.path.param_info = subpath->param_info;
 	path->cpath.path.pathtarget = subpath->pathtarget;
 
+	/*
+	 * The children of a partial Append, i.e., one that runs below a Gather,
+	 * are partial scans. We then coordinate the processes that scan them.
+	 */
+	path->cpath.path.parallel_safe = subpath->parallel_safe;
+	path->cpath.path.parallel_workers = subpath->parallel_workers;
+	path->cpath.path.parallel_aware = subpath->parallel_workers > 0;
+
 	/*
 	 * Set flags. We can set CUSTOMPATH_SUPPORT_BACKWARD_SCAN and
 	 * CUSTOMPATH_SUPPORT_MARK_RESTORE. The only interesting flag is the first
@@ -394,8 +1313,8 @@ constraint_aware_append_path_create(PlannerInfo *root, Hypertable *ht, Path *sub
 	path->cpath.methods = &constraint_aware_append_path_methods;
 
 	/*
-	 * Remove the main table from the append_rel_list and Append's subpaths
-	 * since it cannot contain any tuples
+	 * Remove the main table from the Append's subpaths since it cannot contain
+	 * any tuples
 	 */
 	switch (nodeTag(subpath))
 	{
@@ -413,16 +1332,27 @@ constraint_aware_append_path_create(PlannerInfo *root, Hypertable *ht, Path *sub
 				append->subpaths = remove_parent_subpath(root, append->subpaths, ht->main_table_relid);
 				break;
 			}
+		case T_CustomPath:
+			/* An ordered append has no subpath for the main table */
+			if (is_ordered_append_path(subpath))
+				break;
+			/* FALLTHROUGH */
 		default:
 			elog(ERROR, "Invalid node type %u", nodeTag(subpath));
 			break;
 	}
 
-	appinfo = linitial(root->append_rel_list);
-	relid = root->simple_rte_array[appinfo->child_relid]->relid;
+	return &path->cpath.path;
+}
 
-	if (relid == ht->main_table_relid)
-		root->append_rel_list = list_delete_first(root->append_rel_list);
+void
+_constraint_aware_append_init(void)
+{
+	/* Needed to send the plan to parallel workers */
+	RegisterCustomScanMethods(&constraint_aware_append_plan_methods);
+}
 
-	return &path->cpath.path;
+void
+_constraint_aware_append_fini(void)
+{
 }
@@ -10,16 +10,82 @@ typedef struct ConstraintAwareAppendPath
 	CustomPath	cpath;
 } ConstraintAwareAppendPath;
 
+typedef struct Cache Cache;
+typedef struct Chunk Chunk;
+typedef struct Hypertable Hypertable;
+typedef struct LazyAppend LazyAppend;
+typedef struct ConstraintAwareAppendParallelState ConstraintAwareAppendParallelState;
+
+/* A child of the Append that survived exclusion at startup */
+typedef struct ConstraintAwareAppendChild
+{
+	PlanState  *state;
+
+	/*
+	 * Range table index of the chunk before the plan's range table was
+	 * flattened, or 0 if the child is not a chunk, in which case it is never
+	 * excluded
+	 */
+	Index		rti;
+	/* Built on first use, since only constraint refutation needs it */
+	AppendRelInfo *appinfo;
+	RangeTblEntry *rte;
+	/* The chunk, if found in the hypertable's slice index */
+	Chunk	   *chunk;
+} ConstraintAwareAppendChild;
+
 typedef struct ConstraintAwareAppendState
 {
 	CustomScanState csstate;
 	Plan	   *subplan;
+	/* Range table index of the hypertable before flattening */
+	Index		rti;
+	Oid			hypertable_relid;
 	Size		num_append_subplans;
-} ConstraintAwareAppendState;
+	Size		num_excluded_by_slices;
+	Size		num_excluded_by_stats;
+	Size		num_excluded_by_constraints;
+	/* Set if the hypertable has columns with chunk stats */
+	bool		has_stats;
+	/* Time spent excluding chunks, in milliseconds */
+	double		exclusion_time;
+	/* Set if the Append's children are initialized on demand */
+	LazyAppend *lazy;
 
-typedef struct Hypertable Hypertable;
+	/*
+	 * Runtime exclusion state, used if there are clauses that compare against
+	 * parameters
+	 */
+	List	   *param_clauses;
+	Cache	   *hcache;
+	Hypertable *ht;
+	ConstraintAwareAppendChild *children;
+	int			num_children;
+	int			num_active_subplans;
+	Size		num_excluded_at_runtime;
+	bool		exclude_on_exec;
+	MemoryContext exclusion_mcxt;
+
+	/*
+	 * Parallel scan state, used if the node is parallel aware. Processes
+	 * identify children by their index in the plan's list of children, before
+	 * any exclusion, which is the same in all processes.
+	 */
+	ConstraintAwareAppendParallelState *pstate;
+	/* Number of children in the plan */
+	int			num_plans;
+	/* Plan index of each child that survived exclusion at startup */
+	int		   *plan_indexes;
+	/* Plan index of each child in the Append's array of active children */
+	int		   *active_plan_indexes;
+	/* Position of the child currently scanned, or -1 */
+	int			parallel_current;
+} ConstraintAwareAppendState;
 
 Path	   *constraint_aware_append_path_create(PlannerInfo *root, Hypertable *ht, Path *subpath);
 
+extern void _constraint_aware_append_init(void);
+extern void _constraint_aware_append_fini(void);
+
 
 #endif   /* TIMESCALEDB_CONSTRAINT_AWARE_APPEND_H */
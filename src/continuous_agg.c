@@ -0,0 +1,1246 @@
+#include <postgres.h>
+#include <access/htup_details.h>
+#include <access/xact.h>
+#include <catalog/dependency.h>
+#include <catalog/namespace.h>
+#include <catalog/pg_class.h>
+#include <catalog/pg_type.h>
+#include <commands/tablecmds.h>
+#include <executor/spi.h>
+#include <lib/stringinfo.h>
+#include <optimizer/clauses.h>
+#include <optimizer/tlist.h>
+#include <parser/parsetree.h>
+#include <rewrite/rewriteHandler.h>
+#include <storage/lmgr.h>
+#include <utils/acl.h>
+#include <utils/builtins.h>
+#include <utils/date.h>
+#include <utils/fmgroids.h>
+#include <utils/lsyscache.h>
+#include <utils/rel.h>
+#include <utils/timestamp.h>
+#include <miscadmin.h>
+
+#include "continuous_agg.h"
+#include "catalog.h"
+#include "chunk.h"
+#include "compat.h"
+#include "dimension.h"
+#include "dimension_slice.h"
+#include "errors.h"
+#include "hypercube.h"
+#include "hypertable.h"
+#include "hypertable_cache.h"
+#include "scanner.h"
+#include "utils.h"
+
+/*
+ * Continuous aggregates.
+ *
+ * A continuous aggregate is a view that groups the rows of a hypertable (the
+ * "raw" hypertable) by time_bucket() on the hypertable's time column. The
+ * aggregated rows are materialized into a separate hypertable, so that
+ * queries on the view do not need to aggregate the raw data again.
+ *
+ * Creating a continuous aggregate keeps the original view definition as the
+ * "direct view" and replaces the user's view with the union of:
+ *
+ *	 - the materialized rows of buckets below the watermark, and
+ *	 - the rows of the direct view for buckets at or above the watermark.
+ *
+ * The watermark only moves forward, on refresh, up to the bucket of the
+ * greatest time value in the raw hypertable. Writes to the raw hypertable
+ * log the range of time values they modified in the invalidation log and a
+ * refresh recomputes the materialized buckets in the logged ranges from the
+ * direct view. Refreshes are thus incremental: their cost depends on the
+ * amount of modified and new data rather than on the size of the raw
+ * hypertable.
+ */
+
+TS_FUNCTION_INFO_V1(create_continuous_aggregate);
+TS_FUNCTION_INFO_V1(refresh_continuous_aggregate);
+TS_FUNCTION_INFO_V1(continuous_agg_watermark);
+
+#define MATERIALIZATION_TABLE_PREFIX "_materialized_hypertable_"
+#define DIRECT_VIEW_PREFIX "_direct_view_"
+
+static int
+continuous_agg_scan(int indexid, ScanKeyData *scankey, int nkeys,
+					tuple_found_func tuple_found, void *data, LOCKMODE lockmode)
+{
+	Catalog    *catalog = catalog_get();
+	ScannerCtx	scanctx = {
+		.table = catalog->tables[CONTINUOUS_AGG].id,
+		.index = catalog->tables[CONTINUOUS_AGG].index_ids[indexid],
+		.scantype = ScannerTypeIndex,
+		.nkeys = nkeys,
+		.scankey = scankey,
+		.tuple_found = tuple_found,
+		.data = data,
+		.lockmode = lockmode,
+		.scandirection = ForwardScanDirection,
+	};
+
+	return scanner_scan(&scanctx);
+}
+
+static int
+continuous_agg_scan_by_mat_id(int32 mat_hypertable_id, tuple_found_func tuple_found,
+							  void *data, LOCKMODE lockmode)
+{
+	ScanKeyData scankey[1];
+
+	ScanKeyInit(&scankey[0], Anum_continuous_agg_pkey_idx_mat_hypertable_id,
+				BTEqualStrategyNumber, F_INT4EQ, Int32GetDatum(mat_hypertable_id));
+
+	return continuous_agg_scan(CONTINUOUS_AGG_PKEY_IDX, scankey, 1,
+							   tuple_found, data, lockmode);
+}
+
+static bool
+continuous_agg_tuple_append_mat_id(TupleInfo *ti, void *data)
+{
+	List	  **mat_ids = data;
+
+	*mat_ids = lappend_int(*mat_ids, ((Form_continuous_agg) GETSTRUCT(ti->tuple))->mat_hypertable_id);
+
+	return true;
+}
+
+/*
+ * Get the IDs of the materialization hypertables of the continuous
+ * aggregates on a raw hypertable.
+ */
+List *
+continuous_agg_get_mat_ids(int32 raw_hypertable_id)
+{
+	ScanKeyData scankey[1];
+	List	   *mat_ids = NIL;
+
+	ScanKeyInit(&scankey[0], Anum_continuous_agg_raw_hypertable_id_idx_raw_hypertable_id,
+				BTEqualStrategyNumber, F_INT4EQ, Int32GetDatum(raw_hypertable_id));
+
+	continuous_agg_scan(CONTINUOUS_AGG_RAW_HYPERTABLE_ID_IDX, scankey, 1,
+						continuous_agg_tuple_append_mat_id, &mat_ids, AccessShareLock);
+
+	return mat_ids;
+}
+
+static bool
+continuous_agg_tuple_found(TupleInfo *ti, void *data)
+{
+	ContinuousAgg **cagg = data;
+
+	*cagg = palloc(sizeof(ContinuousAgg));
+	memcpy(&(*cagg)->fd, GETSTRUCT(ti->tuple), sizeof(FormData_continuous_agg));
+
+	return false;
+}
+
+ContinuousAgg *
+continuous_agg_get_by_mat_id(int32 mat_hypertable_id)
+{
+	ContinuousAgg *cagg = NULL;
+
+	continuous_agg_scan_by_mat_id(mat_hypertable_id, continuous_agg_tuple_found,
+								  &cagg, AccessShareLock);
+
+	return cagg;
+}
+
+static ContinuousAgg *
+continuous_agg_get_by_user_view(Oid view_relid)
+{
+	ScanKeyData scankey[2];
+	ContinuousAgg *cagg = NULL;
+	char	   *schema_name = get_namespace_name(get_rel_namespace(view_relid));
+	char	   *view_name = get_rel_name(view_relid);
+
+	if (NULL == schema_name || NULL == view_name)
+		return NULL;
+
+	ScanKeyInit(&scankey[0], Anum_continuous_agg_user_view_name_idx_user_view_schema,
+				BTEqualStrategyNumber, F_NAMEEQ,
+				DirectFunctionCall1(namein, CStringGetDatum(schema_name)));
+	ScanKeyInit(&scankey[1], Anum_continuous_agg_user_view_name_idx_user_view_name,
+				BTEqualStrategyNumber, F_NAMEEQ,
+				DirectFunctionCall1(namein, CStringGetDatum(view_name)));
+
+	continuous_agg_scan(CONTINUOUS_AGG_USER_VIEW_NAME_IDX, scankey, 2,
+						continuous_agg_tuple_found, &cagg, AccessShareLock);
+
+	return cagg;
+}
+
+static void
+continuous_agg_insert(FormData_continuous_agg *fd)
+{
+	Catalog    *catalog = catalog_get();
+	Relation	rel = heap_open(catalog->tables[CONTINUOUS_AGG].id, RowExclusiveLock);
+	Datum		values[Natts_continuous_agg];
+	bool		nulls[Natts_continuous_agg] = {false};
+	CatalogSecurityContext sec_ctx;
+
+	values[Anum_continuous_agg_mat_hypertable_id - 1] = Int32GetDatum(fd->mat_hypertable_id);
+	values[Anum_continuous_agg_raw_hypertable_id - 1] = Int32GetDatum(fd->raw_hypertable_id);
+	values[Anum_continuous_agg_user_view_schema - 1] = NameGetDatum(&fd->user_view_schema);
+	values[Anum_continuous_agg_user_view_name - 1] = NameGetDatum(&fd->user_view_name);
+	values[Anum_continuous_agg_direct_view_schema - 1] = NameGetDatum(&fd->direct_view_schema);
+	values[Anum_continuous_agg_direct_view_name - 1] = NameGetDatum(&fd->direct_view_name);
+	values[Anum_continuous_agg_bucket_column_name - 1] = NameGetDatum(&fd->bucket_column_name);
+	values[Anum_continuous_agg_bucket_width - 1] = Int64GetDatum(fd->bucket_width);
+	values[Anum_continuous_agg_watermark - 1] = Int64GetDatum(fd->watermark);
+
+	catalog_become_owner(catalog, &sec_ctx);
+	catalog_insert_values(rel, RelationGetDescr(rel), values, nulls);
+	catalog_restore_user(&sec_ctx);
+
+	heap_close(rel, RowExclusiveLock);
+}
+
+static bool
+continuous_agg_tuple_update_watermark(TupleInfo *ti, void *data)
+{
+	HeapTuple	tuple = heap_copytuple(ti->tuple);
+	CatalogSecurityContext sec_ctx;
+
+	((Form_continuous_agg) GETSTRUCT(tuple))->watermark = *((int64 *) data);
+
+	catalog_become_owner(catalog_get(), &sec_ctx);
+	catalog_update(ti->scanrel, tuple);
+	catalog_restore_user(&sec_ctx);
+
+	heap_freetuple(tuple);
+
+	return false;
+}
+
+static void
+continuous_agg_update_watermark(ContinuousAgg *cagg, int64 watermark)
+{
+	continuous_agg_scan_by_mat_id(cagg->fd.mat_hypertable_id,
+								  continuous_agg_tuple_update_watermark,
+								  &watermark, RowExclusiveLock);
+	cagg->fd.watermark = watermark;
+}
+
+static bool
+continuous_agg_tuple_delete(TupleInfo *ti, void *data)
+{
+	CatalogSecurityContext sec_ctx;
+
+	catalog_become_owner(catalog_get(), &sec_ctx);
+	catalog_delete(ti->scanrel, ti->tuple);
+	catalog_restore_user(&sec_ctx);
+
+	return true;
+}
+
+static int
+invalidation_log_scan(int32 mat_hypertable_id, tuple_found_func tuple_found,
+					  void *data, LOCKMODE lockmode)
+{
+	Catalog    *catalog = catalog_get();
+	ScanKeyData scankey[1];
+	ScannerCtx	scanctx = {
+		.table = catalog->tables[CONTINUOUS_AGGS_INVALIDATION_LOG].id,
+		.index = catalog->tables[CONTINUOUS_AGGS_INVALIDATION_LOG].index_ids[CONTINUOUS_AGGS_INVALIDATION_LOG_IDX],
+		.scantype = ScannerTypeIndex,
+		.nkeys = 1,
+		.scankey = scankey,
+		.tuple_found = tuple_found,
+		.data = data,
+		.lockmode = lockmode,
+		.scandirection = ForwardScanDirection,
+	};
+
+	ScanKeyInit(&scankey[0], Anum_continuous_aggs_invalidation_log_idx_materialization_id,
+				BTEqualStrategyNumber, F_INT4EQ, Int32GetDatum(mat_hypertable_id));
+
+	return scanner_scan(&scanctx);
+}
+
+static void
+invalidation_log_insert(int32 mat_hypertable_id, int64 lowest, int64 greatest)
+{
+	Catalog    *catalog = catalog_get();
+	Relation	rel = heap_open(catalog->tables[CONTINUOUS_AGGS_INVALIDATION_LOG].id, RowExclusiveLock);
+	Datum		values[Natts_continuous_aggs_invalidation_log];
+	bool		nulls[Natts_continuous_aggs_invalidation_log] = {false};
+	CatalogSecurityContext sec_ctx;
+
+	values[Anum_continuous_aggs_invalidation_log_materialization_id - 1] = Int32GetDatum(mat_hypertable_id);
+	values[Anum_continuous_aggs_invalidation_log_lowest_modified_value - 1] = Int64GetDatum(lowest);
+	values[Anum_continuous_aggs_invalidation_log_greatest_modified_value - 1] = Int64GetDatum(greatest);
+
+	catalog_become_owner(catalog, &sec_ctx);
+	catalog_insert_values(rel, RelationGetDescr(rel), values, nulls);
+	catalog_restore_user(&sec_ctx);
+
+	heap_close(rel, RowExclusiveLock);
+}
+
+static bool
+invalidation_log_tuple_pop(TupleInfo *ti, void *data)
+{
+	List	  **invalidations = data;
+	Form_continuous_aggs_invalidation_log form = (Form_continuous_aggs_invalidation_log) GETSTRUCT(ti->tuple);
+	ContinuousAggInvalidation *inv = palloc(sizeof(ContinuousAggInvalidation));
+
+	inv->lowest = form->lowest_modified_value;
+	inv->greatest = form->greatest_modified_value;
+	*invalidations = lappend(*invalidations, inv);
+
+	return continuous_agg_tuple_delete(ti, NULL);
+}
+
+/*
+ * Remove and return the logged invalidations of a continuous aggregate.
+ */
+static List *
+invalidation_log_pop(int32 mat_hypertable_id)
+{
+	List	   *invalidations = NIL;
+
+	invalidation_log_scan(mat_hypertable_id, invalidation_log_tuple_pop,
+						  &invalidations, RowExclusiveLock);
+
+	return invalidations;
+}
+
+void
+continuous_agg_invalidation_init(ContinuousAggInvalidation *inv)
+{
+	inv->lowest = PG_INT64_MAX;
+	inv->greatest = PG_INT64_MIN;
+}
+
+/*
+ * Add a point written to a hypertable to the invalidated range. The time
+ * dimension is the first open dimension, which comes first in the point.
+ */
+void
+continuous_agg_invalidation_add_point(ContinuousAggInvalidation *inv, Point *point)
+{
+	int64		value = point->coordinates[0];
+
+	if (value < inv->lowest)
+		inv->lowest = value;
+
+	if (value > inv->greatest)
+		inv->greatest = value;
+}
+
+static void
+continuous_agg_invalidation_add_range(ContinuousAggInvalidation *inv, int64 lowest, int64 greatest)
+{
+	inv->lowest = Min(inv->lowest, lowest);
+	inv->greatest = Max(inv->greatest, greatest);
+}
+
+/*
+ * Log the invalidated range for all continuous aggregates on a hypertable.
+ */
+void
+continuous_agg_invalidation_flush(ContinuousAggInvalidation *inv, Hypertable *ht)
+{
+	ListCell   *lc;
+
+	if (inv->lowest > inv->greatest)
+		return;
+
+	foreach(lc, ht->continuous_aggs)
+		invalidation_log_insert(lfirst_int(lc), inv->lowest, inv->greatest);
+
+	continuous_agg_invalidation_init(inv);
+}
+
+/*
+ * Get the hypertable of a chunk, if the hypertable has continuous
+ * aggregates, along with the range of time values of the chunk.
+ */
+static Hypertable *
+chunk_get_cagg_hypertable(Cache *hcache, Oid relid, int64 *range_start, int64 *range_end)
+{
+	Hypertable *ht;
+	Chunk	   *chunk;
+	Dimension  *dim;
+	DimensionSlice *slice;
+
+	if (NULL != hypertable_cache_get_entry(hcache, relid))
+		return NULL;
+
+	chunk = chunk_get_by_relid(relid, 0, false);
+
+	if (NULL == chunk)
+		return NULL;
+
+	ht = hypertable_cache_get_entry(hcache, chunk->hypertable_relid);
+
+	if (NULL == ht || ht->continuous_aggs == NIL)
+		return NULL;
+
+	chunk = chunk_get_by_id(chunk->fd.id, ht->space->num_dimensions, true);
+	dim = hyperspace_get_open_dimension(ht->space, 0);
+	slice = hypercube_get_slice_by_dimension_id(chunk->cube, dim->fd.id);
+
+	*range_start = slice->fd.range_start;
+	*range_end = slice->fd.range_end;
+
+	return ht;
+}
+
+/*
+ * Invalidate the range of time values of a chunk before rows are written to
+ * it directly, e.g., via COPY, rather than via its hypertable.
+ */
+void
+continuous_agg_invalidate_by_relid(Oid relid)
+{
+	Cache	   *hcache = hypertable_cache_pin();
+	ContinuousAggInvalidation inv;
+	Hypertable *ht;
+	int64		range_start,
+				range_end;
+
+	ht = chunk_get_cagg_hypertable(hcache, relid, &range_start, &range_end);
+
+	if (NULL != ht)
+	{
+		continuous_agg_invalidation_init(&inv);
+		continuous_agg_invalidation_add_range(&inv, range_start, range_end - 1);
+		continuous_agg_invalidation_flush(&inv, ht);
+	}
+
+	cache_release(hcache);
+}
+
+typedef struct HypertableInvalidation
+{
+	Hypertable *ht;
+	ContinuousAggInvalidation inv;
+} HypertableInvalidation;
+
+/*
+ * Invalidate the ranges of time values that a statement might modify
+ * without going through the hypertable's insert path, which tracks the
+ * exact range of inserted values. UPDATEs and DELETEs, as well as INSERTs
+ * into chunks, invalidate the whole range of their chunks. The ranges of the
+ * chunks of a hypertable are merged, so that the statement logs one range
+ * per continuous aggregate.
+ */
+void
+continuous_agg_invalidate_for_statement(PlannedStmt *stmt)
+{
+	Cache	   *hcache;
+	List	   *invalidations = NIL;
+	ListCell   *lc;
+
+	if (stmt->commandType != CMD_INSERT &&
+		stmt->commandType != CMD_UPDATE &&
+		stmt->commandType != CMD_DELETE)
+		return;
+
+	hcache = hypertable_cache_pin();
+
+	foreach(lc, stmt->resultRelations)
+	{
+		RangeTblEntry *rte = rt_fetch(lfirst_int(lc), stmt->rtable);
+		HypertableInvalidation *hi = NULL;
+		Hypertable *ht;
+		int64		range_start,
+					range_end;
+		ListCell   *lc_inv;
+
+		ht = chunk_get_cagg_hypertable(hcache, rte->relid, &range_start, &range_end);
+
+		if (NULL == ht)
+			continue;
+
+		foreach(lc_inv, invalidations)
+		{
+			if (((HypertableInvalidation *) lfirst(lc_inv))->ht == ht)
+			{
+				hi = lfirst(lc_inv);
+				break;
+			}
+		}
+
+		if (NULL == hi)
+		{
+			hi = palloc(sizeof(HypertableInvalidation));
+			hi->ht = ht;
+			continuous_agg_invalidation_init(&hi->inv);
+			invalidations = lappend(invalidations, hi);
+		}
+
+		continuous_agg_invalidation_add_range(&hi->inv, range_start, range_end - 1);
+	}
+
+	foreach(lc, invalidations)
+	{
+		HypertableInvalidation *hi = lfirst(lc);
+
+		continuous_agg_invalidation_flush(&hi->inv, hi->ht);
+	}
+
+	cache_release(hcache);
+}
+
+/*
+ * Drop a continuous aggregate when its view is dropped. Drops the view, the
+ * direct view and the materialization hypertable and returns true if the
+ * view is a continuous aggregate.
+ */
+bool
+continuous_agg_drop_view(Oid relid, DropBehavior behavior)
+{
+	ContinuousAgg *cagg = continuous_agg_get_by_user_view(relid);
+	ObjectAddress addr;
+	Oid			raw_relid;
+	Oid			mat_relid;
+	Oid			direct_relid;
+
+	if (NULL == cagg)
+		return false;
+
+	if (!pg_class_ownercheck(relid, GetUserId()))
+		aclcheck_error(ACLCHECK_NOT_OWNER, ACL_KIND_CLASS, get_rel_name(relid));
+
+	raw_relid = hypertable_id_to_relid(cagg->fd.raw_hypertable_id);
+	mat_relid = hypertable_id_to_relid(cagg->fd.mat_hypertable_id);
+	direct_relid = get_relname_relid(NameStr(cagg->fd.direct_view_name),
+									 get_namespace_oid(NameStr(cagg->fd.direct_view_schema), false));
+
+	/* Foreign key cascades do not fire for catalog changes made here */
+	invalidation_log_scan(cagg->fd.mat_hypertable_id, continuous_agg_tuple_delete,
+						  NULL, RowExclusiveLock);
+	continuous_agg_scan_by_mat_id(cagg->fd.mat_hypertable_id, continuous_agg_tuple_delete,
+								  NULL, RowExclusiveLock);
+
+	ObjectAddressSet(addr, RelationRelationId, relid);
+	performDeletion(&addr, behavior, 0);
+
+	if (OidIsValid(direct_relid))
+	{
+		ObjectAddressSet(addr, RelationRelationId, direct_relid);
+		performDeletion(&addr, DROP_RESTRICT, 0);
+	}
+
+	if (OidIsValid(mat_relid))
+	{
+		/* Drop the materialization like any other hypertable */
+		if (SPI_connect() != SPI_OK_CONNECT)
+			elog(ERROR, "Could not connect to SPI");
+
+		if (SPI_execute(psprintf("DROP TABLE %s",
+								 quote_qualified_identifier(get_namespace_name(get_rel_namespace(mat_relid)),
+															get_rel_name(mat_relid))),
+						false, 0) != SPI_OK_UTILITY)
+			elog(ERROR, "could not drop table \"%s\"", get_rel_name(mat_relid));
+
+		SPI_finish();
+	}
+
+	catalog_invalidate_hypertable(raw_relid);
+
+	return true;
+}
+
+static bool
+continuous_agg_tuple_rename_view(TupleInfo *ti, void *data)
+{
+	HeapTuple	tuple = heap_copytuple(ti->tuple);
+	CatalogSecurityContext sec_ctx;
+
+	namestrcpy(&((Form_continuous_agg) GETSTRUCT(tuple))->user_view_name, data);
+
+	catalog_become_owner(catalog_get(), &sec_ctx);
+	catalog_update(ti->scanrel, tuple);
+	catalog_restore_user(&sec_ctx);
+
+	heap_freetuple(tuple);
+
+	return false;
+}
+
+/*
+ * Update a continuous aggregate after its view was renamed.
+ */
+void
+continuous_agg_rename_view(Oid relid, const char *new_name)
+{
+	ContinuousAgg *cagg = continuous_agg_get_by_user_view(relid);
+
+	if (NULL != cagg)
+		continuous_agg_scan_by_mat_id(cagg->fd.mat_hypertable_id,
+									  continuous_agg_tuple_rename_view,
+									  (void *) new_name, RowExclusiveLock);
+}
+
+static void
+continuous_agg_view_unsupported(Oid view_relid, const char *detail)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("View \"%s\" cannot be a continuous aggregate", get_rel_name(view_relid)),
+			 errdetail("%s", detail)));
+}
+
+/*
+ * Check whether an expression is time_bucket() on the given column.
+ */
+static bool
+is_time_bucket_on_column(Node *expr, Index varno, AttrNumber attno)
+{
+	FuncExpr   *func = (FuncExpr *) expr;
+	Node	   *width;
+	Var		   *var;
+	char	   *func_name;
+
+	if (!IsA(expr, FuncExpr) || list_length(func->args) != 2)
+		return false;
+
+	func_name = get_func_name(func->funcid);
+
+	if (NULL == func_name || strncmp(func_name, "time_bucket", NAMEDATALEN) != 0)
+		return false;
+
+	width = linitial(func->args);
+	var = lsecond(func->args);
+
+	return IsA(width, Const) && IsA(var, Var) && var->varno == varno &&
+		var->varlevelsup == 0 && var->varattno == attno;
+}
+
+/*
+ * Get the bucket width of a time_bucket() call in the internal time
+ * representation.
+ */
+static int64
+time_bucket_get_width(Oid view_relid, FuncExpr *bucket)
+{
+	Const	   *width = linitial(bucket->args);
+	int64		value;
+
+	if (width->constisnull)
+		continuous_agg_view_unsupported(view_relid, "The time bucket width cannot be NULL.");
+
+	switch (width->consttype)
+	{
+		case INT2OID:
+			value = DatumGetInt16(width->constvalue);
+			break;
+		case INT4OID:
+			value = DatumGetInt32(width->constvalue);
+			break;
+		case INT8OID:
+			value = DatumGetInt64(width->constvalue);
+			break;
+		case INTERVALOID:
+			value = get_interval_period(DatumGetIntervalP(width->constvalue));
+#ifndef HAVE_INT64_TIMESTAMP
+			/* Internal time values are in microseconds */
+			value *= USECS_PER_SEC;
+#endif
+			break;
+		default:
+			continuous_agg_view_unsupported(view_relid, "Unsupported time bucket width type.");
+			return 0;
+	}
+
+	if (value <= 0)
+		continuous_agg_view_unsupported(view_relid, "The time bucket width must be positive.");
+
+	return value;
+}
+
+/*
+ * Validate the query of a continuous aggregate view and get its raw
+ * hypertable, the target entry of its time bucket and the bucket width.
+ *
+ * The query must aggregate a single hypertable, grouped by time_bucket() on
+ * the hypertable's time column and possibly other columns. Since buckets
+ * are recomputed independently of each other, anything that relates rows
+ * across buckets or depends on anything but the rows of a bucket is not
+ * supported.
+ */
+static Hypertable *
+continuous_agg_validate_query(Oid view_relid, Query *query, Cache *hcache,
+							  TargetEntry **bucket_tle, int64 *bucket_width)
+{
+	RangeTblRef *rtr;
+	RangeTblEntry *rte;
+	Hypertable *ht;
+	Dimension  *time_dim;
+	ListCell   *lc;
+
+	if (query->commandType != CMD_SELECT || query->utilityStmt != NULL)
+		continuous_agg_view_unsupported(view_relid, "The view must be a SELECT.");
+
+	if (query->setOperations != NULL || query->cteList != NIL || query->hasSubLinks ||
+		query->hasWindowFuncs || query->groupingSets != NIL ||
+		query->distinctClause != NIL || query->sortClause != NIL ||
+		query->limitCount != NULL || query->limitOffset != NULL || query->rowMarks != NIL)
+		continuous_agg_view_unsupported(view_relid,
+										"Set operations, CTEs, subqueries, window functions, "
+										"grouping sets, DISTINCT, ORDER BY, LIMIT and row "
+										"locking are not supported.");
+
+	if (contain_mutable_functions((Node *) query))
+		continuous_agg_view_unsupported(view_relid, "Only immutable functions are supported.");
+
+	if (list_length(query->jointree->fromlist) != 1 ||
+		!IsA(linitial(query->jointree->fromlist), RangeTblRef))
+		continuous_agg_view_unsupported(view_relid, "The view must select from a single hypertable.");
+
+	rtr = linitial(query->jointree->fromlist);
+	rte = rt_fetch(rtr->rtindex, query->rtable);
+
+	if (rte->rtekind != RTE_RELATION || !rte->inh)
+		continuous_agg_view_unsupported(view_relid, "The view must select from a single hypertable.");
+
+	ht = hypertable_cache_get_entry(hcache, rte->relid);
+
+	if (NULL == ht)
+		continuous_agg_view_unsupported(view_relid, "The view must select from a single hypertable.");
+
+	if (NULL != continuous_agg_get_by_mat_id(ht->fd.id))
+		continuous_agg_view_unsupported(view_relid, "The hypertable is the materialization of a continuous aggregate.");
+
+	time_dim = hyperspace_get_open_dimension(ht->space, 0);
+	*bucket_tle = NULL;
+
+	foreach(lc, query->groupClause)
+	{
+		SortGroupClause *sgc = lfirst(lc);
+		TargetEntry *tle = get_sortgroupclause_tle(sgc, query->targetList);
+
+		if (!is_time_bucket_on_column((Node *) tle->expr, rtr->rtindex, time_dim->column_attno))
+			continue;
+
+		if (NULL != *bucket_tle)
+			continuous_agg_view_unsupported(view_relid, "The view must group by a single time bucket.");
+
+		*bucket_tle = tle;
+	}
+
+	if (NULL == *bucket_tle)
+		continuous_agg_view_unsupported(view_relid,
+										"The view must group by time_bucket() on the time column of the hypertable.");
+
+	if ((*bucket_tle)->resjunk)
+		continuous_agg_view_unsupported(view_relid, "The time bucket must be in the select list of the view.");
+
+	*bucket_width = time_bucket_get_width(view_relid, (FuncExpr *) (*bucket_tle)->expr);
+
+	return ht;
+}
+
+static void
+continuous_agg_spi_execute(const char *command, int expected)
+{
+	if (SPI_execute(command, false, 0) != expected)
+		elog(ERROR, "could not execute \"%s\"", command);
+}
+
+/*
+ * Turn a view into a continuous aggregate.
+ */
+Datum
+create_continuous_aggregate(PG_FUNCTION_ARGS)
+{
+	Oid			view_relid = PG_GETARG_OID(0);
+	const char *ext_schema = get_namespace_name(get_func_namespace(fcinfo->flinfo->fn_oid));
+	Relation	view_rel;
+	Query	   *query;
+	Cache	   *hcache;
+	Hypertable *raw_ht;
+	Dimension  *time_dim;
+	TargetEntry *bucket_tle;
+	int64		bucket_width;
+	int32		raw_hypertable_id;
+	int32		mat_hypertable_id;
+	int64		chunk_time_interval;
+	Oid			raw_relid;
+	Oid			owner;
+	Oid			mat_relid;
+	char	   *view_schema;
+	char	   *view_name;
+	char	   *view_def;
+	const char *time_type;
+	const char *bucket_column;
+	char		mat_name[NAMEDATALEN];
+	char		direct_name[NAMEDATALEN];
+	const char *qualified_mat;
+	const char *qualified_direct;
+	FormData_continuous_agg fd;
+	CatalogSecurityContext sec_ctx;
+
+	if (get_rel_relkind(view_relid) != RELKIND_VIEW)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("\"%s\" is not a view", get_rel_name(view_relid))));
+
+	if (!pg_class_ownercheck(view_relid, GetUserId()))
+		aclcheck_error(ACLCHECK_NOT_OWNER, ACL_KIND_CLASS, get_rel_name(view_relid));
+
+	if (NULL != continuous_agg_get_by_user_view(view_relid))
+		ereport(ERROR,
+				(errcode(ERRCODE_DUPLICATE_OBJECT),
+				 errmsg("View \"%s\" is already a continuous aggregate", get_rel_name(view_relid))));
+
+	view_rel = relation_open(view_relid, AccessExclusiveLock);
+	query = copyObject(get_view_query(view_rel));
+	owner = view_rel->rd_rel->relowner;
+	relation_close(view_rel, NoLock);
+
+	hcache = hypertable_cache_pin();
+	raw_ht = continuous_agg_validate_query(view_relid, query, hcache, &bucket_tle, &bucket_width);
+	hypertable_permissions_check(raw_ht->main_table_relid, GetUserId());
+	time_dim = hyperspace_get_open_dimension(raw_ht->space, 0);
+	time_type = format_type_be(time_dim->fd.column_type);
+	chunk_time_interval = time_dim->fd.interval_length;
+	raw_hypertable_id = raw_ht->fd.id;
+	raw_relid = raw_ht->main_table_relid;
+	bucket_column = quote_identifier(bucket_tle->resname);
+	cache_release(hcache);
+
+	view_schema = get_namespace_name(get_rel_namespace(view_relid));
+	view_name = get_rel_name(view_relid);
+	view_def = TextDatumGetCString(DirectFunctionCall1(pg_get_viewdef, ObjectIdGetDatum(view_relid)));
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "Could not connect to SPI");
+
+	/*
+	 * Create the materialization table in the internal schema, which
+	 * requires the catalog owner, and hand it over to the view's owner.
+	 */
+	snprintf(mat_name, NAMEDATALEN, "_materialized_%u", view_relid);
+	qualified_mat = quote_qualified_identifier(INTERNAL_SCHEMA_NAME, mat_name);
+
+	catalog_become_owner(catalog_get(), &sec_ctx);
+	continuous_agg_spi_execute(psprintf("CREATE TABLE %s AS SELECT * FROM %s WITH NO DATA",
+										qualified_mat,
+										quote_qualified_identifier(view_schema, view_name)),
+							   SPI_OK_UTILITY);
+	catalog_restore_user(&sec_ctx);
+
+	mat_relid = get_relname_relid(mat_name, get_namespace_oid(INTERNAL_SCHEMA_NAME, false));
+	ATExecChangeOwner(mat_relid, owner, false, AccessExclusiveLock);
+	CommandCounterIncrement();
+
+	continuous_agg_spi_execute(psprintf("ALTER TABLE %s ALTER COLUMN %s SET NOT NULL",
+										qualified_mat, bucket_column),
+							   SPI_OK_UTILITY);
+	continuous_agg_spi_execute(psprintf("SELECT %s.create_hypertable(%s, %s, chunk_time_interval => "
+										INT64_FORMAT "::bigint)",
+										quote_identifier(ext_schema), quote_literal_cstr(qualified_mat),
+										quote_literal_cstr(bucket_tle->resname), chunk_time_interval),
+							   SPI_OK_SELECT);
+
+	hcache = hypertable_cache_pin();
+	mat_hypertable_id = hypertable_cache_get_entry(hcache, mat_relid)->fd.id;
+	cache_release(hcache);
+
+	/* Name the materialization and the direct view after the hypertable */
+	snprintf(mat_name, NAMEDATALEN, MATERIALIZATION_TABLE_PREFIX "%d", mat_hypertable_id);
+	snprintf(direct_name, NAMEDATALEN, DIRECT_VIEW_PREFIX "%d", mat_hypertable_id);
+	continuous_agg_spi_execute(psprintf("ALTER TABLE %s RENAME TO %s",
+										qualified_mat, quote_identifier(mat_name)),
+							   SPI_OK_UTILITY);
+	qualified_mat = quote_qualified_identifier(INTERNAL_SCHEMA_NAME, mat_name);
+	qualified_direct = quote_qualified_identifier(INTERNAL_SCHEMA_NAME, direct_name);
+
+	catalog_become_owner(catalog_get(), &sec_ctx);
+	continuous_agg_spi_execute(psprintf("CREATE VIEW %s AS %s", qualified_direct, view_def),
+							   SPI_OK_UTILITY);
+	catalog_restore_user(&sec_ctx);
+
+	ATExecChangeOwner(get_relname_relid(direct_name, get_namespace_oid(INTERNAL_SCHEMA_NAME, false)),
+					  owner, false, AccessExclusiveLock);
+	CommandCounterIncrement();
+
+	/*
+	 * Replace the view with the union of the materialization and the direct
+	 * view. The view keeps its columns, so objects that depend on it and its
+	 * privileges are kept as well.
+	 */
+	continuous_agg_spi_execute(psprintf("CREATE OR REPLACE VIEW %s AS "
+										"SELECT * FROM %s WHERE %s < %s.cagg_watermark(%d, NULL::%s) "
+										"UNION ALL "
+										"SELECT * FROM %s WHERE %s >= %s.cagg_watermark(%d, NULL::%s)",
+										quote_qualified_identifier(view_schema, view_name),
+										qualified_mat, bucket_column, INTERNAL_SCHEMA_NAME,
+										mat_hypertable_id, time_type,
+										qualified_direct, bucket_column, INTERNAL_SCHEMA_NAME,
+										mat_hypertable_id, time_type),
+							   SPI_OK_UTILITY);
+
+	SPI_finish();
+
+	memset(&fd, 0, sizeof(fd));
+	fd.mat_hypertable_id = mat_hypertable_id;
+	fd.raw_hypertable_id = raw_hypertable_id;
+	namestrcpy(&fd.user_view_schema, view_schema);
+	namestrcpy(&fd.user_view_name, view_name);
+	namestrcpy(&fd.direct_view_schema, INTERNAL_SCHEMA_NAME);
+	namestrcpy(&fd.direct_view_name, direct_name);
+	namestrcpy(&fd.bucket_column_name, bucket_tle->resname);
+	fd.bucket_width = bucket_width;
+	fd.watermark = PG_INT64_MIN;
+	continuous_agg_insert(&fd);
+
+	/* Writes to the raw hypertable need to log invalidations */
+	catalog_invalidate_hypertable(raw_relid);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Get the bucket of a time value, both in the internal time representation.
+ * Integer buckets are computed like the SQL time_bucket() functions and
+ * other buckets by calling the C functions.
+ */
+static int64
+continuous_agg_bucket(ContinuousAgg *cagg, Oid type, int64 value)
+{
+	Interval	interval = {0};
+	Datum		time_value = internal_to_time_value(value, type);
+	Datum		bucket;
+
+#ifdef HAVE_INT64_TIMESTAMP
+	interval.time = cagg->fd.bucket_width;
+#else
+	interval.time = (double) cagg->fd.bucket_width / USECS_PER_SEC;
+#endif
+
+	switch (type)
+	{
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+			return (value / cagg->fd.bucket_width) * cagg->fd.bucket_width;
+		case TIMESTAMPOID:
+			bucket = DirectFunctionCall2(timestamp_bucket, IntervalPGetDatum(&interval), time_value);
+			break;
+		case TIMESTAMPTZOID:
+			bucket = DirectFunctionCall2(timestamptz_bucket, IntervalPGetDatum(&interval), time_value);
+			break;
+		case DATEOID:
+			bucket = DirectFunctionCall2(date_bucket, IntervalPGetDatum(&interval), time_value);
+			break;
+		default:
+			elog(ERROR, "unsupported time type \"%s\"", format_type_be(type));
+			return 0;
+	}
+
+	return time_value_to_internal(bucket, type);
+}
+
+/* A range of buckets to materialize, [start, end) */
+typedef struct RefreshRange
+{
+	int64		start;
+	int64		end;
+} RefreshRange;
+
+static int
+refresh_range_cmp(const void *left, const void *right)
+{
+	const RefreshRange *l = left;
+	const RefreshRange *r = right;
+
+	if (l->start < r->start)
+		return -1;
+	if (l->start > r->start)
+		return 1;
+	return 0;
+}
+
+/*
+ * Get the sorted, non-overlapping ranges of materialized buckets that
+ * contain invalidated time values. Only buckets below the watermark are
+ * materialized. Returns the number of ranges.
+ */
+static int
+continuous_agg_get_refresh_ranges(ContinuousAgg *cagg, Oid type, List *invalidations,
+								  RefreshRange **ranges)
+{
+	int64		watermark = cagg->fd.watermark;
+	int64		width = cagg->fd.bucket_width;
+	int			num_ranges = 0;
+	int			num_merged = 0;
+	ListCell   *lc;
+	int			i;
+
+	*ranges = palloc(sizeof(RefreshRange) * Max(list_length(invalidations), 1));
+
+	foreach(lc, invalidations)
+	{
+		ContinuousAggInvalidation *inv = lfirst(lc);
+		int64		start = continuous_agg_bucket(cagg, type, inv->lowest);
+		int64		end;
+
+		if (start >= watermark)
+			continue;
+
+		end = continuous_agg_bucket(cagg, type, inv->greatest);
+
+		/* The end is exclusive, so it is the bucket after the last one */
+		if (end >= watermark || (uint64) watermark - (uint64) end <= (uint64) width)
+			end = watermark;
+		else
+			end += width;
+
+		(*ranges)[num_ranges].start = start;
+		(*ranges)[num_ranges].end = end;
+		num_ranges++;
+	}
+
+	if (num_ranges <= 1)
+		return num_ranges;
+
+	qsort(*ranges, num_ranges, sizeof(RefreshRange), refresh_range_cmp);
+
+	/* Merge overlapping and adjacent ranges */
+	for (i = 1; i < num_ranges; i++)
+	{
+		if ((*ranges)[i].start <= (*ranges)[num_merged].end)
+			(*ranges)[num_merged].end = Max((*ranges)[num_merged].end, (*ranges)[i].end);
+		else
+			(*ranges)[++num_merged] = (*ranges)[i];
+	}
+
+	return num_merged + 1;
+}
+
+/*
+ * Replace the materialized rows of a range of buckets with the rows of the
+ * direct view. The range has no lower bound if has_start is false.
+ */
+static void
+continuous_agg_materialize(ContinuousAgg *cagg, Oid type, const char *qualified_mat,
+						   const char *qualified_direct, bool has_start, int64 start, int64 end)
+{
+	const char *bucket_column = quote_identifier(NameStr(cagg->fd.bucket_column_name));
+	Oid			argtypes[2] = {type, type};
+	Datum		values[2];
+	char	   *where;
+
+	if (has_start)
+	{
+		where = psprintf("%s >= $1 AND %s < $2", bucket_column, bucket_column);
+		values[0] = internal_to_time_value(start, type);
+		values[1] = internal_to_time_value(end, type);
+	}
+	else
+	{
+		where = psprintf("%s < $1", bucket_column);
+		values[0] = internal_to_time_value(end, type);
+	}
+
+	if (SPI_execute_with_args(psprintf("DELETE FROM %s WHERE %s", qualified_mat, where),
+							  has_start ? 2 : 1, argtypes, values, NULL, false, 0) != SPI_OK_DELETE)
+		elog(ERROR, "could not delete from \"%s\"", qualified_mat);
+
+	if (SPI_execute_with_args(psprintf("INSERT INTO %s SELECT * FROM %s WHERE %s",
+									   qualified_mat, qualified_direct, where),
+							  has_start ? 2 : 1, argtypes, values, NULL, false, 0) != SPI_OK_INSERT)
+		elog(ERROR, "could not insert into \"%s\"", qualified_mat);
+}
+
+/*
+ * Get the new watermark of a continuous aggregate, which is the bucket of
+ * the greatest time value of the raw hypertable. That bucket might still
+ * get new rows, so it is not materialized.
+ */
+static int64
+continuous_agg_get_new_watermark(ContinuousAgg *cagg, Hypertable *raw_ht, Dimension *time_dim)
+{
+	Datum		max_time;
+	bool		isnull;
+
+	continuous_agg_spi_execute(psprintf("SELECT max(%s) FROM %s",
+										quote_identifier(NameStr(time_dim->fd.column_name)),
+										quote_qualified_identifier(NameStr(raw_ht->fd.schema_name),
+																   NameStr(raw_ht->fd.table_name))),
+							   SPI_OK_SELECT);
+
+	max_time = SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 1, &isnull);
+
+	if (isnull)
+		return cagg->fd.watermark;
+
+	return continuous_agg_bucket(cagg, time_dim->fd.column_type,
+								 time_value_to_internal(max_time, time_dim->fd.column_type));
+}
+
+/*
+ * Refresh a continuous aggregate: recompute the materialized buckets that
+ * were invalidated since the last refresh and materialize the buckets
+ * between the watermark and the bucket of the greatest time value of the
+ * raw hypertable.
+ */
+Datum
+refresh_continuous_aggregate(PG_FUNCTION_ARGS)
+{
+	Oid			view_relid = PG_GETARG_OID(0);
+	ContinuousAgg *cagg = continuous_agg_get_by_user_view(view_relid);
+	Cache	   *hcache;
+	Hypertable *raw_ht;
+	Dimension  *time_dim;
+	Oid			mat_relid;
+	Oid			type;
+	const char *qualified_mat;
+	const char *qualified_direct;
+	List	   *invalidations;
+	RefreshRange *ranges;
+	int			num_ranges;
+	int64		watermark;
+	int			i;
+
+	if (NULL == cagg)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("\"%s\" is not a continuous aggregate", get_rel_name(view_relid))));
+
+	/*
+	 * Logged invalidations are consumed under a newer snapshot than the one
+	 * of a transaction snapshot, so their writes might not be visible to it.
+	 */
+	if (IsolationUsesXactSnapshot())
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("Cannot refresh a continuous aggregate in a REPEATABLE READ or SERIALIZABLE transaction")));
+
+	mat_relid = hypertable_id_to_relid(cagg->fd.mat_hypertable_id);
+	hypertable_permissions_check(mat_relid, GetUserId());
+
+	/* Serialize refreshes and re-read the watermark of the last one */
+	LockRelationOid(mat_relid, ExclusiveLock);
+	cagg = continuous_agg_get_by_mat_id(cagg->fd.mat_hypertable_id);
+
+	hcache = hypertable_cache_pin();
+	raw_ht = hypertable_cache_get_entry_by_id(hcache, cagg->fd.raw_hypertable_id);
+	time_dim = hyperspace_get_open_dimension(raw_ht->space, 0);
+	type = time_dim->fd.column_type;
+	qualified_mat = quote_qualified_identifier(get_namespace_name(get_rel_namespace(mat_relid)),
+											   get_rel_name(mat_relid));
+	qualified_direct = quote_qualified_identifier(NameStr(cagg->fd.direct_view_schema),
+												  NameStr(cagg->fd.direct_view_name));
+
+	/*
+	 * Consume the invalidations before reading any data, so that the rows
+	 * written by the logging transactions are visible to the refresh.
+	 */
+	invalidations = invalidation_log_pop(cagg->fd.mat_hypertable_id);
+	num_ranges = continuous_agg_get_refresh_ranges(cagg, type, invalidations, &ranges);
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "Could not connect to SPI");
+
+	for (i = 0; i < num_ranges; i++)
+		continuous_agg_materialize(cagg, type, qualified_mat, qualified_direct,
+								   true, ranges[i].start, ranges[i].end);
+
+	watermark = continuous_agg_get_new_watermark(cagg, raw_ht, time_dim);
+
+	if (watermark > cagg->fd.watermark)
+	{
+		continuous_agg_materialize(cagg, type, qualified_mat, qualified_direct,
+								   cagg->fd.watermark != PG_INT64_MIN,
+								   cagg->fd.watermark, watermark);
+		continuous_agg_update_watermark(cagg, watermark);
+	}
+
+	SPI_finish();
+
+	cache_release(hcache);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Read the watermark of a continuous aggregate under the snapshot of the
+ * calling query, so that it is consistent with the materialized rows the
+ * query reads.
+ */
+static int64
+continuous_agg_read_watermark(int32 mat_hypertable_id)
+{
+	Oid			argtypes[1] = {INT4OID};
+	Datum		values[1] = {Int32GetDatum(mat_hypertable_id)};
+	int64		watermark = PG_INT64_MIN;
+	bool		isnull;
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "Could not connect to SPI");
+
+	if (SPI_execute_with_args("SELECT watermark FROM " CATALOG_SCHEMA_NAME "." CONTINUOUS_AGG_TABLE_NAME
+							  " WHERE mat_hypertable_id = $1",
+							  1, argtypes, values, NULL, true, 1) != SPI_OK_SELECT)
+		elog(ERROR, "could not read the watermark of continuous aggregate %d", mat_hypertable_id);
+
+	if (SPI_processed > 0)
+	{
+		Datum		value = SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 1, &isnull);
+
+		if (!isnull)
+			watermark = DatumGetInt64(value);
+	}
+
+	SPI_finish();
+
+	return watermark;
+}
+
+/*
+ * Get the watermark of a continuous aggregate as a value of the time type of
+ * the second argument. Before the first refresh, the watermark is the
+ * minimum value of the type, so that all buckets are read from the direct
+ * view. The watermark is read once per call site of a query.
+ */
+Datum
+continuous_agg_watermark(PG_FUNCTION_ARGS)
+{
+	Oid			type = get_fn_expr_argtype(fcinfo->flinfo, 1);
+	int64	   *watermark = fcinfo->flinfo->fn_extra;
+	Timestamp	timestamp;
+	DateADT		date;
+
+	if (PG_ARGISNULL(0))
+		PG_RETURN_NULL();
+
+	if (NULL == watermark)
+	{
+		watermark = MemoryContextAlloc(fcinfo->flinfo->fn_mcxt, sizeof(int64));
+		*watermark = continuous_agg_read_watermark(PG_GETARG_INT32(0));
+		fcinfo->flinfo->fn_extra = watermark;
+	}
+
+	if (*watermark != PG_INT64_MIN)
+		PG_RETURN_DATUM(internal_to_time_value(*watermark, type));
+
+	switch (type)
+	{
+		case INT2OID:
+			PG_RETURN_INT16(PG_INT16_MIN);
+		case INT4OID:
+			PG_RETURN_INT32(PG_INT32_MIN);
+		case INT8OID:
+			PG_RETURN_INT64(PG_INT64_MIN);
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			TIMESTAMP_NOBEGIN(timestamp);
+			PG_RETURN_TIMESTAMP(timestamp);
+		case DATEOID:
+			DATE_NOBEGIN(date);
+			PG_RETURN_DATEADT(date);
+		default:
+			elog(ERROR, "unsupported time type \"%s\"", format_type_be(type));
+			PG_RETURN_NULL();
+	}
+}
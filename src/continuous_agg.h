@@ -0,0 +1,41 @@
+#ifndef TIMESCALEDB_CONTINUOUS_AGG_H
+#define TIMESCALEDB_CONTINUOUS_AGG_H
+
+#include <postgres.h>
+#include <nodes/parsenodes.h>
+#include <nodes/pg_list.h>
+#include <nodes/plannodes.h>
+
+#include "catalog.h"
+
+typedef struct Hypertable Hypertable;
+typedef struct Point Point;
+
+typedef struct ContinuousAgg
+{
+	FormData_continuous_agg fd;
+} ContinuousAgg;
+
+/*
+ * The range of time values written to a hypertable by a statement, in the
+ * internal time representation. An empty range has lowest > greatest.
+ */
+typedef struct ContinuousAggInvalidation
+{
+	int64		lowest;
+	int64		greatest;
+} ContinuousAggInvalidation;
+
+extern List *continuous_agg_get_mat_ids(int32 raw_hypertable_id);
+extern ContinuousAgg *continuous_agg_get_by_mat_id(int32 mat_hypertable_id);
+
+extern void continuous_agg_invalidation_init(ContinuousAggInvalidation *inv);
+extern void continuous_agg_invalidation_add_point(ContinuousAggInvalidation *inv, Point *point);
+extern void continuous_agg_invalidation_flush(ContinuousAggInvalidation *inv, Hypertable *ht);
+extern void continuous_agg_invalidate_by_relid(Oid relid);
+extern void continuous_agg_invalidate_for_statement(PlannedStmt *stmt);
+
+extern bool continuous_agg_drop_view(Oid relid, DropBehavior behavior);
+extern void continuous_agg_rename_view(Oid relid, const char *new_name);
+
+#endif   /* TIMESCALEDB_CONTINUOUS_AGG_H */
@@ -15,6 +15,9 @@
 #include <executor/executor.h>
 #include <miscadmin.h>
 #include <nodes/makefuncs.h>
+#include <optimizer/clauses.h>
+#include <optimizer/planner.h>
+#include <rewrite/rewriteHandler.h>
 #include <storage/bufmgr.h>
 #include <utils/builtins.h>
 #include <utils/guc.h>
@@ -40,23 +43,291 @@
  *
  */
 
+/*
+ * Limits on the number of tuples and bytes buffered for a single chunk before
+ * they are flushed with heap_multi_insert(). These are the same limits as
+ * those used by PostgreSQL's own COPY.
+ */
+#define MAX_BUFFERED_TUPLES 1000
+#define MAX_BUFFERED_BYTES 65535
+
+/*
+ * A buffer of tuples destined for a single chunk.
+ *
+ * Each buffer has its own BulkInsertState so that a COPY that interleaves
+ * tuples for different chunks (e.g., across space partitions) keeps the
+ * current target page of each chunk pinned.
+ */
+typedef struct CopyMultiInsertBuffer
+{
+	ChunkInsertState *cis;
+	BulkInsertState bistate;
+	TupleTableSlot *slot;		/* slot used to insert index tuples */
+	MemoryContext mctx;			/* memory context for buffered tuples */
+	int			ntuples;
+	Size		nbytes;
+	HeapTuple	tuples[MAX_BUFFERED_TUPLES];
+} CopyMultiInsertBuffer;
+
 typedef struct CopyChunkState
 {
 	EState	   *estate;
 	ChunkDispatch *dispatch;
 	CopyState	cstate;
+	MemoryContext mcxt;
+	CommandId	mycid;
+	int			hi_options;
+
+	/*
+	 * Whether tuples can be buffered and inserted with heap_multi_insert().
+	 * Chunks with BEFORE ROW triggers are always inserted one tuple at a
+	 * time, irrespective of this setting.
+	 */
+	bool		use_multi_insert;
+	List	   *buffers;
+	CopyMultiInsertBuffer *last_buffer;
 } CopyChunkState;
 
+static CopyMultiInsertBuffer *
+copy_multi_insert_buffer_find(CopyChunkState *ccstate, ChunkInsertState *cis)
+{
+	ListCell   *lc;
+
+	if (NULL != ccstate->last_buffer && ccstate->last_buffer->cis == cis)
+		return ccstate->last_buffer;
+
+	foreach(lc, ccstate->buffers)
+	{
+		CopyMultiInsertBuffer *buffer = lfirst(lc);
+
+		if (buffer->cis == cis)
+		{
+			ccstate->last_buffer = buffer;
+			return buffer;
+		}
+	}
+
+	return NULL;
+}
+
+static CopyMultiInsertBuffer *
+copy_multi_insert_buffer_get(CopyChunkState *ccstate, ChunkInsertState *cis)
+{
+	CopyMultiInsertBuffer *buffer = copy_multi_insert_buffer_find(ccstate, cis);
+	MemoryContext old;
+
+	if (NULL != buffer)
+		return buffer;
+
+	old = MemoryContextSwitchTo(ccstate->mcxt);
+
+	buffer = palloc0(sizeof(CopyMultiInsertBuffer));
+	buffer->cis = cis;
+	buffer->bistate = GetBulkInsertState();
+	buffer->slot = MakeTupleTableSlot();
+	ExecSetSlotDescriptor(buffer->slot, RelationGetDescr(cis->rel));
+	buffer->mctx = AllocSetContextCreate(ccstate->mcxt,
+										 "COPY multi-insert buffer",
+										 ALLOCSET_DEFAULT_SIZES);
+	ccstate->buffers = lappend(ccstate->buffers, buffer);
+	ccstate->last_buffer = buffer;
+
+	MemoryContextSwitchTo(old);
+
+	return buffer;
+}
+
+/*
+ * Write all tuples in a buffer to the chunk using heap_multi_insert() and then
+ * insert index entries and queue AFTER ROW triggers for each tuple. This
+ * mirrors CopyFromInsertBatch() in PostgreSQL's copy.c.
+ */
+static void
+copy_multi_insert_buffer_flush(CopyChunkState *ccstate, CopyMultiInsertBuffer *buffer)
+{
+	EState	   *estate = ccstate->estate;
+	ResultRelInfo *saved_rri = estate->es_result_relation_info;
+	ResultRelInfo *rri = buffer->cis->result_relation_info;
+	MemoryContext old;
+	int			i;
+
+	if (buffer->ntuples == 0)
+		return;
+
+	estate->es_result_relation_info = rri;
+
+	/*
+	 * heap_multi_insert() leaks memory, so switch to a short-lived memory
+	 * context before calling it.
+	 */
+	old = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+	heap_multi_insert(rri->ri_RelationDesc,
+					  buffer->tuples,
+					  buffer->ntuples,
+					  ccstate->mycid,
+					  ccstate->hi_options,
+					  buffer->bistate);
+
+	/* Index entries and triggers are handled in query context */
+	MemoryContextSwitchTo(ccstate->mcxt);
+
+	if (rri->ri_NumIndices > 0)
+	{
+		for (i = 0; i < buffer->ntuples; i++)
+		{
+			HeapTuple	tuple = buffer->tuples[i];
+			List	   *recheckIndexes;
+
+			ExecStoreTuple(tuple, buffer->slot, InvalidBuffer, false);
+			recheckIndexes = ExecInsertIndexTuples(buffer->slot, &(tuple->t_self),
+												   estate, false, NULL, NIL);
+			ExecARInsertTriggersCompat(estate, rri, tuple, recheckIndexes);
+			list_free(recheckIndexes);
+		}
+		ExecClearTuple(buffer->slot);
+	}
+	else if (rri->ri_TrigDesc != NULL &&
+			 rri->ri_TrigDesc->trig_insert_after_row)
+	{
+		/*
+		 * There's no indexes, but see if we need to run AFTER ROW INSERT
+		 * triggers anyway.
+		 */
+		for (i = 0; i < buffer->ntuples; i++)
+			ExecARInsertTriggersCompat(estate, rri, buffer->tuples[i], NIL);
+	}
+
+	MemoryContextSwitchTo(old);
+
+	estate->es_result_relation_info = saved_rri;
+	buffer->ntuples = 0;
+	buffer->nbytes = 0;
+	MemoryContextReset(buffer->mctx);
+}
+
+static void
+copy_multi_insert_buffer_free(CopyChunkState *ccstate, CopyMultiInsertBuffer *buffer)
+{
+	Assert(buffer->ntuples == 0);
+
+	if (ccstate->last_buffer == buffer)
+		ccstate->last_buffer = NULL;
+
+	ccstate->buffers = list_delete_ptr(ccstate->buffers, buffer);
+	FreeBulkInsertState(buffer->bistate);
+	ExecDropSingleTupleTableSlot(buffer->slot);
+	MemoryContextDelete(buffer->mctx);
+	pfree(buffer);
+}
+
+/*
+ * Add a tuple to the chunk's buffer, flushing the buffer if it is full.
+ */
+static void
+copy_multi_insert_buffer_add(CopyChunkState *ccstate, ChunkInsertState *cis, HeapTuple tuple)
+{
+	CopyMultiInsertBuffer *buffer = copy_multi_insert_buffer_get(ccstate, cis);
+	MemoryContext old = MemoryContextSwitchTo(buffer->mctx);
+
+	buffer->tuples[buffer->ntuples++] = heap_copytuple(tuple);
+	buffer->nbytes += tuple->t_len;
+
+	MemoryContextSwitchTo(old);
+
+	if (buffer->ntuples >= MAX_BUFFERED_TUPLES ||
+		buffer->nbytes >= MAX_BUFFERED_BYTES)
+		copy_multi_insert_buffer_flush(ccstate, buffer);
+}
+
+static void
+copy_multi_insert_buffer_flush_all(CopyChunkState *ccstate)
+{
+	ListCell   *lc;
+
+	foreach(lc, ccstate->buffers)
+		copy_multi_insert_buffer_flush(ccstate, lfirst(lc));
+}
+
+/*
+ * Flush and free a chunk's buffer before the chunk's insert state is closed
+ * by the dispatcher.
+ */
+static void
+copy_on_chunk_insert_state_close(ChunkInsertState *cis, void *arg)
+{
+	CopyChunkState *ccstate = arg;
+	CopyMultiInsertBuffer *buffer = copy_multi_insert_buffer_find(ccstate, cis);
+
+	if (NULL != buffer)
+	{
+		copy_multi_insert_buffer_flush(ccstate, buffer);
+		copy_multi_insert_buffer_free(ccstate, buffer);
+	}
+}
+
+/*
+ * Whether tuples for a chunk can be buffered. Like PostgreSQL's COPY, we
+ * cannot buffer tuples if there are BEFORE/INSTEAD OF ROW triggers, since
+ * such triggers might query the table we are inserting into and act
+ * differently if the tuples that have already been processed and prepared for
+ * insertion are not there.
+ */
+static inline bool
+copy_chunk_state_use_multi_insert(CopyChunkState *ccstate, ResultRelInfo *rri)
+{
+	return ccstate->use_multi_insert &&
+		!(rri->ri_TrigDesc != NULL &&
+		  (rri->ri_TrigDesc->trig_insert_before_row ||
+		   rri->ri_TrigDesc->trig_insert_instead_row));
+}
+
+/*
+ * Check for volatile default expressions on the columns that are not part of
+ * the COPY. If there are any, we cannot buffer tuples since the expressions
+ * might query the table we are inserting into. We allow nextval() to keep the
+ * common case of serial columns fast.
+ */
+static bool
+copy_has_volatile_defaults(Relation rel, List *attnums)
+{
+	TupleDesc	tupdesc = RelationGetDescr(rel);
+	int			i;
+
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		Expr	   *defexpr;
+
+		if (tupdesc->attrs[i]->attisdropped || list_member_int(attnums, i + 1))
+			continue;
+
+		defexpr = (Expr *) build_column_default(rel, i + 1);
+
+		if (NULL != defexpr)
+		{
+			defexpr = expression_planner(defexpr);
+
+			if (contain_volatile_functions_not_nextval((Node *) defexpr))
+				return true;
+		}
+	}
+
+	return false;
+}
+
 static CopyChunkState *
-copy_chunk_state_create(Hypertable *ht, Relation rel, CopyState cstate)
+copy_chunk_state_create(Hypertable *ht, Relation rel, CopyState cstate, List *attnums)
 {
 	CopyChunkState *ccstate;
 	EState	   *estate = CreateExecutorState();
 
-	ccstate = palloc(sizeof(CopyChunkState));
+	ccstate = palloc0(sizeof(CopyChunkState));
 	ccstate->estate = estate;
 	ccstate->dispatch = chunk_dispatch_create(ht, estate, NULL);
+	ccstate->dispatch->on_chunk_insert_state_close = copy_on_chunk_insert_state_close;
+	ccstate->dispatch->on_chunk_insert_state_close_arg = ccstate;
 	ccstate->cstate = cstate;
+	ccstate->mcxt = CurrentMemoryContext;
+	ccstate->use_multi_insert = !copy_has_volatile_defaults(rel, attnums);
 
 	return ccstate;
 }
@@ -65,6 +336,7 @@ static void
 copy_chunk_state_destroy(CopyChunkState *ccstate)
 {
 	chunk_dispatch_destroy(ccstate->dispatch);
+	Assert(ccstate->buffers == NIL);
 	FreeExecutorState(ccstate->estate);
 }
 
@@ -72,7 +344,7 @@ copy_chunk_state_destroy(CopyChunkState *ccstate)
  * Copy FROM file to relation.
  */
 static uint64
-timescaledb_CopyFrom(CopyState cstate, Relation main_rel, List *range_table, Hypertable *ht)
+timescaledb_CopyFrom(CopyState cstate, Relation main_rel, List *range_table, Hypertable *ht, List *attnums)
 {
 	HeapTuple	tuple;
 	TupleDesc	tupDesc;
@@ -80,7 +352,7 @@ timescaledb_CopyFrom(CopyState cstate, Relation main_rel, List *range_table, Hyp
 	bool	   *nulls;
 	ResultRelInfo *resultRelInfo;
 	ResultRelInfo *saved_resultRelInfo = NULL;
-	CopyChunkState *ccstate = copy_chunk_state_create(ht, main_rel, cstate);
+	CopyChunkState *ccstate = copy_chunk_state_create(ht, main_rel, cstate, attnums);
 	EState	   *estate = ccstate->estate;		/* for ExecConstraints() */
 	ExprContext *econtext;
 	TupleTableSlot *myslot;
@@ -168,6 +440,9 @@ timescaledb_CopyFrom(CopyState cstate, Relation main_rel, List *range_table, Hyp
 			hi_options |= HEAP_INSERT_SKIP_WAL;
 	}
 
+	ccstate->mycid = mycid;
+	ccstate->hi_options = hi_options;
+
 	/*
 	 * We need a ResultRelInfo so we can use the regular executor's
 	 * index-entry-making machinery.  (There used to be a huge amount of code
@@ -243,6 +518,7 @@ timescaledb_CopyFrom(CopyState cstate, Relation main_rel, List *range_table, Hyp
 
 		/* Calculate the tuple's point in the N-dimensional hyperspace */
 		point = hyperspace_calculate_point(ht->space, tuple, tupDesc);
+		continuous_agg_invalidation_add_point(&dispatch->invalidation, point);
 
 		/* Save the main table's (hypertable's) ResultRelInfo */
 		if (NULL == dispatch->hypertable_result_rel_info)
@@ -307,6 +583,16 @@ timescaledb_CopyFrom(CopyState cstate, Relation main_rel, List *range_table, Hyp
 			if (main_rel->rd_att->constr)
 				ExecConstraints(resultRelInfo, slot, estate);
 
+			if (copy_chunk_state_use_multi_insert(ccstate, resultRelInfo))
+			{
+				/*
+				 * Buffer the tuple with other tuples for the same chunk.
+				 * Index entries and AFTER ROW triggers are handled when the
+				 * buffer is flushed.
+				 */
+				copy_multi_insert_buffer_add(ccstate, cis, tuple);
+			}
+			else
 			{
 				List	   *recheckIndexes = NIL;
 
@@ -339,6 +625,9 @@ timescaledb_CopyFrom(CopyState cstate, Relation main_rel, List *range_table, Hyp
 			}
 		}
 	}
+	/* Flush any remaining buffered tuples */
+	copy_multi_insert_buffer_flush_all(ccstate);
+
 	/* Done, clean up */
 	error_context_stack = errcallback.previous;
 
@@ -587,8 +876,8 @@ timescaledb_DoCopy(const CopyStmt *stmt, const char *queryString, uint64 *proces
 	cstate = BeginCopyFrom(rel, stmt->filename, stmt->is_program,
 						   stmt->attlist, stmt->options);
 #endif
-	*processed = timescaledb_CopyFrom(cstate, rel, range_table, ht);	/* copy from file to
-																		 * database */
+	*processed = timescaledb_CopyFrom(cstate, rel, range_table, ht, attnums);	/* copy from file to
+																				 * database */
 	EndCopyFrom(cstate);
 
 	/*
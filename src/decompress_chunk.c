@@ -0,0 +1,583 @@
+#include <postgres.h>
+#include <access/heapam.h>
+#include <access/htup_details.h>
+#include <access/nbtree.h>
+#include <access/relscan.h>
+#include <access/stratnum.h>
+#include <catalog/pg_class.h>
+#include <catalog/pg_type.h>
+#include <commands/explain.h>
+#include <executor/executor.h>
+#include <nodes/extensible.h>
+#include <nodes/makefuncs.h>
+#include <nodes/nodeFuncs.h>
+#include <optimizer/clauses.h>
+#include <optimizer/pathnode.h>
+#include <optimizer/planmain.h>
+#include <optimizer/prep.h>
+#include <optimizer/restrictinfo.h>
+#include <parser/parsetree.h>
+#include <utils/lsyscache.h>
+#include <utils/memutils.h>
+#include <utils/rel.h>
+#include <utils/typcache.h>
+
+#include "compat-msvc-enter.h"
+#include <optimizer/cost.h>
+#include "compat-msvc-exit.h"
+
+#include "decompress_chunk.h"
+#include "compress_chunk.h"
+#include "dimension.h"
+#include "hypertable.h"
+#include "hypertable_cache.h"
+#include "compat.h"
+
+/*
+ * Scan of a compressed chunk.
+ *
+ * The rows of a compressed chunk live in two places: the batches of the
+ * compressed table and the chunk's own table, which holds the rows inserted
+ * after compression. The DecompressChunk node replaces all scan paths of a
+ * compressed chunk and returns the rows of both, first decompressing the
+ * batches one by one and then reading the chunk's table.
+ *
+ * Every batch stores the minimum and maximum value of the time column, so
+ * batches that cannot match a comparison of the time column with a constant
+ * are skipped without being decompressed. All other quals are evaluated on the
+ * decompressed rows, as for a regular scan.
+ */
+
+enum CustomPrivateIndex
+{
+	DECOMPRESS_CHUNK_PRIVATE_RELIDS,
+	DECOMPRESS_CHUNK_PRIVATE_ATTNOS,
+};
+
+typedef struct DecompressChunkPath
+{
+	CustomPath	cpath;
+	Oid			compressed_relid;
+	/* The time column in the chunk */
+	AttrNumber	time_attno;
+} DecompressChunkPath;
+
+/*
+ * A "time <op> constant" qual, which is used to skip batches based on their
+ * minimum and maximum time. The constant can be of another type than the time
+ * column, e.g., an int4 constant compared with a bigint column, so every key
+ * has the comparison function for its pair of types.
+ */
+typedef struct BatchSkipKey
+{
+	StrategyNumber strategy;
+	Oid			collation;
+	Datum		value;
+	FmgrInfo	cmp_finfo;
+} BatchSkipKey;
+
+typedef struct DecompressChunkState
+{
+	CustomScanState csstate;
+	Relation	compressed_rel;
+	HeapScanDesc compressed_scan;
+	CompressedBatchReader *reader;
+	/* Holds the decompressed data of the current batch */
+	MemoryContext batch_context;
+	bool		batch_valid;
+	bool		batches_done;
+	int			num_skip_keys;
+	BatchSkipKey *skip_keys;
+	AttrNumber	min_attno;
+	AttrNumber	max_attno;
+	/* Instrumentation, shown by EXPLAIN ANALYZE */
+	Size		num_batches_decompressed;
+	Size		num_batches_skipped;
+} DecompressChunkState;
+
+static AttrNumber
+get_compressed_attno(TupleDesc desc, const char *name, Oid typid)
+{
+	int			i;
+
+	for (i = 0; i < desc->natts; i++)
+	{
+		Form_pg_attribute attr = desc->attrs[i];
+
+		if (!attr->attisdropped &&
+			namestrcmp(&attr->attname, name) == 0 &&
+			attr->atttypid == typid)
+			return attr->attnum;
+	}
+
+	return InvalidAttrNumber;
+}
+
+/*
+ * Turn the quals on the time column into batch skip keys. Quals that use an
+ * operator outside of the time type's btree operator family, or for which the
+ * family has no comparison function, are ignored.
+ */
+static void
+decompress_chunk_init_skip_keys(DecompressChunkState *state, List *skip_quals, AttrNumber time_attno)
+{
+	TupleDesc	desc = RelationGetDescr(state->compressed_rel);
+	Oid			time_typid;
+	TypeCacheEntry *tce;
+	ListCell   *lc;
+
+	if (skip_quals == NIL || time_attno == InvalidAttrNumber)
+		return;
+
+	time_typid = RelationGetDescr(state->csstate.ss.ss_currentRelation)->attrs[AttrNumberGetAttrOffset(time_attno)]->atttypid;
+	state->min_attno = get_compressed_attno(desc, COMPRESSION_COLUMN_MIN, time_typid);
+	state->max_attno = get_compressed_attno(desc, COMPRESSION_COLUMN_MAX, time_typid);
+
+	if (state->min_attno == InvalidAttrNumber || state->max_attno == InvalidAttrNumber)
+		return;
+
+	tce = lookup_type_cache(time_typid, TYPECACHE_BTREE_OPFAMILY);
+
+	if (!OidIsValid(tce->btree_opf))
+		return;
+
+	state->skip_keys = palloc(sizeof(BatchSkipKey) * list_length(skip_quals));
+
+	foreach(lc, skip_quals)
+	{
+		OpExpr	   *op = lfirst(lc);
+		Const	   *value = lsecond(op->args);
+		int			strategy = get_op_opfamily_strategy(op->opno, tce->btree_opf);
+		BatchSkipKey *key = &state->skip_keys[state->num_skip_keys];
+		Oid			cmp_proc;
+
+		if (strategy == InvalidStrategy || exprType(linitial(op->args)) != time_typid)
+			continue;
+
+		cmp_proc = get_opfamily_proc(tce->btree_opf, time_typid, value->consttype, BTORDER_PROC);
+
+		if (!OidIsValid(cmp_proc))
+			continue;
+
+		fmgr_info(cmp_proc, &key->cmp_finfo);
+		key->strategy = strategy;
+		key->collation = op->inputcollid;
+		key->value = value->constvalue;
+		state->num_skip_keys++;
+	}
+}
+
+static bool
+decompress_chunk_skip_batch(DecompressChunkState *state, HeapTuple tuple)
+{
+	TupleDesc	desc = RelationGetDescr(state->compressed_rel);
+	Datum		min,
+				max;
+	bool		min_isnull,
+				max_isnull;
+	int			i;
+
+	if (state->num_skip_keys == 0)
+		return false;
+
+	min = heap_getattr(tuple, state->min_attno, desc, &min_isnull);
+	max = heap_getattr(tuple, state->max_attno, desc, &max_isnull);
+
+	if (min_isnull || max_isnull)
+		return false;
+
+	for (i = 0; i < state->num_skip_keys; i++)
+	{
+		BatchSkipKey *key = &state->skip_keys[i];
+		int32		cmp_min = DatumGetInt32(FunctionCall2Coll(&key->cmp_finfo, key->collation,
+															  min, key->value));
+		int32		cmp_max = DatumGetInt32(FunctionCall2Coll(&key->cmp_finfo, key->collation,
+															  max, key->value));
+
+		switch (key->strategy)
+		{
+			case BTLessStrategyNumber:
+				if (cmp_min >= 0)
+					return true;
+				break;
+			case BTLessEqualStrategyNumber:
+				if (cmp_min > 0)
+					return true;
+				break;
+			case BTEqualStrategyNumber:
+				if (cmp_min > 0 || cmp_max < 0)
+					return true;
+				break;
+			case BTGreaterEqualStrategyNumber:
+				if (cmp_max < 0)
+					return true;
+				break;
+			case BTGreaterStrategyNumber:
+				if (cmp_max <= 0)
+					return true;
+				break;
+			default:
+				break;
+		}
+	}
+
+	return false;
+}
+
+static void
+decompress_chunk_begin(CustomScanState *node, EState *estate, int eflags)
+{
+	DecompressChunkState *state = (DecompressChunkState *) node;
+	CustomScan *cscan = (CustomScan *) node->ss.ps.plan;
+	List	   *relids = list_nth(cscan->custom_private, DECOMPRESS_CHUNK_PRIVATE_RELIDS);
+	List	   *attnos = list_nth(cscan->custom_private, DECOMPRESS_CHUNK_PRIVATE_ATTNOS);
+
+	state->compressed_rel = heap_open(linitial_oid(relids), AccessShareLock);
+
+	if (eflags & EXEC_FLAG_EXPLAIN_ONLY)
+		return;
+
+	state->reader = compressed_batch_reader_create(RelationGetDescr(node->ss.ss_currentRelation),
+												   RelationGetDescr(state->compressed_rel));
+	state->batch_context = AllocSetContextCreate(estate->es_query_cxt,
+												 "DecompressChunk batch",
+												 ALLOCSET_DEFAULT_SIZES);
+	decompress_chunk_init_skip_keys(state, cscan->custom_exprs, linitial_int(attnos));
+
+	state->compressed_scan = heap_beginscan(state->compressed_rel, estate->es_snapshot, 0, NULL);
+	node->ss.ss_currentScanDesc = heap_beginscan(node->ss.ss_currentRelation,
+												 estate->es_snapshot, 0, NULL);
+}
+
+static TupleTableSlot *
+decompress_chunk_next(ScanState *node)
+{
+	DecompressChunkState *state = (DecompressChunkState *) node;
+	TupleTableSlot *slot = node->ss_ScanTupleSlot;
+	MemoryContext oldcontext;
+	HeapTuple	tuple;
+
+	while (!state->batches_done)
+	{
+		if (state->batch_valid)
+		{
+			bool		found;
+
+			ExecClearTuple(slot);
+			oldcontext = MemoryContextSwitchTo(state->batch_context);
+			found = compressed_batch_reader_next(state->reader, slot->tts_values, slot->tts_isnull);
+			MemoryContextSwitchTo(oldcontext);
+
+			if (found)
+				return ExecStoreVirtualTuple(slot);
+
+			state->batch_valid = false;
+		}
+
+		tuple = heap_getnext(state->compressed_scan, ForwardScanDirection);
+
+		if (NULL == tuple)
+			state->batches_done = true;
+		else if (decompress_chunk_skip_batch(state, tuple))
+			state->num_batches_skipped++;
+		else
+		{
+			state->num_batches_decompressed++;
+			MemoryContextReset(state->batch_context);
+			oldcontext = MemoryContextSwitchTo(state->batch_context);
+			compressed_batch_reader_set_batch(state->reader, tuple);
+			MemoryContextSwitchTo(oldcontext);
+			state->batch_valid = true;
+		}
+	}
+
+	/* Rows inserted into the chunk after it was compressed */
+	tuple = heap_getnext(node->ss_currentScanDesc, ForwardScanDirection);
+
+	if (NULL == tuple)
+		return ExecClearTuple(slot);
+
+	return ExecStoreTuple(tuple, slot, node->ss_currentScanDesc->rs_cbuf, false);
+}
+
+static bool
+decompress_chunk_recheck(ScanState *node, TupleTableSlot *slot)
+{
+	return true;
+}
+
+static TupleTableSlot *
+decompress_chunk_exec(CustomScanState *node)
+{
+	return ExecScan(&node->ss,
+					(ExecScanAccessMtd) decompress_chunk_next,
+					(ExecScanRecheckMtd) decompress_chunk_recheck);
+}
+
+static void
+decompress_chunk_end(CustomScanState *node)
+{
+	DecompressChunkState *state = (DecompressChunkState *) node;
+
+	if (NULL != state->compressed_scan)
+		heap_endscan(state->compressed_scan);
+
+	if (NULL != node->ss.ss_currentScanDesc)
+		heap_endscan(node->ss.ss_currentScanDesc);
+
+	heap_close(state->compressed_rel, NoLock);
+}
+
+static void
+decompress_chunk_rescan(CustomScanState *node)
+{
+	DecompressChunkState *state = (DecompressChunkState *) node;
+
+	ExecScanReScan(&node->ss);
+	heap_rescan(state->compressed_scan, NULL);
+	heap_rescan(node->ss.ss_currentScanDesc, NULL);
+	state->batch_valid = false;
+	state->batches_done = false;
+}
+
+static void
+decompress_chunk_explain(CustomScanState *node, List *ancestors, ExplainState *es)
+{
+	DecompressChunkState *state = (DecompressChunkState *) node;
+
+	if (es->analyze)
+	{
+		ExplainPropertyInteger("Batches decompressed", state->num_batches_decompressed, es);
+		ExplainPropertyInteger("Batches skipped", state->num_batches_skipped, es);
+	}
+}
+
+static CustomExecMethods decompress_chunk_state_methods = {
+	.CustomName = "DecompressChunk",
+	.BeginCustomScan = decompress_chunk_begin,
+	.ExecCustomScan = decompress_chunk_exec,
+	.EndCustomScan = decompress_chunk_end,
+	.ReScanCustomScan = decompress_chunk_rescan,
+	.ExplainCustomScan = decompress_chunk_explain,
+};
+
+static Node *
+decompress_chunk_state_create(CustomScan *cscan)
+{
+	DecompressChunkState *state = (DecompressChunkState *) newNode(sizeof(DecompressChunkState), T_CustomScanState);
+
+	state->csstate.methods = &decompress_chunk_state_methods;
+
+	return (Node *) state;
+}
+
+static CustomScanMethods decompress_chunk_plan_methods = {
+	.CustomName = "DecompressChunk",
+	.CreateCustomScanState = decompress_chunk_state_create,
+};
+
+/*
+ * Get the quals that compare the time column with a constant, in the form
+ * "time <op> constant". These are used to skip batches during execution.
+ */
+static List *
+get_batch_skip_quals(List *quals, Index relid, AttrNumber time_attno)
+{
+	List	   *skip_quals = NIL;
+	ListCell   *lc;
+
+	foreach(lc, quals)
+	{
+		OpExpr	   *op = lfirst(lc);
+		Expr	   *left;
+		Expr	   *right;
+		Oid			opno;
+
+		if (!IsA(op, OpExpr) || list_length(op->args) != 2)
+			continue;
+
+		left = linitial(op->args);
+		right = lsecond(op->args);
+		opno = op->opno;
+
+		if (IsA(left, Const))
+		{
+			Expr	   *tmp = left;
+
+			left = right;
+			right = tmp;
+			opno = get_commutator(opno);
+		}
+
+		if (!OidIsValid(opno) ||
+			!IsA(left, Var) ||
+			((Var *) left)->varno != relid ||
+			((Var *) left)->varattno != time_attno ||
+			!IsA(right, Const) ||
+			((Const *) right)->constisnull)
+			continue;
+
+		skip_quals = lappend(skip_quals,
+							 make_opclause(opno, BOOLOID, false, left, right,
+										   op->opcollid, op->inputcollid));
+	}
+
+	return skip_quals;
+}
+
+static Plan *
+decompress_chunk_plan_create(PlannerInfo *root,
+							 RelOptInfo *rel,
+							 CustomPath *path,
+							 List *tlist,
+							 List *clauses,
+							 List *custom_plans)
+{
+	DecompressChunkPath *dcpath = (DecompressChunkPath *) path;
+	CustomScan *cscan = makeNode(CustomScan);
+	List	   *quals = extract_actual_clauses(clauses, false);
+
+	cscan->scan.scanrelid = rel->relid;
+	cscan->scan.plan.targetlist = tlist;
+	cscan->scan.plan.qual = quals;
+	cscan->custom_exprs = get_batch_skip_quals(quals, rel->relid, dcpath->time_attno);
+	cscan->custom_private = list_make2(list_make1_oid(dcpath->compressed_relid),
+									   list_make1_int(dcpath->time_attno));
+	cscan->flags = path->flags;
+	cscan->methods = &decompress_chunk_plan_methods;
+
+	return &cscan->scan.plan;
+}
+
+static CustomPathMethods decompress_chunk_path_methods = {
+	.CustomName = "DecompressChunk",
+	.PlanCustomPath = decompress_chunk_plan_create,
+};
+
+static bool
+has_row_mark(PlannerInfo *root, RelOptInfo *rel)
+{
+	ListCell   *lc;
+
+	if (NULL != get_plan_rowmark(root->rowMarks, rel->relid))
+		return true;
+
+	foreach(lc, root->append_rel_list)
+	{
+		AppendRelInfo *appinfo = lfirst(lc);
+
+		if (appinfo->child_relid == rel->relid &&
+			NULL != get_plan_rowmark(root->rowMarks, appinfo->parent_relid))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Add the size of the compressed data to the size of a compressed chunk.
+ *
+ * This runs for every relation that is planned, so tables that are not
+ * compressed chunks are ruled out via the cached set of compressed chunks
+ * rather than the catalog.
+ *
+ * The chunk's table only has the rows inserted after compression, so the
+ * planner's estimates of the chunk's size need to include the rows of the
+ * batches. This is done when getting the relation info, since the size of
+ * the chunks is used for the hypertable before the chunks' paths are created.
+ * The compressed chunk is kept in the relation's fdw_private, which is
+ * otherwise unused for plain tables, for creating the scan path later.
+ */
+void
+decompress_chunk_adjust_rel_size(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte)
+{
+	CompressedChunk *cc;
+	Relation	compressed_rel;
+
+	if (rte->rtekind != RTE_RELATION || rte->inh || rte->relkind != RELKIND_RELATION ||
+		!compressed_chunk_exists(rte->relid))
+		return;
+
+	cc = compressed_chunk_get_by_relid(rte->relid);
+
+	if (NULL == cc)
+		return;
+
+	compressed_rel = heap_open(cc->compressed_relid, AccessShareLock);
+	rel->pages += RelationGetNumberOfBlocks(compressed_rel);
+	heap_close(compressed_rel, NoLock);
+
+	rel->tuples += cc->fd.num_rows;
+	rel->fdw_private = cc;
+}
+
+/*
+ * Replace the paths of a compressed chunk with a DecompressChunk path.
+ *
+ * Other scans of the chunk would only return the rows of the chunk's table,
+ * so the DecompressChunk path is the only path of the relation. It does not
+ * support parallel scans.
+ */
+void
+decompress_chunk_add_paths(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte)
+{
+	CompressedChunk *cc = rel->fdw_private;
+	DecompressChunkPath *path;
+	Cache	   *hcache;
+	Hypertable *ht;
+	Dimension  *time_dim;
+	QualCost	qual_cost;
+	Cost		run_cost;
+
+	if (NULL == cc || rte->rtekind != RTE_RELATION || rte->relkind != RELKIND_RELATION)
+		return;
+
+	/*
+	 * Rows are only located by their position in a batch. This is checked
+	 * here rather than when getting the relation info, so that chunks
+	 * excluded by constraints do not fail the query.
+	 */
+	if (rel->relid == root->parse->resultRelation || has_row_mark(root, rel))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("Cannot modify or lock rows of compressed chunk \"%s\"",
+						get_rel_name(rte->relid)),
+				 errhint("Decompress the chunk with decompress_chunk() first.")));
+
+	path = (DecompressChunkPath *) newNode(sizeof(DecompressChunkPath), T_CustomPath);
+	path->compressed_relid = cc->compressed_relid;
+
+	hcache = hypertable_cache_pin();
+	ht = hypertable_cache_get_entry(hcache, cc->hypertable_relid);
+	time_dim = NULL == ht ? NULL : hyperspace_get_open_dimension(ht->space, 0);
+
+	if (NULL != time_dim)
+		path->time_attno = get_attnum(rte->relid, NameStr(time_dim->fd.column_name));
+
+	cache_release(hcache);
+
+	/* Same as a sequential scan of the chunk and the compressed table */
+	cost_qual_eval(&qual_cost, rel->baserestrictinfo, root);
+	run_cost = seq_page_cost * rel->pages +
+		(cpu_tuple_cost + qual_cost.per_tuple) * rel->tuples +
+		rel->reltarget->cost.per_tuple * rel->rows;
+
+	path->cpath.path.pathtype = T_CustomScan;
+	path->cpath.path.parent = rel;
+	path->cpath.path.pathtarget = rel->reltarget;
+	path->cpath.path.param_info = NULL;
+	path->cpath.path.parallel_aware = false;
+	path->cpath.path.parallel_safe = false;
+	path->cpath.path.parallel_workers = 0;
+	path->cpath.path.rows = rel->rows;
+	path->cpath.path.startup_cost = qual_cost.startup + rel->reltarget->cost.startup;
+	path->cpath.path.total_cost = path->cpath.path.startup_cost + run_cost;
+	path->cpath.path.pathkeys = NIL;
+	path->cpath.flags = 0;
+	path->cpath.custom_paths = NIL;
+	path->cpath.methods = &decompress_chunk_path_methods;
+
+	rel->pathlist = NIL;
+	rel->partial_pathlist = NIL;
+	add_path(rel, &path->cpath.path);
+}
@@ -0,0 +1,11 @@
+#ifndef TIMESCALEDB_DECOMPRESS_CHUNK_H
+#define TIMESCALEDB_DECOMPRESS_CHUNK_H
+
+#include <postgres.h>
+#include <nodes/relation.h>
+#include <nodes/extensible.h>
+
+extern void decompress_chunk_adjust_rel_size(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte);
+extern void decompress_chunk_add_paths(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte);
+
+#endif   /* TIMESCALEDB_DECOMPRESS_CHUNK_H */
@@ -395,6 +395,16 @@ dimension_update_name(Dimension *dim, const char *newname)
 	return dimension_scan_update(dim->fd.id, dimension_tuple_update, dim, RowExclusiveLock);
 }
 
+int
+dimension_set_interval_length(Dimension *dim, int64 interval_length)
+{
+	Assert(IS_OPEN_DIMENSION(dim));
+
+	dim->fd.interval_length = interval_length;
+
+	return dimension_scan_update(dim->fd.id, dimension_tuple_update, dim, RowExclusiveLock);
+}
+
 static Point *
 point_create(int16 num_dimensions)
 {
@@ -16,10 +16,6 @@
 #include "dimension_vector.h"
 
 
-/* Put DIMENSION_SLICE_MAXVALUE point in same slice as DIMENSION_SLICE_MAXVALUE-1, always */
-/* This avoids the problem with coord < range_end where coord and range_end is an int64 */
-#define REMAP_LAST_COORDINATE(coord) ((coord==DIMENSION_SLICE_MAXVALUE) ? DIMENSION_SLICE_MAXVALUE-1 : coord)
-
 static inline DimensionSlice *
 dimension_slice_alloc(void)
 {
@@ -182,6 +178,28 @@ dimension_slice_collision_scan_limit(int32 dimension_id, int64 range_start, int6
 	return dimension_vec_sort(&slices);
 }
 
+/*
+ * Scan for slices that end at or before the given value, i.e., slices that
+ * only cover values below it.
+ */
+DimensionVec *
+dimension_slice_scan_ending_before(int32 dimension_id, int64 range_end, int limit)
+{
+	ScanKeyData scankey[3];
+	DimensionVec *slices = dimension_vec_create(limit > 0 ? limit : DIMENSION_VEC_DEFAULT_SIZE);
+
+	ScanKeyInit(&scankey[0], Anum_dimension_slice_dimension_id_range_start_range_end_idx_dimension_id,
+				BTEqualStrategyNumber, F_INT4EQ, Int32GetDatum(dimension_id));
+	ScanKeyInit(&scankey[1], Anum_dimension_slice_dimension_id_range_start_range_end_idx_range_start,
+				BTLessStrategyNumber, F_INT8LT, Int64GetDatum(range_end));
+	ScanKeyInit(&scankey[2], Anum_dimension_slice_dimension_id_range_start_range_end_idx_range_end,
+				BTLessEqualStrategyNumber, F_INT8LE, Int64GetDatum(range_end));
+
+	dimension_slice_scan_limit_internal(scankey, 3, dimension_vec_tuple_found, &slices, limit);
+
+	return dimension_vec_sort(&slices);
+}
+
 DimensionVec *
 dimension_slice_scan_by_dimension(int32 dimension_id, int limit)
 {
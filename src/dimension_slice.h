@@ -14,6 +14,10 @@
 /* partition functions return int32 */
 #define DIMENSION_SLICE_CLOSED_MAX ((int64)PG_INT32_MAX)
 
+/* Put DIMENSION_SLICE_MAXVALUE point in same slice as DIMENSION_SLICE_MAXVALUE-1, always */
+/* This avoids the problem with coord < range_end where coord and range_end is an int64 */
+#define REMAP_LAST_COORDINATE(coord) ((coord==DIMENSION_SLICE_MAXVALUE) ? DIMENSION_SLICE_MAXVALUE-1 : coord)
+
 typedef struct DimensionSlice
 {
 	FormData_dimension_slice fd;
@@ -29,6 +33,7 @@ extern DimensionVec *dimension_slice_collision_scan_limit(int32 dimension_id, in
 extern Hypercube *dimension_slice_point_scan(Hyperspace *space, int64 point[]);
 extern DimensionSlice *dimension_slice_scan_for_existing(DimensionSlice *slice);
 extern DimensionSlice *dimension_slice_scan_by_id(int32 dimension_slice_id);
+extern DimensionVec *dimension_slice_scan_ending_before(int32 dimension_id, int64 range_end, int limit);
 extern DimensionVec *dimension_slice_scan_by_dimension(int32 dimension_id, int limit);
 extern DimensionSlice *dimension_slice_create(int dimension_id, int64 range_start, int64 range_end);
 extern DimensionSlice *dimension_slice_copy(const DimensionSlice *original);
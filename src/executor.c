@@ -3,8 +3,12 @@
 #include <access/xact.h>
 
 #include "executor.h"
+#include "chunk_column_stats.h"
 #include "compat.h"
+#include "continuous_agg.h"
+#include "extension.h"
 
+static ExecutorStart_hook_type prev_ExecutorStart_hook;
 static ExecutorRun_hook_type prev_ExecutorRun_hook;
 static uint64 additional_tuples;
 static uint64 level = 0;
@@ -37,6 +41,27 @@ executor_level_exit(void)
 	level--;
 }
 
+/*
+ * Writes that bypass the hypertable cannot maintain chunk column stats or
+ * track the modified range of time values for continuous aggregates, so
+ * the stats and ranges they affect are invalidated before the statement
+ * runs.
+ */
+static void
+timescaledb_ExecutorStart(QueryDesc *queryDesc, int eflags)
+{
+	if (extension_is_loaded() && !(eflags & EXEC_FLAG_EXPLAIN_ONLY))
+	{
+		chunk_column_stats_invalidate_for_statement(queryDesc->plannedstmt);
+		continuous_agg_invalidate_for_statement(queryDesc->plannedstmt);
+	}
+
+	if (prev_ExecutorStart_hook)
+		(*prev_ExecutorStart_hook) (queryDesc, eflags);
+	else
+		standard_ExecutorStart(queryDesc, eflags);
+}
+
 #if PG10
 static void
 timescaledb_ExecutorRun(QueryDesc *queryDesc,
@@ -97,6 +122,8 @@ executor_AtEOXact_abort(XactEvent event, void *arg)
 void
 _executor_init(void)
 {
+	prev_ExecutorStart_hook = ExecutorStart_hook;
+	ExecutorStart_hook = timescaledb_ExecutorStart;
 	prev_ExecutorRun_hook = ExecutorRun_hook;
 	ExecutorRun_hook = timescaledb_ExecutorRun;
 
@@ -106,6 +133,7 @@ _executor_init(void)
 void
 _executor_fini(void)
 {
+	ExecutorStart_hook = prev_ExecutorStart_hook;
 	ExecutorRun_hook = prev_ExecutorRun_hook;
 	UnregisterXactCallback(executor_AtEOXact_abort, NULL);
 }
@@ -7,6 +7,18 @@ bool		guc_disable_optimizations = false;
 bool		guc_optimize_non_hypertables = false;
 bool		guc_restoring = false;
 bool		guc_constraint_aware_append = true;
+bool		guc_plan_time_chunk_exclusion = true;
+bool		guc_ordered_append = false;
+bool		guc_lazy_chunk_init = false;
+bool		guc_optimize_bookend_aggregates = true;
+bool		guc_skip_scan = true;
+bool		guc_chunk_partial_aggregation = false;
+int			guc_insert_batch_size = 0;
+int			guc_max_open_chunks_per_insert = 10;
+int			guc_max_cached_chunks_per_hypertable = 100;
+double		guc_chunk_precreate_threshold = 0.9;
+char	   *guc_bgw_scheduler_database = NULL;
+int			guc_max_background_jobs = 4;
 
 void
 _guc_init(void)
@@ -51,6 +63,149 @@ _guc_init(void)
 							 NULL,
 							 NULL,
 							 NULL);
+
+	DefineCustomBoolVariable("timescaledb.plan_time_chunk_exclusion", "Enable chunk exclusion at planning time",
+							 "Exclude chunks based on the restrictions on dimension columns "
+							 "before the planner opens them",
+							 &guc_plan_time_chunk_exclusion,
+							 true,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomBoolVariable("timescaledb.ordered_append", "Enable ordered append scans",
+							 "Scan the chunks of hypertables partitioned only on time one after the "
+							 "other, instead of merging them, for queries that order by time",
+							 &guc_ordered_append,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomBoolVariable("timescaledb.lazy_chunk_init", "Enable lazy initialization of chunk scans",
+							 "Initialize the scan of a chunk in an append only when execution "
+							 "reaches it, instead of initializing all chunk scans up front",
+							 &guc_lazy_chunk_init,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomBoolVariable("timescaledb.optimize_bookend_aggregates", "Enable index scans for first() and last()",
+							 "Compute first() and last() aggregates on the time column of a hypertable "
+							 "by reading only the first row in time order",
+							 &guc_optimize_bookend_aggregates,
+							 true,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomBoolVariable("timescaledb.skip_scan", "Enable skip scans for DISTINCT queries",
+							 "Read only the first row of each distinct value from the chunk indexes "
+							 "for DISTINCT and DISTINCT ON queries on a single column",
+							 &guc_skip_scan,
+							 true,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomBoolVariable("timescaledb.chunk_partial_aggregation", "Enable per-chunk partial aggregation",
+							 "Compute partial aggregates for each chunk below the append of a hypertable "
+							 "and combine them above it. Not used for queries that exclude chunks at "
+							 "execution time (constraint-aware append)",
+							 &guc_chunk_partial_aggregation,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomIntVariable("timescaledb.max_open_chunks_per_insert", "Maximum open chunks per insert",
+							"Maximum number of open chunk tables per insert. When the limit is reached, "
+							"the least recently used chunks are closed",
+							&guc_max_open_chunks_per_insert,
+							10,
+							1,
+							65536,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("timescaledb.max_cached_chunks_per_hypertable", "Maximum cached chunks",
+							"Maximum number of chunks stored in the cache of each hypertable",
+							&guc_max_cached_chunks_per_hypertable,
+							100,
+							1,
+							65536,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("timescaledb.insert_batch_size", "Number of tuples routed to chunks as a batch on INSERT",
+							"Tuples in a batch are grouped by chunk before they are inserted, "
+							"which changes the order of insertion. Zero disables batching",
+							&guc_insert_batch_size,
+							0,
+							0,
+							65536,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomRealVariable("timescaledb.chunk_precreate_threshold", "Fill threshold for chunk pre-creation",
+							 "Fraction of the most recent interval that needs to be filled with data "
+							 "before the chunks for the next interval are pre-created",
+							 &guc_chunk_precreate_threshold,
+							 0.9,
+							 0.0,
+							 1.0,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomStringVariable("timescaledb.bgw_scheduler_database", "Database to run background jobs in",
+							   "Name of the database in which a background worker schedules and starts "
+							   "background jobs. The scheduler is not started if unset",
+							   &guc_bgw_scheduler_database,
+							   NULL,
+							   PGC_POSTMASTER,
+							   0,
+							   NULL,
+							   NULL,
+							   NULL);
+
+	DefineCustomIntVariable("timescaledb.max_background_jobs", "Maximum number of concurrent background jobs",
+							"Maximum number of background jobs that run at the same time. Each job "
+							"runs in its own background worker, so max_worker_processes needs to "
+							"allow for them",
+							&guc_max_background_jobs,
+							4,
+							0,
+							MAX_BACKENDS,
+							PGC_SIGHUP,
+							0,
+							NULL,
+							NULL,
+							NULL);
 }
 
 void
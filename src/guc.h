@@ -5,7 +5,19 @@
 extern bool guc_disable_optimizations;
 extern bool guc_optimize_non_hypertables;
 extern bool guc_constraint_aware_append;
+extern bool guc_plan_time_chunk_exclusion;
+extern bool guc_ordered_append;
+extern bool guc_lazy_chunk_init;
+extern bool guc_optimize_bookend_aggregates;
+extern bool guc_skip_scan;
+extern bool guc_chunk_partial_aggregation;
 extern bool guc_restoring;
+extern int	guc_insert_batch_size;
+extern int	guc_max_open_chunks_per_insert;
+extern int	guc_max_cached_chunks_per_hypertable;
+extern double guc_chunk_precreate_threshold;
+extern char *guc_bgw_scheduler_database;
+extern int	guc_max_background_jobs;
 
 void		_guc_init(void);
 void		_guc_fini(void);
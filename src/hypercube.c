@@ -126,6 +126,27 @@ hypercube_get_slice_by_dimension_id(Hypercube *hc, int32 dimension_id)
 	return *((DimensionSlice **) ptr);
 }
 
+/*
+ * Check if the hypercube encloses the given point.
+ *
+ * The hypercube needs to have a slice in every dimension of the point's
+ * hyperspace.
+ */
+bool
+hypercube_contains_point(Hypercube *hc, Point *p)
+{
+	int			i;
+
+	if (hc->num_slices != p->num_coords)
+		return false;
+
+	for (i = 0; i < hc->num_slices; i++)
+		if (dimension_slice_cmp_coordinate(hc->slices[i], p->coordinates[i]) != 0)
+			return false;
+
+	return true;
+}
+
 /*
  * Given a set of constraints, build the corresponding hypercube.
  */
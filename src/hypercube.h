@@ -28,6 +28,7 @@ extern void hypercube_add_slice(Hypercube *hc, DimensionSlice *slice);
 extern Hypercube *hypercube_from_constraints(ChunkConstraints *constraints);
 extern Hypercube *hypercube_calculate_from_point(Hyperspace *hs, Point *p);
 extern bool hypercubes_collide(Hypercube *cube1, Hypercube *cube2);
+extern bool hypercube_contains_point(Hypercube *hc, Point *p);
 extern DimensionSlice *hypercube_get_slice_by_dimension_id(Hypercube *hc, int32 dimension_id);
 extern Hypercube *hypercube_copy(Hypercube *hc);
 extern void hypercube_slice_sort(Hypercube *hc);
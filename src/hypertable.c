@@ -14,7 +14,10 @@
 #include "hypertable.h"
 #include "dimension.h"
 #include "chunk.h"
+#include "chunk_column_stats.h"
+#include "chunk_slice_index.h"
 #include "compat.h"
+#include "continuous_agg.h"
 #include "subspace_store.h"
 #include "hypertable_cache.h"
 #include "trigger.h"
@@ -23,6 +26,7 @@
 #include "dimension_slice.h"
 #include "dimension_vector.h"
 #include "hypercube.h"
+#include "guc.h"
 
 static Oid
 rel_get_owner(Oid relid)
@@ -77,7 +81,10 @@ hypertable_from_tuple(HeapTuple tuple)
 	namespace_oid = get_namespace_oid(NameStr(h->fd.schema_name), false);
 	h->main_table_relid = get_relname_relid(NameStr(h->fd.table_name), namespace_oid);
 	h->space = dimension_scan(h->fd.id, h->main_table_relid, h->fd.num_dimensions);
-	h->chunk_cache = subspace_store_init(h->space->num_dimensions, CurrentMemoryContext);
+	h->chunk_cache = subspace_store_init(h->space->num_dimensions, CurrentMemoryContext,
+										 guc_max_cached_chunks_per_hypertable);
+	h->stats_columns = chunk_column_stats_get_columns(h->fd.id, h->main_table_relid);
+	h->continuous_aggs = continuous_agg_get_mat_ids(h->fd.id);
 
 	return h;
 }
@@ -132,7 +139,13 @@ typedef struct ChunkCacheEntry
 static void
 chunk_cache_entry_free(void *cce)
 {
-	MemoryContextDelete(((ChunkCacheEntry *) cce)->mcxt);
+	ChunkCacheEntry *entry = cce;
+
+	/* Entries without a memory context share the chunk slice index's chunk */
+	if (NULL == entry->mcxt)
+		pfree(entry);
+	else
+		MemoryContextDelete(entry->mcxt);
 }
 
 static int
@@ -161,6 +174,50 @@ hypertable_scan_limit_internal(ScanKeyData *scankey,
 	return scanner_scan(&scanctx);
 }
 
+static bool
+hypertable_tuple_append_relid(TupleInfo *ti, void *data)
+{
+	List	  **relids = data;
+	Oid			relid = InvalidOid;
+
+	hypertable_tuple_get_relid(ti, &relid);
+
+	if (OidIsValid(relid))
+		*relids = lappend_oid(*relids, relid);
+
+	return true;
+}
+
+/*
+ * Get the relids of all hypertables with the given schema and table name. A
+ * NULL name matches any name.
+ */
+List *
+hypertable_get_relids_by_name(Name schema_name, Name table_name)
+{
+	List	   *relids = NIL;
+	ScanKeyData scankey[2];
+	int			nkeys = 0;
+
+	if (NULL != schema_name)
+		ScanKeyInit(&scankey[nkeys++], Anum_hypertable_name_idx_schema,
+					BTEqualStrategyNumber, F_NAMEEQ, NameGetDatum(schema_name));
+
+	if (NULL != table_name)
+		ScanKeyInit(&scankey[nkeys++], Anum_hypertable_name_idx_table,
+					BTEqualStrategyNumber, F_NAMEEQ, NameGetDatum(table_name));
+
+	hypertable_scan_limit_internal(scankey,
+								   nkeys,
+								   HYPERTABLE_NAME_INDEX,
+								   hypertable_tuple_append_relid,
+								   &relids,
+								   0,
+								   AccessShareLock);
+
+	return relids;
+}
+
 static bool
 hypertable_tuple_update(TupleInfo *ti, void *data)
 {
@@ -171,6 +228,7 @@ hypertable_tuple_update(TupleInfo *ti, void *data)
 
 	namecpy(&form->schema_name, &update->schema_name);
 	namecpy(&form->table_name, &update->table_name);
+	form->chunk_target_size = update->chunk_target_size;
 	catalog_become_owner(catalog_get(), &sec_ctx);
 	catalog_update(ti->scanrel, tuple);
 	catalog_restore_user(&sec_ctx);
@@ -206,6 +264,14 @@ hypertable_set_name(Hypertable *ht, const char *newname)
 	return hypertable_update_form(&ht->fd);
 }
 
+int
+hypertable_set_chunk_target_size(Hypertable *ht, int64 chunk_target_size)
+{
+	ht->fd.chunk_target_size = chunk_target_size;
+
+	return hypertable_update_form(&ht->fd);
+}
+
 int
 hypertable_set_schema(Hypertable *ht, const char *newname)
 {
@@ -214,6 +280,68 @@ hypertable_set_schema(Hypertable *ht, const char *newname)
 	return hypertable_update_form(&ht->fd);
 }
 
+/*
+ * Get the hypertable's chunk slice index, building it if necessary. A stale
+ * index is refreshed so that it has all chunks of the hypertable.
+ */
+ChunkSliceIndex *
+hypertable_get_slice_index(Hypertable *h)
+{
+	if (NULL == h->slice_index)
+		h->slice_index = chunk_slice_index_create(h->space,
+												  subspace_store_mcxt(h->chunk_cache));
+	else
+		chunk_slice_index_refresh(h->slice_index, h->space);
+
+	return h->slice_index;
+}
+
+/*
+ * Find the chunk that encloses the point, first in the hypertable's chunk
+ * slice index and then in the catalog. If no chunk exists, a new one is
+ * created.
+ *
+ * A stale index is not refreshed here, since a chunk that is missing from the
+ * index is found in the catalog anyway and then added to the index. Chunks
+ * are never removed without invalidating the hypertable cache, and thereby
+ * the index, so an index hit is always valid.
+ *
+ * Returns the chunk, which is owned by the index if *indexed is set to true.
+ */
+static Chunk *
+hypertable_find_or_create_chunk(Hypertable *h, Point *point, bool *indexed)
+{
+	ChunkSliceIndex *index = h->slice_index;
+	Chunk	   *chunk;
+	Chunk	   *indexed_chunk;
+
+	if (NULL == index)
+		index = hypertable_get_slice_index(h);
+
+	chunk = chunk_slice_index_find(index, point);
+	*indexed = (NULL != chunk);
+
+	if (NULL != chunk)
+		return chunk;
+
+	/*
+	 * chunk_find() must execute on a per-tuple memory context since it
+	 * allocates a lot of transient data. We don't want this allocated on the
+	 * cache's memory context.
+	 */
+	chunk = chunk_find(h->space, point);
+
+	if (NULL == chunk)
+		chunk = chunk_create(h, point,
+							 NameStr(h->fd.associated_schema_name),
+							 NameStr(h->fd.associated_table_prefix));
+
+	indexed_chunk = chunk_slice_index_add(index, chunk);
+	*indexed = (NULL != indexed_chunk);
+
+	return *indexed ? indexed_chunk : chunk;
+}
+
 Chunk *
 hypertable_get_chunk(Hypertable *h, Point *point)
 {
@@ -224,21 +352,27 @@ hypertable_get_chunk(Hypertable *h, Point *point)
 		MemoryContext old_mcxt,
 					chunk_mcxt;
 		Chunk	   *chunk;
+		bool		indexed;
 
-		/*
-		 * chunk_find() must execute on a per-tuple memory context since it
-		 * allocates a lot of transient data. We don't want this allocated on
-		 * the cache's memory context.
-		 */
-		chunk = chunk_find(h->space, point);
-
-		if (NULL == chunk)
-			chunk = chunk_create(h, point,
-								 NameStr(h->fd.associated_schema_name),
-								 NameStr(h->fd.associated_table_prefix));
+		chunk = hypertable_find_or_create_chunk(h, point, &indexed);
 
 		Assert(chunk != NULL);
 
+		if (indexed)
+		{
+			/*
+			 * The index outlives the chunk cache, so the cache can share the
+			 * index's copy of the chunk.
+			 */
+			cce = MemoryContextAlloc(subspace_store_mcxt(h->chunk_cache),
+									 sizeof(ChunkCacheEntry));
+			cce->mcxt = NULL;
+			cce->chunk = chunk;
+			subspace_store_add(h->chunk_cache, chunk->cube, cce, chunk_cache_entry_free);
+
+			return chunk;
+		}
+
 		chunk_mcxt = AllocSetContextCreate(subspace_store_mcxt(h->chunk_cache),
 										   "chunk cache memory context",
 										   ALLOCSET_SMALL_SIZES);
@@ -257,8 +391,8 @@ hypertable_get_chunk(Hypertable *h, Point *point)
 
 	Assert(NULL != cce);
 	Assert(NULL != cce->chunk);
-	Assert(MemoryContextContains(cce->mcxt, cce));
-	Assert(MemoryContextContains(cce->mcxt, cce->chunk));
+	Assert(NULL == cce->mcxt || MemoryContextContains(cce->mcxt, cce));
+	Assert(NULL == cce->mcxt || MemoryContextContains(cce->mcxt, cce->chunk));
 
 	return cce->chunk;
 }
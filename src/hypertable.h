@@ -9,6 +9,7 @@
 #include "tablespace.h"
 
 typedef struct SubspaceStore SubspaceStore;
+typedef struct ChunkSliceIndex ChunkSliceIndex;
 typedef struct Chunk Chunk;
 typedef struct HeapTupleData *HeapTuple;
 
@@ -18,15 +19,24 @@ typedef struct Hypertable
 	Oid			main_table_relid;
 	Hyperspace *space;
 	SubspaceStore *chunk_cache;
+	/* Index of all chunks, built on demand. Use hypertable_get_slice_index() */
+	ChunkSliceIndex *slice_index;
+	/* Columns with per-chunk stats (ChunkStatsColumn) */
+	List	   *stats_columns;
+	/* IDs of the materialization hypertables of continuous aggregates */
+	List	   *continuous_aggs;
 } Hypertable;
 
 extern bool hypertable_has_privs_of(Oid hypertable_oid, Oid userid);
 extern Oid	hypertable_permissions_check(Oid hypertable_oid, Oid userid);
 extern Hypertable *hypertable_from_tuple(HeapTuple tuple);
 extern int	hypertable_set_name(Hypertable *ht, const char *newname);
+extern int	hypertable_set_chunk_target_size(Hypertable *ht, int64 chunk_target_size);
 extern int	hypertable_set_schema(Hypertable *ht, const char *newname);
 extern Oid	hypertable_id_to_relid(int32 hypertable_id);
+extern List *hypertable_get_relids_by_name(Name schema_name, Name table_name);
 extern Chunk *hypertable_get_chunk(Hypertable *h, Point *point);
+extern ChunkSliceIndex *hypertable_get_slice_index(Hypertable *h);
 extern Oid	hypertable_relid(RangeVar *rv);
 extern bool is_hypertable(Oid relid);
 extern bool hypertable_has_tablespace(Hypertable *ht, Oid tspc_oid);
@@ -1,13 +1,17 @@
 #include <postgres.h>
 #include <catalog/namespace.h>
 #include <utils/catcache.h>
+#include <utils/inval.h>
 #include <utils/lsyscache.h>
 #include <utils/builtins.h>
+#include <utils/memutils.h>
 
 #include "hypertable_cache.h"
 #include "hypertable.h"
+#include "chunk_slice_index.h"
 #include "catalog.h"
 #include "cache.h"
+#include "compat.h"
 #include "utils.h"
 #include "scanner.h"
 #include "dimension.h"
@@ -32,6 +36,7 @@ hypertable_cache_get_key(CacheQuery *query)
 typedef struct
 {
 	Oid			relid;
+	MemoryContext mcxt;
 	Hypertable *hypertable;
 } HypertableNameCacheEntry;
 
@@ -68,6 +73,64 @@ hypertable_cache_create()
 
 static Cache *hypertable_cache_current = NULL;
 
+/*
+ * Memory contexts of entries that were invalidated while the cache was
+ * pinned. These cannot be freed until the cache is no longer pinned, since
+ * the hypertables they hold might still be in use.
+ */
+static List *hypertable_cache_stale_entries = NIL;
+
+/*
+ * The relation whose entry is currently being created. Catalog lookups during
+ * entry creation might process invalidation messages, which must not remove
+ * the half-initialized entry. Since the lookups happen after the messages are
+ * processed, the entry will be up-to-date anyway.
+ */
+static Oid	hypertable_cache_creating_relid = InvalidOid;
+
+/*
+ * Chunk slice indexes of invalidated entries, waiting to be adopted by the
+ * next entry of the same hypertable. Removing chunks invalidates the entire
+ * cache, so an index remains valid when only a single entry is invalidated
+ * (e.g., when a chunk is added). The index is marked stale and refreshed on
+ * demand, instead of being rebuilt from scratch.
+ */
+static List *hypertable_cache_slice_indexes = NIL;
+
+static void
+hypertable_cache_keep_slice_index(Cache *cache, ChunkSliceIndex *index)
+{
+	MemoryContext old;
+
+	/* The index must survive the deletion of the entry's memory context */
+	MemoryContextSetParent(index->mcxt, cache_memory_ctx(cache));
+	index->stale = true;
+
+	old = cache_switch_to_memory_context(cache);
+	hypertable_cache_slice_indexes = lappend(hypertable_cache_slice_indexes, index);
+	MemoryContextSwitchTo(old);
+}
+
+static ChunkSliceIndex *
+hypertable_cache_adopt_slice_index(int32 hypertable_id)
+{
+	ListCell   *lc;
+
+	foreach(lc, hypertable_cache_slice_indexes)
+	{
+		ChunkSliceIndex *index = lfirst(lc);
+
+		if (index->hypertable_id == hypertable_id)
+		{
+			hypertable_cache_slice_indexes =
+				list_delete_ptr(hypertable_cache_slice_indexes, index);
+			return index;
+		}
+	}
+
+	return NULL;
+}
+
 static bool
 hypertable_tuple_found(TupleInfo *ti, void *data)
 {
@@ -83,6 +146,7 @@ hypertable_cache_create_entry(Cache *cache, CacheQuery *query)
 	HypertableCacheQuery *hq = (HypertableCacheQuery *) query;
 	Catalog    *catalog = catalog_get();
 	HypertableNameCacheEntry *cache_entry = query->result;
+	MemoryContext old;
 	int			number_found;
 	ScanKeyData scankey[2];
 	ScannerCtx	scanCtx = {
@@ -97,6 +161,10 @@ hypertable_cache_create_entry(Cache *cache, CacheQuery *query)
 		.scandirection = ForwardScanDirection,
 	};
 
+	cache_entry->mcxt = NULL;
+	cache_entry->hypertable = NULL;
+	hypertable_cache_creating_relid = hq->relid;
+
 	if (NULL == hq->schema)
 		hq->schema = get_namespace_name(get_rel_namespace(hq->relid));
 
@@ -111,23 +179,38 @@ hypertable_cache_create_entry(Cache *cache, CacheQuery *query)
 				BTEqualStrategyNumber, F_NAMEEQ,
 				DirectFunctionCall1(namein, CStringGetDatum(hq->table)));
 
+	/*
+	 * Every hypertable gets its own memory context so that its entry can be
+	 * freed on invalidation without flushing the entire cache.
+	 */
+	cache_entry->mcxt = AllocSetContextCreate(cache_memory_ctx(cache),
+											  "Hypertable cache entry",
+											  ALLOCSET_SMALL_SIZES);
+	old = MemoryContextSwitchTo(cache_entry->mcxt);
 	number_found = scanner_scan(&scanCtx);
+	MemoryContextSwitchTo(old);
 
 	switch (number_found)
 	{
 		case 0:
 			/* Negative cache entry: table is not a hypertable */
 			cache_entry->hypertable = NULL;
+			MemoryContextDelete(cache_entry->mcxt);
+			cache_entry->mcxt = NULL;
 			break;
 		case 1:
 			Assert(strncmp(cache_entry->hypertable->fd.schema_name.data, hq->schema, NAMEDATALEN) == 0);
 			Assert(strncmp(cache_entry->hypertable->fd.table_name.data, hq->table, NAMEDATALEN) == 0);
+			cache_entry->hypertable->slice_index =
+				hypertable_cache_adopt_slice_index(cache_entry->hypertable->fd.id);
 			break;
 		default:
 			elog(ERROR, "Got an unexpected number of records: %d", number_found);
 			break;
 	}
 
+	hypertable_cache_creating_relid = InvalidOid;
+
 	return query->result;
 }
 
@@ -137,6 +220,93 @@ hypertable_cache_invalidate_callback(void)
 	CACHE1_elog(WARNING, "DESTROY hypertable_cache");
 	cache_invalidate(hypertable_cache_current);
 	hypertable_cache_current = hypertable_cache_create();
+
+	/* Stale entries are freed along with the old cache's memory context */
+	hypertable_cache_stale_entries = NIL;
+	hypertable_cache_slice_indexes = NIL;
+	hypertable_cache_creating_relid = InvalidOid;
+}
+
+/*
+ * Free the memory of entries that were invalidated while the cache was pinned.
+ */
+static void
+hypertable_cache_free_stale_entries(void)
+{
+	ListCell   *lc;
+
+	foreach(lc, hypertable_cache_stale_entries)
+		MemoryContextDelete(lfirst(lc));
+
+	list_free(hypertable_cache_stale_entries);
+	hypertable_cache_stale_entries = NIL;
+}
+
+/*
+ * Invalidate the cache entry of a single hypertable (or a negative entry for a
+ * regular table).
+ *
+ * This is called on relcache invalidation of any relation, so it should be
+ * cheap when the relation is not in the cache.
+ */
+void
+hypertable_cache_invalidate_entry(Oid relid)
+{
+	Cache	   *cache = hypertable_cache_current;
+	HypertableNameCacheEntry *entry;
+	MemoryContext mcxt;
+
+	if (NULL == cache || !OidIsValid(relid) || relid == hypertable_cache_creating_relid)
+		return;
+
+	entry = hash_search(cache->htab, &relid, HASH_FIND, NULL);
+
+	if (NULL == entry)
+		return;
+
+	CACHE1_elog(WARNING, "INVALIDATE hypertable_cache entry");
+
+	mcxt = entry->mcxt;
+
+	if (NULL != entry->hypertable && NULL != entry->hypertable->slice_index)
+		hypertable_cache_keep_slice_index(cache, entry->hypertable->slice_index);
+
+	cache_remove(cache, &relid);
+
+	if (NULL == mcxt)
+		return;
+
+	/*
+	 * The cache holds one reference of its own, so a higher reference count
+	 * means that someone has pinned the cache and might still hold a pointer
+	 * to the hypertable.
+	 */
+	if (cache->refcount > 1)
+	{
+		MemoryContext old = cache_switch_to_memory_context(cache);
+
+		hypertable_cache_stale_entries = lappend(hypertable_cache_stale_entries, mcxt);
+		MemoryContextSwitchTo(old);
+	}
+	else
+		MemoryContextDelete(mcxt);
+}
+
+TS_FUNCTION_INFO_V1(hypertable_cache_has_entry);
+
+/*
+ * Check whether a relation has an entry in this backend's hypertable cache.
+ *
+ * Only used for testing.
+ */
+Datum
+hypertable_cache_has_entry(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+
+	AcceptInvalidationMessages();
+
+	PG_RETURN_BOOL(NULL != hash_search(hypertable_cache_current->htab, &relid, HASH_FIND, NULL));
 }
 
 /* Get hypertable cache entry. If the entry is not in the cache, add it. */
@@ -177,6 +347,9 @@ hypertable_cache_get_entry_with_table(Cache *cache, Oid relid, const char *schem
 extern Cache *
 hypertable_cache_pin()
 {
+	if (hypertable_cache_current->refcount == 1 && hypertable_cache_stale_entries != NIL)
+		hypertable_cache_free_stale_entries();
+
 	return cache_pin(hypertable_cache_current);
 }
 
@@ -191,4 +364,6 @@ void
 _hypertable_cache_fini(void)
 {
 	cache_invalidate(hypertable_cache_current);
+	hypertable_cache_stale_entries = NIL;
+	hypertable_cache_slice_indexes = NIL;
 }
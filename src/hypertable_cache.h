@@ -11,6 +11,7 @@ extern Hypertable *hypertable_cache_get_entry_with_table(Cache *cache, Oid relid
 extern Hypertable *hypertable_cache_get_entry_by_id(Cache *cache, int32 hypertable_id);
 
 extern void hypertable_cache_invalidate_callback(void);
+extern void hypertable_cache_invalidate_entry(Oid relid);
 
 extern Cache *hypertable_cache_pin(void);
 
@@ -0,0 +1,473 @@
+#include <postgres.h>
+#include <access/stratnum.h>
+#include <catalog/pg_am.h>
+#include <catalog/pg_type.h>
+#include <commands/defrem.h>
+#include <nodes/nodeFuncs.h>
+#include <optimizer/clauses.h>
+#include <parser/parse_coerce.h>
+#include <utils/date.h>
+#include <utils/lsyscache.h>
+#include <utils/timestamp.h>
+
+#include "hypertable_restrict.h"
+#include "catalog.h"
+#include "chunk.h"
+#include "chunk_slice_index.h"
+#include "dimension.h"
+#include "dimension_slice.h"
+#include "hypercube.h"
+#include "partitioning.h"
+#include "utils.h"
+
+/*
+ * Restrictions of a query on the dimensions of a hypertable.
+ *
+ * Comparisons between dimension columns and constants are turned into ranges
+ * of coordinates in each dimension, which can then be matched directly
+ * against the dimension slices of chunks. This is much cheaper than proving
+ * that a chunk's constraints refute the query's restrictions.
+ */
+
+/*
+ * Create an (unrestricted) restriction on the hypertable with the given range
+ * table index.
+ */
+HypertableRestrict *
+hypertable_restrict_create(Index rti, Hyperspace *space)
+{
+	HypertableRestrict *hr = palloc0(sizeof(HypertableRestrict) +
+									 sizeof(DimensionRestrict) * space->num_dimensions);
+	int			i;
+
+	hr->rti = rti;
+	hr->space = space;
+
+	for (i = 0; i < space->num_dimensions; i++)
+	{
+		hr->dimensions[i].range_start = DIMENSION_SLICE_MINVALUE;
+		hr->dimensions[i].range_end = DIMENSION_SLICE_MAXVALUE;
+	}
+
+	return hr;
+}
+
+static void
+dimension_restrict_update(DimensionRestrict *dr, StrategyNumber strategy, int64 value)
+{
+	int64		range_start = DIMENSION_SLICE_MINVALUE;
+	int64		range_end = DIMENSION_SLICE_MAXVALUE;
+
+	value = REMAP_LAST_COORDINATE(value);
+
+	switch (strategy)
+	{
+		case BTLessStrategyNumber:
+			range_end = value;
+			break;
+		case BTLessEqualStrategyNumber:
+			range_end = value + 1;
+			break;
+		case BTEqualStrategyNumber:
+			range_start = value;
+			range_end = value + 1;
+			break;
+		case BTGreaterEqualStrategyNumber:
+			range_start = value;
+			break;
+		case BTGreaterStrategyNumber:
+			range_start = value + 1;
+			break;
+		default:
+			return;
+	}
+
+	dr->restricted = true;
+	dr->range_start = Max(dr->range_start, range_start);
+	dr->range_end = Min(dr->range_end, range_end);
+}
+
+/*
+ * Convert a constant to the internal time representation of a column of the
+ * given type. Only constants of the column's type are supported, except for
+ * integers where any integer type is accepted. Infinite values cannot be
+ * converted.
+ */
+bool
+hypertable_restrict_const_to_internal(Oid column_type, Const *c, int64 *value)
+{
+	switch (column_type)
+	{
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+			if (c->consttype != INT2OID && c->consttype != INT4OID && c->consttype != INT8OID)
+				return false;
+			break;
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			if (c->consttype != column_type ||
+				TIMESTAMP_NOT_FINITE(DatumGetTimestamp(c->constvalue)))
+				return false;
+			break;
+		case DATEOID:
+			if (c->consttype != DATEOID ||
+				DATE_NOT_FINITE(DatumGetDateADT(c->constvalue)))
+				return false;
+			break;
+		default:
+			return false;
+	}
+
+	*value = time_value_to_internal(c->constvalue, c->consttype);
+
+	return true;
+}
+
+/*
+ * Get the btree strategy of an operator in the default operator family of the
+ * given column type.
+ */
+StrategyNumber
+hypertable_restrict_operator_strategy(Oid column_type, Oid opno)
+{
+	Oid			opclass = GetDefaultOpClass(column_type, BTREE_AM_OID);
+
+	if (!OidIsValid(opclass))
+		return InvalidStrategy;
+
+	return get_op_opfamily_strategy(opno, get_opclass_family(opclass));
+}
+
+/*
+ * Split a binary operator expression into a Var and a Const. The operator is
+ * commuted if the Const is on the left, so that the returned operator always
+ * has the Var on the left.
+ */
+bool
+hypertable_restrict_get_var_const(OpExpr *op, Var **var, Const **c, Oid *opno)
+{
+	Node	   *left,
+			   *right;
+
+	if (list_length(op->args) != 2)
+		return false;
+
+	left = linitial(op->args);
+	right = lsecond(op->args);
+
+	if (IsA(left, RelabelType))
+		left = (Node *) ((RelabelType *) left)->arg;
+
+	if (IsA(right, RelabelType))
+		right = (Node *) ((RelabelType *) right)->arg;
+
+	if (IsA(left, Var) && IsA(right, Const))
+	{
+		*var = (Var *) left;
+		*c = (Const *) right;
+		*opno = op->opno;
+	}
+	else if (IsA(left, Const) && IsA(right, Var))
+	{
+		*var = (Var *) right;
+		*c = (Const *) left;
+		*opno = get_commutator(op->opno);
+
+		if (!OidIsValid(*opno))
+			return false;
+	}
+	else
+		return false;
+
+	return true;
+}
+
+static bool
+hypertable_restrict_add_opexpr(HypertableRestrict *hr, OpExpr *op)
+{
+	Var		   *var;
+	Const	   *c;
+	Oid			opno;
+	bool		added = false;
+	int			i;
+
+	if (!hypertable_restrict_get_var_const(op, &var, &c, &opno))
+		return false;
+
+	if (var->varno != hr->rti || var->varlevelsup != 0 || c->constisnull)
+		return false;
+
+	for (i = 0; i < hr->space->num_dimensions; i++)
+	{
+		Dimension  *dim = &hr->space->dimensions[i];
+		StrategyNumber strategy;
+		int64		value;
+
+		if (dim->column_attno != var->varattno)
+			continue;
+
+		strategy = hypertable_restrict_operator_strategy(dim->fd.column_type, opno);
+
+		if (strategy == InvalidStrategy)
+			continue;
+
+		if (IS_OPEN_DIMENSION(dim))
+		{
+			if (!hypertable_restrict_const_to_internal(dim->fd.column_type, c, &value))
+				continue;
+		}
+		else
+		{
+			/* Only equality maps to a range of hash values */
+			if (strategy != BTEqualStrategyNumber ||
+				!IsBinaryCoercible(c->consttype, dim->fd.column_type))
+				continue;
+
+			value = partitioning_func_apply(dim->partitioning, c->constvalue);
+		}
+
+		dimension_restrict_update(&hr->dimensions[i], strategy, value);
+		hr->restricted = true;
+		added = true;
+	}
+
+	return added;
+}
+
+/*
+ * Get the time_bucket() call and the Const of a comparison between the two,
+ * e.g., "time_bucket('1 hour', time) >= c". The operator is commuted if the
+ * Const is on the left. Only our own time_bucket() qualifies, not a function
+ * of the same name in another schema.
+ */
+static bool
+hypertable_restrict_get_time_bucket_const(OpExpr *op, FuncExpr **bucket, Const **c, Oid *opno)
+{
+	Node	   *left,
+			   *right;
+	char	   *func_name;
+
+	if (list_length(op->args) != 2)
+		return false;
+
+	left = linitial(op->args);
+	right = lsecond(op->args);
+
+	if (IsA(left, FuncExpr) && IsA(right, Const))
+	{
+		*bucket = (FuncExpr *) left;
+		*c = (Const *) right;
+		*opno = op->opno;
+	}
+	else if (IsA(left, Const) && IsA(right, FuncExpr))
+	{
+		*bucket = (FuncExpr *) right;
+		*c = (Const *) left;
+		*opno = get_commutator(op->opno);
+
+		if (!OidIsValid(*opno))
+			return false;
+	}
+	else
+		return false;
+
+	if (list_length((*bucket)->args) != 2)
+		return false;
+
+	if (get_func_namespace((*bucket)->funcid) != catalog_get()->extension_schema_id)
+		return false;
+
+	func_name = get_func_name((*bucket)->funcid);
+
+	return NULL != func_name && strncmp(func_name, "time_bucket", NAMEDATALEN) == 0;
+}
+
+/*
+ * Add a comparison between time_bucket() on an open dimension column and a
+ * constant, which is common in queries on continuous aggregates. A bucket
+ * starts at or before the values it holds and ends one bucket width later,
+ * so
+ *
+ *	 time_bucket(w, time) >= c  =>  time >= c
+ *	 time_bucket(w, time) <= c  =>  time < c + w
+ *
+ * The restriction on the column is wider than the qual, so the qual is never
+ * fully represented by the restriction.
+ */
+static void
+hypertable_restrict_add_time_bucket(HypertableRestrict *hr, OpExpr *op)
+{
+	FuncExpr   *bucket;
+	Const	   *c;
+	Const	   *width;
+	Var		   *var;
+	Interval   *interval;
+	Oid			opno;
+	int64		period;
+	int			i;
+
+	if (!hypertable_restrict_get_time_bucket_const(op, &bucket, &c, &opno))
+		return;
+
+	width = linitial(bucket->args);
+	var = lsecond(bucket->args);
+
+	if (!IsA(width, Const) || width->constisnull || width->consttype != INTERVALOID ||
+		!IsA(var, Var) || var->varno != hr->rti || var->varlevelsup != 0 ||
+		var->vartype != bucket->funcresulttype || c->constisnull)
+		return;
+
+	interval = DatumGetIntervalP(width->constvalue);
+
+	if (interval->month != 0)
+		return;
+
+	period = get_interval_period(interval);
+
+#ifndef HAVE_INT64_TIMESTAMP
+	/* Internal time values are in microseconds */
+	period *= USECS_PER_SEC;
+#endif
+
+	if (period <= 0)
+		return;
+
+	for (i = 0; i < hr->space->num_dimensions; i++)
+	{
+		Dimension  *dim = &hr->space->dimensions[i];
+		StrategyNumber strategy;
+		int64		value;
+
+		if (dim->column_attno != var->varattno || !IS_OPEN_DIMENSION(dim))
+			continue;
+
+		strategy = hypertable_restrict_operator_strategy(dim->fd.column_type, opno);
+
+		if (strategy == InvalidStrategy ||
+			!hypertable_restrict_const_to_internal(dim->fd.column_type, c, &value))
+			continue;
+
+		switch (strategy)
+		{
+			case BTGreaterStrategyNumber:
+			case BTGreaterEqualStrategyNumber:
+				dimension_restrict_update(&hr->dimensions[i], strategy, value);
+				break;
+			case BTEqualStrategyNumber:
+				dimension_restrict_update(&hr->dimensions[i], BTGreaterEqualStrategyNumber, value);
+				/* FALLTHROUGH */
+			case BTLessStrategyNumber:
+			case BTLessEqualStrategyNumber:
+				if (value > PG_INT64_MAX - period)
+					break;
+				dimension_restrict_update(&hr->dimensions[i], BTLessStrategyNumber, value + period);
+				break;
+			default:
+				break;
+		}
+
+		if (hr->dimensions[i].restricted)
+			hr->restricted = true;
+	}
+}
+
+/*
+ * Add a qual (or an implicitly AND'ed list of quals) to the restriction.
+ *
+ * Returns true if the qual is fully represented by the restriction, i.e.,
+ * every row that fulfills the qual is within the restriction, so chunks
+ * outside of it cannot contain matching rows and need not be checked against
+ * the qual. The converse does not hold: rows within the restriction need not
+ * fulfill the qual, e.g., the partition of a closed dimension that an
+ * equality qual hashes to also holds rows with other values. Quals that are
+ * not comparisons between a dimension column and a constant are ignored.
+ */
+bool
+hypertable_restrict_add_qual(HypertableRestrict *hr, Node *qual)
+{
+	ListCell   *lc;
+	bool		added = true;
+
+	if (NULL == qual)
+		return false;
+
+	if (IsA(qual, List))
+	{
+		foreach(lc, (List *) qual)
+			added = hypertable_restrict_add_qual(hr, lfirst(lc)) && added;
+	}
+	else if (and_clause(qual))
+	{
+		foreach(lc, ((BoolExpr *) qual)->args)
+			added = hypertable_restrict_add_qual(hr, lfirst(lc)) && added;
+	}
+	else if (IsA(qual, OpExpr))
+	{
+		added = hypertable_restrict_add_opexpr(hr, (OpExpr *) qual);
+
+		if (!added)
+			hypertable_restrict_add_time_bucket(hr, (OpExpr *) qual);
+	}
+	else
+		added = false;
+
+	return added;
+}
+
+/*
+ * Check if a chunk's slices overlap the restricted ranges of all dimensions.
+ */
+bool
+hypertable_restrict_match_chunk(HypertableRestrict *hr, Chunk *chunk)
+{
+	int			i;
+
+	for (i = 0; i < hr->space->num_dimensions; i++)
+	{
+		DimensionRestrict *dr = &hr->dimensions[i];
+		DimensionSlice *slice = chunk->cube->slices[i];
+
+		if (dr->restricted &&
+			(slice->fd.range_start >= dr->range_end ||
+			 slice->fd.range_end <= dr->range_start))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Get the chunks that match the restrictions.
+ *
+ * Candidates are found via the index of the first restricted dimension and
+ * then matched against the restrictions on the other dimensions.
+ */
+List *
+hypertable_restrict_get_chunk_relids(HypertableRestrict *hr, ChunkSliceIndex *index)
+{
+	List	   *relids = NIL;
+	List	   *chunks;
+	ListCell   *lc;
+	int			i;
+
+	for (i = 0; i < hr->space->num_dimensions; i++)
+		if (hr->dimensions[i].restricted)
+			break;
+
+	Assert(i < hr->space->num_dimensions);
+
+	chunks = chunk_slice_index_find_range(index, i,
+										  hr->dimensions[i].range_start,
+										  hr->dimensions[i].range_end);
+
+	foreach(lc, chunks)
+	{
+		Chunk	   *chunk = lfirst(lc);
+
+		if (hypertable_restrict_match_chunk(hr, chunk))
+			relids = lappend_oid(relids, chunk->table_id);
+	}
+
+	return relids;
+}
@@ -0,0 +1,41 @@
+#ifndef TIMESCALEDB_HYPERTABLE_RESTRICT_H
+#define TIMESCALEDB_HYPERTABLE_RESTRICT_H
+
+#include <postgres.h>
+#include <access/stratnum.h>
+#include <nodes/pg_list.h>
+#include <nodes/primnodes.h>
+
+#include "dimension.h"
+
+typedef struct Chunk Chunk;
+typedef struct ChunkSliceIndex ChunkSliceIndex;
+
+/*
+ * The range of coordinates that a query restricts a dimension to:
+ * [range_start, range_end).
+ */
+typedef struct DimensionRestrict
+{
+	bool		restricted;
+	int64		range_start;
+	int64		range_end;
+} DimensionRestrict;
+
+typedef struct HypertableRestrict
+{
+	Index		rti;
+	Hyperspace *space;
+	bool		restricted;
+	DimensionRestrict dimensions[FLEXIBLE_ARRAY_MEMBER];
+} HypertableRestrict;
+
+extern HypertableRestrict *hypertable_restrict_create(Index rti, Hyperspace *space);
+extern bool hypertable_restrict_add_qual(HypertableRestrict *hr, Node *qual);
+extern bool hypertable_restrict_match_chunk(HypertableRestrict *hr, Chunk *chunk);
+extern List *hypertable_restrict_get_chunk_relids(HypertableRestrict *hr, ChunkSliceIndex *index);
+extern bool hypertable_restrict_const_to_internal(Oid column_type, Const *c, int64 *value);
+extern StrategyNumber hypertable_restrict_operator_strategy(Oid column_type, Oid opno);
+extern bool hypertable_restrict_get_var_const(OpExpr *op, Var **var, Const **c, Oid *opno);
+
+#endif   /* TIMESCALEDB_HYPERTABLE_RESTRICT_H */
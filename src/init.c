@@ -5,6 +5,7 @@
 #include <miscadmin.h>
 #include <utils/guc.h>
 
+#include "bgw_scheduler.h"
 #include "executor.h"
 #include "guc.h"
 
@@ -16,6 +17,9 @@ PG_MODULE_MAGIC;
 extern void _chunk_dispatch_info_init(void);
 extern void _chunk_dispatch_info_fini(void);
 
+extern void _constraint_aware_append_init(void);
+extern void _constraint_aware_append_fini(void);
+
 extern void _hypertable_cache_init(void);
 extern void _hypertable_cache_fini(void);
 
@@ -70,6 +74,7 @@ _PG_init(void)
 	}
 	elog(INFO, "timescaledb loaded");
 	_chunk_dispatch_info_init();
+	_constraint_aware_append_init();
 	_cache_init();
 	_hypertable_cache_init();
 	_cache_invalidate_init();
@@ -79,6 +84,7 @@ _PG_init(void)
 	_process_utility_init();
 	_parse_analyze_init();
 	_guc_init();
+	_bgw_scheduler_init();
 }
 
 void
@@ -88,6 +94,7 @@ _PG_fini(void)
 	 * Order of items should be strict reverse order of _PG_init. Please
 	 * document any exceptions.
 	 */
+	_bgw_scheduler_fini();
 	_guc_fini();
 	_parse_analyze_fini();
 	_process_utility_fini();
@@ -97,5 +104,6 @@ _PG_fini(void)
 	_cache_invalidate_fini();
 	_hypertable_cache_fini();
 	_cache_fini();
+	_constraint_aware_append_fini();
 	_chunk_dispatch_info_fini();
 }
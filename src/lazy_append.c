@@ -0,0 +1,126 @@
+#include <postgres.h>
+#include <executor/executor.h>
+
+#include "lazy_append.h"
+#include "guc.h"
+
+/*
+ * Lazy initialization of the children of an Append.
+ *
+ * ExecInitNode() on an Append initializes all its children up front, which
+ * opens every chunk and its indexes and sets up the scans. A query that stops
+ * early, e.g., due to a LIMIT, might only read from the first chunk. By
+ * initializing children on first use, the startup cost is proportional to the
+ * number of chunks actually read.
+ */
+
+/*
+ * Check if children can be initialized lazily for the given executor
+ * state. EXPLAIN without ANALYZE needs all children to show them, backward
+ * scans would need all children to start from the end, and row marks
+ * (SELECT FOR UPDATE) require EvalPlanQual to be able to reach all
+ * children.
+ */
+bool
+lazy_append_enabled(EState *estate, int eflags)
+{
+	return guc_lazy_chunk_init &&
+		(eflags & (EXEC_FLAG_EXPLAIN_ONLY | EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)) == 0 &&
+		estate->es_rowMarks == NIL;
+}
+
+LazyAppend *
+lazy_append_create(List *plans, EState *estate, int eflags)
+{
+	LazyAppend *la = palloc0(sizeof(LazyAppend));
+	ListCell   *lc;
+	int			i = 0;
+
+	la->estate = estate;
+	la->eflags = eflags;
+	la->num_plans = list_length(plans);
+	la->plans = palloc(sizeof(Plan *) * la->num_plans);
+	la->states = palloc0(sizeof(PlanState *) * la->num_plans);
+	la->active = palloc(sizeof(int) * la->num_plans);
+	la->num_active = la->num_plans;
+
+	foreach(lc, plans)
+	{
+		la->plans[i] = lfirst(lc);
+		la->active[i] = i;
+		i++;
+	}
+
+	return la;
+}
+
+/*
+ * Get the next tuple, moving on to the next active child when the current
+ * one is exhausted. Children that get initialized are appended to the given
+ * list, so that they show up in EXPLAIN ANALYZE.
+ */
+TupleTableSlot *
+lazy_append_exec(LazyAppend *la, List **initialized)
+{
+	while (la->current < la->num_active)
+	{
+		int			i = la->active[la->current];
+		TupleTableSlot *slot;
+
+		if (NULL == la->states[i])
+		{
+			MemoryContext old = MemoryContextSwitchTo(la->estate->es_query_cxt);
+
+			la->states[i] = ExecInitNode(la->plans[i], la->estate, la->eflags);
+			*initialized = lappend(*initialized, la->states[i]);
+			MemoryContextSwitchTo(old);
+		}
+
+		slot = ExecProcNode(la->states[i]);
+
+		if (!TupIsNull(slot))
+			return slot;
+
+		la->current++;
+	}
+
+	return NULL;
+}
+
+/*
+ * Restart the scan from the first active child. Children that were
+ * initialized are rescanned in the same way as ExecReScanAppend() does it,
+ * i.e., children affected by changed parameters are rescanned on their next
+ * execution.
+ */
+void
+lazy_append_rescan(LazyAppend *la, Bitmapset *chgParam)
+{
+	int			i;
+
+	for (i = 0; i < la->num_plans; i++)
+	{
+		PlanState  *ps = la->states[i];
+
+		if (NULL == ps)
+			continue;
+
+		if (chgParam != NULL)
+			UpdateChangedParamSet(ps, chgParam);
+
+		if (ps->chgParam == NULL)
+			ExecReScan(ps);
+	}
+
+	la->current = 0;
+}
+
+void
+lazy_append_end(LazyAppend *la)
+{
+	int			i;
+
+	for (i = 0; i < la->num_plans; i++)
+		if (NULL != la->states[i])
+			ExecEndNode(la->states[i]);
+}
@@ -0,0 +1,33 @@
+#ifndef TIMESCALEDB_LAZY_APPEND_H
+#define TIMESCALEDB_LAZY_APPEND_H
+
+#include <postgres.h>
+#include <nodes/execnodes.h>
+
+/*
+ * LazyAppend scans the children of an Append one after the other, like the
+ * Append node does, but initializes each child only when execution first
+ * reaches it.
+ */
+typedef struct LazyAppend
+{
+	EState	   *estate;
+	int			eflags;
+	int			num_plans;
+	Plan	  **plans;
+	/* Child states, NULL until the child is initialized */
+	PlanState **states;
+	/* Indexes of the children to scan, in scan order */
+	int		   *active;
+	int			num_active;
+	/* Position in the active array of the child currently scanned */
+	int			current;
+} LazyAppend;
+
+extern bool lazy_append_enabled(EState *estate, int eflags);
+extern LazyAppend *lazy_append_create(List *plans, EState *estate, int eflags);
+extern TupleTableSlot *lazy_append_exec(LazyAppend *la, List **initialized);
+extern void lazy_append_rescan(LazyAppend *la, Bitmapset *chgParam);
+extern void lazy_append_end(LazyAppend *la);
+
+#endif   /* TIMESCALEDB_LAZY_APPEND_H */
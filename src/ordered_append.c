@@ -0,0 +1,374 @@
+#include <postgres.h>
+#include <access/stratnum.h>
+#include <catalog/pg_am.h>
+#include <commands/defrem.h>
+#include <executor/executor.h>
+#include <nodes/extensible.h>
+#include <nodes/plannodes.h>
+#include <optimizer/pathnode.h>
+#include <optimizer/paths.h>
+#include <utils/lsyscache.h>
+
+#include "ordered_append.h"
+#include "chunk.h"
+#include "chunk_slice_index.h"
+#include "dimension.h"
+#include "dimension_slice.h"
+#include "hypercube.h"
+#include "hypertable.h"
+#include "lazy_append.h"
+#include "compat.h"
+
+/*
+ * Ordered append of the chunks of a hypertable.
+ *
+ * For queries that order by the time dimension, PostgreSQL merges the sorted
+ * output of all chunks with a MergeAppend, which needs to fetch a tuple from
+ * every chunk before it can return the first one. When a hypertable is only
+ * partitioned on time, chunks do not overlap in time, so the same order can
+ * be produced by scanning the sorted chunks one after the other in the order
+ * of their time slices. A LIMIT above the scan then stops the scan as soon as
+ * it has enough tuples, without touching the remaining chunks.
+ *
+ * The plan is a CustomScan on top of a regular Append node with the chunk
+ * scans in slice order. The CustomScan carries the sort order, which a plain
+ * Append cannot.
+ */
+
+typedef struct OrderedAppendChild
+{
+	Path	   *path;
+	int64		range_start;
+} OrderedAppendChild;
+
+static int
+child_cmp_asc(const void *left, const void *right)
+{
+	const OrderedAppendChild *lc = left;
+	const OrderedAppendChild *rc = right;
+
+	if (lc->range_start < rc->range_start)
+		return -1;
+
+	if (lc->range_start > rc->range_start)
+		return 1;
+
+	return 0;
+}
+
+static int
+child_cmp_desc(const void *left, const void *right)
+{
+	return child_cmp_asc(right, left);
+}
+
+/*
+ * Check if a path key orders by the given dimension's column, in the column
+ * type's default btree order.
+ */
+static bool
+pathkey_is_dimension(PathKey *pk, Index relid, Dimension *dim)
+{
+	Oid			opclass = GetDefaultOpClass(dim->fd.column_type, BTREE_AM_OID);
+	ListCell   *lc;
+
+	if (!OidIsValid(opclass) || get_opclass_family(opclass) != pk->pk_opfamily)
+		return false;
+
+	foreach(lc, pk->pk_eclass->ec_members)
+	{
+		EquivalenceMember *em = lfirst(lc);
+		Expr	   *expr = em->em_expr;
+
+		while (IsA(expr, RelabelType))
+			expr = ((RelabelType *) expr)->arg;
+
+		if (IsA(expr, Var) &&
+			((Var *) expr)->varno == relid &&
+			((Var *) expr)->varlevelsup == 0 &&
+			((Var *) expr)->varattno == dim->column_attno)
+			return true;
+	}
+
+	return false;
+}
+
+static CustomScanMethods ordered_append_plan_methods;
+static CustomPathMethods ordered_append_path_methods;
+
+/*
+ * Create an ordered append path from a MergeAppend path over the chunks of a
+ * hypertable.
+ *
+ * Returns NULL if the MergeAppend's order does not start with the time
+ * dimension, if the hypertable has more than one dimension, or if any chunk
+ * cannot produce sorted output by itself.
+ */
+Path *
+ordered_append_path_create(PlannerInfo *root, RelOptInfo *rel, Hypertable *ht, MergeAppendPath *merge)
+{
+	CustomPath *path;
+	Dimension  *dim;
+	ChunkSliceIndex *index;
+	OrderedAppendChild *children;
+	PathKey    *pk;
+	List	   *subpaths = NIL;
+	int			num_children = 0;
+	ListCell   *lc;
+	int			i;
+
+	if (ht->space->num_dimensions != 1 || merge->path.pathkeys == NIL)
+		return NULL;
+
+	dim = &ht->space->dimensions[0];
+	pk = linitial(merge->path.pathkeys);
+
+	if (!IS_OPEN_DIMENSION(dim) || !pathkey_is_dimension(pk, rel->relid, dim))
+		return NULL;
+
+	index = hypertable_get_slice_index(ht);
+	children = palloc(sizeof(OrderedAppendChild) * list_length(merge->subpaths));
+
+	foreach(lc, merge->subpaths)
+	{
+		Path	   *subpath = lfirst(lc);
+		Oid			relid = root->simple_rte_array[subpath->parent->relid]->relid;
+		Chunk	   *chunk;
+
+		/* The main table cannot contain any tuples */
+		if (relid == ht->main_table_relid)
+			continue;
+
+		if (!pathkeys_contained_in(merge->path.pathkeys, subpath->pathkeys))
+			return NULL;
+
+		chunk = chunk_slice_index_get_by_relid(index, relid);
+
+		if (NULL == chunk)
+			return NULL;
+
+		children[num_children].path = subpath;
+		children[num_children].range_start = chunk->cube->slices[0]->fd.range_start;
+		num_children++;
+	}
+
+	if (num_children == 0)
+		return NULL;
+
+	qsort(children, num_children, sizeof(OrderedAppendChild),
+		  pk->pk_strategy == BTLessStrategyNumber ? child_cmp_asc : child_cmp_desc);
+
+	path = (CustomPath *) newNode(sizeof(CustomPath), T_CustomPath);
+	path->path.pathtype = T_CustomScan;
+	path->path.parent = rel;
+	path->path.pathtarget = merge->path.pathtarget;
+	path->path.param_info = merge->path.param_info;
+	path->path.pathkeys = merge->path.pathkeys;
+	path->path.rows = 0;
+	path->path.startup_cost = children[0].path->startup_cost;
+	path->path.total_cost = 0;
+
+	/* Cost like an Append, which does no work of its own */
+	for (i = 0; i < num_children; i++)
+	{
+		subpaths = lappend(subpaths, children[i].path);
+		path->path.rows += children[i].path->rows;
+		path->path.total_cost += children[i].path->total_cost;
+	}
+
+	path->flags = 0;
+	path->custom_paths = subpaths;
+	path->methods = &ordered_append_path_methods;
+
+	return &path->path;
+}
+
+typedef struct OrderedAppendState
+{
+	CustomScanState csstate;
+	/* Set if the Append's children are initialized on demand */
+	LazyAppend *lazy;
+} OrderedAppendState;
+
+static void
+ordered_append_begin(CustomScanState *node, EState *estate, int eflags)
+{
+	OrderedAppendState *state = (OrderedAppendState *) node;
+	CustomScan *cscan = (CustomScan *) node->ss.ps.plan;
+	Plan	   *append = linitial(cscan->custom_plans);
+
+	/*
+	 * Since chunks are scanned one after the other, there is no need to
+	 * initialize a chunk's scan before the previous chunks are exhausted.
+	 */
+	if (IsA(append, Append) && lazy_append_enabled(estate, eflags))
+		state->lazy = lazy_append_create(((Append *) append)->appendplans, estate, eflags);
+	else
+		node->custom_ps = list_make1(ExecInitNode(append, estate, eflags));
+}
+
+static TupleTableSlot *
+ordered_append_exec(CustomScanState *node)
+{
+	OrderedAppendState *state = (OrderedAppendState *) node;
+	TupleTableSlot *subslot;
+	ExprContext *econtext = node->ss.ps.ps_ExprContext;
+#if PG96
+	TupleTableSlot *resultslot;
+	ExprDoneCond isDone;
+
+	if (node->ss.ps.ps_TupFromTlist)
+	{
+		resultslot = ExecProject(node->ss.ps.ps_ProjInfo, &isDone);
+
+		if (isDone == ExprMultipleResult)
+			return resultslot;
+
+		node->ss.ps.ps_TupFromTlist = false;
+	}
+#endif
+
+	ResetExprContext(econtext);
+
+	while (true)
+	{
+		if (NULL != state->lazy)
+			subslot = lazy_append_exec(state->lazy, &node->custom_ps);
+		else
+			subslot = ExecProcNode(linitial(node->custom_ps));
+
+		if (TupIsNull(subslot))
+			return NULL;
+
+		if (!node->ss.ps.ps_ProjInfo)
+			return subslot;
+
+		econtext->ecxt_scantuple = subslot;
+
+#if PG10
+		return ExecProject(node->ss.ps.ps_ProjInfo);
+#elif PG96
+		resultslot = ExecProject(node->ss.ps.ps_ProjInfo, &isDone);
+
+		if (isDone != ExprEndResult)
+		{
+			node->ss.ps.ps_TupFromTlist = (isDone == ExprMultipleResult);
+			return resultslot;
+		}
+#endif
+	}
+}
+
+static void
+ordered_append_end(CustomScanState *node)
+{
+	OrderedAppendState *state = (OrderedAppendState *) node;
+
+	if (NULL != state->lazy)
+		lazy_append_end(state->lazy);
+	else
+		ExecEndNode(linitial(node->custom_ps));
+}
+
+static void
+ordered_append_rescan(CustomScanState *node)
+{
+	OrderedAppendState *state = (OrderedAppendState *) node;
+
+#if PG96
+	node->ss.ps.ps_TupFromTlist = false;
+#endif
+
+	if (NULL != state->lazy)
+	{
+		lazy_append_rescan(state->lazy, node->ss.ps.chgParam);
+		return;
+	}
+
+	if (node->ss.ps.chgParam != NULL)
+		UpdateChangedParamSet(linitial(node->custom_ps), node->ss.ps.chgParam);
+
+	ExecReScan(linitial(node->custom_ps));
+}
+
+static CustomExecMethods ordered_append_state_methods = {
+	.CustomName = "OrderedAppend",
+	.BeginCustomScan = ordered_append_begin,
+	.ExecCustomScan = ordered_append_exec,
+	.EndCustomScan = ordered_append_end,
+	.ReScanCustomScan = ordered_append_rescan,
+};
+
+static Node *
+ordered_append_state_create(CustomScan *cscan)
+{
+	OrderedAppendState *state = (OrderedAppendState *) newNode(sizeof(OrderedAppendState), T_CustomScanState);
+
+	state->csstate.methods = &ordered_append_state_methods;
+
+	return (Node *) state;
+}
+
+static CustomScanMethods ordered_append_plan_methods = {
+	.CustomName = "OrderedAppend",
+	.CreateCustomScanState = ordered_append_state_create,
+};
+
+/*
+ * Create the plan: a CustomScan with a plain Append of the sorted chunk scans
+ * as its only child. The restriction clauses are already enforced by the
+ * chunk scans.
+ */
+static Plan *
+ordered_append_plan_create(PlannerInfo *root,
+						   RelOptInfo *rel,
+						   CustomPath *path,
+						   List *tlist,
+						   List *clauses,
+						   List *custom_plans)
+{
+	CustomScan *cscan = makeNode(CustomScan);
+	Append	   *append = makeNode(Append);
+
+	append->plan.targetlist = tlist;
+	append->plan.startup_cost = path->path.startup_cost;
+	append->plan.total_cost = path->path.total_cost;
+	append->plan.plan_rows = path->path.rows;
+	append->plan.plan_width = path->path.pathtarget->width;
+	append->appendplans = custom_plans;
+
+	cscan->scan.scanrelid = 0;	/* Not a real relation we are scanning */
+	cscan->scan.plan.targetlist = tlist;
+	cscan->custom_plans = list_make1(append);
+	cscan->custom_scan_tlist = tlist;
+	cscan->flags = path->flags;
+	cscan->methods = &ordered_append_plan_methods;
+
+	return &cscan->scan.plan;
+}
+
+static CustomPathMethods ordered_append_path_methods = {
+	.CustomName = "OrderedAppend",
+	.PlanCustomPath = ordered_append_plan_create,
+};
+
+bool
+is_ordered_append_path(Path *path)
+{
+	return IsA(path, CustomPath) &&
+		((CustomPath *) path)->methods == &ordered_append_path_methods;
+}
+
+bool
+is_ordered_append_plan(Plan *plan)
+{
+	return IsA(plan, CustomScan) &&
+		((CustomScan *) plan)->methods == &ordered_append_plan_methods;
+}
+
+bool
+is_ordered_append_state(PlanState *ps)
+{
+	return IsA(ps, CustomScanState) &&
+		((CustomScanState *) ps)->methods == &ordered_append_state_methods;
+}
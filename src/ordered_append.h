@@ -0,0 +1,15 @@
+#ifndef TIMESCALEDB_ORDERED_APPEND_H
+#define TIMESCALEDB_ORDERED_APPEND_H
+
+#include <postgres.h>
+#include <nodes/relation.h>
+#include <nodes/extensible.h>
+
+typedef struct Hypertable Hypertable;
+
+extern Path *ordered_append_path_create(PlannerInfo *root, RelOptInfo *rel, Hypertable *ht, MergeAppendPath *merge);
+extern bool is_ordered_append_path(Path *path);
+extern bool is_ordered_append_plan(Plan *plan);
+extern bool is_ordered_append_state(PlanState *ps);
+
+#endif   /* TIMESCALEDB_ORDERED_APPEND_H */
@@ -0,0 +1,353 @@
+#include <postgres.h>
+#include <access/genam.h>
+#include <access/heapam.h>
+#include <access/htup_details.h>
+#include <catalog/pg_aggregate.h>
+#include <catalog/pg_am.h>
+#include <catalog/pg_index.h>
+#include <catalog/pg_type.h>
+#include <nodes/makefuncs.h>
+#include <nodes/nodeFuncs.h>
+#include <optimizer/clauses.h>
+#include <parser/parse_oper.h>
+#include <parser/parsetree.h>
+#include <rewrite/rewriteManip.h>
+#include <utils/lsyscache.h>
+#include <utils/rel.h>
+#include <utils/syscache.h>
+
+#include "plan_agg_bookend.h"
+#include "catalog.h"
+#include "dimension.h"
+#include "hypertable.h"
+#include "hypertable_cache.h"
+
+/*
+ * Rewrite of the first() and last() bookend aggregates into index scans.
+ *
+ * Computing first(value, time) or last(value, time) as an aggregate compares
+ * every qualifying row. When the comparison column is the time dimension of a
+ * hypertable, the same result is the value of the first row returned by
+ *
+ *	 SELECT value FROM hypertable WHERE ... ORDER BY time [DESC] LIMIT 1
+ *
+ * which the planner can answer with an ordered scan of the time index that
+ * stops at the first matching row. This is the same transformation that
+ * PostgreSQL applies to min() and max() in planagg.c, but since bookend
+ * aggregates take two arguments, we cannot reuse it. Instead, we rewrite the
+ * query before planning: each bookend aggregate is replaced by a scalar
+ * subquery of the above form, and the query itself no longer reads from the
+ * hypertable. Like for an aggregate without GROUP BY, the rewritten query
+ * returns a single row, with NULL values if there are no matching rows.
+ *
+ * The rewrite only pays off if the chunks can be scanned in time order.
+ * Otherwise, each subquery sorts all matching rows, which is more expensive
+ * than aggregating them once. Therefore, the query is only rewritten if the
+ * hypertable has a btree index on the time column, which all chunks inherit.
+ *
+ * Time dimension columns are NOT NULL, so the special treatment of NULL
+ * comparison values in the aggregates does not apply.
+ */
+
+typedef enum BookendKind
+{
+	BOOKEND_NONE,
+	BOOKEND_FIRST,
+	BOOKEND_LAST,
+} BookendKind;
+
+static BookendKind
+get_bookend_kind(Oid aggfnoid)
+{
+	HeapTuple	tuple;
+	Oid			transfn;
+	char	   *name;
+
+	tuple = SearchSysCache1(AGGFNOID, ObjectIdGetDatum(aggfnoid));
+
+	if (!HeapTupleIsValid(tuple))
+		return BOOKEND_NONE;
+
+	transfn = ((Form_pg_aggregate) GETSTRUCT(tuple))->aggtransfn;
+	ReleaseSysCache(tuple);
+
+	if (get_func_namespace(transfn) != catalog_get()->internal_schema_id)
+		return BOOKEND_NONE;
+
+	name = get_func_name(transfn);
+
+	if (strcmp(name, "first_sfunc") == 0)
+		return BOOKEND_FIRST;
+
+	if (strcmp(name, "last_sfunc") == 0)
+		return BOOKEND_LAST;
+
+	return BOOKEND_NONE;
+}
+
+/*
+ * Check if the hypertable has a (non-partial) btree index with the given
+ * column as its leading key.
+ */
+static bool
+hypertable_has_btree_index_on(Hypertable *ht, AttrNumber attno)
+{
+	Relation	rel = heap_open(ht->main_table_relid, AccessShareLock);
+	List	   *indexes = RelationGetIndexList(rel);
+	bool		found = false;
+	ListCell   *lc;
+
+	foreach(lc, indexes)
+	{
+		Relation	idxrel = index_open(lfirst_oid(lc), AccessShareLock);
+
+		found = idxrel->rd_rel->relam == BTREE_AM_OID &&
+			idxrel->rd_index->indkey.values[0] == attno &&
+			heap_attisnull(idxrel->rd_indextuple, Anum_pg_index_indpred);
+
+		index_close(idxrel, AccessShareLock);
+
+		if (found)
+			break;
+	}
+
+	list_free(indexes);
+	heap_close(rel, AccessShareLock);
+
+	return found;
+}
+
+/*
+ * Check that an aggregate is a plain first() or last() on the hypertable's
+ * time dimension, and that the time dimension is indexed.
+ */
+static bool
+bookend_is_rewritable(Aggref *aggref, Hypertable *ht)
+{
+	Expr	   *value;
+	Var		   *cmp;
+	Oid			ltopr,
+				eqopr,
+				gtopr;
+	bool		hashable;
+	int			i;
+
+	if (aggref->agglevelsup != 0 ||
+		aggref->aggorder != NIL ||
+		aggref->aggdistinct != NIL ||
+		aggref->aggfilter != NULL ||
+		list_length(aggref->args) != 2 ||
+		get_bookend_kind(aggref->aggfnoid) == BOOKEND_NONE)
+		return false;
+
+	value = ((TargetEntry *) linitial(aggref->args))->expr;
+	cmp = (Var *) ((TargetEntry *) lsecond(aggref->args))->expr;
+
+	if (!IsA(cmp, Var) || cmp->varno != 1 || cmp->varlevelsup != 0 ||
+		contain_volatile_functions((Node *) value))
+		return false;
+
+	get_sort_group_operators(cmp->vartype, false, false, false,
+							 &ltopr, &eqopr, &gtopr, &hashable);
+
+	if (!OidIsValid(ltopr) || !OidIsValid(eqopr) || !OidIsValid(gtopr))
+		return false;
+
+	for (i = 0; i < ht->space->num_dimensions; i++)
+	{
+		Dimension  *dim = &ht->space->dimensions[i];
+
+		if (IS_OPEN_DIMENSION(dim) && dim->column_attno == cmp->varattno)
+			return hypertable_has_btree_index_on(ht, cmp->varattno);
+	}
+
+	return false;
+}
+
+/*
+ * Returns true if the expression contains an aggregate that cannot be
+ * rewritten.
+ */
+static bool
+contains_non_rewritable_agg(Node *node, void *context)
+{
+	if (NULL == node)
+		return false;
+
+	if (IsA(node, Aggref))
+		return !bookend_is_rewritable((Aggref *) node, context);
+
+	return expression_tree_walker(node, contains_non_rewritable_agg, context);
+}
+
+/*
+ * Get the hypertable if the query is an aggregate over a single hypertable
+ * that only computes bookend aggregates that we can rewrite. Volatile quals
+ * are not supported, since each subquery would evaluate them separately and
+ * could see a different set of rows.
+ */
+static Hypertable *
+get_rewritable_hypertable(Query *parse, Cache *hcache)
+{
+	RangeTblEntry *rte;
+	RangeTblRef *rtr;
+	Hypertable *ht;
+
+	if (parse->commandType != CMD_SELECT ||
+		parse->utilityStmt != NULL ||
+		!parse->hasAggs ||
+		parse->hasWindowFuncs ||
+		parse->hasSubLinks ||
+		parse->hasForUpdate ||
+		parse->cteList != NIL ||
+		parse->groupClause != NIL ||
+		parse->groupingSets != NIL ||
+		parse->havingQual != NULL ||
+		parse->distinctClause != NIL ||
+		parse->sortClause != NIL ||
+		parse->setOperations != NULL ||
+		parse->rowMarks != NIL ||
+		list_length(parse->rtable) != 1 ||
+		list_length(parse->jointree->fromlist) != 1 ||
+		contain_volatile_functions((Node *) parse->jointree->quals))
+		return NULL;
+
+	rtr = linitial(parse->jointree->fromlist);
+
+	if (!IsA(rtr, RangeTblRef) || rtr->rtindex != 1)
+		return NULL;
+
+	rte = rt_fetch(1, parse->rtable);
+
+	if (rte->rtekind != RTE_RELATION || !rte->inh || rte->tablesample != NULL)
+		return NULL;
+
+	ht = hypertable_cache_get_entry(hcache, rte->relid);
+
+	if (NULL == ht ||
+		expression_returns_set((Node *) parse->targetList) ||
+		contains_non_rewritable_agg((Node *) parse->targetList, ht))
+		return NULL;
+
+	return ht;
+}
+
+/*
+ * Build the subquery that returns the bookend value:
+ *
+ *	 SELECT value FROM hypertable WHERE quals ORDER BY time [DESC] LIMIT 1
+ */
+static SubLink *
+make_bookend_sublink(Query *parse, Aggref *aggref)
+{
+	TargetEntry *value = linitial(aggref->args);
+	TargetEntry *cmp = lsecond(aggref->args);
+	Query	   *subquery = makeNode(Query);
+	SortGroupClause *sortcl = makeNode(SortGroupClause);
+	SubLink    *sublink = makeNode(SubLink);
+	TargetEntry *sort_tle;
+	Oid			ltopr,
+				eqopr,
+				gtopr;
+	bool		hashable;
+
+	get_sort_group_operators(exprType((Node *) cmp->expr), true, true, true,
+							 &ltopr, &eqopr, &gtopr, &hashable);
+
+	sort_tle = makeTargetEntry(copyObject(cmp->expr), 2, NULL, true);
+	sort_tle->ressortgroupref = 1;
+
+	sortcl->tleSortGroupRef = 1;
+	sortcl->eqop = eqopr;
+	sortcl->hashable = hashable;
+
+	if (get_bookend_kind(aggref->aggfnoid) == BOOKEND_FIRST)
+	{
+		sortcl->sortop = ltopr;
+		sortcl->nulls_first = false;
+	}
+	else
+	{
+		sortcl->sortop = gtopr;
+		sortcl->nulls_first = true;
+	}
+
+	subquery->commandType = CMD_SELECT;
+	subquery->querySource = QSRC_ORIGINAL;
+	subquery->canSetTag = true;
+	subquery->hasRowSecurity = parse->hasRowSecurity;
+	subquery->rtable = copyObject(parse->rtable);
+	subquery->jointree = copyObject(parse->jointree);
+	subquery->targetList = list_make2(makeTargetEntry(copyObject(value->expr), 1,
+													  get_func_name(aggref->aggfnoid),
+													  false),
+									  sort_tle);
+	subquery->sortClause = list_make1(sortcl);
+	subquery->limitCount = (Node *) makeConst(INT8OID, -1, InvalidOid, sizeof(int64),
+											  Int64GetDatum(1), false, FLOAT8PASSBYVAL);
+
+	/* The subquery is one level further down from any outer query */
+	IncrementVarSublevelsUp((Node *) subquery, 1, 1);
+
+	sublink->subLinkType = EXPR_SUBLINK;
+	sublink->subLinkId = 0;
+	sublink->testexpr = NULL;
+	sublink->operName = NIL;
+	sublink->subselect = (Node *) subquery;
+	sublink->location = aggref->location;
+
+	return sublink;
+}
+
+static Node *
+replace_bookends_mutator(Node *node, void *context)
+{
+	if (NULL == node)
+		return NULL;
+
+	if (IsA(node, Aggref))
+		return (Node *) make_bookend_sublink(context, (Aggref *) node);
+
+	return expression_tree_mutator(node, replace_bookends_mutator, context);
+}
+
+static void
+rewrite_bookends(Query *parse, Cache *hcache)
+{
+	if (NULL == get_rewritable_hypertable(parse, hcache))
+		return;
+
+	parse->targetList = (List *) replace_bookends_mutator((Node *) parse->targetList, parse);
+	parse->rtable = NIL;
+	parse->jointree = makeFromExpr(NIL, NULL);
+	parse->hasAggs = false;
+	parse->hasSubLinks = true;
+}
+
+static bool
+rewrite_query_walker(Node *node, void *context)
+{
+	if (NULL == node)
+		return false;
+
+	if (IsA(node, Query))
+	{
+		Query	   *query = (Query *) node;
+
+		rewrite_bookends(query, context);
+
+		return query_tree_walker(query, rewrite_query_walker, context, 0);
+	}
+
+	return expression_tree_walker(node, rewrite_query_walker, context);
+}
+
+/*
+ * Rewrite first() and last() aggregates on hypertables in a query, including
+ * its subqueries, into subqueries that can use a time index.
+ */
+void
+plan_agg_bookend_rewrite_query(Query *parse, Cache *hcache)
+{
+	rewrite_query_walker((Node *) parse, hcache);
+}
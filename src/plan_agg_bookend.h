@@ -0,0 +1,11 @@
+#ifndef TIMESCALEDB_PLAN_AGG_BOOKEND_H
+#define TIMESCALEDB_PLAN_AGG_BOOKEND_H
+
+#include <postgres.h>
+#include <nodes/parsenodes.h>
+
+typedef struct Cache Cache;
+
+extern void plan_agg_bookend_rewrite_query(Query *parse, Cache *hcache);
+
+#endif   /* TIMESCALEDB_PLAN_AGG_BOOKEND_H */
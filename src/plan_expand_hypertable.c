@@ -0,0 +1,313 @@
+#include <postgres.h>
+#include <access/heapam.h>
+#include <catalog/pg_class.h>
+#include <catalog/pg_inherits_fn.h>
+#include <nodes/makefuncs.h>
+#include <nodes/nodeFuncs.h>
+#include <optimizer/clauses.h>
+#include <optimizer/prep.h>
+#include <parser/parsetree.h>
+#include <storage/lmgr.h>
+#include <utils/builtins.h>
+#include <utils/lsyscache.h>
+#include <utils/rel.h>
+#include <utils/syscache.h>
+
+#include "plan_expand_hypertable.h"
+#include "planner_utils.h"
+#include "chunk.h"
+#include "chunk_slice_index.h"
+#include "hypertable.h"
+#include "hypertable_cache.h"
+#include "hypertable_restrict.h"
+#include "utils.h"
+
+/*
+ * Expansion of hypertables into their chunks at planning time.
+ *
+ * PostgreSQL expands an inheritance parent into all its children before the
+ * planner looks at any restrictions, opening and locking every child and
+ * building planner data structures for it. Children are then excluded one by
+ * one via constraint exclusion. For hypertables with many chunks, this
+ * dominates planning time even when a query touches only a few chunks.
+ *
+ * Instead, we prevent PostgreSQL from expanding hypertables by clearing the
+ * inheritance flag on hypertable range table entries before planning
+ * starts. The entries are marked so that we can recognize them when the
+ * planner asks for information about the relation (get_relation_info_hook),
+ * at which point we expand the hypertable ourselves. The chunks to include
+ * are found by matching the query's restrictions on dimension columns against
+ * the hypertable's chunk slice index, so that excluded chunks are never
+ * opened or locked.
+ */
+
+/* Marker set in the ctename field, which is otherwise unused for relations */
+#define EXPAND_HYPERTABLE_MARKER "timescaledb_expand_hypertable"
+
+static bool
+mark_query_walker(Node *node, void *context)
+{
+	Cache	   *hcache = context;
+
+	if (NULL == node)
+		return false;
+
+	if (IsA(node, RangeTblEntry))
+	{
+		RangeTblEntry *rte = (RangeTblEntry *) node;
+
+		if (rte->rtekind == RTE_RELATION &&
+			rte->relkind == RELKIND_RELATION &&
+			rte->inh &&
+			rte->securityQuals == NIL &&
+			NULL != hypertable_cache_get_entry(hcache, rte->relid))
+		{
+			rte->inh = false;
+			rte->ctename = EXPAND_HYPERTABLE_MARKER;
+		}
+
+		return false;
+	}
+
+	if (IsA(node, Query))
+	{
+		Query	   *query = (Query *) node;
+
+		/*
+		 * Queries with row marks require row marks on all children, which is
+		 * something that only the standard inheritance expansion deals
+		 * with. Note that UPDATE and DELETE add row marks for all relations
+		 * other than the result relation, including those in pulled up
+		 * subqueries, so we leave those queries alone entirely.
+		 */
+		if ((query->commandType != CMD_SELECT && query->commandType != CMD_INSERT) ||
+			query->rowMarks != NIL)
+			return false;
+
+		return query_tree_walker(query, mark_query_walker, context, QTW_EXAMINE_RTES);
+	}
+
+	return expression_tree_walker(node, mark_query_walker, context);
+}
+
+/*
+ * Mark all hypertables in a query (including subqueries) for expansion at
+ * planning time instead of standard inheritance expansion.
+ */
+void
+plan_expand_hypertable_mark_query(Query *parse, Cache *hcache)
+{
+	mark_query_walker((Node *) parse, hcache);
+}
+
+bool
+plan_expand_hypertable_is_marked(RangeTblEntry *rte)
+{
+	return rte->rtekind == RTE_RELATION &&
+		NULL != rte->ctename &&
+		strcmp(rte->ctename, EXPAND_HYPERTABLE_MARKER) == 0;
+}
+
+/*
+ * Collect restrictions from the query's join tree. At this point, the quals
+ * have been preprocessed, i.e., constants are folded and subqueries are
+ * pulled up. We only look at quals that must hold for every row produced from
+ * the hypertable, which rules out quals of outer and semi/anti joins.
+ */
+static void
+hypertable_restrict_add_jointree(HypertableRestrict *hr, Node *jtnode)
+{
+	if (NULL == jtnode)
+		return;
+
+	if (IsA(jtnode, FromExpr))
+	{
+		FromExpr   *f = (FromExpr *) jtnode;
+		ListCell   *lc;
+
+		foreach(lc, f->fromlist)
+			hypertable_restrict_add_jointree(hr, lfirst(lc));
+
+		hypertable_restrict_add_qual(hr, f->quals);
+	}
+	else if (IsA(jtnode, JoinExpr))
+	{
+		JoinExpr   *j = (JoinExpr *) jtnode;
+
+		hypertable_restrict_add_jointree(hr, j->larg);
+		hypertable_restrict_add_jointree(hr, j->rarg);
+
+		if (j->jointype == JOIN_INNER)
+			hypertable_restrict_add_qual(hr, j->quals);
+	}
+}
+
+/*
+ * Get the relids of the chunks to scan, sorted by relid in the same way as
+ * standard inheritance expansion orders children.
+ *
+ * If the hypertable is not restricted on any dimension, or not all chunks are
+ * in the slice index, we fall back to all children of the hypertable.
+ */
+static Oid *
+hypertable_get_chunk_relids(PlannerInfo *root, RelOptInfo *rel, Hypertable *ht, int *num_relids)
+{
+	HypertableRestrict *hr = NULL;
+	ChunkSliceIndex *index = NULL;
+	List	   *relids;
+	ListCell   *lc;
+	Oid		   *result;
+	int			i = 0;
+
+	if (NULL != ht)
+	{
+		hr = hypertable_restrict_create(rel->relid, ht->space);
+		hypertable_restrict_add_jointree(hr, (Node *) root->parse->jointree);
+
+		if (hr->restricted)
+			index = hypertable_get_slice_index(ht);
+	}
+
+	if (NULL != index && index->num_unindexed == 0)
+		relids = hypertable_restrict_get_chunk_relids(hr, index);
+	else
+		relids = find_inheritance_children(planner_rt_fetch(rel->relid, root)->relid, NoLock);
+
+	*num_relids = list_length(relids);
+	result = palloc(sizeof(Oid) * (*num_relids + 1));
+
+	foreach(lc, relids)
+		result[i++] = lfirst_oid(lc);
+
+	qsort(result, *num_relids, sizeof(Oid), oid_cmp);
+
+	return result;
+}
+
+/*
+ * Add a child relation (chunk) to the hypertable's append relation.
+ */
+static AppendRelInfo *
+expand_child(PlannerInfo *root, RangeTblEntry *rte, Index rti, Relation parent, Relation child)
+{
+	Query	   *parse = root->parse;
+	RangeTblEntry *childrte = copyObject(rte);
+	AppendRelInfo *appinfo = makeNode(AppendRelInfo);
+	Index		child_rti;
+
+	/*
+	 * Permissions are checked on the hypertable only, so the child requires
+	 * none.
+	 */
+	childrte->relid = RelationGetRelid(child);
+	childrte->relkind = child->rd_rel->relkind;
+	childrte->inh = false;
+	childrte->requiredPerms = 0;
+	parse->rtable = lappend(parse->rtable, childrte);
+	child_rti = list_length(parse->rtable);
+	root->simple_rte_array[child_rti] = childrte;
+	root->simple_rel_array[child_rti] = NULL;
+
+	appinfo->parent_relid = rti;
+	appinfo->child_relid = child_rti;
+	appinfo->parent_reltype = parent->rd_rel->reltype;
+	appinfo->child_reltype = child->rd_rel->reltype;
+	appinfo->translated_vars = make_translation_list(parent, child, child_rti);
+	appinfo->parent_reloid = RelationGetRelid(parent);
+
+	return appinfo;
+}
+
+/*
+ * Expand a hypertable that was marked for expansion into the chunks that
+ * match the query's restrictions.
+ *
+ * This is called from get_relation_info_hook, i.e., after the planner has
+ * built the RelOptInfo for the hypertable as a regular relation, but before
+ * it looks for children to build "other member" relations for. Like in
+ * standard inheritance expansion, the hypertable's main table is always
+ * included as the first child.
+ */
+void
+plan_expand_hypertable_chunks(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte, Hypertable *ht)
+{
+	Index		rti = rel->relid;
+	Relation	parent;
+	Oid		   *relids;
+	int			num_relids;
+	List	   *appinfos = NIL;
+	List	   *fkeys = NIL;
+	ListCell   *lc;
+	int			old_size = root->simple_rel_array_size;
+	int			i;
+
+	Assert(plan_expand_hypertable_is_marked(rte));
+
+	rte->ctename = NULL;
+	rte->inh = true;
+
+	if (NULL != get_plan_rowmark(root->rowMarks, rti))
+		elog(ERROR, "unexpected row mark on hypertable \"%s\"", get_rel_name(rte->relid));
+
+	relids = hypertable_get_chunk_relids(root, rel, ht, &num_relids);
+
+	/* The planner's arrays have been set up already, so make room */
+	root->simple_rel_array_size += num_relids + 1;
+	root->simple_rel_array = repalloc(root->simple_rel_array,
+									  sizeof(RelOptInfo *) * root->simple_rel_array_size);
+	root->simple_rte_array = repalloc(root->simple_rte_array,
+									  sizeof(RangeTblEntry *) * root->simple_rel_array_size);
+
+	for (i = old_size; i < root->simple_rel_array_size; i++)
+	{
+		root->simple_rel_array[i] = NULL;
+		root->simple_rte_array[i] = NULL;
+	}
+
+	parent = heap_open(rte->relid, NoLock);
+
+	appinfos = lappend(appinfos, expand_child(root, rte, rti, parent, parent));
+
+	for (i = 0; i < num_relids; i++)
+	{
+		Relation	child;
+
+		LockRelationOid(relids[i], AccessShareLock);
+
+		/* The chunk might have been dropped while we waited for the lock */
+		if (!SearchSysCacheExists1(RELOID, ObjectIdGetDatum(relids[i])))
+		{
+			UnlockRelationOid(relids[i], AccessShareLock);
+			continue;
+		}
+
+		child = heap_open(relids[i], NoLock);
+		appinfos = lappend(appinfos, expand_child(root, rte, rti, parent, child));
+		heap_close(child, NoLock);
+	}
+
+	heap_close(parent, NoLock);
+
+	root->append_rel_list = list_concat(root->append_rel_list, appinfos);
+
+	/*
+	 * The relation was set up as a regular relation, so make it look like an
+	 * inheritance parent to the rest of the planner: parents have no indexes,
+	 * their size is the sum of their children's, and their foreign keys are
+	 * ignored.
+	 */
+	rel->indexlist = NIL;
+	rel->pages = 0;
+	rel->tuples = 0;
+	rel->allvisfrac = 0;
+
+	foreach(lc, root->fkey_list)
+	{
+		ForeignKeyOptInfo *fkinfo = lfirst(lc);
+
+		if (fkinfo->con_relid != rti)
+			fkeys = lappend(fkeys, fkinfo);
+	}
+
+	root->fkey_list = fkeys;
+}
@@ -0,0 +1,15 @@
+#ifndef TIMESCALEDB_PLAN_EXPAND_HYPERTABLE_H
+#define TIMESCALEDB_PLAN_EXPAND_HYPERTABLE_H
+
+#include <postgres.h>
+#include <nodes/parsenodes.h>
+#include <nodes/relation.h>
+
+typedef struct Cache Cache;
+typedef struct Hypertable Hypertable;
+
+extern void plan_expand_hypertable_mark_query(Query *parse, Cache *hcache);
+extern bool plan_expand_hypertable_is_marked(RangeTblEntry *rte);
+extern void plan_expand_hypertable_chunks(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte, Hypertable *ht);
+
+#endif   /* TIMESCALEDB_PLAN_EXPAND_HYPERTABLE_H */
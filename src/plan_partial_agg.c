@@ -0,0 +1,303 @@
+#include <postgres.h>
+#include <nodes/makefuncs.h>
+#include <nodes/nodeFuncs.h>
+#include <optimizer/clauses.h>
+#include <optimizer/pathnode.h>
+#include <optimizer/planner.h>
+#include <optimizer/prep.h>
+#include <optimizer/tlist.h>
+#include <optimizer/var.h>
+#include <parser/parsetree.h>
+#include <utils/selfuncs.h>
+
+#include "plan_partial_agg.h"
+#include "hypertable_cache.h"
+#include "ordered_append.h"
+#include "compat.h"
+
+/*
+ * Chunk-wise partial aggregation.
+ *
+ * An aggregate over a hypertable is normally computed on top of the Append
+ * of all its chunks, which means that a single (hash) aggregate sees every
+ * row of the hypertable. Aggregates that support partial aggregation (i.e.,
+ * have a combine function and, for internal states, serialization functions)
+ * can instead be computed per chunk, with only the partial states passed up
+ * through the Append to be combined:
+ *
+ *	 Finalize HashAggregate
+ *	   ->  Append
+ *			 ->  Partial HashAggregate
+ *				   ->  Scan on chunk 1
+ *			 ->  Partial HashAggregate
+ *				   ->  Scan on chunk 2
+ *
+ * Since chunks are split on time, a GROUP BY on a time bucket has few groups
+ * per chunk, keeping each hash table small. This uses the same partial
+ * aggregation machinery as parallel aggregation in PostgreSQL.
+ */
+
+/*
+ * Build the target for the partial aggregates, i.e., the grouping expressions
+ * and the partial versions of the aggregates in the final target. This
+ * mirrors make_partial_grouping_target() in PostgreSQL's planner, which is not
+ * exported.
+ */
+static PathTarget *
+make_partial_target(PlannerInfo *root, PathTarget *target)
+{
+	Query	   *parse = root->parse;
+	PathTarget *partial_target = create_empty_pathtarget();
+	List	   *non_group_exprs = NIL;
+	ListCell   *lc;
+	int			i = 0;
+
+	foreach(lc, target->exprs)
+	{
+		Expr	   *expr = lfirst(lc);
+		Index		sgref = get_pathtarget_sortgroupref(target, i++);
+
+		if (sgref != 0 && get_sortgroupref_clause_noerr(sgref, parse->groupClause) != NULL)
+			add_column_to_pathtarget(partial_target, expr, sgref);
+		else
+			non_group_exprs = lappend(non_group_exprs, expr);
+	}
+
+	if (parse->havingQual != NULL)
+		non_group_exprs = lappend(non_group_exprs, parse->havingQual);
+
+	add_new_columns_to_pathtarget(partial_target,
+								  pull_var_clause((Node *) non_group_exprs,
+												  PVC_INCLUDE_AGGREGATES |
+												  PVC_RECURSE_WINDOWFUNCS |
+												  PVC_INCLUDE_PLACEHOLDERS));
+
+	foreach(lc, partial_target->exprs)
+	{
+		Aggref	   *aggref = lfirst(lc);
+
+		if (IsA(aggref, Aggref))
+		{
+			Aggref	   *partial = makeNode(Aggref);
+
+			memcpy(partial, aggref, sizeof(Aggref));
+			mark_partial_aggref(partial, AGGSPLIT_INITIAL_SERIAL);
+			lfirst(lc) = partial;
+		}
+	}
+
+	return set_pathtarget_cost_width(root, partial_target);
+}
+
+/*
+ * Translate a target on the hypertable into a target on one of its chunks.
+ */
+static PathTarget *
+translate_target(PlannerInfo *root, PathTarget *target, RelOptInfo *childrel)
+{
+	AppendRelInfo *appinfo = find_childrel_appendrelinfo(root, childrel);
+	PathTarget *child_target = copy_pathtarget(target);
+
+	child_target->exprs = (List *) adjust_appendrel_attrs(root, (Node *) target->exprs, appinfo);
+
+	return child_target;
+}
+
+static List *
+get_group_exprs(PathTarget *target, List *group_clause)
+{
+	List	   *group_exprs = NIL;
+	ListCell   *lc;
+	int			i = 0;
+
+	foreach(lc, target->exprs)
+	{
+		Index		sgref = get_pathtarget_sortgroupref(target, i++);
+
+		if (sgref != 0 && get_sortgroupref_clause_noerr(sgref, group_clause) != NULL)
+			group_exprs = lappend(group_exprs, lfirst(lc));
+	}
+
+	return group_exprs;
+}
+
+static bool
+is_hypertable_rel(PlannerInfo *root, RelOptInfo *rel)
+{
+	RangeTblEntry *rte;
+	Cache	   *hcache;
+	bool		found;
+
+	if (rel->reloptkind != RELOPT_BASEREL)
+		return false;
+
+	rte = planner_rt_fetch(rel->relid, root);
+
+	if (rte->rtekind != RTE_RELATION || !rte->inh)
+		return false;
+
+	hcache = hypertable_cache_pin();
+	found = hypertable_cache_get_entry(hcache, rte->relid) != NULL;
+	cache_release(hcache);
+
+	return found;
+}
+
+/*
+ * Get the children of an Append, MergeAppend or OrderedAppend path. The order
+ * of the children does not matter to aggregation, so the rows of all of them
+ * can be appended.
+ *
+ * A ConstraintAwareAppend is not unwrapped, since it would lose the exclusion
+ * of chunks at execution time, which can matter more than per-chunk
+ * aggregation. Its children also need not be plain scans of the chunks.
+ */
+static List *
+get_append_subpaths(Path *path)
+{
+	switch (nodeTag(path))
+	{
+		case T_AppendPath:
+			return ((AppendPath *) path)->subpaths;
+		case T_MergeAppendPath:
+			return ((MergeAppendPath *) path)->subpaths;
+		case T_CustomPath:
+			if (is_ordered_append_path(path))
+				return ((CustomPath *) path)->custom_paths;
+			return NIL;
+		default:
+			return NIL;
+	}
+}
+
+/*
+ * Add a path to the grouping relation that computes partial aggregates for
+ * each child of the hypertable's Append and combines them above it.
+ *
+ * Only hash aggregation is used per chunk, since the chunk scans do not
+ * produce rows in grouping order. When the path can be built, it replaces the
+ * other grouping paths: the cost model does not account for the reduced size
+ * of the per-chunk hash tables, so the optimization is enabled explicitly.
+ *
+ * Queries whose chunks are excluded at execution time (i.e., that use a
+ * ConstraintAwareAppend) are not aggregated per chunk.
+ */
+void
+plan_partial_agg_add_paths(PlannerInfo *root, RelOptInfo *input_rel, RelOptInfo *output_rel)
+{
+	Query	   *parse = root->parse;
+	Path	   *input_path = input_rel->cheapest_total_path;
+	Path	   *grouped_path;
+	PathTarget *target;
+	PathTarget *input_target;
+	PathTarget *partial_target;
+	List	   *subpaths;
+	AggClauseCosts agg_costs;
+	AggClauseCosts agg_partial_costs;
+	AggClauseCosts agg_final_costs;
+	AggStrategy strategy = AGG_PLAIN;
+	List	   *partial_paths = NIL;
+	ListCell   *lc;
+	Path	   *path;
+
+	if (output_rel->pathlist == NIL ||
+		input_path == NULL ||
+		input_path->param_info != NULL ||
+		parse->groupingSets != NIL ||
+		parse->hasTargetSRFs ||
+		!is_hypertable_rel(root, input_rel))
+		return;
+
+	if (parse->groupClause != NIL)
+	{
+		if (!grouping_is_hashable(parse->groupClause))
+			return;
+		strategy = AGG_HASHED;
+	}
+
+	/*
+	 * The input to grouping is the Append of the chunks, projected to the
+	 * grouping expressions and the inputs of the aggregates.
+	 */
+	input_target = input_path->pathtarget;
+
+	if (IsA(input_path, ProjectionPath))
+		input_path = ((ProjectionPath *) input_path)->subpath;
+
+	subpaths = get_append_subpaths(input_path);
+
+	if (subpaths == NIL)
+		return;
+
+	grouped_path = linitial(output_rel->pathlist);
+	target = grouped_path->pathtarget;
+
+	/* All aggregates must support partial aggregation */
+	MemSet(&agg_costs, 0, sizeof(AggClauseCosts));
+	get_agg_clause_costs(root, (Node *) target->exprs, AGGSPLIT_SIMPLE, &agg_costs);
+	get_agg_clause_costs(root, parse->havingQual, AGGSPLIT_SIMPLE, &agg_costs);
+
+	if (agg_costs.hasNonPartial || agg_costs.hasNonSerial)
+		return;
+
+	partial_target = make_partial_target(root, target);
+
+	MemSet(&agg_partial_costs, 0, sizeof(AggClauseCosts));
+	MemSet(&agg_final_costs, 0, sizeof(AggClauseCosts));
+	get_agg_clause_costs(root, (Node *) partial_target->exprs, AGGSPLIT_INITIAL_SERIAL, &agg_partial_costs);
+	get_agg_clause_costs(root, (Node *) target->exprs, AGGSPLIT_FINAL_DESERIAL, &agg_final_costs);
+	get_agg_clause_costs(root, parse->havingQual, AGGSPLIT_FINAL_DESERIAL, &agg_final_costs);
+
+	foreach(lc, subpaths)
+	{
+		Path	   *subpath = lfirst(lc);
+		RelOptInfo *childrel = subpath->parent;
+		PathTarget *child_input_target;
+		double		num_groups = 1;
+
+		if (subpath->param_info != NULL)
+			return;
+
+		child_input_target = translate_target(root, input_target, childrel);
+		subpath = (Path *) create_projection_path(root, childrel, subpath, child_input_target);
+
+		if (strategy == AGG_HASHED)
+			num_groups = estimate_num_groups(root,
+											 get_group_exprs(child_input_target, parse->groupClause),
+											 subpath->rows,
+											 NULL);
+
+		path = (Path *) create_agg_path(root,
+										output_rel,
+										subpath,
+										translate_target(root, partial_target, childrel),
+										strategy,
+										AGGSPLIT_INITIAL_SERIAL,
+										parse->groupClause,
+										NIL,
+										&agg_partial_costs,
+										num_groups);
+		partial_paths = lappend(partial_paths, path);
+	}
+
+	path = (Path *) create_append_path(output_rel, partial_paths, NULL, 0
+#if PG10
+									   ,NIL
+#endif
+		);
+	path->pathtarget = partial_target;
+
+	path = (Path *) create_agg_path(root,
+									output_rel,
+									path,
+									target,
+									strategy,
+									AGGSPLIT_FINAL_DESERIAL,
+									parse->groupClause,
+									(List *) parse->havingQual,
+									&agg_final_costs,
+									grouped_path->rows);
+
+	output_rel->pathlist = NIL;
+	add_path(output_rel, path);
+}
@@ -0,0 +1,9 @@
+#ifndef TIMESCALEDB_PLAN_PARTIAL_AGG_H
+#define TIMESCALEDB_PLAN_PARTIAL_AGG_H
+
+#include <postgres.h>
+#include <nodes/relation.h>
+
+extern void plan_partial_agg_add_paths(PlannerInfo *root, RelOptInfo *input_rel, RelOptInfo *output_rel);
+
+#endif   /* TIMESCALEDB_PLAN_PARTIAL_AGG_H */
@@ -5,6 +5,9 @@
 #include <optimizer/planner.h>
 #include <optimizer/pathnode.h>
 #include <optimizer/paths.h>
+#include <optimizer/plancat.h>
+#include <optimizer/var.h>
+#include <access/sysattr.h>
 #include <catalog/namespace.h>
 #include <utils/guc.h>
 #include <miscadmin.h>
@@ -18,16 +21,25 @@
 #include "utils.h"
 #include "guc.h"
 #include "dimension.h"
+#include "chunk_column_stats.h"
 #include "chunk_dispatch_plan.h"
 #include "planner_utils.h"
 #include "hypertable_insert.h"
 #include "constraint_aware_append.h"
+#include "decompress_chunk.h"
+#include "ordered_append.h"
+#include "plan_agg_bookend.h"
+#include "plan_expand_hypertable.h"
+#include "plan_partial_agg.h"
+#include "skip_scan.h"
 
 void		_planner_init(void);
 void		_planner_fini(void);
 
 static planner_hook_type prev_planner_hook;
 static set_rel_pathlist_hook_type prev_set_rel_pathlist_hook;
+static get_relation_info_hook_type prev_get_relation_info_hook;
+static create_upper_paths_hook_type prev_create_upper_paths_hook;
 
 typedef struct ModifyTableWalkerCtx
 {
@@ -148,6 +160,23 @@ timescaledb_planner(Query *parse, int cursor_opts, ParamListInfo bound_params)
 {
 	PlannedStmt *plan_stmt = NULL;
 
+	if (extension_is_loaded() && !guc_disable_optimizations)
+	{
+		Cache	   *hcache = hypertable_cache_pin();
+
+		/*
+		 * Bookend aggregates are rewritten first, since the rewrite adds
+		 * subqueries with hypertables that need to be marked for expansion.
+		 */
+		if (guc_optimize_bookend_aggregates)
+			plan_agg_bookend_rewrite_query(parse, hcache);
+
+		if (guc_plan_time_chunk_exclusion)
+			plan_expand_hypertable_mark_query(parse, hcache);
+
+		cache_release(hcache);
+	}
+
 	if (prev_planner_hook != NULL)
 	{
 		/* Call any earlier hooks */
@@ -185,8 +214,44 @@ should_optimize_query(Hypertable *ht)
 
 extern void sort_transform_optimization(PlannerInfo *root, RelOptInfo *rel);
 
+/*
+ * Check if a clause references any of the hypertable's dimension columns.
+ */
+static bool
+clause_references_dimension(Hypertable *ht, Index relid, Node *clause)
+{
+	Bitmapset  *attnos = NULL;
+	int			i;
+
+	pull_varattnos(clause, relid, &attnos);
+
+	for (i = 0; i < ht->space->num_dimensions; i++)
+		if (bms_is_member(ht->space->dimensions[i].column_attno - FirstLowInvalidHeapAttributeNumber, attnos))
+			return true;
+
+	return false;
+}
+
+static bool
+clause_references_stats_column(Hypertable *ht, Index relid, Node *clause)
+{
+	Bitmapset  *attnos = NULL;
+	ListCell   *lc;
+
+	if (ht->stats_columns == NIL)
+		return false;
+
+	pull_varattnos(clause, relid, &attnos);
+
+	foreach(lc, ht->stats_columns)
+		if (bms_is_member(((ChunkStatsColumn *) lfirst(lc))->attno - FirstLowInvalidHeapAttributeNumber, attnos))
+			return true;
+
+	return false;
+}
+
 static inline bool
-should_optimize_append(const Path *path)
+should_optimize_append(const Path *path, Hypertable *ht)
 {
 	RelOptInfo *rel = path->parent;
 	ListCell   *lc;
@@ -197,7 +262,9 @@ should_optimize_append(const Path *path)
 
 	/*
 	 * If there are clauses that have mutable functions, this path is ripe for
-	 * execution-time optimization
+	 * execution-time optimization. The same goes for clauses on dimension
+	 * columns that compare against parameters, e.g., in generic plans of
+	 * prepared statements.
 	 */
 	foreach(lc, rel->baserestrictinfo)
 	{
@@ -205,7 +272,36 @@ should_optimize_append(const Path *path)
 
 		if (contain_mutable_functions((Node *) rinfo->clause))
 			return true;
+
+		if (contain_param((Node *) rinfo->clause) &&
+			clause_references_dimension(ht, rel->relid, (Node *) rinfo->clause))
+			return true;
+
+		/*
+		 * Chunk stats change as rows are inserted, so they can only be used
+		 * at execution time
+		 */
+		if (clause_references_stats_column(ht, rel->relid, (Node *) rinfo->clause))
+			return true;
 	}
+
+	/*
+	 * A parameterized path is rescanned for every outer row of a nested loop.
+	 * Join clauses on dimension columns, or columns with chunk stats, allow
+	 * excluding chunks on every rescan.
+	 */
+	if (NULL != path->param_info)
+	{
+		foreach(lc, path->param_info->ppi_clauses)
+		{
+			RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+
+			if (clause_references_dimension(ht, rel->relid, (Node *) rinfo->clause) ||
+				clause_references_stats_column(ht, rel->relid, (Node *) rinfo->clause))
+				return true;
+		}
+	}
+
 	return false;
 }
 
@@ -244,6 +340,9 @@ timescaledb_set_rel_pathlist(PlannerInfo *root,
 	if (!extension_is_loaded() || IS_DUMMY_REL(rel) || !OidIsValid(rte->relid))
 		return;
 
+	/* Compressed chunks can only be read by decompressing them */
+	decompress_chunk_add_paths(root, rel, rte);
+
 	/* quick abort if only optimizing hypertables */
 	if (!guc_optimize_non_hypertables && !(is_append_parent(rel, rte) || is_append_child(rel, rte)))
 		return;
@@ -302,6 +401,31 @@ timescaledb_set_rel_pathlist(PlannerInfo *root,
 	{
 		ListCell   *lc;
 
+		if (guc_ordered_append)
+		{
+			List	   *ordered_paths = NIL;
+
+			foreach(lc, rel->pathlist)
+			{
+				Path	   *path = lfirst(lc);
+
+				if (IsA(path, MergeAppendPath))
+				{
+					Path	   *ordered = ordered_append_path_create(root, rel, ht, (MergeAppendPath *) path);
+
+					if (NULL != ordered)
+						ordered_paths = lappend(ordered_paths, ordered);
+				}
+			}
+
+			/* Adding paths can free existing ones, so add them afterwards */
+			foreach(lc, ordered_paths)
+				add_path(rel, lfirst(lc));
+		}
+
+		if (guc_skip_scan)
+			skip_scan_add_paths(root, rel, ht);
+
 		foreach(lc, rel->pathlist)
 		{
 			Path	  **pathptr = (Path **) &lfirst(lc);
@@ -309,20 +433,94 @@ timescaledb_set_rel_pathlist(PlannerInfo *root,
 
 			switch (nodeTag(path))
 			{
+				case T_CustomPath:
+					if (!is_ordered_append_path(path))
+						break;
+					/* FALLTHROUGH */
 				case T_AppendPath:
 				case T_MergeAppendPath:
-					if (should_optimize_append(path))
+					if (should_optimize_append(path, ht))
 						*pathptr = constraint_aware_append_path_create(root, ht, path);
+					break;
+				case T_GatherPath:
+					{
+						/*
+						 * Gather paths are created from the partial paths
+						 * before this hook is called
+						 */
+						GatherPath *gather = (GatherPath *) path;
+
+						if (IsA(gather->subpath, AppendPath) &&
+							should_optimize_append(gather->subpath, ht))
+							gather->subpath = constraint_aware_append_path_create(root, ht, gather->subpath);
+						break;
+					}
 				default:
 					break;
 			}
 		}
+
+		/* Partial paths are used for parallel plans above this relation */
+		foreach(lc, rel->partial_pathlist)
+		{
+			Path	  **pathptr = (Path **) &lfirst(lc);
+
+			if (IsA(*pathptr, AppendPath) && should_optimize_append(*pathptr, ht))
+				*pathptr = constraint_aware_append_path_create(root, ht, *pathptr);
+		}
 	}
 
 out_release:
 	cache_release(hcache);
 }
 
+/*
+ * Expand hypertables that were marked for expansion in the planner hook. This
+ * needs to happen before the planner builds relations for the children of
+ * the hypertable, which it does right after getting the relation info.
+ */
+static void
+timescaledb_get_relation_info(PlannerInfo *root,
+							  Oid relation_objectid,
+							  bool inhparent,
+							  RelOptInfo *rel)
+{
+	RangeTblEntry *rte;
+
+	if (prev_get_relation_info_hook != NULL)
+		(*prev_get_relation_info_hook) (root, relation_objectid, inhparent, rel);
+
+	rte = planner_rt_fetch(rel->relid, root);
+
+	if (plan_expand_hypertable_is_marked(rte))
+	{
+		Cache	   *hcache = hypertable_cache_pin();
+
+		plan_expand_hypertable_chunks(root, rel, rte,
+									  hypertable_cache_get_entry(hcache, rte->relid));
+		cache_release(hcache);
+	}
+
+	if (!inhparent && extension_is_loaded())
+		decompress_chunk_adjust_rel_size(root, rel, rte);
+}
+
+static void
+timescaledb_create_upper_paths(PlannerInfo *root,
+							   UpperRelationKind stage,
+							   RelOptInfo *input_rel,
+							   RelOptInfo *output_rel)
+{
+	if (prev_create_upper_paths_hook != NULL)
+		(*prev_create_upper_paths_hook) (root, stage, input_rel, output_rel);
+
+	if (!extension_is_loaded() || guc_disable_optimizations)
+		return;
+
+	if (stage == UPPERREL_GROUP_AGG && guc_chunk_partial_aggregation)
+		plan_partial_agg_add_paths(root, input_rel, output_rel);
+}
+
 void
 _planner_init(void)
 {
@@ -330,6 +528,10 @@ _planner_init(void)
 	planner_hook = timescaledb_planner;
 	prev_set_rel_pathlist_hook = set_rel_pathlist_hook;
 	set_rel_pathlist_hook = timescaledb_set_rel_pathlist;
+	prev_get_relation_info_hook = get_relation_info_hook;
+	get_relation_info_hook = timescaledb_get_relation_info;
+	prev_create_upper_paths_hook = create_upper_paths_hook;
+	create_upper_paths_hook = timescaledb_create_upper_paths;
 }
 
 void
@@ -337,4 +539,6 @@ _planner_fini(void)
 {
 	planner_hook = prev_planner_hook;
 	set_rel_pathlist_hook = prev_set_rel_pathlist_hook;
+	get_relation_info_hook = prev_get_relation_info_hook;
+	create_upper_paths_hook = prev_create_upper_paths_hook;
 }
@@ -1,5 +1,8 @@
 #include <postgres.h>
 #include <nodes/plannodes.h>
+#include <nodes/nodeFuncs.h>
+#include <nodes/makefuncs.h>
+#include <utils/rel.h>
 #include <miscadmin.h>
 
 #include "planner_utils.h"
@@ -74,3 +77,90 @@ void
 	foreach(lc, stmt->subplans)
 		plantree_walker((Plan **) &lfirst(lc), walker, context);
 }
+
+static bool
+contain_param_walker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+
+	if (IsA(node, Param))
+	{
+		Param	   *param = (Param *) node;
+
+		return param->paramkind == PARAM_EXEC || param->paramkind == PARAM_EXTERN;
+	}
+
+	return expression_tree_walker(node, contain_param_walker, context);
+}
+
+/*
+ * Check if an expression contains parameters whose values are only known at
+ * execution time, i.e., parameters of generic plans and values passed down
+ * from the outer side of nested loops or from init plans.
+ */
+bool
+contain_param(Node *node)
+{
+	return contain_param_walker(node, NULL);
+}
+
+/*
+ * Build the list of Vars that translate the parent's columns into the
+ * child's. This is the same as make_inh_translation_list() in
+ * PostgreSQL's prepunion.c, which is not exported.
+ */
+List *
+make_translation_list(Relation parent, Relation child, Index child_rti)
+{
+	List	   *vars = NIL;
+	TupleDesc	parent_desc = RelationGetDescr(parent);
+	TupleDesc	child_desc = RelationGetDescr(child);
+	int			parent_attno;
+
+	for (parent_attno = 0; parent_attno < parent_desc->natts; parent_attno++)
+	{
+		Form_pg_attribute att = parent_desc->attrs[parent_attno];
+		const char *attname;
+		int			child_attno;
+
+		if (att->attisdropped)
+		{
+			vars = lappend(vars, NULL);
+			continue;
+		}
+
+		attname = NameStr(att->attname);
+
+		if (parent == child)
+			child_attno = parent_attno;
+		else if (parent_attno < child_desc->natts &&
+				 !child_desc->attrs[parent_attno]->attisdropped &&
+				 strcmp(attname, NameStr(child_desc->attrs[parent_attno]->attname)) == 0)
+			child_attno = parent_attno;
+		else
+		{
+			for (child_attno = 0; child_attno < child_desc->natts; child_attno++)
+			{
+				Form_pg_attribute child_att = child_desc->attrs[child_attno];
+
+				if (!child_att->attisdropped &&
+					strcmp(attname, NameStr(child_att->attname)) == 0)
+					break;
+			}
+
+			if (child_attno >= child_desc->natts)
+				elog(ERROR, "could not find inherited attribute \"%s\" of relation \"%s\"",
+					 attname, RelationGetRelationName(child));
+		}
+
+		vars = lappend(vars, makeVar(child_rti,
+									 (AttrNumber) (child_attno + 1),
+									 att->atttypid,
+									 att->atttypmod,
+									 att->attcollation,
+									 0));
+	}
+
+	return vars;
+}
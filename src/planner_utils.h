@@ -3,7 +3,10 @@
 
 #include <postgres.h>
 #include <nodes/plannodes.h>
+#include <utils/relcache.h>
 
+extern bool contain_param(Node *node);
 extern void planned_stmt_walker(PlannedStmt *stmt, void (*walker) (Plan **, void *), void *context);
+extern List *make_translation_list(Relation parent, Relation child, Index child_rti);
 
 #endif   /* TIMESCALEDB_PLANNER_UTILS_H */
@@ -30,8 +30,11 @@
 #include "process_utility.h"
 #include "catalog.h"
 #include "chunk.h"
+#include "chunk_column_stats.h"
 #include "chunk_index.h"
 #include "compat.h"
+#include "compress_chunk.h"
+#include "continuous_agg.h"
 #include "copy.h"
 #include "errors.h"
 #include "event_trigger.h"
@@ -228,6 +231,12 @@ process_copy(Node *parsetree, const char *query_string, char *completion_tag)
 	if (ht == NULL)
 	{
 		cache_release(hcache);
+		/*
+		 * Direct copies into chunks do not maintain chunk column stats and
+		 * do not track the range of copied time values
+		 */
+		chunk_column_stats_invalidate_by_relid(relid);
+		continuous_agg_invalidate_by_relid(relid);
 		return false;
 	}
 
@@ -471,6 +480,36 @@ process_drop_index(DropStmt *stmt)
 	}
 }
 
+/*
+ * Drop continuous aggregates along with their materialization and direct
+ * view. The views of continuous aggregates are removed from the statement,
+ * which then drops any other views.
+ */
+static void
+process_drop_view(DropStmt *stmt)
+{
+	List	   *objects = NIL;
+	ListCell   *lc;
+
+	foreach(lc, stmt->objects)
+	{
+		List	   *object = lfirst(lc);
+		RangeVar   *relation = makeRangeVarFromNameList(object);
+
+		if (NULL != relation)
+		{
+			Oid			relid = RangeVarGetRelid(relation, NoLock, true);
+
+			if (OidIsValid(relid) && continuous_agg_drop_view(relid, stmt->behavior))
+				continue;
+		}
+
+		objects = lappend(objects, object);
+	}
+
+	stmt->objects = objects;
+}
+
 static void
 process_drop(Node *parsetree)
 {
@@ -487,6 +526,9 @@ process_drop(Node *parsetree)
 		case OBJECT_INDEX:
 			process_drop_index(stmt);
 			break;
+		case OBJECT_VIEW:
+			process_drop_view(stmt);
+			break;
 		default:
 			break;
 	}
@@ -594,6 +636,9 @@ process_rename_column(Cache *hcache, Oid relid, RenameStmt *stmt)
 	if (NULL == ht)
 		return;
 
+	chunk_column_stats_rename_column(ht, stmt->subname, stmt->newname);
+	compressed_chunk_rename_column(ht, stmt->subname, stmt->newname);
+
 	dim = hyperspace_get_dimension_by_name(ht->space, DIMENSION_TYPE_ANY, stmt->subname);
 
 	if (NULL == dim)
@@ -655,6 +700,9 @@ process_rename(Node *parsetree)
 		case OBJECT_INDEX:
 			process_rename_index(hcache, relid, stmt);
 			break;
+		case OBJECT_VIEW:
+			continuous_agg_rename_view(relid, stmt->newname);
+			break;
 		default:
 			break;
 	}
@@ -702,6 +750,7 @@ process_drop_constraint_chunk(Hypertable *ht, Oid chunk_relid, void *arg)
 	Chunk	   *chunk = chunk_get_by_relid(chunk_relid, ht->space->num_dimensions, true);
 
 	chunk_constraint_delete_by_hypertable_constraint_name(chunk->fd.id, chunk->table_id, hypertable_constraint_name);
+	catalog_invalidate_hypertable(ht->main_table_relid);
 }
 
 static void
@@ -1169,6 +1218,50 @@ process_alter_column_type_start(Hypertable *ht, AlterTableCmd *cmd)
 					(errcode(ERRCODE_IO_OPERATION_NOT_SUPPORTED),
 			 errmsg("Cannot change the type of a hash-partitioned column")));
 	}
+
+	if (NULL != chunk_column_stats_get_column(ht, cmd->name))
+		ereport(ERROR,
+				(errcode(ERRCODE_IO_OPERATION_NOT_SUPPORTED),
+				 errmsg("Cannot change the type of a column with chunk skipping enabled"),
+				 errhint("Disable chunk skipping on the column with disable_chunk_skipping() first.")));
+
+	/* Compressed data cannot be converted to the new type */
+	if (compressed_chunk_hypertable_has_compressed(ht))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("Cannot change the type of a column of a hypertable with compressed chunks"),
+				 errhint("Decompress the chunks with decompress_chunk() first.")));
+}
+
+/*
+ * Existing rows get the default of a new column, or must fulfill its NOT NULL
+ * constraint, but the rows of compressed chunks would read the new column as
+ * NULL.
+ */
+static void
+process_add_column_start(Hypertable *ht, AlterTableCmd *cmd)
+{
+	ColumnDef  *coldef = (ColumnDef *) cmd->def;
+	bool		has_default = (NULL != coldef->raw_default || NULL != coldef->cooked_default);
+	bool		is_not_null = coldef->is_not_null;
+	ListCell   *lc;
+
+	foreach(lc, coldef->constraints)
+	{
+		Constraint *con = lfirst(lc);
+
+		if (con->contype == CONSTR_DEFAULT)
+			has_default = true;
+		else if (con->contype == CONSTR_NOTNULL || con->contype == CONSTR_PRIMARY)
+			is_not_null = true;
+	}
+
+	if ((has_default || is_not_null) && compressed_chunk_hypertable_has_compressed(ht))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("Cannot add column \"%s\" with a default or NOT NULL constraint to a hypertable with compressed chunks",
+						coldef->colname),
+				 errhint("Decompress the chunks with decompress_chunk() first.")));
 }
 
 static void
@@ -1291,6 +1384,18 @@ process_altertable_start_table(Node *parsetree)
 				if (ht != NULL)
 					process_alter_column_type_start(ht, cmd);
 				break;
+			case AT_AddColumn:
+			case AT_AddColumnRecurse:
+				Assert(IsA(cmd->def, ColumnDef));
+
+				if (ht != NULL)
+					process_add_column_start(ht, cmd);
+				break;
+			case AT_DropColumn:
+			case AT_DropColumnRecurse:
+				if (ht != NULL)
+					chunk_column_stats_drop_column(ht, cmd->name);
+				break;
 #if PG10
 			case AT_AttachPartition:
 				{
@@ -0,0 +1,344 @@
+#include <postgres.h>
+#include <access/genam.h>
+#include <access/heapam.h>
+#include <access/htup_details.h>
+#include <access/multixact.h>
+#include <access/rewriteheap.h>
+#include <access/transam.h>
+#include <access/xlog.h>
+#include <catalog/index.h>
+#include <catalog/pg_class.h>
+#include <catalog/pg_index.h>
+#include <commands/cluster.h>
+#include <commands/tablecmds.h>
+#include <commands/vacuum.h>
+#include <storage/bufmgr.h>
+#include <storage/lmgr.h>
+#include <utils/acl.h>
+#include <utils/lsyscache.h>
+#include <utils/rel.h>
+#include <utils/relcache.h>
+#include <utils/syscache.h>
+#include <utils/tqual.h>
+#include <miscadmin.h>
+
+#include "catalog.h"
+#include "chunk.h"
+#include "chunk_index.h"
+#include "compat.h"
+#include "errors.h"
+#include "hypertable_cache.h"
+#include "reorder.h"
+
+/*
+ * Online reordering of chunks.
+ *
+ * Reordering a chunk rewrites it in the order of one of its indexes, like
+ * CLUSTER, so that rows that are read together, e.g., all rows of a device,
+ * are stored together. Unlike CLUSTER, which holds an AccessExclusiveLock
+ * throughout, the chunk is copied into a new relfilenode under an
+ * ExclusiveLock, which blocks writes but not reads. The lock is only
+ * upgraded to an AccessExclusiveLock to swap the new relfilenode in and
+ * rebuild the indexes. This is meant for chunks that no longer receive
+ * inserts.
+ *
+ * Like CLUSTER, the copy preserves the visibility information of the rows,
+ * so concurrent readers with older snapshots see the same rows after the
+ * swap.
+ */
+
+TS_FUNCTION_INFO_V1(reorder_chunk);
+
+/*
+ * Copy the rows of the old heap into the new heap in index order. Mirrors
+ * copy_heap_data() in PostgreSQL's cluster.c, but only takes an
+ * ExclusiveLock on the old heap.
+ */
+static void
+reorder_copy_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex, bool verbose,
+				  TransactionId *pFreezeXid, MultiXactId *pCutoffMulti)
+{
+	Relation	NewHeap = heap_open(OIDNewHeap, AccessExclusiveLock);
+	Relation	OldHeap = heap_open(OIDOldHeap, NoLock);
+	Relation	OldIndex = index_open(OIDOldIndex, ExclusiveLock);
+	TupleDesc	oldTupDesc = RelationGetDescr(OldHeap);
+	TupleDesc	newTupDesc = RelationGetDescr(NewHeap);
+	int			natts = newTupDesc->natts;
+	Datum	   *values = palloc(natts * sizeof(Datum));
+	bool	   *isnull = palloc(natts * sizeof(bool));
+	bool		use_wal = XLogIsNeeded() && RelationNeedsWAL(NewHeap);
+	TransactionId OldestXmin;
+	TransactionId FreezeXid;
+	MultiXactId MultiXactCutoff;
+	RewriteState rwstate;
+	IndexScanDesc indexScan;
+	HeapTuple	tuple;
+	double		num_tuples = 0,
+				tups_vacuumed = 0,
+				tups_recently_dead = 0;
+	Relation	relRelation;
+	HeapTuple	reltup;
+	Form_pg_class relform;
+
+	vacuum_set_xid_limits(OldHeap, 0, 0, 0, 0, &OldestXmin, &FreezeXid,
+						  NULL, &MultiXactCutoff, NULL);
+
+	/* Never move the frozen horizons of the relation backwards */
+	if (TransactionIdPrecedes(FreezeXid, OldHeap->rd_rel->relfrozenxid))
+		FreezeXid = OldHeap->rd_rel->relfrozenxid;
+
+	if (MultiXactIdPrecedes(MultiXactCutoff, OldHeap->rd_rel->relminmxid))
+		MultiXactCutoff = OldHeap->rd_rel->relminmxid;
+
+	*pFreezeXid = FreezeXid;
+	*pCutoffMulti = MultiXactCutoff;
+
+	rwstate = begin_heap_rewrite(OldHeap, NewHeap, OldestXmin, FreezeXid,
+								 MultiXactCutoff, use_wal);
+
+	indexScan = index_beginscan(OldHeap, OldIndex, SnapshotAny, 0, 0);
+	index_rescan(indexScan, NULL, 0, NULL, 0);
+
+	while ((tuple = index_getnext(indexScan, ForwardScanDirection)) != NULL)
+	{
+		Buffer		buf = indexScan->xs_cbuf;
+		HeapTuple	copiedTuple;
+		bool		isdead;
+		int			i;
+
+		CHECK_FOR_INTERRUPTS();
+
+		LockBuffer(buf, BUFFER_LOCK_SHARE);
+
+		switch (HeapTupleSatisfiesVacuum(tuple, OldestXmin, buf))
+		{
+			case HEAPTUPLE_DEAD:
+				isdead = true;
+				break;
+			case HEAPTUPLE_RECENTLY_DEAD:
+				tups_recently_dead += 1;
+				/* fall through */
+			case HEAPTUPLE_LIVE:
+				isdead = false;
+				break;
+			case HEAPTUPLE_INSERT_IN_PROGRESS:
+			case HEAPTUPLE_DELETE_IN_PROGRESS:
+
+				/*
+				 * Writers are blocked by the ExclusiveLock, so these can only
+				 * come from the current transaction. Keep them, like CLUSTER.
+				 */
+				isdead = false;
+				break;
+			default:
+				elog(ERROR, "unexpected HeapTupleSatisfiesVacuum result");
+				isdead = false;
+				break;
+		}
+
+		LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+
+		if (isdead)
+		{
+			tups_vacuumed += 1;
+
+			/* The rewrite module still needs to see dead tuples of chains */
+			if (rewrite_heap_dead_tuple(rwstate, tuple))
+			{
+				/* A previous recently-dead tuple is now known dead */
+				tups_vacuumed += 1;
+				tups_recently_dead -= 1;
+			}
+			continue;
+		}
+
+		num_tuples += 1;
+
+		/* Form the tuple anew to drop the values of dropped columns */
+		heap_deform_tuple(tuple, oldTupDesc, values, isnull);
+
+		for (i = 0; i < natts; i++)
+			if (newTupDesc->attrs[i]->attisdropped)
+				isnull[i] = true;
+
+		copiedTuple = heap_form_tuple(newTupDesc, values, isnull);
+
+		if (OldHeap->rd_rel->relhasoids)
+			HeapTupleSetOid(copiedTuple, HeapTupleGetOid(tuple));
+
+		rewrite_heap_tuple(rwstate, tuple, copiedTuple);
+		heap_freetuple(copiedTuple);
+	}
+
+	index_endscan(indexScan);
+	end_heap_rewrite(rwstate);
+
+	ereport(verbose ? INFO : DEBUG2,
+			(errmsg("\"%s\": found %.0f removable, %.0f nonremovable row versions",
+					RelationGetRelationName(OldHeap), tups_vacuumed, num_tuples),
+			 errdetail("%.0f dead row versions cannot be removed yet.",
+					   tups_recently_dead)));
+
+	pfree(values);
+	pfree(isnull);
+
+	/* The size statistics are swapped along with the relfilenodes */
+	relRelation = heap_open(RelationRelationId, RowExclusiveLock);
+	reltup = SearchSysCacheCopy1(RELOID, ObjectIdGetDatum(OIDNewHeap));
+
+	if (!HeapTupleIsValid(reltup))
+		elog(ERROR, "cache lookup failed for relation %u", OIDNewHeap);
+
+	relform = (Form_pg_class) GETSTRUCT(reltup);
+	relform->relpages = RelationGetNumberOfBlocks(NewHeap);
+	relform->reltuples = num_tuples;
+	catalog_update(relRelation, reltup);
+	heap_freetuple(reltup);
+	heap_close(relRelation, RowExclusiveLock);
+
+	index_close(OldIndex, NoLock);
+	heap_close(OldHeap, NoLock);
+	heap_close(NewHeap, NoLock);
+}
+
+/*
+ * Rewrite a table in the order of one of its indexes. Reads of the table
+ * are only blocked while the rewritten table is swapped in.
+ */
+void
+reorder_rel(Oid tableOid, Oid indexOid, bool verbose)
+{
+	Relation	OldHeap = heap_open(tableOid, ExclusiveLock);
+	Oid			tableSpace = OldHeap->rd_rel->reltablespace;
+	char		relpersistence = OldHeap->rd_rel->relpersistence;
+	Oid			OIDNewHeap;
+	TransactionId frozenXid;
+	MultiXactId cutoffMulti;
+
+	if (!pg_class_ownercheck(tableOid, GetUserId()))
+		aclcheck_error(ACLCHECK_NOT_OWNER, ACL_KIND_CLASS,
+					   RelationGetRelationName(OldHeap));
+
+	if (RELATION_IS_OTHER_TEMP(OldHeap))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot reorder temporary tables of other sessions")));
+
+	CheckTableNotInUse(OldHeap, "reorder_chunk");
+	check_index_is_clusterable(OldHeap, indexOid, true, ExclusiveLock);
+	heap_close(OldHeap, NoLock);
+
+	/* Also makes the index the one to use for CLUSTER without an index */
+	chunk_index_mark_clustered(tableOid, indexOid);
+
+	OIDNewHeap = make_new_heap(tableOid, tableSpace, relpersistence, ExclusiveLock);
+	reorder_copy_data(OIDNewHeap, tableOid, indexOid, verbose, &frozenXid, &cutoffMulti);
+
+	/* Only the swap and the index rebuild block reads */
+	LockRelationOid(tableOid, AccessExclusiveLock);
+
+	finish_heap_swap(tableOid, OIDNewHeap, false, false, true, true,
+					 frozenXid, cutoffMulti, relpersistence);
+}
+
+bool
+reorder_index_is_clustered(Oid indexOid)
+{
+	HeapTuple	tuple = SearchSysCache1(INDEXRELID, ObjectIdGetDatum(indexOid));
+	bool		isclustered;
+
+	if (!HeapTupleIsValid(tuple))
+		elog(ERROR, "cache lookup failed for index %u", indexOid);
+
+	isclustered = ((Form_pg_index) GETSTRUCT(tuple))->indisclustered;
+	ReleaseSysCache(tuple);
+
+	return isclustered;
+}
+
+/*
+ * Get the index of a chunk to reorder by. The index can be an index on the
+ * chunk or an index on its hypertable. Without an index, the chunk's
+ * clustered index is used.
+ */
+static Oid
+reorder_get_chunk_index(Chunk *chunk, Oid indexOid)
+{
+	Cache	   *hcache;
+	Hypertable *ht;
+	List	   *mappings;
+	ListCell   *lc;
+	Oid			chunk_indexOid = InvalidOid;
+
+	if (!OidIsValid(indexOid))
+	{
+		Relation	rel = heap_open(chunk->table_id, AccessShareLock);
+		List	   *indexes = RelationGetIndexList(rel);
+
+		heap_close(rel, AccessShareLock);
+
+		foreach(lc, indexes)
+			if (reorder_index_is_clustered(lfirst_oid(lc)))
+				return lfirst_oid(lc);
+
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_OBJECT),
+				 errmsg("there is no previously clustered index for chunk \"%s\"",
+						get_rel_name(chunk->table_id))));
+	}
+
+	if (IndexGetRelation(indexOid, false) == chunk->table_id)
+		return indexOid;
+
+	hcache = hypertable_cache_pin();
+	ht = hypertable_cache_get_entry_by_id(hcache, chunk->fd.hypertable_id);
+	mappings = chunk_index_get_mappings(ht, indexOid);
+	cache_release(hcache);
+
+	foreach(lc, mappings)
+	{
+		ChunkIndexMapping *cim = lfirst(lc);
+
+		if (cim->chunkoid == chunk->table_id)
+			chunk_indexOid = cim->indexoid;
+	}
+
+	if (!OidIsValid(chunk_indexOid))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("\"%s\" is not an index of chunk \"%s\" or its hypertable",
+						get_rel_name(indexOid), get_rel_name(chunk->table_id))));
+
+	return chunk_indexOid;
+}
+
+/*
+ * Reorder a chunk by an index.
+ *
+ * Takes the chunk, an optional index of the chunk or its hypertable, and
+ * whether to report progress.
+ */
+Datum
+reorder_chunk(PG_FUNCTION_ARGS)
+{
+	Oid			chunk_relid = PG_ARGISNULL(0) ? InvalidOid : PG_GETARG_OID(0);
+	Oid			index_relid = PG_ARGISNULL(1) ? InvalidOid : PG_GETARG_OID(1);
+	bool		verbose = PG_ARGISNULL(2) ? false : PG_GETARG_BOOL(2);
+	Chunk	   *chunk;
+
+	if (!OidIsValid(chunk_relid))
+		ereport(ERROR,
+				(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+				 errmsg("Chunk cannot be NULL")));
+
+	chunk = chunk_get_by_relid(chunk_relid, 0, false);
+
+	if (NULL == chunk)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("\"%s\" is not a chunk", get_rel_name(chunk_relid))));
+
+	reorder_rel(chunk_relid, reorder_get_chunk_index(chunk, index_relid), verbose);
+
+	PG_RETURN_VOID();
+}
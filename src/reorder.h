@@ -0,0 +1,10 @@
+#ifndef TIMESCALEDB_REORDER_H
+#define TIMESCALEDB_REORDER_H
+
+#include <postgres.h>
+#include <fmgr.h>
+
+extern void reorder_rel(Oid tableOid, Oid indexOid, bool verbose);
+extern bool reorder_index_is_clustered(Oid indexOid);
+
+#endif   /* TIMESCALEDB_REORDER_H */
@@ -0,0 +1,530 @@
+#include <postgres.h>
+#include <access/relscan.h>
+#include <access/skey.h>
+#include <access/stratnum.h>
+#include <catalog/pg_am.h>
+#include <catalog/pg_type.h>
+#include <executor/executor.h>
+#include <nodes/extensible.h>
+#include <nodes/makefuncs.h>
+#include <nodes/nodeFuncs.h>
+#include <nodes/plannodes.h>
+#include <optimizer/clauses.h>
+#include <optimizer/pathnode.h>
+#include <optimizer/paths.h>
+#include <optimizer/tlist.h>
+#include <utils/datum.h>
+#include <utils/lsyscache.h>
+#include <utils/selfuncs.h>
+
+#include "compat-msvc-enter.h"
+#include <optimizer/cost.h>
+#include "compat-msvc-exit.h"
+
+#include "skip_scan.h"
+#include "hypertable.h"
+#include "compat.h"
+
+/*
+ * Skip scan of the distinct values of an index's leading column.
+ *
+ * A query like
+ *
+ *	 SELECT DISTINCT ON (device) * FROM metrics ORDER BY device, time DESC
+ *
+ * is planned as a Unique on top of a MergeAppend of ordered chunk scans, which
+ * reads every row of every chunk although only the first row of each device
+ * is kept. With an index on (device, time DESC), the first row of each
+ * device in a chunk can instead be found with a single index descent: after
+ * returning a row, the index scan is restarted at the next value larger than
+ * the device just returned. The number of rows read from each chunk is then
+ * the number of distinct devices in the chunk rather than the number of rows.
+ *
+ * The SkipScan node wraps a chunk's btree index scan, to which we add a
+ * comparison on the leading index column against a placeholder. The node
+ * drives the index scan in stages, by changing that scan key:
+ *
+ *	 - "IS NOT NULL" to find the first non-NULL value,
+ *	 - "> previous value" (or "<" for descending scans) to find the next one,
+ *	 - "IS NULL" to find the first row of the NULL group, if any.
+ *
+ * The MergeAppend above merges the first rows of each device from all chunks
+ * and the Unique above it keeps the first one, which is the same as before
+ * since each chunk's index order refines the order of the MergeAppend.
+ */
+
+typedef enum SkipScanStage
+{
+	SKIP_SCAN_NULLS,
+	SKIP_SCAN_FIRST,
+	SKIP_SCAN_NEXT,
+	SKIP_SCAN_DONE,
+} SkipScanStage;
+
+enum CustomPrivateIndex
+{
+	SKIP_SCAN_PRIVATE_DISTINCT_ATTNO,
+	SKIP_SCAN_PRIVATE_NULLS_FIRST,
+};
+
+typedef struct SkipScanPath
+{
+	CustomPath	cpath;
+	IndexPath  *index_path;
+	/* The distinct column in the chunk */
+	Var		   *distinct_var;
+	/* Operator that finds the next distinct value in scan order */
+	Oid			skip_opno;
+	/* Whether NULLs are returned before other values in scan order */
+	bool		nulls_first;
+} SkipScanPath;
+
+typedef struct SkipScanState
+{
+	CustomScanState csstate;
+	/* The scan key on the leading index column, in the index scan's keys */
+	ScanKey		skip_key;
+	StrategyNumber skip_strategy;
+	Oid			skip_subtype;
+	Oid			skip_collation;
+	SkipScanStage stage;
+	bool		nulls_first;
+	bool		needs_rescan;
+	/* The distinct column in the index scan's output */
+	AttrNumber	distinct_attno;
+	int16		distinct_typlen;
+	bool		distinct_typbyval;
+	Datum		prev_value;
+	bool		prev_value_valid;
+} SkipScanState;
+
+static SkipScanStage
+skip_scan_initial_stage(SkipScanState *state)
+{
+	return state->nulls_first ? SKIP_SCAN_NULLS : SKIP_SCAN_FIRST;
+}
+
+/*
+ * Set up the skip key for a stage. The index scan is restarted with the new
+ * key on the next call to the node.
+ */
+static void
+skip_scan_set_stage(SkipScanState *state, SkipScanStage stage)
+{
+	ScanKey		key = state->skip_key;
+
+	state->stage = stage;
+	state->needs_rescan = true;
+
+	switch (stage)
+	{
+		case SKIP_SCAN_NULLS:
+		case SKIP_SCAN_FIRST:
+			key->sk_flags = SK_ISNULL | (stage == SKIP_SCAN_NULLS ? SK_SEARCHNULL : SK_SEARCHNOTNULL);
+			key->sk_strategy = InvalidStrategy;
+			key->sk_subtype = InvalidOid;
+			key->sk_collation = InvalidOid;
+			key->sk_argument = (Datum) 0;
+			break;
+		case SKIP_SCAN_NEXT:
+			key->sk_flags = 0;
+			key->sk_strategy = state->skip_strategy;
+			key->sk_subtype = state->skip_subtype;
+			key->sk_collation = state->skip_collation;
+			key->sk_argument = state->prev_value;
+			break;
+		case SKIP_SCAN_DONE:
+			break;
+	}
+}
+
+static void
+skip_scan_begin(CustomScanState *node, EState *estate, int eflags)
+{
+	SkipScanState *state = (SkipScanState *) node;
+	CustomScan *cscan = (CustomScan *) node->ss.ps.plan;
+	PlanState  *child = ExecInitNode(linitial(cscan->custom_plans), estate, eflags);
+	Form_pg_attribute attr;
+
+	node->custom_ps = list_make1(child);
+
+	/* The index scan does not set up its scan keys for EXPLAIN */
+	if (eflags & EXEC_FLAG_EXPLAIN_ONLY)
+		return;
+
+	switch (nodeTag(child))
+	{
+		case T_IndexScanState:
+			state->skip_key = &((IndexScanState *) child)->iss_ScanKeys[0];
+			break;
+		case T_IndexOnlyScanState:
+			state->skip_key = &((IndexOnlyScanState *) child)->ioss_ScanKeys[0];
+			break;
+		default:
+			elog(ERROR, "invalid child of SkipScan: %d", nodeTag(child));
+	}
+
+	state->skip_strategy = state->skip_key->sk_strategy;
+	state->skip_subtype = state->skip_key->sk_subtype;
+	state->skip_collation = state->skip_key->sk_collation;
+	state->distinct_attno = list_nth_int(cscan->custom_private, SKIP_SCAN_PRIVATE_DISTINCT_ATTNO);
+	state->nulls_first = list_nth_int(cscan->custom_private, SKIP_SCAN_PRIVATE_NULLS_FIRST);
+
+	attr = ExecGetResultType(child)->attrs[state->distinct_attno - 1];
+	state->distinct_typlen = attr->attlen;
+	state->distinct_typbyval = attr->attbyval;
+
+	skip_scan_set_stage(state, skip_scan_initial_stage(state));
+}
+
+static TupleTableSlot *
+skip_scan_exec(CustomScanState *node)
+{
+	SkipScanState *state = (SkipScanState *) node;
+	PlanState  *child = linitial(node->custom_ps);
+	TupleTableSlot *slot;
+
+	while (state->stage != SKIP_SCAN_DONE)
+	{
+		if (state->needs_rescan)
+		{
+			ExecReScan(child);
+			state->needs_rescan = false;
+		}
+
+		slot = ExecProcNode(child);
+
+		if (TupIsNull(slot))
+		{
+			/* No more values in the current stage, so go to the next one */
+			if (state->stage == SKIP_SCAN_NULLS)
+				skip_scan_set_stage(state, state->nulls_first ? SKIP_SCAN_FIRST : SKIP_SCAN_DONE);
+			else
+				skip_scan_set_stage(state, state->nulls_first ? SKIP_SCAN_DONE : SKIP_SCAN_NULLS);
+			continue;
+		}
+
+		if (state->stage == SKIP_SCAN_NULLS)
+			skip_scan_set_stage(state, state->nulls_first ? SKIP_SCAN_FIRST : SKIP_SCAN_DONE);
+		else
+		{
+			bool		isnull;
+			Datum		value = slot_getattr(slot, state->distinct_attno, &isnull);
+
+			Assert(!isnull);
+
+			if (state->prev_value_valid && !state->distinct_typbyval)
+				pfree(DatumGetPointer(state->prev_value));
+
+			state->prev_value = datumCopy(value, state->distinct_typbyval, state->distinct_typlen);
+			state->prev_value_valid = true;
+			skip_scan_set_stage(state, SKIP_SCAN_NEXT);
+		}
+
+		if (NULL == node->ss.ps.ps_ProjInfo)
+			return slot;
+
+		node->ss.ps.ps_ExprContext->ecxt_scantuple = slot;
+
+#if PG10
+		return ExecProject(node->ss.ps.ps_ProjInfo);
+#elif PG96
+		return ExecProject(node->ss.ps.ps_ProjInfo, NULL);
+#endif
+	}
+
+	return NULL;
+}
+
+static void
+skip_scan_end(CustomScanState *node)
+{
+	ExecEndNode(linitial(node->custom_ps));
+}
+
+static void
+skip_scan_rescan(CustomScanState *node)
+{
+	SkipScanState *state = (SkipScanState *) node;
+
+	if (node->ss.ps.chgParam != NULL)
+		UpdateChangedParamSet(linitial(node->custom_ps), node->ss.ps.chgParam);
+
+	skip_scan_set_stage(state, skip_scan_initial_stage(state));
+}
+
+static CustomExecMethods skip_scan_state_methods = {
+	.CustomName = "SkipScan",
+	.BeginCustomScan = skip_scan_begin,
+	.ExecCustomScan = skip_scan_exec,
+	.EndCustomScan = skip_scan_end,
+	.ReScanCustomScan = skip_scan_rescan,
+};
+
+static Node *
+skip_scan_state_create(CustomScan *cscan)
+{
+	SkipScanState *state = (SkipScanState *) newNode(sizeof(SkipScanState), T_CustomScanState);
+
+	state->csstate.methods = &skip_scan_state_methods;
+
+	return (Node *) state;
+}
+
+static CustomScanMethods skip_scan_plan_methods = {
+	.CustomName = "SkipScan",
+	.CreateCustomScanState = skip_scan_state_create,
+};
+
+/*
+ * Create the plan: a CustomScan on the chunk with the index scan as its only
+ * child. The index scan gets an extra index qual on the leading column,
+ *
+ *	 column > NULL
+ *
+ * which is turned into the scan key that we change during execution. It is
+ * added first, since btree expects scan keys in the order of the index
+ * columns. The qual is not added to the original quals, which are only used
+ * for rechecks and EXPLAIN.
+ */
+static Plan *
+skip_scan_plan_create(PlannerInfo *root,
+					  RelOptInfo *rel,
+					  CustomPath *path,
+					  List *tlist,
+					  List *clauses,
+					  List *custom_plans)
+{
+	SkipScanPath *sspath = (SkipScanPath *) path;
+	IndexOptInfo *index = sspath->index_path->indexinfo;
+	CustomScan *cscan = makeNode(CustomScan);
+	Scan	   *scan = linitial(custom_plans);
+	Expr	   *skip_qual;
+	AttrNumber	distinct_attno = InvalidAttrNumber;
+	ListCell   *lc;
+
+	skip_qual = make_opclause(sspath->skip_opno, BOOLOID, false,
+							  (Expr *) makeVar(INDEX_VAR, 1, index->opcintype[0], -1,
+											   index->indexcollations[0], 0),
+							  (Expr *) makeNullConst(index->opcintype[0], -1,
+													 index->indexcollations[0]),
+							  InvalidOid, index->indexcollations[0]);
+
+	switch (nodeTag(scan))
+	{
+		case T_IndexScan:
+			((IndexScan *) scan)->indexqual = lcons(skip_qual, ((IndexScan *) scan)->indexqual);
+			break;
+		case T_IndexOnlyScan:
+			((IndexOnlyScan *) scan)->indexqual = lcons(skip_qual, ((IndexOnlyScan *) scan)->indexqual);
+			break;
+		default:
+			elog(ERROR, "invalid child of SkipScan: %d", nodeTag(scan));
+	}
+
+	foreach(lc, scan->plan.targetlist)
+	{
+		TargetEntry *tle = lfirst(lc);
+
+		if (IsA(tle->expr, Var) &&
+			((Var *) tle->expr)->varno == sspath->distinct_var->varno &&
+			((Var *) tle->expr)->varattno == sspath->distinct_var->varattno)
+		{
+			distinct_attno = tle->resno;
+			break;
+		}
+	}
+
+	if (distinct_attno == InvalidAttrNumber)
+		elog(ERROR, "distinct column not found in the target list of SkipScan");
+
+	cscan->scan.scanrelid = scan->scanrelid;
+	cscan->scan.plan.targetlist = tlist;
+	cscan->custom_scan_tlist = scan->plan.targetlist;
+	cscan->custom_plans = custom_plans;
+	cscan->custom_private = list_make2_int(distinct_attno, sspath->nulls_first);
+	cscan->flags = path->flags;
+	cscan->methods = &skip_scan_plan_methods;
+
+	return &cscan->scan.plan;
+}
+
+static CustomPathMethods skip_scan_path_methods = {
+	.CustomName = "SkipScan",
+	.PlanCustomPath = skip_scan_plan_create,
+};
+
+bool
+is_skip_scan_plan(Plan *plan)
+{
+	return IsA(plan, CustomScan) &&
+		((CustomScan *) plan)->methods == &skip_scan_plan_methods;
+}
+
+/*
+ * Create a skip scan path on a chunk's index path.
+ *
+ * Returns NULL if the index is not a btree index that leads with the distinct
+ * column, or if skipping is not expected to be cheaper than reading all rows.
+ */
+static Path *
+skip_scan_path_create(PlannerInfo *root, IndexPath *index_path, Var *distinct_var)
+{
+	IndexOptInfo *index = index_path->indexinfo;
+	SkipScanPath *path;
+	StrategyNumber strategy;
+	Oid			skip_opno;
+	double		ngroups;
+	double		per_row_cost;
+	Cost		total_cost;
+	bool		forward = ScanDirectionIsForward(index_path->indexscandir);
+
+	if (index->relam != BTREE_AM_OID ||
+		index->indexkeys[0] != distinct_var->varattno ||
+		index_path->indexorderbys != NIL ||
+		ScanDirectionIsNoMovement(index_path->indexscandir))
+		return NULL;
+
+	/* The next distinct value is larger if the scan goes up the index */
+	strategy = (forward != index->reverse_sort[0]) ? BTGreaterStrategyNumber : BTLessStrategyNumber;
+	skip_opno = get_opfamily_member(index->opfamily[0], index->opcintype[0],
+									index->opcintype[0], strategy);
+
+	if (!OidIsValid(skip_opno))
+		return NULL;
+
+	/* Every distinct value costs an index descent and reading one row */
+	ngroups = estimate_num_groups(root, list_make1(distinct_var), index_path->path.rows, NULL);
+	per_row_cost = (index_path->path.total_cost - index_path->path.startup_cost) /
+		clamp_row_est(index_path->path.rows);
+	total_cost = index_path->path.startup_cost + ngroups * (random_page_cost + per_row_cost);
+
+	if (total_cost >= index_path->path.total_cost)
+		return NULL;
+
+	path = (SkipScanPath *) newNode(sizeof(SkipScanPath), T_CustomPath);
+	path->cpath.path.pathtype = T_CustomScan;
+	path->cpath.path.parent = index_path->path.parent;
+	path->cpath.path.pathtarget = index_path->path.pathtarget;
+	path->cpath.path.param_info = index_path->path.param_info;
+	path->cpath.path.pathkeys = index_path->path.pathkeys;
+	path->cpath.path.rows = ngroups;
+	path->cpath.path.startup_cost = index_path->path.startup_cost;
+	path->cpath.path.total_cost = total_cost;
+	path->cpath.flags = 0;
+	path->cpath.custom_paths = list_make1(index_path);
+	path->cpath.methods = &skip_scan_path_methods;
+	path->index_path = index_path;
+	path->distinct_var = distinct_var;
+	path->skip_opno = skip_opno;
+	path->nulls_first = (forward == index->nulls_first[0]);
+
+	return &path->cpath.path;
+}
+
+/*
+ * Get the distinct column if the query returns one row per distinct value of
+ * a column of the hypertable, and nothing else needs all rows.
+ */
+static Var *
+get_distinct_var(PlannerInfo *root, RelOptInfo *rel)
+{
+	Query	   *parse = root->parse;
+	TargetEntry *tle;
+	Expr	   *expr;
+
+	if (list_length(parse->distinctClause) != 1 ||
+		list_length(root->distinct_pathkeys) != 1 ||
+		parse->hasAggs ||
+		parse->hasWindowFuncs ||
+		parse->groupClause != NIL ||
+		parse->groupingSets != NIL ||
+		parse->havingQual != NULL ||
+		parse->setOperations != NULL ||
+		parse->rowMarks != NIL ||
+		bms_num_members(root->all_baserels) != 1 ||
+		expression_returns_set((Node *) parse->targetList))
+		return NULL;
+
+	tle = get_sortgroupclause_tle(linitial(parse->distinctClause), parse->targetList);
+	expr = tle->expr;
+
+	while (IsA(expr, RelabelType))
+		expr = ((RelabelType *) expr)->arg;
+
+	if (!IsA(expr, Var) ||
+		((Var *) expr)->varno != rel->relid ||
+		((Var *) expr)->varlevelsup != 0 ||
+		((Var *) expr)->varattno <= 0)
+		return NULL;
+
+	return (Var *) expr;
+}
+
+/*
+ * Add MergeAppend paths with skip scans on the chunks for queries with
+ * DISTINCT (ON) on a single column of the hypertable.
+ *
+ * Each MergeAppend path of the hypertable that orders by the distinct column
+ * and satisfies the query's ORDER BY is copied, replacing the ordered index
+ * scans of chunks that lead with the distinct column by skip scans. Other
+ * children are kept as they are, which is correct since they return a
+ * superset of the rows.
+ */
+void
+skip_scan_add_paths(PlannerInfo *root, RelOptInfo *rel, Hypertable *ht)
+{
+	Var		   *distinct_var = get_distinct_var(root, rel);
+	List	   *skip_paths = NIL;
+	ListCell   *lc;
+
+	if (NULL == distinct_var)
+		return;
+
+	foreach(lc, rel->pathlist)
+	{
+		MergeAppendPath *merge = lfirst(lc);
+		List	   *subpaths = NIL;
+		bool		has_skip_scan = false;
+		ListCell   *lc_sub;
+
+		if (!IsA(merge, MergeAppendPath) ||
+			!pathkeys_contained_in(root->distinct_pathkeys, merge->path.pathkeys) ||
+			!pathkeys_contained_in(root->sort_pathkeys, merge->path.pathkeys))
+			continue;
+
+		foreach(lc_sub, merge->subpaths)
+		{
+			Path	   *subpath = lfirst(lc_sub);
+			Path	   *skip_path = NULL;
+
+			if (IsA(subpath, IndexPath) &&
+				pathkeys_contained_in(merge->path.pathkeys, subpath->pathkeys))
+			{
+				AppendRelInfo *appinfo = find_childrel_appendrelinfo(root, subpath->parent);
+				Var		   *child_var = list_nth(appinfo->translated_vars, distinct_var->varattno - 1);
+
+				skip_path = skip_scan_path_create(root, (IndexPath *) subpath, child_var);
+			}
+
+			if (NULL != skip_path)
+				has_skip_scan = true;
+
+			subpaths = lappend(subpaths, NULL != skip_path ? skip_path : subpath);
+		}
+
+		if (has_skip_scan)
+			skip_paths = lappend(skip_paths,
+								 create_merge_append_path(root, rel, subpaths,
+														  merge->path.pathkeys,
+														  PATH_REQ_OUTER(&merge->path)
+#if PG10
+														  ,merge->partitioned_rels
+#endif
+														  ));
+	}
+
+	/* Adding paths can free existing ones, so add them afterwards */
+	foreach(lc, skip_paths)
+		add_path(rel, lfirst(lc));
+}
@@ -0,0 +1,13 @@
+#ifndef TIMESCALEDB_SKIP_SCAN_H
+#define TIMESCALEDB_SKIP_SCAN_H
+
+#include <postgres.h>
+#include <nodes/relation.h>
+#include <nodes/extensible.h>
+
+typedef struct Hypertable Hypertable;
+
+extern void skip_scan_add_paths(PlannerInfo *root, RelOptInfo *rel, Hypertable *ht);
+extern bool is_skip_scan_plan(Plan *plan);
+
+#endif   /* TIMESCALEDB_SKIP_SCAN_H */
@@ -19,6 +19,21 @@ typedef struct SubspaceStore
 	MemoryContext mcxt;
 	int16		num_dimensions;
 	DimensionVec *origin;		/* origin of the tree */
+
+	/*
+	 * The maximum number of objects to keep in the store, or zero for no
+	 * limit. When the store is full, the least recently used slice in the
+	 * first dimension is evicted, along with all objects stored under it.
+	 */
+	int			max_items;
+	int			num_items;
+
+	/*
+	 * The slices of the first dimension, ordered from least to most recently
+	 * used. Only tracked when the store has a limit.
+	 */
+	DimensionSlice **lru;
+	int			num_lru;
 } SubspaceStore;
 
 static inline DimensionVec *
@@ -28,14 +43,19 @@ subspace_store_dimension_create()
 }
 
 SubspaceStore *
-subspace_store_init(int16 num_dimensions, MemoryContext mcxt)
+subspace_store_init(int16 num_dimensions, MemoryContext mcxt, int max_items)
 {
 	MemoryContext old = MemoryContextSwitchTo(mcxt);
-	SubspaceStore *sst = palloc(sizeof(SubspaceStore));
+	SubspaceStore *sst = palloc0(sizeof(SubspaceStore));
 
 	sst->origin = subspace_store_dimension_create();
 	sst->num_dimensions = num_dimensions;
 	sst->mcxt = mcxt;
+	sst->max_items = max_items;
+
+	if (max_items > 0)
+		sst->lru = palloc(sizeof(DimensionSlice *) * max_items);
+
 	MemoryContextSwitchTo(old);
 	return sst;
 }
@@ -46,6 +66,93 @@ subspace_store_free_internal_node(void *node)
 	dimension_vec_free((DimensionVec *) node);
 }
 
+/*
+ * Mark a first-dimension slice as the most recently used one.
+ */
+static void
+subspace_store_lru_touch(SubspaceStore *store, DimensionSlice *slice)
+{
+	int			i;
+
+	if (NULL == store->lru ||
+		(store->num_lru > 0 && store->lru[store->num_lru - 1] == slice))
+		return;
+
+	for (i = 0; i < store->num_lru; i++)
+		if (store->lru[i] == slice)
+			break;
+
+	/* Slices not yet in the list are simply appended */
+	if (i < store->num_lru)
+	{
+		memmove(store->lru + i, store->lru + i + 1,
+				sizeof(DimensionSlice *) * (store->num_lru - i - 1));
+		store->num_lru--;
+	}
+
+	/* The list never holds more slices than there are items */
+	Assert(store->num_lru < store->max_items);
+	store->lru[store->num_lru++] = slice;
+}
+
+/*
+ * Count the number of objects stored under a slice at the given dimension.
+ */
+static int
+subspace_store_count_items(SubspaceStore *store, DimensionSlice *slice, int dimension)
+{
+	DimensionVec *vec;
+	int			count = 0;
+	int			i;
+
+	if (dimension == store->num_dimensions - 1)
+		return 1;
+
+	vec = slice->storage;
+
+	for (i = 0; i < vec->num_slices; i++)
+		count += subspace_store_count_items(store, vec->slices[i], dimension + 1);
+
+	return count;
+}
+
+/*
+ * Evict least recently used slices of the first dimension until there is room
+ * for another object. The slice that the new object will be added under is
+ * never evicted, so the store can temporarily hold more objects than the limit
+ * if a single slice holds them all.
+ */
+static void
+subspace_store_evict(SubspaceStore *store, const DimensionSlice *target)
+{
+	int			i = 0;
+
+	while (store->num_items >= store->max_items && i < store->num_lru)
+	{
+		DimensionSlice *victim = store->lru[i];
+		int			index;
+
+		if (victim->fd.range_start == target->fd.range_start &&
+			victim->fd.range_end == target->fd.range_end)
+		{
+			i++;
+			continue;
+		}
+
+		for (index = 0; index < store->origin->num_slices; index++)
+			if (store->origin->slices[index] == victim)
+				break;
+
+		Assert(index < store->origin->num_slices);
+
+		store->num_items -= subspace_store_count_items(store, victim, 0);
+		memmove(store->lru + i, store->lru + i + 1,
+				sizeof(DimensionSlice *) * (store->num_lru - i - 1));
+		store->num_lru--;
+		dimension_vec_remove_slice(&store->origin, index);
+	}
+}
+
 void
 subspace_store_add(SubspaceStore *store, const Hypercube *hc,
 				   void *object, void (*object_free) (void *))
@@ -57,6 +164,9 @@ subspace_store_add(SubspaceStore *store, const Hypercube *hc,
 
 	Assert(hc->num_slices == store->num_dimensions);
 
+	if (store->max_items > 0)
+		subspace_store_evict(store, hc->slices[0]);
+
 	for (i = 0; i < hc->num_slices; i++)
 	{
 		const DimensionSlice *target = hc->slices[i];
@@ -80,23 +190,15 @@ subspace_store_add(SubspaceStore *store, const Hypercube *hc,
 
 		if (match == NULL)
 		{
-			DimensionSlice *copy;
-
-			if (i == 0 && vec->num_slices > 0)
-			{
-				/*
-				 * At dimension 0 only keep one slice. This is an optimization
-				 * to prevent this store from growing too large.
-				 */
-				Assert(1 == vec->num_slices);
-				dimension_vec_remove_slice(vecptr, 0);
-			}
-			copy = dimension_slice_copy(target);
+			DimensionSlice *copy = dimension_slice_copy(target);
 
 			dimension_vec_add_slice_sort(vecptr, copy);
 			match = copy;
 		}
 
+		if (i == 0)
+			subspace_store_lru_touch(store, match);
+
 		last = match;
 		/* internal nodes point to the next dimension's vector */
 		vecptr = (DimensionVec **) &last->storage;
@@ -105,6 +207,7 @@ subspace_store_add(SubspaceStore *store, const Hypercube *hc,
 	Assert(last != NULL && last->storage == NULL);
 	last->storage = object;		/* at the end we store the object */
 	last->storage_free = object_free;
+	store->num_items++;
 	MemoryContextSwitchTo(old);
 }
 
@@ -125,6 +228,9 @@ subspace_store_get(SubspaceStore *store, Point *target)
 		if (NULL == match)
 			return NULL;
 
+		if (i == 0)
+			subspace_store_lru_touch(store, match);
+
 		vec = match->storage;
 	}
 	Assert(match != NULL);
@@ -135,6 +241,10 @@ void
 subspace_store_free(SubspaceStore *store)
 {
 	dimension_vec_free(store->origin);
+
+	if (NULL != store->lru)
+		pfree(store->lru);
+
 	pfree(store);
 }
 
@@ -13,7 +13,10 @@ typedef struct Hypercube Hypercube;
 typedef struct Point Point;
 typedef struct SubspaceStore SubspaceStore;
 
-extern SubspaceStore *subspace_store_init(int16 num_dimensions, MemoryContext mcxt);
+/* Create a store. If max_items is greater than zero, the store evicts the least
+ * recently used subspaces (along the first dimension) to stay within the
+ * limit. */
+extern SubspaceStore *subspace_store_init(int16 num_dimensions, MemoryContext mcxt, int max_items);
 
 /* Store an object associate with the subspace represented by a hypercube */
 extern void subspace_store_add(SubspaceStore *cache, const Hypercube *hc,
@@ -204,6 +204,33 @@ time_value_to_internal(Datum time_val, Oid type)
 	return -1;
 }
 
+Datum
+internal_to_time_value(int64 value, Oid type)
+{
+	Datum		timestamp;
+
+	switch (type)
+	{
+		case INT2OID:
+			return Int16GetDatum((int16) value);
+		case INT4OID:
+			return Int32GetDatum((int32) value);
+		case INT8OID:
+			return Int64GetDatum(value);
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			return DirectFunctionCall1(pg_unix_microseconds_to_timestamp, Int64GetDatum(value));
+		case DATEOID:
+			timestamp = DirectFunctionCall1(pg_unix_microseconds_to_timestamp, Int64GetDatum(value));
+			return DirectFunctionCall1(timestamp_date, timestamp);
+		default:
+			break;
+	}
+
+	elog(ERROR, "unkown time type oid '%d'", type);
+	return (Datum) 0;
+}
+
 /* Make a RangeVar from a regclass Oid */
 RangeVar *
 makeRangeVarFromRelid(Oid relid)
@@ -246,7 +273,7 @@ create_fmgr(char *schema, char *function_name, int num_args)
 	return finfo;
 }
 
-static inline int64
+int64
 get_interval_period(Interval *interval)
 {
 	if (interval->month != 0)
@@ -3,12 +3,28 @@
 
 #include "fmgr.h"
 #include "nodes/primnodes.h"
+#include "datatype/timestamp.h"
 
 /*
  * Convert a column value into the internal time representation.
  */
 extern int64 time_value_to_internal(Datum time_val, Oid type);
 
+/*
+ * Convert an internal time value back into a value of the given time type.
+ */
+extern Datum internal_to_time_value(int64 value, Oid type);
+
+/*
+ * Get the length of an interval in microseconds (or seconds with float
+ * timestamps).
+ */
+extern int64 get_interval_period(Interval *interval);
+
+extern Datum timestamp_bucket(PG_FUNCTION_ARGS);
+extern Datum timestamptz_bucket(PG_FUNCTION_ARGS);
+extern Datum date_bucket(PG_FUNCTION_ARGS);
+
 #if 0
 #define CACHE1_elog(a,b)				elog(a,b)
 #define CACHE2_elog(a,b,c)				elog(a,b,c)
@@ -0,0 +1,30 @@
+# Two sessions insert the first rows of the same new chunk concurrently.
+# The second session waits for the chunk creation lock of the first and
+# uses its chunk, or creates the chunk itself if the first one aborts.
+setup
+{
+  CREATE TABLE chunk_create_test(time int NOT NULL, device int, temp float);
+  DO $$ BEGIN PERFORM create_hypertable('chunk_create_test', 'time', chunk_time_interval => 10); END $$;
+}
+
+teardown
+{
+  DROP TABLE chunk_create_test;
+}
+
+session "s1"
+setup		{ BEGIN; }
+step "s1a"	{ INSERT INTO chunk_create_test VALUES (1, 1, 1.0); }
+step "s1c"	{ COMMIT; }
+step "s1r"	{ ROLLBACK; }
+
+session "s2"
+setup		{ BEGIN; }
+step "s2a"	{ INSERT INTO chunk_create_test VALUES (2, 2, 2.0); }
+step "s2c"	{ COMMIT; }
+
+session "s3"
+step "s3_chunks"	{ SELECT count(*) AS chunks, (SELECT count(*) FROM chunk_create_test) AS num_rows FROM _timescaledb_catalog.chunk; }
+
+permutation "s1a" "s2a" "s1c" "s2c" "s3_chunks"
+permutation "s1a" "s2a" "s1r" "s2c" "s3_chunks"
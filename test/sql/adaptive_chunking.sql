@@ -0,0 +1,32 @@
+CREATE TABLE readings(time int NOT NULL, value float);
+SELECT create_hypertable('readings', 'time', chunk_time_interval => 10);
+SELECT set_adaptive_chunk_sizing('readings', '1MB');
+SELECT chunk_target_size FROM _timescaledb_catalog.hypertable;
+
+-- The first chunk has no predecessors to adapt the interval from
+INSERT INTO readings SELECT t, t FROM generate_series(0, 9) t;
+SELECT interval_length FROM _timescaledb_catalog.dimension;
+
+-- The first chunk is far smaller than the target, so the interval grows
+INSERT INTO readings VALUES (10, 10);
+SELECT interval_length > 10 AS grown FROM _timescaledb_catalog.dimension;
+
+-- With a smaller target, the interval shrinks again. The second chunk is
+-- too sparse to be taken into account.
+SELECT set_adaptive_chunk_sizing('readings', '8kB');
+INSERT INTO readings VALUES (100000, 0);
+SELECT interval_length < 10 AS shrunk FROM _timescaledb_catalog.dimension;
+
+-- Without a target size, the interval is kept
+SELECT set_adaptive_chunk_sizing('readings', 'off');
+SELECT interval_length AS shrunk_interval FROM _timescaledb_catalog.dimension \gset
+INSERT INTO readings SELECT t, t FROM generate_series(200000, 200100) t;
+SELECT interval_length = :shrunk_interval AS kept FROM _timescaledb_catalog.dimension;
+
+SELECT set_adaptive_chunk_sizing('readings') > 0 AS estimated;
+
+CREATE TABLE plain(time int NOT NULL);
+\set ON_ERROR_STOP 0
+SELECT set_adaptive_chunk_sizing('plain', '1MB');
+SELECT set_adaptive_chunk_sizing('readings', 'lots');
+\set ON_ERROR_STOP 1
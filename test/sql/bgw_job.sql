@@ -0,0 +1,45 @@
+CREATE TABLE conditions(time timestamptz NOT NULL, device int, temperature float);
+SELECT create_hypertable('conditions', 'time', chunk_time_interval => interval '1 day');
+CREATE INDEX conditions_device_time_idx ON conditions(device, time);
+INSERT INTO conditions
+SELECT t, 1, 1 FROM generate_series(now() - interval '10 days', now(), interval '1 day') t;
+SELECT count(*) FROM _timescaledb_catalog.chunk;
+
+SELECT add_drop_chunks_policy('conditions', interval '5 days');
+SELECT add_analyze_policy('conditions', interval '1 hour');
+SELECT add_reorder_policy('conditions', 'conditions_device_time_idx');
+SELECT id, job_type, hypertable_id, schedule_interval, max_runtime, max_retries, retry_period, older_than, index_name
+FROM _timescaledb_catalog.bgw_job ORDER BY id;
+
+CREATE TABLE plain(time timestamptz NOT NULL);
+\set ON_ERROR_STOP 0
+SELECT add_analyze_policy('plain');
+-- Only one job of each type per hypertable
+SELECT add_analyze_policy('conditions');
+SELECT add_reorder_policy('plain', 'conditions_device_time_idx');
+SELECT add_reorder_policy('conditions', 'missing_idx');
+SELECT delete_job(42);
+\set ON_ERROR_STOP 1
+
+-- Run the jobs inline, as the scheduler would in a background worker
+SELECT _timescaledb_internal.run_job(1);
+SELECT count(*) FROM _timescaledb_catalog.chunk;
+SELECT _timescaledb_internal.run_job(2);
+SELECT _timescaledb_internal.run_job(3);
+SELECT count(*) FROM pg_index WHERE indisclustered;
+SELECT job_id, last_run_success, total_runs, total_successes, total_failures, total_crashes,
+       consecutive_failures, last_finish >= last_start AS finished, next_start > last_start AS scheduled
+FROM _timescaledb_catalog.bgw_job_stat ORDER BY job_id;
+
+SELECT alter_job_schedule(2, max_retries => 3, retry_period => interval '1 minute');
+SELECT max_retries, retry_period FROM _timescaledb_catalog.bgw_job WHERE id = 2;
+
+-- Deleting a job also deletes its stats
+SELECT delete_job(2);
+SELECT id FROM _timescaledb_catalog.bgw_job ORDER BY id;
+SELECT job_id FROM _timescaledb_catalog.bgw_job_stat ORDER BY job_id;
+
+-- Dropping the hypertable drops its jobs
+DROP TABLE conditions;
+SELECT count(*) FROM _timescaledb_catalog.bgw_job;
+SELECT count(*) FROM _timescaledb_catalog.bgw_job_stat;
@@ -0,0 +1,47 @@
+CREATE TABLE precreate_test(time integer NOT NULL, temp float8, device integer);
+SELECT create_hypertable('precreate_test', 'time', 'device', 2, chunk_time_interval => 10);
+
+-- No chunks, so nothing to pre-create
+SELECT _timescaledb_internal.precreate_chunks('precreate_test');
+
+SET timescaledb.chunk_precreate_threshold = 0.5;
+INSERT INTO precreate_test VALUES (12, 20.1, 1);
+
+-- The interval [10, 20) is only 20% filled
+SELECT _timescaledb_internal.precreate_chunks('precreate_test');
+
+INSERT INTO precreate_test VALUES (16, 21.3, 1);
+
+-- The interval is 60% filled, so the chunks for [20, 30) should be
+-- created for both space partitions
+SELECT _timescaledb_internal.precreate_chunks('precreate_test');
+
+-- The pre-created chunks are empty, so nothing more is created
+SELECT _timescaledb_internal.precreate_chunks('precreate_test');
+
+SELECT c.table_name AS chunk_name, ds.range_start, ds.range_end
+FROM _timescaledb_catalog.chunk c
+INNER JOIN _timescaledb_catalog.chunk_constraint cc ON (c.id = cc.chunk_id)
+INNER JOIN _timescaledb_catalog.dimension_slice ds ON (ds.id = cc.dimension_slice_id)
+INNER JOIN _timescaledb_catalog.dimension d ON (d.id = ds.dimension_id)
+WHERE d.column_name = 'time'
+ORDER BY c.id;
+
+-- New data goes into the pre-created chunks
+INSERT INTO precreate_test VALUES (25, 22.4, 1), (26, 19.8, 2);
+SELECT count(*) FROM _timescaledb_catalog.chunk;
+SELECT * FROM precreate_test ORDER BY time;
+
+-- A pre-creation policy pre-creates the chunks in a background job. The
+-- interval [20, 30) is 60% filled, so the chunks for [30, 40) are created.
+SELECT add_precreate_chunks_policy('precreate_test');
+SELECT _timescaledb_internal.run_job(1);
+SELECT count(*) FROM _timescaledb_catalog.chunk;
+SELECT job_id, last_run_success, total_runs FROM _timescaledb_catalog.bgw_job_stat;
+
+RESET timescaledb.chunk_precreate_threshold;
+
+\set ON_ERROR_STOP 0
+CREATE TABLE plain_table(time integer);
+SELECT _timescaledb_internal.precreate_chunks('plain_table');
+\set ON_ERROR_STOP 1
@@ -0,0 +1,80 @@
+CREATE TABLE metrics(time bigint NOT NULL, seq bigint, value float);
+SELECT create_hypertable('metrics', 'time', chunk_time_interval => 100, create_default_indexes => false);
+INSERT INTO metrics SELECT t, t + 1000, t FROM generate_series(0, 299) t;
+
+-- Enabling chunk skipping computes the stats of existing chunks
+SELECT enable_chunk_skipping('metrics', 'seq');
+SELECT chunk_id, column_name, min_value, max_value, null_count, valid
+FROM _timescaledb_catalog.chunk_column_stats ORDER BY chunk_id, column_name;
+
+-- Chunks whose range of values cannot match are excluded
+EXPLAIN (costs off) SELECT * FROM metrics WHERE seq > 1250;
+SELECT count(*), min(time) FROM metrics WHERE seq > 1250;
+
+-- Inserts widen the stats of their chunk
+INSERT INTO metrics VALUES (50, 5000, 0);
+EXPLAIN (costs off) SELECT * FROM metrics WHERE seq > 1250;
+SELECT count(*), min(time) FROM metrics WHERE seq > 1250;
+
+-- New chunks get stats, which also count NULLs
+INSERT INTO metrics VALUES (350, NULL, 0);
+SELECT chunk_id, column_name, min_value, max_value, null_count, valid
+FROM _timescaledb_catalog.chunk_column_stats ORDER BY chunk_id, column_name;
+EXPLAIN (costs off) SELECT * FROM metrics WHERE seq IS NULL;
+SELECT * FROM metrics WHERE seq IS NULL;
+
+-- Updates of the column and direct inserts into chunks invalidate the stats
+UPDATE metrics SET seq = 0 WHERE time = 10;
+INSERT INTO _timescaledb_internal._hyper_1_2_chunk VALUES (150, 1, 0);
+SELECT chunk_id, column_name, min_value, max_value, null_count, valid
+FROM _timescaledb_catalog.chunk_column_stats ORDER BY chunk_id, column_name;
+SELECT * FROM metrics WHERE seq < 1100 ORDER BY seq LIMIT 2;
+
+-- Renaming the column renames its stats
+ALTER TABLE metrics RENAME COLUMN seq TO sequence;
+SELECT * FROM _timescaledb_catalog.hypertable_column_stats;
+SELECT DISTINCT column_name FROM _timescaledb_catalog.chunk_column_stats;
+
+\set ON_ERROR_STOP 0
+ALTER TABLE metrics ALTER COLUMN sequence TYPE int;
+SELECT enable_chunk_skipping('metrics', 'sequence');
+SELECT enable_chunk_skipping('metrics', 'value');
+SELECT enable_chunk_skipping('metrics', 'foo');
+SELECT disable_chunk_skipping('metrics', 'value');
+\set ON_ERROR_STOP 1
+
+-- Disabling chunk skipping removes the stats
+SELECT disable_chunk_skipping('metrics', 'sequence');
+SELECT count(*) FROM _timescaledb_catalog.chunk_column_stats;
+EXPLAIN (costs off) SELECT * FROM metrics WHERE sequence > 1250;
+
+-- Stats of existing chunks are recomputed when enabling again
+SELECT enable_chunk_skipping('metrics', 'sequence');
+SELECT chunk_id, column_name, min_value, max_value, null_count, valid
+FROM _timescaledb_catalog.chunk_column_stats ORDER BY chunk_id, column_name;
+
+-- Dropping the column removes its stats
+ALTER TABLE metrics DROP COLUMN sequence;
+SELECT count(*) FROM _timescaledb_catalog.hypertable_column_stats;
+SELECT count(*) FROM _timescaledb_catalog.chunk_column_stats;
+
+-- Bloom filters allow skipping chunks on equality restrictions of
+-- high-cardinality columns of any hashable type
+CREATE TABLE readings(time bigint NOT NULL, device text, value float);
+SELECT create_hypertable('readings', 'time', chunk_time_interval => 100, create_default_indexes => false);
+INSERT INTO readings SELECT t, 'dev' || (t / 100), t FROM generate_series(0, 299) t;
+
+\set ON_ERROR_STOP 0
+SELECT enable_chunk_skipping('readings', 'device');
+\set ON_ERROR_STOP 1
+SELECT enable_chunk_skipping('readings', 'device', bloom_filter => true);
+SELECT chunk_id, column_name, null_count, valid, length(bloom_filter)
+FROM _timescaledb_catalog.chunk_column_stats ORDER BY chunk_id, column_name;
+EXPLAIN (costs off) SELECT * FROM readings WHERE device = 'dev1';
+SELECT count(*) FROM readings WHERE device = 'dev1';
+
+-- Inserted values are added to the Bloom filter of their chunk
+INSERT INTO readings VALUES (250, 'dev7', 0);
+EXPLAIN (costs off) SELECT * FROM readings WHERE device IN ('dev0', 'dev7');
+SELECT * FROM readings WHERE device IN ('dev0', 'dev7') AND time > 90 ORDER BY time;
+EXPLAIN (costs off) SELECT * FROM readings WHERE device = 'dev9';
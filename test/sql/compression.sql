@@ -0,0 +1,78 @@
+CREATE TABLE readings(time bigint NOT NULL, device int, value float);
+SELECT create_hypertable('readings', 'time', chunk_time_interval => 2000, create_default_indexes => false);
+INSERT INTO readings SELECT t, t % 4, t * 0.5 FROM generate_series(0, 3999) t;
+SELECT device, count(*), sum(value), min(time), max(time) FROM readings GROUP BY device ORDER BY device;
+
+-- Compress the first chunk, with one batch per device
+SELECT compress_chunk('_timescaledb_internal._hyper_1_1_chunk', ARRAY['device']);
+SELECT chunk_id, table_name, num_rows FROM _timescaledb_catalog.compressed_chunk;
+SELECT device, _ts_meta_count, _ts_meta_min, _ts_meta_max
+FROM _timescaledb_internal._compressed_hyper_1_1_chunk ORDER BY device;
+
+-- Queries on the compressed chunk decompress its batches
+EXPLAIN (costs off) SELECT * FROM readings WHERE time < 1000;
+SELECT device, count(*), sum(value), min(time), max(time) FROM readings GROUP BY device ORDER BY device;
+SELECT * FROM readings WHERE time >= 998 AND time < 1003 ORDER BY time;
+
+-- Batches that cannot match are skipped, also for comparisons with
+-- constants of another type than the time column
+SELECT * FROM test.explain_analyze('SELECT * FROM readings WHERE time > 1998');
+SELECT * FROM test.explain_analyze('SELECT * FROM readings WHERE time <= 2::bigint');
+
+-- Rows inserted after compression are stored in the chunk's table
+INSERT INTO readings VALUES (1, 5, 100);
+SELECT * FROM readings WHERE device = 5;
+
+-- Rows of other chunks can still be modified
+UPDATE readings SET value = 0 WHERE time = 3999;
+
+\set ON_ERROR_STOP 0
+UPDATE readings SET value = 0 WHERE time = 1;
+DELETE FROM readings WHERE time < 10;
+SELECT * FROM readings WHERE time = 1 FOR UPDATE;
+SELECT compress_chunk('_timescaledb_internal._hyper_1_1_chunk');
+SELECT compress_chunk('readings');
+SELECT decompress_chunk('_timescaledb_internal._hyper_1_2_chunk');
+\set ON_ERROR_STOP 1
+
+-- Decompressing moves the rows back into the chunk
+SELECT decompress_chunk('_timescaledb_internal._hyper_1_1_chunk');
+SELECT count(*) FROM _timescaledb_catalog.compressed_chunk;
+EXPLAIN (costs off) SELECT * FROM readings WHERE time < 1000;
+SELECT device, count(*), sum(value), min(time), max(time) FROM readings GROUP BY device ORDER BY device;
+
+-- Dropping a compressed chunk drops its compressed data
+SELECT compress_chunk('_timescaledb_internal._hyper_1_1_chunk');
+SELECT drop_chunks(2000, 'readings');
+SELECT count(*) FROM _timescaledb_catalog.compressed_chunk;
+SELECT relname FROM pg_class WHERE relname LIKE '\_compressed%';
+
+-- Unique indexes do not cover the rows of compressed batches
+CREATE TABLE readings_unique(time bigint NOT NULL, device int, value float, UNIQUE (time, device));
+SELECT create_hypertable('readings_unique', 'time', chunk_time_interval => 2000);
+INSERT INTO readings_unique VALUES (1, 1, 1), (2001, 1, 1);
+SELECT compress_chunk('_timescaledb_internal._hyper_2_3_chunk');
+
+\set ON_ERROR_STOP 0
+INSERT INTO readings_unique VALUES (1, 1, 2);
+INSERT INTO readings_unique VALUES (1, 1, 2) ON CONFLICT DO NOTHING;
+\set ON_ERROR_STOP 1
+
+-- Chunks that are not compressed still take inserts
+INSERT INTO readings_unique VALUES (2002, 1, 1);
+SELECT * FROM readings_unique ORDER BY time;
+
+-- Renaming a column also renames it in the compressed tables
+ALTER TABLE readings_unique RENAME COLUMN value TO reading;
+SELECT * FROM readings_unique ORDER BY time;
+
+-- Compressed data cannot be converted or get a default for a new column
+\set ON_ERROR_STOP 0
+ALTER TABLE readings_unique ALTER COLUMN reading TYPE numeric;
+ALTER TABLE readings_unique ADD COLUMN note text DEFAULT 'none';
+ALTER TABLE readings_unique ADD COLUMN note text NOT NULL;
+\set ON_ERROR_STOP 1
+
+-- New columns without a default read as NULL in compressed chunks
+ALTER TABLE readings_unique ADD COLUMN note text;
+SELECT * FROM readings_unique ORDER BY time;
@@ -0,0 +1,54 @@
+-- A stable function that cannot be constified at planning time, which
+-- makes the planner use ConstraintAwareAppend
+CREATE OR REPLACE FUNCTION stable_int(i bigint)
+RETURNS bigint LANGUAGE PLPGSQL STABLE AS
+$BODY$
+BEGIN
+    RETURN i;
+END;
+$BODY$;
+
+CREATE TABLE hyper(time bigint NOT NULL, value float);
+SELECT create_hypertable('hyper', 'time', chunk_time_interval => 10, create_default_indexes => false);
+INSERT INTO hyper SELECT t, t FROM generate_series(0, 49) t;
+
+-- Chunks are excluded by matching the restrictions on the time
+-- dimension against the chunks' slices
+EXPLAIN (costs off) SELECT * FROM hyper WHERE time < stable_int(15);
+EXPLAIN (costs off) SELECT * FROM hyper WHERE time >= stable_int(20) AND stable_int(30) >= time;
+EXPLAIN (costs off) SELECT * FROM hyper WHERE time > stable_int(100);
+
+-- Clauses on other columns do not prevent exclusion on the time
+-- dimension
+EXPLAIN (costs off) SELECT * FROM hyper WHERE time >= stable_int(30) AND value > stable_int(42);
+
+SELECT count(*) FROM hyper WHERE time < stable_int(15);
+SELECT * FROM hyper WHERE time >= stable_int(20) AND stable_int(21) >= time ORDER BY time;
+SELECT * FROM hyper WHERE time >= stable_int(30) AND value > stable_int(47) ORDER BY time;
+
+-- Join clauses on the time dimension exclude chunks every time the
+-- inner side of a nested loop is rescanned
+CREATE TABLE metrics(time bigint NOT NULL, value float);
+SELECT create_hypertable('metrics', 'time', chunk_time_interval => 2000, create_default_indexes => false);
+CREATE INDEX ON metrics(time);
+INSERT INTO metrics SELECT t, t FROM generate_series(0, 9999) t;
+CREATE TABLE lookup(time bigint);
+INSERT INTO lookup VALUES (100), (4100);
+ANALYZE;
+
+SET enable_hashjoin = 'off';
+SET enable_mergejoin = 'off';
+SET enable_material = 'off';
+EXPLAIN (costs off)
+SELECT m.* FROM lookup l INNER JOIN metrics m ON (m.time = l.time);
+SELECT m.* FROM lookup l INNER JOIN metrics m ON (m.time = l.time) ORDER BY m.time;
+SELECT count(*) FROM lookup l INNER JOIN metrics m ON (m.time >= l.time AND m.time < l.time + 10);
+
+-- Chunk scans initialized on demand give the same results on rescan
+SET timescaledb.lazy_chunk_init = on;
+SELECT m.* FROM lookup l INNER JOIN metrics m ON (m.time = l.time) ORDER BY m.time;
+SELECT count(*) FROM lookup l INNER JOIN metrics m ON (m.time >= l.time AND m.time < l.time + 10);
+RESET timescaledb.lazy_chunk_init;
+RESET enable_hashjoin;
+RESET enable_mergejoin;
+RESET enable_material;
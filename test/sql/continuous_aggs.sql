@@ -0,0 +1,72 @@
+CREATE TABLE conditions(time int NOT NULL, device int, temperature float);
+SELECT create_hypertable('conditions', 'time', chunk_time_interval => 10);
+INSERT INTO conditions SELECT t, t % 2, t FROM generate_series(0, 19) t;
+
+CREATE VIEW conditions_summary AS
+SELECT time_bucket(5, time) AS bucket, device, count(*), max(temperature)
+FROM conditions GROUP BY 1, 2;
+SELECT create_continuous_aggregate('conditions_summary');
+SELECT mat_hypertable_id, raw_hypertable_id, user_view_name, direct_view_name, bucket_width, watermark
+FROM _timescaledb_catalog.continuous_agg;
+
+-- Before the first refresh, all buckets are computed from the hypertable
+SELECT * FROM conditions_summary ORDER BY bucket, device;
+
+-- Refreshing materializes the buckets below the bucket of the greatest
+-- time value
+SELECT refresh_continuous_aggregate('conditions_summary');
+SELECT mat_hypertable_id, raw_hypertable_id, user_view_name, direct_view_name, bucket_width, watermark
+FROM _timescaledb_catalog.continuous_agg;
+SELECT * FROM _timescaledb_internal._materialized_hypertable_2 ORDER BY bucket, device;
+SELECT * FROM conditions_summary ORDER BY bucket, device;
+
+-- Inserts log the range of inserted time values, which is recomputed
+-- on the next refresh
+INSERT INTO conditions VALUES (3, 0, 100);
+SELECT * FROM _timescaledb_catalog.continuous_aggs_invalidation_log;
+SELECT * FROM conditions_summary WHERE bucket = 0 ORDER BY device;
+SELECT refresh_continuous_aggregate('conditions_summary');
+SELECT * FROM _timescaledb_catalog.continuous_aggs_invalidation_log;
+SELECT * FROM conditions_summary WHERE bucket = 0 ORDER BY device;
+
+-- Updates invalidate the ranges of the chunks they modify
+UPDATE conditions SET temperature = 50 WHERE time = 12;
+SELECT refresh_continuous_aggregate('conditions_summary');
+SELECT * FROM conditions_summary WHERE bucket = 10 ORDER BY device;
+
+-- New data moves the watermark forward
+INSERT INTO conditions VALUES (27, 1, 7);
+SELECT refresh_continuous_aggregate('conditions_summary');
+SELECT mat_hypertable_id, raw_hypertable_id, user_view_name, direct_view_name, bucket_width, watermark
+FROM _timescaledb_catalog.continuous_agg;
+SELECT * FROM conditions_summary ORDER BY bucket, device;
+
+\set ON_ERROR_STOP 0
+SELECT create_continuous_aggregate('conditions');
+SELECT refresh_continuous_aggregate('conditions');
+CREATE VIEW conditions_by_device AS
+SELECT device, count(*) FROM conditions GROUP BY device;
+SELECT create_continuous_aggregate('conditions_by_device');
+CREATE VIEW conditions_ordered AS
+SELECT time_bucket(5, time) AS bucket, count(*) FROM conditions GROUP BY 1 ORDER BY 1;
+SELECT create_continuous_aggregate('conditions_ordered');
+\set ON_ERROR_STOP 1
+
+-- Dropping the view drops the materialization and the direct view
+DROP VIEW conditions_summary;
+SELECT count(*) FROM _timescaledb_catalog.continuous_agg;
+SELECT table_name FROM _timescaledb_catalog.hypertable;
+SELECT viewname FROM pg_views WHERE schemaname = '_timescaledb_internal';
+
+-- Restrictions on time_bucket() of the time column exclude chunks
+CREATE TABLE readings(time timestamp NOT NULL, value float);
+SELECT create_hypertable('readings', 'time', chunk_time_interval => interval '1 day', create_default_indexes => false);
+INSERT INTO readings SELECT t, 1 FROM generate_series('2017-05-20'::timestamp, '2017-05-23 23:00', '1 hour') t;
+EXPLAIN (costs off) SELECT * FROM readings WHERE time_bucket('1 day', time) >= '2017-05-22';
+EXPLAIN (costs off) SELECT * FROM readings WHERE time_bucket('1 day', time) < '2017-05-21';
+
+-- A time_bucket() function in another schema does not exclude chunks
+CREATE SCHEMA other;
+CREATE FUNCTION other.time_bucket(bucket_width interval, ts timestamp) RETURNS timestamp
+AS $$ BEGIN RETURN date_trunc('day', ts); END $$ LANGUAGE plpgsql IMMUTABLE;
+EXPLAIN (costs off) SELECT * FROM readings WHERE other.time_bucket('1 day', time) >= '2017-05-22';
@@ -49,3 +49,36 @@ COPY hyper (time, meta_id, value) FROM STDIN DELIMITER ',';
 \set ON_ERROR_STOP 1
 
 COPY (SELECT * FROM hyper ORDER BY time, meta_id) TO STDOUT;
+
+---test COPY that interleaves tuples for several chunks and space partitions
+CREATE TABLE "hyper_interleaved" (
+    "time" bigint NOT NULL,
+    "device" text NOT NULL,
+    "value" double precision NOT NULL
+);
+SELECT create_hypertable('hyper_interleaved', 'time', 'device', 2, chunk_time_interval => 10);
+
+COPY hyper_interleaved FROM STDIN DELIMITER ',';
+1,dev1,1
+11,dev2,2
+2,dev2,3
+12,dev1,4
+\.
+
+--tuples for chunks with BEFORE ROW triggers are inserted one at a time
+CREATE OR REPLACE FUNCTION hyper_interleaved_scale() RETURNS TRIGGER LANGUAGE PLPGSQL AS
+$BODY$
+BEGIN
+    NEW.value = NEW.value * 10;
+    RETURN NEW;
+END
+$BODY$;
+CREATE TRIGGER hyper_interleaved_scale BEFORE INSERT ON hyper_interleaved
+FOR EACH ROW EXECUTE PROCEDURE hyper_interleaved_scale();
+
+COPY hyper_interleaved FROM STDIN DELIMITER ',';
+3,dev1,5
+13,dev2,6
+\.
+
+SELECT * FROM hyper_interleaved ORDER BY time, device;
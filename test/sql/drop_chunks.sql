@@ -160,3 +160,13 @@ BEGIN;
     SELECT * FROM test.show_subtables('drop_chunk_test_date');
 ROLLBACK;
 
+
+-- Dropping chunks only evicts the hypertable that the chunks belong to
+-- from the hypertable cache
+SELECT * FROM drop_chunk_test2 LIMIT 0;
+SELECT * FROM drop_chunk_test_date LIMIT 0;
+SELECT _timescaledb_cache.hypertable_cache_has_entry('drop_chunk_test2') AS test2_cached,
+       _timescaledb_cache.hypertable_cache_has_entry('drop_chunk_test_date') AS test_date_cached;
+SELECT drop_chunks(interval '1 day', 'drop_chunk_test_date');
+SELECT _timescaledb_cache.hypertable_cache_has_entry('drop_chunk_test2') AS test2_cached,
+       _timescaledb_cache.hypertable_cache_has_entry('drop_chunk_test_date') AS test_date_cached;
@@ -76,3 +76,30 @@ INSERT INTO one_space_test VALUES
 ('2001-01-01 01:01:01', 1.0, 'device'),
 ('2002-01-01 01:02:01', 1.0, 'device');
 SELECT * FROM one_space_test;
+
+--test batched dispatch of tuples to chunks
+CREATE TABLE batch_insert_test(time bigint NOT NULL, temp float8, device text NOT NULL);
+SELECT create_hypertable('batch_insert_test', 'time', 'device', 2, chunk_time_interval => 10);
+SET timescaledb.insert_batch_size = 4;
+INSERT INTO batch_insert_test VALUES
+(1, 1.0, 'dev1'),
+(11, 2.0, 'dev2'),
+(2, 3.0, 'dev2'),
+(12, 4.0, 'dev1'),
+(3, 5.0, 'dev1'),
+(21, 6.0, 'dev2');
+INSERT INTO batch_insert_test
+SELECT t, t, 'dev' || (t % 3) FROM generate_series(1, 30) t;
+RESET timescaledb.insert_batch_size;
+SELECT count(*), sum(temp) FROM batch_insert_test;
+SELECT * FROM batch_insert_test WHERE time < 4 ORDER BY time, device, temp;
+
+--test out-of-order inserts with a bounded number of open chunks
+SET timescaledb.max_open_chunks_per_insert = 1;
+INSERT INTO batch_insert_test VALUES
+(25, 1.0, 'dev1'),
+(5, 1.0, 'dev2'),
+(26, 1.0, 'dev2'),
+(6, 1.0, 'dev1');
+RESET timescaledb.max_open_chunks_per_insert;
+SELECT count(*) FROM batch_insert_test;
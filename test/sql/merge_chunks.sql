@@ -0,0 +1,44 @@
+CREATE TABLE conditions(time int NOT NULL, junk int, device int, temperature float);
+SELECT create_hypertable('conditions', 'time', chunk_time_interval => 10);
+CREATE INDEX conditions_device_time_idx ON conditions(device, time);
+INSERT INTO conditions SELECT t, 0, t % 3, t FROM generate_series(0, 19) t;
+
+-- Chunks created after a column is dropped have a different row layout
+ALTER TABLE conditions DROP COLUMN junk;
+INSERT INTO conditions SELECT t, t % 3, t FROM generate_series(20, 29) t;
+SELECT c.table_name, ds.range_start, ds.range_end
+FROM _timescaledb_catalog.chunk c
+INNER JOIN _timescaledb_catalog.chunk_constraint cc ON (cc.chunk_id = c.id)
+INNER JOIN _timescaledb_catalog.dimension_slice ds ON (ds.id = cc.dimension_slice_id)
+ORDER BY c.id;
+
+-- The rows are merged into the chunk with the lowest range, whose range
+-- and constraint are extended, and the other chunks are dropped
+SELECT merge_chunks(ARRAY['_timescaledb_internal._hyper_1_2_chunk', '_timescaledb_internal._hyper_1_1_chunk', '_timescaledb_internal._hyper_1_3_chunk']::regclass[]);
+SELECT c.table_name, ds.range_start, ds.range_end
+FROM _timescaledb_catalog.chunk c
+INNER JOIN _timescaledb_catalog.chunk_constraint cc ON (cc.chunk_id = c.id)
+INNER JOIN _timescaledb_catalog.dimension_slice ds ON (ds.id = cc.dimension_slice_id)
+ORDER BY c.id;
+SELECT conname, consrc FROM pg_constraint
+WHERE conrelid = '_timescaledb_internal._hyper_1_1_chunk'::regclass ORDER BY conname;
+SELECT * FROM _timescaledb_catalog.chunk_index ORDER BY index_name;
+SELECT count(*), sum(time), sum(device), sum(temperature) FROM conditions;
+
+-- The indexes of the merged chunk were rebuilt
+SET enable_seqscan = false;
+SELECT time, device FROM conditions WHERE device = 1 AND time > 20 ORDER BY time;
+RESET enable_seqscan;
+
+-- Inserts into the merged range go to the merged chunk
+INSERT INTO conditions VALUES (15, 0, 15);
+SELECT count(*) FROM _timescaledb_catalog.chunk;
+SELECT count(*) FROM _timescaledb_internal._hyper_1_1_chunk;
+
+INSERT INTO conditions VALUES (50, 0, 50);
+\set ON_ERROR_STOP 0
+SELECT merge_chunks(ARRAY['_timescaledb_internal._hyper_1_1_chunk']::regclass[]);
+SELECT merge_chunks(ARRAY['conditions', '_timescaledb_internal._hyper_1_1_chunk']::regclass[]);
+SELECT merge_chunks(ARRAY['_timescaledb_internal._hyper_1_1_chunk', '_timescaledb_internal._hyper_1_1_chunk']::regclass[]);
+SELECT merge_chunks(ARRAY['_timescaledb_internal._hyper_1_1_chunk', '_timescaledb_internal._hyper_1_4_chunk']::regclass[]);
+\set ON_ERROR_STOP 1
@@ -0,0 +1,36 @@
+CREATE OR REPLACE FUNCTION stable_int(i bigint)
+RETURNS bigint LANGUAGE PLPGSQL STABLE AS
+$BODY$
+BEGIN
+    RETURN i;
+END;
+$BODY$;
+
+CREATE TABLE ordered(time bigint NOT NULL, value float);
+SELECT create_hypertable('ordered', 'time', chunk_time_interval => 10, create_default_indexes => false);
+CREATE INDEX ON ordered(time);
+INSERT INTO ordered SELECT t, t FROM generate_series(0, 49) t;
+ANALYZE;
+
+SET timescaledb.ordered_append = on;
+
+-- Chunks are scanned one after the other in the order of their time
+-- slices instead of being merged
+EXPLAIN (costs off) SELECT * FROM ordered ORDER BY time DESC LIMIT 3;
+SELECT * FROM ordered ORDER BY time DESC LIMIT 3;
+
+EXPLAIN (costs off) SELECT * FROM ordered ORDER BY time LIMIT 3;
+SELECT * FROM ordered ORDER BY time LIMIT 3;
+
+-- Chunks are excluded at execution time without changing the order
+EXPLAIN (costs off) SELECT * FROM ordered WHERE time > stable_int(25) ORDER BY time DESC LIMIT 3;
+SELECT * FROM ordered WHERE time > stable_int(25) ORDER BY time LIMIT 3;
+
+-- Chunk scans are initialized when the scan reaches them
+SET timescaledb.lazy_chunk_init = on;
+SELECT * FROM ordered ORDER BY time DESC LIMIT 3;
+SELECT * FROM ordered WHERE time > stable_int(25) ORDER BY time LIMIT 3;
+SELECT count(*) FROM ordered WHERE time > stable_int(15);
+RESET timescaledb.lazy_chunk_init;
+
+RESET timescaledb.ordered_append;
@@ -46,3 +46,35 @@ SELECT histogram(i, 0, 100000, 5) FROM "test";
 
 EXPLAIN (costs off) SELECT histogram(i, 10,100000,5) FROM "test";
 SELECT histogram(i, 10, 100000, 5) FROM "test";
+
+--test parallel scans of hypertables with chunk exclusion at execution time
+CREATE TABLE test_ht (i int, j double precision, ts timestamp NOT NULL);
+SELECT create_hypertable('test_ht', 'ts', chunk_time_interval => interval '5 minutes', create_default_indexes => false);
+INSERT INTO test_ht SELECT * FROM "test";
+
+SET client_min_messages = 'error';
+ANALYZE test_ht;
+RESET client_min_messages;
+
+--the cast to timestamp is stable, so chunks are excluded at execution time
+EXPLAIN (costs off)
+SELECT count(*) FROM test_ht WHERE ts > '1969-12-31 16:10:00'::timestamptz::timestamp;
+SELECT count(*) FROM test_ht WHERE ts > '1969-12-31 16:10:00'::timestamptz::timestamp;
+
+--run the query to make sure workers scan the chunks. Row counts per process
+--vary, so only show the plan.
+CREATE OR REPLACE FUNCTION explain_parallel(query text) RETURNS SETOF text
+LANGUAGE plpgsql AS
+$BODY$
+DECLARE
+    ln text;
+BEGIN
+    FOR ln IN EXECUTE format('EXPLAIN (analyze, costs off, timing off) %s', query)
+    LOOP
+        CONTINUE WHEN ln ~ '(Planning|Execution) [Tt]ime|Rows Removed by Filter';
+        RETURN NEXT regexp_replace(ln, 'rows=\d+ loops=\d+', 'rows=N loops=N');
+    END LOOP;
+END
+$BODY$;
+
+SELECT * FROM explain_parallel($$SELECT count(*) FROM test_ht WHERE ts > '1969-12-31 16:10:00'::timestamptz::timestamp$$);
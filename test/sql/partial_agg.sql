@@ -0,0 +1,19 @@
+CREATE TABLE metrics(time bigint NOT NULL, value float);
+SELECT create_hypertable('metrics', 'time', chunk_time_interval => 2000, create_default_indexes => false);
+INSERT INTO metrics SELECT t, t FROM generate_series(0, 9999) t;
+ANALYZE;
+
+SET timescaledb.chunk_partial_aggregation = on;
+
+-- Aggregates are computed per chunk and combined above the append
+EXPLAIN (costs off) SELECT time_bucket(1000, time) AS bucket, count(*), sum(value), last(value, time) FROM metrics GROUP BY bucket;
+SELECT time_bucket(1000, time) AS bucket, count(*), sum(value), last(value, time) FROM metrics GROUP BY bucket ORDER BY bucket;
+SELECT time_bucket(1000, time) AS bucket, count(*), sum(value), last(value, time) FROM metrics GROUP BY bucket HAVING max(time) >= 8000 ORDER BY bucket;
+SET timescaledb.optimize_bookend_aggregates = off;
+SELECT count(*), sum(value), last(value, time) FROM metrics;
+RESET timescaledb.optimize_bookend_aggregates;
+
+-- Results are the same without partial aggregation
+RESET timescaledb.chunk_partial_aggregation;
+SELECT time_bucket(1000, time) AS bucket, count(*), sum(value), last(value, time) FROM metrics GROUP BY bucket ORDER BY bucket;
+SELECT time_bucket(1000, time) AS bucket, count(*), sum(value), last(value, time) FROM metrics GROUP BY bucket HAVING max(time) >= 8000 ORDER BY bucket;
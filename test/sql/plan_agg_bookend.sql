@@ -0,0 +1,41 @@
+CREATE TABLE bookend(time bigint NOT NULL, device int, value float);
+SELECT create_hypertable('bookend', 'time', chunk_time_interval => 10, create_default_indexes => false);
+CREATE INDEX ON bookend(time);
+INSERT INTO bookend SELECT t, t % 3, t FROM generate_series(0, 49) t;
+ANALYZE;
+
+SET timescaledb.ordered_append = on;
+
+-- first() and last() on the time column read only the first row of an
+-- ordered scan of the time index
+EXPLAIN (costs off) SELECT first(value, time), last(value, time) FROM bookend;
+SELECT first(value, time), last(value, time) FROM bookend;
+SELECT first(value, time), last(value, time) FROM bookend WHERE device = 2;
+
+-- No matching rows give NULL, like the aggregates
+SELECT first(value, time), last(value, time) FROM bookend WHERE time < 0;
+
+-- Correlated subqueries are rewritten too
+CREATE TABLE devices(id int);
+INSERT INTO devices VALUES (0), (1), (2), (3);
+SELECT id, (SELECT last(value, time) FROM bookend WHERE device = id) FROM devices ORDER BY id;
+
+-- Results are the same without the rewrite
+SET timescaledb.optimize_bookend_aggregates = off;
+SELECT first(value, time), last(value, time) FROM bookend;
+SELECT id, (SELECT last(value, time) FROM bookend WHERE device = id) FROM devices ORDER BY id;
+RESET timescaledb.optimize_bookend_aggregates;
+
+RESET timescaledb.ordered_append;
+
+-- Without an index on the time column, the aggregates are not rewritten,
+-- since the subqueries would have to sort all rows
+CREATE TABLE bookend_noidx(time bigint NOT NULL, value float);
+SELECT create_hypertable('bookend_noidx', 'time', chunk_time_interval => 10, create_default_indexes => false);
+INSERT INTO bookend_noidx SELECT t, t FROM generate_series(0, 19) t;
+EXPLAIN (costs off) SELECT first(value, time), last(value, time) FROM bookend_noidx;
+SELECT first(value, time), last(value, time) FROM bookend_noidx;
+
+-- Volatile quals would be evaluated separately by each subquery, so the
+-- aggregates are not rewritten
+EXPLAIN (costs off) SELECT first(value, time), last(value, time) FROM bookend WHERE random() >= 0;
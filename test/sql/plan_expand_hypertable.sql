@@ -0,0 +1,45 @@
+CREATE TABLE hyper(time bigint NOT NULL, device int, value float);
+SELECT create_hypertable('hyper', 'time', chunk_time_interval => 10, create_default_indexes => false);
+INSERT INTO hyper SELECT t, t % 3, t FROM generate_series(0, 49) t;
+
+-- Show the chunks of the hypertable that this backend has locked
+CREATE VIEW hyper_locks AS
+SELECT relation::regclass FROM pg_locks
+WHERE locktype = 'relation' AND pid = pg_backend_pid()
+AND relation::regclass::text LIKE '%\_hyper\_%chunk'
+ORDER BY relation;
+
+-- Only chunks that match the restrictions are opened and locked by
+-- the planner
+BEGIN;
+EXPLAIN (costs off) SELECT * FROM hyper WHERE time < 15;
+SELECT * FROM hyper_locks;
+ROLLBACK;
+
+BEGIN;
+EXPLAIN (costs off) SELECT * FROM hyper WHERE time >= 20 AND time <= 30;
+SELECT * FROM hyper_locks;
+ROLLBACK;
+
+BEGIN;
+EXPLAIN (costs off) SELECT * FROM hyper WHERE 42 = time;
+SELECT * FROM hyper_locks;
+ROLLBACK;
+
+-- No matching chunks, only the main table is scanned
+BEGIN;
+EXPLAIN (costs off) SELECT * FROM hyper WHERE time > 100;
+SELECT * FROM hyper_locks;
+ROLLBACK;
+
+-- Without plan-time exclusion, all chunks are locked although the
+-- plan is the same
+SET timescaledb.plan_time_chunk_exclusion = false;
+BEGIN;
+EXPLAIN (costs off) SELECT * FROM hyper WHERE time < 15;
+SELECT * FROM hyper_locks;
+ROLLBACK;
+RESET timescaledb.plan_time_chunk_exclusion;
+
+SELECT count(*) FROM hyper WHERE time < 15;
+SELECT * FROM hyper WHERE time >= 20 AND time <= 21 ORDER BY time;
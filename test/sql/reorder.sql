@@ -0,0 +1,31 @@
+CREATE TABLE conditions(time int NOT NULL, device int, temperature float);
+SELECT create_hypertable('conditions', 'time', chunk_time_interval => 10);
+CREATE INDEX conditions_device_time_idx ON conditions(device, time);
+INSERT INTO conditions SELECT t, t % 3, t FROM generate_series(0, 24) t;
+SELECT ctid, time, device FROM _timescaledb_internal._hyper_1_1_chunk ORDER BY ctid;
+
+-- Reordering rewrites the chunk in index order and marks the index clustered
+SELECT reorder_chunk('_timescaledb_internal._hyper_1_1_chunk', 'conditions_device_time_idx');
+SELECT ctid, time, device FROM _timescaledb_internal._hyper_1_1_chunk ORDER BY ctid;
+SELECT indexrelid::regclass FROM pg_index WHERE indisclustered ORDER BY 1;
+
+-- Without an index, the chunk is reordered by its clustered index
+UPDATE conditions SET temperature = 0 WHERE time = 0;
+SELECT reorder_chunk('_timescaledb_internal._hyper_1_1_chunk');
+SELECT ctid, time, device FROM _timescaledb_internal._hyper_1_1_chunk ORDER BY ctid;
+
+\set ON_ERROR_STOP 0
+SELECT reorder_chunk('conditions', 'conditions_device_time_idx');
+SELECT reorder_chunk('_timescaledb_internal._hyper_1_2_chunk', '_timescaledb_internal._hyper_1_1_chunk_conditions_device_time_idx');
+SELECT reorder_chunk('_timescaledb_internal._hyper_1_2_chunk');
+\set ON_ERROR_STOP 1
+
+-- A reorder policy reorders the chunks of the most recent completed
+-- interval, here the second chunk, and skips reordered chunks. An empty
+-- chunk after the greatest time value does not count as completed.
+INSERT INTO conditions VALUES (45, 0, 45);
+DELETE FROM conditions WHERE time = 45;
+SELECT add_reorder_policy('conditions', 'conditions_device_time_idx');
+SELECT _timescaledb_internal.run_job(1);
+SELECT indexrelid::regclass FROM pg_index WHERE indisclustered ORDER BY 1;
+SELECT ctid, time, device FROM _timescaledb_internal._hyper_1_2_chunk ORDER BY ctid;
@@ -0,0 +1,24 @@
+CREATE TABLE readings(time bigint NOT NULL, device int, value float);
+SELECT create_hypertable('readings', 'time', chunk_time_interval => 2000, create_default_indexes => false);
+CREATE INDEX ON readings(device, time DESC);
+INSERT INTO readings SELECT t, t % 4, t FROM generate_series(0, 9999) t;
+INSERT INTO readings VALUES (5000, NULL, -1);
+ANALYZE;
+
+-- The latest row per device is found by skipping from one device to the
+-- next in the index of each chunk
+EXPLAIN (costs off) SELECT DISTINCT ON (device) device, time, value FROM readings ORDER BY device, time DESC;
+SELECT DISTINCT ON (device) device, time, value FROM readings ORDER BY device, time DESC;
+
+-- Backward scans find the earliest row per device, with NULLs first
+SELECT DISTINCT ON (device) device, time, value FROM readings ORDER BY device DESC, time;
+SELECT DISTINCT ON (device) device, time, value FROM readings WHERE time < 4000 ORDER BY device, time DESC;
+SELECT DISTINCT device FROM readings ORDER BY device;
+
+-- Results are the same without skip scans
+SET timescaledb.skip_scan = off;
+SELECT DISTINCT ON (device) device, time, value FROM readings ORDER BY device, time DESC;
+SELECT DISTINCT ON (device) device, time, value FROM readings ORDER BY device DESC, time;
+SELECT DISTINCT ON (device) device, time, value FROM readings WHERE time < 4000 ORDER BY device, time DESC;
+SELECT DISTINCT device FROM readings ORDER BY device;
+RESET timescaledb.skip_scan;
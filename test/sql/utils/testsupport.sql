@@ -232,3 +232,19 @@ BEGIN
     ORDER BY d.refobjid, d.objid;
 END
 $BODY$;
+
+-- Show the plan of a query with EXPLAIN ANALYZE, without the timing
+-- lines that vary between runs and PostgreSQL versions.
+CREATE OR REPLACE FUNCTION test.explain_analyze(query text)
+RETURNS SETOF text LANGUAGE PLPGSQL AS
+$BODY$
+DECLARE
+    ln text;
+BEGIN
+    FOR ln IN EXECUTE format('EXPLAIN (analyze, costs off, timing off) %s', query)
+    LOOP
+        CONTINUE WHEN ln ~ '^(Planning|Execution) [Tt]ime';
+        RETURN NEXT ln;
+    END LOOP;
+END
+$BODY$;